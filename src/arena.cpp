@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+using namespace std;
+
+Arena::Arena(void) {
+  block_ = 0;
+  offset_ = 0;
+}
+
+Arena::~Arena(void) {
+  unsigned int num_blocks = blocks_.size();
+  for (unsigned int b = 0; b < num_blocks; ++b) {
+    free(blocks_[b]);
+  }
+}
+
+static char *AllocateBlock(size_t num_bytes) {
+  void *p;
+  if (posix_memalign(&p, 64, num_bytes) != 0) {
+    fprintf(stderr, "Arena: posix_memalign of %zu bytes failed\n", num_bytes);
+    exit(-1);
+  }
+  return (char *)p;
+}
+
+void *Arena::Allocate(size_t num_bytes) {
+  // Round up so that the next allocation is aligned.
+  num_bytes = (num_bytes + kAlignment - 1) & ~(kAlignment - 1);
+  if (blocks_.size() == 0) {
+    size_t sz = num_bytes > kBlockSize ? num_bytes : kBlockSize;
+    blocks_.push_back(AllocateBlock(sz));
+    block_sizes_.push_back(sz);
+  }
+  if (offset_ + num_bytes > block_sizes_[block_]) {
+    // Move on to the next block.  Any blocks beyond the current one are
+    // unused, so a block that is too small can simply be replaced.
+    ++block_;
+    offset_ = 0;
+    size_t sz = num_bytes > kBlockSize ? num_bytes : kBlockSize;
+    if (block_ == blocks_.size()) {
+      blocks_.push_back(AllocateBlock(sz));
+      block_sizes_.push_back(sz);
+    } else if (block_sizes_[block_] < num_bytes) {
+      free(blocks_[block_]);
+      blocks_[block_] = AllocateBlock(sz);
+      block_sizes_[block_] = sz;
+    }
+  }
+  void *p = blocks_[block_] + offset_;
+  offset_ += num_bytes;
+  return p;
+}
+
+Arena::Mark Arena::GetMark(void) const {
+  Mark mark;
+  mark.block = block_;
+  mark.offset = offset_;
+  return mark;
+}
+
+void Arena::Release(const Mark &mark) {
+  block_ = mark.block;
+  offset_ = mark.offset;
+}
+
+Arena *Arena::ThreadArena(void) {
+  static thread_local Arena arena;
+  return &arena;
+}
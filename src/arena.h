@@ -0,0 +1,70 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+using namespace std;
+
+// A bump-pointer allocator for the vectors used in a tree walk.  Memory is
+// carved out of large blocks that are kept around after use, so once the
+// arena has grown to the high-water mark of a walk, no further heap
+// allocations take place.  Allocations are released in LIFO order by
+// restoring a previously saved mark; normally this is done with an
+// ArenaFrame at the top of each recursive call.
+//
+// A function that returns a vector from the arena allocates it before
+// creating its own frame, so that the vector lands in the caller's frame.
+// This is how VCFR::Process() returns its values.
+//
+// An Arena is not thread-safe.  Each thread has its own, returned by
+// Arena::ThreadArena().
+class Arena {
+ public:
+  struct Mark {
+    unsigned int block;
+    size_t offset;
+  };
+
+  Arena(void);
+  ~Arena(void);
+  void *Allocate(size_t num_bytes);
+  double *AllocateDoubles(size_t n) {
+    return (double *)Allocate(n * sizeof(double));
+  }
+  double **AllocateDoublePtrs(size_t n) {
+    return (double **)Allocate(n * sizeof(double *));
+  }
+  unsigned int *AllocateUnsignedInts(size_t n) {
+    return (unsigned int *)Allocate(n * sizeof(unsigned int));
+  }
+  bool *AllocateBools(size_t n) {
+    return (bool *)Allocate(n * sizeof(bool));
+  }
+  Mark GetMark(void) const;
+  void Release(const Mark &mark);
+
+  static Arena *ThreadArena(void);
+ private:
+  static const size_t kBlockSize = 1 << 20;
+  static const size_t kAlignment = 64;
+
+  vector<char *> blocks_;
+  vector<size_t> block_sizes_;
+  unsigned int block_;
+  size_t offset_;
+};
+
+// Releases everything allocated from the arena during the lifetime of the
+// frame.
+class ArenaFrame {
+ public:
+  ArenaFrame(Arena *arena) : arena_(arena), mark_(arena->GetMark()) {}
+  ~ArenaFrame(void) {arena_->Release(mark_);}
+ private:
+  Arena *arena_;
+  Arena::Mark mark_;
+};
+
+#endif
@@ -46,6 +46,7 @@
 #include <cmath>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -216,17 +217,20 @@ double *BCBRThread::OurChoice(Node *node, unsigned int lbd,
   } else {
     unsigned int nt = node->NonterminalID();
     unsigned int num_succs = node->NumSuccs();
-    double **succ_card_vals = new double *[num_succs];
+    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    Arena *arena = state.GetArena();
+    // Allocated before the frame so that it survives the return
+    vals = arena->AllocateDoubles(num_hole_card_pairs);
+    ArenaFrame frame(arena);
+    double **succ_card_vals = arena->AllocateDoublePtrs(num_succs);
     for (unsigned int s = 0; s < num_succs; ++s) {
       VCFRState succ_state(state, node, s);
       succ_card_vals[s] = Process(node->IthSucc(s), lbd, succ_state, st);
     }
     
-    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-    vals = new double[num_hole_card_pairs];
     double *alt_vals = nullptr;
     if (st == target_st_) {
-      alt_vals = new double[num_hole_card_pairs];
+      alt_vals = arena->AllocateDoubles(num_hole_card_pairs);
     }
 
     unsigned int **street_buckets = state.StreetBuckets();
@@ -252,11 +256,6 @@ double *BCBRThread::OurChoice(Node *node, unsigned int lbd,
       }
     }
 
-    for (unsigned int s = 0; s < num_succs; ++s) {
-      delete [] succ_card_vals[s];
-    }
-    delete [] succ_card_vals;
-
     if (st == target_st_) {
       unsigned int gbd = 0;
       if (st > 0) {
@@ -428,6 +427,7 @@ void BCBRThread::CardPass(bool first_pass) {
   VCFRState state(opp_probs, street_buckets, trunk_hand_tree_, p_, nullptr,
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
+  ArenaFrame frame(state.GetArena());
   double *vals = Process(betting_tree_->Root(), 0, state, 0);
   DeleteStreetBuckets(street_buckets);
   delete [] opp_probs;
@@ -451,8 +451,6 @@ void BCBRThread::CardPass(bool first_pass) {
     printf("EV: %f\n", ev);
     fflush(stdout);
   }
-
-  delete [] vals;
 }
 
 void BCBRThread::Go(void) {
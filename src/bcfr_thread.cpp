@@ -20,6 +20,7 @@
 #include <cmath>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -153,6 +154,7 @@ void BCFRThread::Go(void) {
   VCFRState state(opp_probs, street_buckets, trunk_hand_tree_, p_, nullptr,
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
+  ArenaFrame frame(state.GetArena());
   double *vals = Process(betting_tree_->Root(), 0, state, 0);
   DeleteStreetBuckets(street_buckets);
   delete [] opp_probs;
@@ -175,8 +177,6 @@ void BCFRThread::Go(void) {
   printf("EV: %f\n", ev);
   fflush(stdout);
 
-  delete [] vals;
-
   time_t end_t = time(NULL);
   double diff_sec = difftime(end_t, start_t);
   fprintf(stderr, "Processing took %.1f seconds\n", diff_sec);
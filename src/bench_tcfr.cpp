@@ -0,0 +1,115 @@
+// Measures TCFR throughput and lost updates at a range of thread counts.
+// Run it once with a CFR config that has AtomicUpdates unset (hogwild) and
+// once with AtomicUpdates true to compare the two modes.
+//
+// Lost updates are measured by comparing the number of sumprob increments
+// performed by the threads with the sum of the sumprobs left in the shared
+// buffer.  This is only exact if no sumprob hits its ceiling during the run.
+// To compare convergence, run run_tcfr with the same configs and evaluate
+// the checkpoints with run_rgbr.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "betting_abstraction.h"
+#include "betting_abstraction_params.h"
+#include "buckets.h"
+#include "card_abstraction.h"
+#include "card_abstraction_params.h"
+#include "cfr_config.h"
+#include "cfr_params.h"
+#include "constants.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "io.h"
+#include "params.h"
+#include "split.h"
+#include "tcfr.h"
+
+using namespace std;
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <card params> <betting params> "
+	  "<CFR params> <thread counts> <batch size> <num batches>\n",
+	  prog_name);
+  fprintf(stderr, "\nThread counts is a comma-separated list; e.g., "
+	  "8,32,64\n");
+  exit(-1);
+}
+
+static double Now(void) {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 8) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unique_ptr<Params> card_params = CreateCardAbstractionParams();
+  card_params->ReadFromFile(argv[2]);
+  unique_ptr<CardAbstraction>
+    card_abstraction(new CardAbstraction(*card_params));
+  unique_ptr<Params> betting_params = CreateBettingAbstractionParams();
+  betting_params->ReadFromFile(argv[3]);
+  unique_ptr<BettingAbstraction>
+    betting_abstraction(new BettingAbstraction(*betting_params));
+  unique_ptr<Params> cfr_params = CreateCFRParams();
+  cfr_params->ReadFromFile(argv[4]);
+  unique_ptr<CFRConfig> cfr_config(new CFRConfig(*cfr_params));
+  vector<unsigned int> thread_counts;
+  ParseUnsignedInts(argv[5], &thread_counts);
+  if (thread_counts.size() == 0) Usage(argv[0]);
+  unsigned int batch_size, num_batches;
+  if (sscanf(argv[6], "%u", &batch_size) != 1)  Usage(argv[0]);
+  if (sscanf(argv[7], "%u", &num_batches) != 1) Usage(argv[0]);
+  if (num_batches == 0) Usage(argv[0]);
+  if (cfr_config->Algorithm() != "tcfr") {
+    fprintf(stderr, "Expected algorithm tcfr\n");
+    exit(-1);
+  }
+  if (betting_abstraction->Asymmetric()) {
+    fprintf(stderr, "Asymmetric betting abstractions not supported\n");
+    exit(-1);
+  }
+
+  Buckets buckets(*card_abstraction, false);
+  const char *mode = cfr_config->AtomicUpdates() ? "atomic" : "hogwild";
+  unsigned int num = thread_counts.size();
+  vector<double> its_per_sec(num), lost_fracs(num);
+  for (unsigned int i = 0; i < num; ++i) {
+    unsigned int num_threads = thread_counts[i];
+    TCFR cfr(*card_abstraction, *betting_abstraction, *cfr_config,
+	     buckets, num_threads, kMaxUInt);
+    // Each batch runs batch_size iterations per thread.  Checkpoints would
+    // go to the CFR output directory of the config, possibly overwriting a
+    // real run, so they are turned off.
+    cfr.SetCheckpoints(false);
+    double start = Now();
+    cfr.Run(0, (num_batches - 1) * num_threads, batch_size,
+	    num_batches * num_threads);
+    double secs = Now() - start;
+    double its = cfr.Iterations();
+    unsigned long long int updates = cfr.SumprobUpdates();
+    unsigned long long int total = cfr.SumprobTotal();
+    its_per_sec[i] = its / secs;
+    lost_fracs[i] = updates > 0 ? (updates - (double)total) / updates : 0;
+    fprintf(stderr, "%s %u threads: %.1f secs; %llu sumprob updates; "
+	    "%llu in buffer\n", mode, num_threads, secs, updates, total);
+  }
+  printf("Mode %s\n", mode);
+  printf("Threads\tIts/sec\tLost sumprob updates\n");
+  for (unsigned int i = 0; i < num; ++i) {
+    printf("%u\t%.0f\t%.6f%%\n", thread_counts[i], its_per_sec[i],
+	   lost_fracs[i] * 100.0);
+  }
+  fflush(stdout);
+}
@@ -7,10 +7,21 @@
 // example, all the turn and river boards that derive from the flop AcKcQc.
 // This is useful when we want to solve subgames independently (e.g., in
 // endgame solving and in cfrp.cpp).
+//
+// Building the boards, the lookup tables and the board counts (and the
+// hands in HandTree) is slow for large games and gives the same answer every
+// time.  WriteImage() (see build_board_tree_image) saves them all to one
+// file which Create() then maps read-only.  Processes on the same machine
+// share the pages of the mapped image.
 
+#include <fcntl.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <memory>
 #include <vector>
@@ -20,7 +31,10 @@
 #include "canonical.h"
 #include "cards.h"
 #include "constants.h"
+#include "files.h"
 #include "game.h"
+#include "hand_value_tree.h"
+#include "io.h"
 #include "sorting.h"
 
 using namespace std;
@@ -36,6 +50,59 @@ unsigned int *BoardTree::bds_ = nullptr;
 unsigned int **BoardTree::lookup_ = nullptr;
 unsigned int **BoardTree::board_counts_ = nullptr;
 unsigned int *BoardTree::pred_boards_ = nullptr;
+unsigned char *BoardTree::image_ = nullptr;
+unsigned long long int BoardTree::image_size_ = 0;
+unsigned int BoardTree::num_image_hand_streets_ = 0;
+unsigned long long int **BoardTree::image_hand_offsets_ = nullptr;
+unsigned int **BoardTree::image_lookup_ = nullptr;
+unsigned int **BoardTree::image_board_counts_ = nullptr;
+
+// Bump the version whenever the layout of the image (or of the CanonicalCards
+// records in it) changes.
+static const unsigned int kImageMagic = 0x42544d47;
+static const unsigned int kImageVersion = 1;
+// Magic, version, max street, num ranks, num suits, num hole cards and num
+// hand streets; followed by the number of boards and of board cards for each
+// street.
+static const unsigned int kImageHeaderFixed = 7;
+
+static unsigned long long int Padded(unsigned long long int num_bytes) {
+  return (num_bytes + 7ULL) & ~7ULL;
+}
+
+static unsigned int NumLookupCodes(unsigned int st) {
+  if (st == 0) return 1;
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  return pow(max_card1, Game::NumBoardCards(st));
+}
+
+// Every section of the image starts on an eight byte boundary.  Writes in
+// chunks because Writer grows its buffer to hold any single write.
+static void WriteSection(Writer *writer, const void *data,
+			 unsigned long long int num_bytes,
+			 unsigned long long int *pos) {
+  const unsigned long long int kChunk = 1 << 20;
+  unsigned char *bytes = (unsigned char *)data;
+  unsigned long long int left = num_bytes;
+  while (left > 0) {
+    unsigned int n = left < kChunk ? left : kChunk;
+    writer->WriteNBytes(bytes, n);
+    bytes += n;
+    left -= n;
+  }
+  for (unsigned long long int i = num_bytes; i < Padded(num_bytes); ++i) {
+    writer->WriteUnsignedChar(0);
+  }
+  *pos += Padded(num_bytes);
+}
+
+static unsigned char *Section(unsigned char *image,
+			      unsigned long long int num_bytes,
+			      unsigned long long int *pos) {
+  unsigned char *section = image + *pos;
+  *pos += Padded(num_bytes);
+  return section;
+}
 
 unsigned int BoardTree::LocalIndex(unsigned int root_st, unsigned int root_bd,
 				   unsigned int st, unsigned int gbd) {
@@ -129,6 +196,7 @@ void BoardTree::Create(void) {
   // Prevent multiple initialization
   if (boards_ != nullptr) return;
   max_street_ = Game::MaxStreet();
+  if (MapImage()) return;
   num_boards_.reset(new unsigned int[max_street_ + 1]);
   // Convenient to say there is one empty board on the preflop
   num_boards_[0] = 1;
@@ -182,6 +250,39 @@ void BoardTree::Create(void) {
 }
 
 void BoardTree::Delete(void) {
+  if (image_) {
+    // The tables point into the image; only the arrays of pointers to them
+    // are ours.  Lookup tables and board counts that were rebuilt after
+    // being deleted are ours too.
+    DeleteLookup();
+    DeleteBoardCounts();
+    delete [] board_variants_;
+    for (unsigned int st = 0; st < max_street_; ++st) {
+      delete [] succ_board_begins_[st];
+      delete [] succ_board_ends_[st];
+    }
+    delete [] succ_board_begins_;
+    delete [] succ_board_ends_;
+    delete [] boards_;
+    delete [] suit_groups_;
+    delete [] image_lookup_;
+    delete [] image_board_counts_;
+    delete [] image_hand_offsets_;
+    munmap(image_, image_size_);
+    board_variants_ = nullptr;
+    succ_board_begins_ = nullptr;
+    succ_board_ends_ = nullptr;
+    boards_ = nullptr;
+    suit_groups_ = nullptr;
+    image_lookup_ = nullptr;
+    image_board_counts_ = nullptr;
+    image_hand_offsets_ = nullptr;
+    image_ = nullptr;
+    image_size_ = 0;
+    num_image_hand_streets_ = 0;
+    num_boards_.reset(nullptr);
+    return;
+  }
   for (unsigned int st = 0; st <= max_street_; ++st) {
     delete [] board_variants_[st];
   }
@@ -208,13 +309,17 @@ void BoardTree::Delete(void) {
 
 void BoardTree::CreateLookup(void) {
   if (lookup_) return;
+  if (image_lookup_) {
+    lookup_ = image_lookup_;
+    return;
+  }
   unsigned int max_card1 = Game::MaxCard() + 1;
   lookup_ = new unsigned int *[max_street_ + 1];
   lookup_[0] = new unsigned int[1];
   lookup_[0][0] = 0;
   for (unsigned int st = 1; st <= max_street_; ++st) {
     unsigned int num_board_cards = Game::NumBoardCards(st);
-    unsigned int num_codes = pow(max_card1, num_board_cards);
+    unsigned int num_codes = NumLookupCodes(st);
     lookup_[st] = new unsigned int[num_codes];
     for (unsigned int i = 0; i < num_codes; ++i) {
       lookup_[st][i] = kMaxUInt;
@@ -233,6 +338,10 @@ void BoardTree::CreateLookup(void) {
 
 void BoardTree::DeleteLookup(void) {
   if (lookup_) {
+    if (lookup_ == image_lookup_) {
+      lookup_ = nullptr;
+      return;
+    }
     for (unsigned int st = 0; st <= max_street_; ++st) {
       delete [] lookup_[st];
     }
@@ -324,6 +433,10 @@ void BoardTree::BuildBoardCounts(void) {
   if (board_counts_) return;
   // Should I delete this when I am done?
   BoardTree::CreateLookup();
+  if (image_board_counts_) {
+    board_counts_ = image_board_counts_;
+    return;
+  }
   board_counts_ = new unsigned int *[max_street_ + 1];
   board_counts_[0] = new unsigned int [1];
   board_counts_[0][0] = 1;
@@ -353,6 +466,10 @@ void BoardTree::BuildBoardCounts(void) {
 
 void BoardTree::DeleteBoardCounts(void) {
   if (board_counts_) {
+    if (board_counts_ == image_board_counts_) {
+      board_counts_ = nullptr;
+      return;
+    }
     for (unsigned int st = 0; st <= max_street_; ++st) {
       delete [] board_counts_[st];
     }
@@ -394,3 +511,212 @@ void BoardTree::DeletePredBoards(void) {
   pred_boards_ = nullptr;
 }
 
+
+void BoardTree::ImageFilename(char *buf) {
+  sprintf(buf, "%s/board_tree_image.%s.%u.%u.%u", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
+	  Game::MaxStreet());
+}
+
+// Returns false, leaving nothing allocated, if there is no usable image.  A
+// stale image (wrong version or game) is ignored with a warning.
+bool BoardTree::MapImage(void) {
+  char buf[500];
+  ImageFilename(buf);
+  int fd = open(buf, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    close(fd);
+    return false;
+  }
+  unsigned long long int size = sb.st_size;
+  unsigned int header_size = kImageHeaderFixed + 2 * (max_street_ + 1);
+  if (size < header_size * sizeof(unsigned int)) {
+    fprintf(stderr, "Ignoring truncated board tree image %s\n", buf);
+    close(fd);
+    return false;
+  }
+  void *v = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (v == MAP_FAILED) {
+    fprintf(stderr, "Could not map board tree image %s\n", buf);
+    return false;
+  }
+  unsigned char *image = (unsigned char *)v;
+  const unsigned int *header = (const unsigned int *)image;
+  bool match = header[0] == kImageMagic && header[1] == kImageVersion &&
+    header[2] == max_street_ && header[3] == Game::NumRanks() &&
+    header[4] == Game::NumSuits() &&
+    header[5] == Game::NumCardsForStreet(0) && header[6] <= max_street_ + 1;
+  for (unsigned int st = 0; st <= max_street_ && match; ++st) {
+    if (header[kImageHeaderFixed + 2 * st + 1] != Game::NumBoardCards(st)) {
+      match = false;
+    }
+  }
+  if (! match) {
+    fprintf(stderr, "Ignoring stale board tree image %s\n", buf);
+    munmap(image, size);
+    return false;
+  }
+  image_ = image;
+  image_size_ = size;
+  num_image_hand_streets_ = header[6];
+  num_boards_.reset(new unsigned int[max_street_ + 1]);
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    num_boards_[st] = header[kImageHeaderFixed + 2 * st];
+  }
+
+  // The sections are in the order WriteImage() writes them.
+  unsigned long long int pos = Padded(header_size * sizeof(unsigned int));
+  board_variants_ = new unsigned int *[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    board_variants_[st] = (unsigned int *)Section(
+			   image, num_boards_[st] * sizeof(unsigned int), &pos);
+  }
+  succ_board_begins_ = new unsigned int **[max_street_];
+  succ_board_ends_ = new unsigned int **[max_street_];
+  for (unsigned int st = 0; st < max_street_; ++st) {
+    unsigned int num_bytes = num_boards_[st] * sizeof(unsigned int);
+    succ_board_begins_[st] = new unsigned int *[max_street_ + 1];
+    succ_board_ends_[st] = new unsigned int *[max_street_ + 1];
+    for (unsigned int nst = st + 1; nst <= max_street_; ++nst) {
+      succ_board_begins_[st][nst] =
+	(unsigned int *)Section(image, num_bytes, &pos);
+      succ_board_ends_[st][nst] =
+	(unsigned int *)Section(image, num_bytes, &pos);
+    }
+  }
+  boards_ = new Card *[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    unsigned long long int num_cards =
+      num_boards_[st] * Game::NumBoardCards(st);
+    boards_[st] = (Card *)Section(image, num_cards * sizeof(Card), &pos);
+  }
+  suit_groups_ = new unsigned int *[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    suit_groups_[st] = (unsigned int *)Section(
+			image, num_boards_[st] * sizeof(unsigned int), &pos);
+  }
+  image_lookup_ = new unsigned int *[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    unsigned long long int num_codes = NumLookupCodes(st);
+    image_lookup_[st] = (unsigned int *)Section(
+		   image, num_codes * sizeof(unsigned int), &pos);
+  }
+  lookup_ = image_lookup_;
+  image_board_counts_ = new unsigned int *[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    image_board_counts_[st] = (unsigned int *)Section(
+			 image, num_boards_[st] * sizeof(unsigned int), &pos);
+  }
+  board_counts_ = image_board_counts_;
+  // The hand records come next.  Their offsets are at the end of the image
+  // so that WriteImage() can write everything in one pass.
+  unsigned long long int offset_bytes = 0;
+  for (unsigned int st = 0; st < num_image_hand_streets_; ++st) {
+    offset_bytes += num_boards_[st] * sizeof(unsigned long long int);
+  }
+  image_hand_offsets_ = new unsigned long long int *[max_street_ + 1];
+  if (pos + offset_bytes > size) {
+    fprintf(stderr, "Ignoring truncated board tree image %s\n", buf);
+    Delete();
+    return false;
+  }
+  unsigned long long int offset_pos = size - offset_bytes;
+  for (unsigned int st = 0; st < num_image_hand_streets_; ++st) {
+    image_hand_offsets_[st] = (unsigned long long int *)Section(
+	 image, num_boards_[st] * sizeof(unsigned long long int), &offset_pos);
+  }
+  return true;
+}
+
+void BoardTree::WriteImage(unsigned int max_hand_st) {
+  Create();
+  // Also creates the lookup tables
+  BuildBoardCounts();
+  unsigned int num_hand_streets =
+    max_hand_st == kMaxUInt ? 0 : max_hand_st + 1;
+  if (num_hand_streets > max_street_ + 1) {
+    fprintf(stderr, "Max hand street %u too large\n", max_hand_st);
+    exit(-1);
+  }
+  // Write to a temporary file and rename it so that a running process that
+  // has the old image mapped (possibly this one) is unaffected.
+  char buf[500], tmp_buf[510];
+  ImageFilename(buf);
+  sprintf(tmp_buf, "%s.tmp", buf);
+  {
+    Writer writer(tmp_buf);
+    unsigned long long int pos = 0;
+    vector<unsigned int> header;
+    header.push_back(kImageMagic);
+    header.push_back(kImageVersion);
+    header.push_back(max_street_);
+    header.push_back(Game::NumRanks());
+    header.push_back(Game::NumSuits());
+    header.push_back(Game::NumCardsForStreet(0));
+    header.push_back(num_hand_streets);
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      header.push_back(num_boards_[st]);
+      header.push_back(Game::NumBoardCards(st));
+    }
+    WriteSection(&writer, header.data(),
+		 header.size() * sizeof(unsigned int), &pos);
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      WriteSection(&writer, board_variants_[st],
+		   num_boards_[st] * sizeof(unsigned int), &pos);
+    }
+    for (unsigned int st = 0; st < max_street_; ++st) {
+      unsigned int num_bytes = num_boards_[st] * sizeof(unsigned int);
+      for (unsigned int nst = st + 1; nst <= max_street_; ++nst) {
+	WriteSection(&writer, succ_board_begins_[st][nst], num_bytes, &pos);
+	WriteSection(&writer, succ_board_ends_[st][nst], num_bytes, &pos);
+      }
+    }
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      unsigned long long int num_cards =
+	num_boards_[st] * Game::NumBoardCards(st);
+      WriteSection(&writer, boards_[st], num_cards * sizeof(Card), &pos);
+    }
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      WriteSection(&writer, suit_groups_[st],
+		   num_boards_[st] * sizeof(unsigned int), &pos);
+    }
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      unsigned long long int num_codes = NumLookupCodes(st);
+      WriteSection(&writer, lookup_[st], num_codes * sizeof(unsigned int),
+		   &pos);
+    }
+    for (unsigned int st = 0; st <= max_street_; ++st) {
+      WriteSection(&writer, board_counts_[st],
+		   num_boards_[st] * sizeof(unsigned int), &pos);
+    }
+    // Same hands as a HandTree rooted at the preflop
+    vector< vector<unsigned long long int> > offsets(num_hand_streets);
+    for (unsigned int st = 0; st < num_hand_streets; ++st) {
+      unsigned int num_boards = num_boards_[st];
+      unsigned int num_board_cards = Game::NumBoardCards(st);
+      offsets[st].resize(num_boards);
+      for (unsigned int bd = 0; bd < num_boards; ++bd) {
+	const Card *board = Board(st, bd);
+	CanonicalCards hands(2, board, num_board_cards, suit_groups_[st][bd],
+			     false);
+	if (st == max_street_) {
+	  HandValueTree::Create();
+	  hands.SortByHandStrength(board);
+	}
+	offsets[st][bd] = pos;
+	pos += hands.WriteImage(&writer);
+      }
+    }
+    for (unsigned int st = 0; st < num_hand_streets; ++st) {
+      WriteSection(&writer, offsets[st].data(),
+		   offsets[st].size() * sizeof(unsigned long long int), &pos);
+    }
+  }
+  if (rename(tmp_buf, buf) != 0) {
+    fprintf(stderr, "Could not rename %s to %s\n", tmp_buf, buf);
+    exit(-1);
+  }
+}
@@ -10,6 +10,8 @@ using namespace std;
 
 class BoardTree {
 public:
+  // Maps the board tree image for the current game if one exists (see
+  // WriteImage()); otherwise builds the boards from scratch.
   static void Create(void);
   static void Delete(void);
   static const Card *Board(unsigned int st, unsigned int bd) {
@@ -54,6 +56,17 @@ public:
   static unsigned int PredBoard(unsigned int msbd, unsigned int pst) {
     return pred_boards_[msbd * max_street_ + pst];
   }
+  // Writes the boards, suit groups, successor board ranges, lookup tables
+  // and board counts to a versioned image in the static directory.  The
+  // hands for each board (as HandTree builds them) are included for streets
+  // up to and including max_hand_st; pass kMaxUInt for none.
+  static void WriteImage(unsigned int max_hand_st);
+  // Returns the CanonicalCards record for the given board from the mapped
+  // image, or NULL if there is no image or it has no hands for st.
+  static const unsigned char *ImageHands(unsigned int st, unsigned int bd) {
+    if (image_ == nullptr || st >= num_image_hand_streets_) return NULL;
+    return image_ + image_hand_offsets_[st][bd];
+  }
 private:
   BoardTree(void) {}
   
@@ -63,6 +76,8 @@ private:
 		    unsigned int prev_sg);
   static void DealRawBoards(Card *board, unsigned int st);
   static void BuildPredBoards(unsigned int st, unsigned int *pred_bds);
+  static void ImageFilename(char *buf);
+  static bool MapImage(void);
 
   static unsigned int max_street_;
   static unique_ptr<unsigned int []> num_boards_;
@@ -75,6 +90,14 @@ private:
   static unsigned int **lookup_;
   static unsigned int **board_counts_;
   static unsigned int *pred_boards_;
+  static unsigned char *image_;
+  static unsigned long long int image_size_;
+  static unsigned int num_image_hand_streets_;
+  static unsigned long long int **image_hand_offsets_;
+  // The lookup tables and board counts in the image.  lookup_ and
+  // board_counts_ point to these when they come from the image.
+  static unsigned int **image_lookup_;
+  static unsigned int **image_board_counts_;
 };
 
 #endif
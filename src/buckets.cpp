@@ -1,5 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <string>
 
 #include "board_tree.h"
 #include "buckets.h"
@@ -8,35 +12,119 @@
 #include "game.h"
 #include "io.h"
 
-// Create a dummy buckets object for an unabstracted system
-Buckets::Buckets(void) {
+using namespace std;
+
+unsigned int PackedBucketBits(unsigned int num_buckets) {
+  unsigned int bits = 1;
+  while ((1ULL << bits) < num_buckets) ++bits;
+  return bits;
+}
+
+unsigned long long int PackedBucketBytes(unsigned long long int num_hands,
+					 unsigned int bits) {
+  return (num_hands * bits + 7) / 8 + 8;
+}
+
+PackedBucketsWriter::PackedBucketsWriter(const char *filename,
+					 unsigned int num_buckets) :
+  writer_(filename) {
+  bits_ = PackedBucketBits(num_buckets);
+  acc_ = 0;
+  num_acc_bits_ = 0;
+}
+
+PackedBucketsWriter::~PackedBucketsWriter(void) {
+  if (num_acc_bits_ > 0) writer_.WriteUnsignedChar(acc_ & 0xff);
+  for (unsigned int i = 0; i < 8; ++i) writer_.WriteUnsignedChar(0);
+}
+
+void BucketsFilename(unsigned int st, const string &bucketing, bool packed,
+		     char *buf) {
+  sprintf(buf, "%s/%sbuckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
+	  packed ? "packed_" : "", Game::GameName().c_str(), Game::NumRanks(),
+	  Game::NumSuits(), Game::MaxStreet(), bucketing.c_str(), st);
+}
+
+void Buckets::Allocate(void) {
   unsigned int max_street = Game::MaxStreet();
   none_ = new bool[max_street + 1];
   short_buckets_ = new unsigned short *[max_street + 1];
   int_buckets_ = new unsigned int *[max_street + 1];
+  packed_buckets_ = new unsigned char *[max_street + 1];
+  bucket_bits_ = new unsigned int[max_street + 1];
   for (unsigned int st = 0; st <= max_street; ++st) {
     short_buckets_[st] = nullptr;
     int_buckets_[st] = nullptr;
+    packed_buckets_[st] = nullptr;
+    bucket_bits_[st] = 0;
   }
   num_buckets_ = new unsigned int[max_street + 1];
+}
+
+// Create a dummy buckets object for an unabstracted system
+Buckets::Buckets(void) {
+  unsigned int max_street = Game::MaxStreet();
+  Allocate();
   for (unsigned int st = 0; st <= max_street; ++st) {
     none_[st] = true;
     num_buckets_[st] = 0;
   }
 }
 
+// Requires num_buckets_[st] to be set.
+void Buckets::ReadStreetBuckets(unsigned int st, const string &bucketing) {
+  unsigned int num_boards = BoardTree::NumBoards(st);
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  unsigned int num_hands = num_boards * num_hole_card_pairs;
+  long long int lli_num_hands = num_hands;
+  char buf[500];
+
+  BucketsFilename(st, bucketing, true, buf);
+  if (FileExists(buf)) {
+    unsigned int bits = PackedBucketBits(num_buckets_[st]);
+    unsigned long long int num_bytes = PackedBucketBytes(num_hands, bits);
+    Reader reader(buf);
+    if ((unsigned long long int)reader.FileSize() != num_bytes) {
+      fprintf(stderr, "Buckets::Buckets: Unexpected file size %lli\n",
+	      reader.FileSize());
+      exit(-1);
+    }
+    packed_buckets_[st] = new unsigned char[num_bytes];
+    // ReadNBytesOrDie() takes an unsigned int
+    const unsigned long long int kChunk = 1 << 30;
+    for (unsigned long long int i = 0; i < num_bytes; i += kChunk) {
+      unsigned int n = num_bytes - i < kChunk ? num_bytes - i : kChunk;
+      reader.ReadNBytesOrDie(n, packed_buckets_[st] + i);
+    }
+    bucket_bits_[st] = bits;
+    return;
+  }
+
+  BucketsFilename(st, bucketing, false, buf);
+  Reader reader(buf);
+  long long int file_size = reader.FileSize();
+  if (file_size == lli_num_hands * 2) {
+    short_buckets_[st] = new unsigned short[num_hands];
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      short_buckets_[st][h] = reader.ReadUnsignedShortOrDie();
+    }
+  } else if (file_size == lli_num_hands * 4) {
+    int_buckets_[st] = new unsigned int[num_hands];
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      int_buckets_[st][h] = reader.ReadUnsignedIntOrDie();
+    }
+  } else {
+    fprintf(stderr, "Buckets::Buckets: Unexpected file size %lli\n",
+	    file_size);
+    exit(-1);
+  }
+}
+
 Buckets::Buckets(const CardAbstraction &ca, unsigned int final_street) {
   BoardTree::Create();
   unsigned int max_street = Game::MaxStreet();
-  none_ = new bool[max_street + 1];
-  short_buckets_ = new unsigned short *[max_street + 1];
-  int_buckets_ = new unsigned int *[max_street + 1];
-  for (unsigned int st = 0; st <= max_street; ++st) {
-    short_buckets_[st] = nullptr;
-    int_buckets_[st] = nullptr;
-  }
+  Allocate();
   char buf[500];
-  num_buckets_ = new unsigned int[max_street + 1];
   for (unsigned int st = 0; st <= final_street; ++st) {
     if (ca.Bucketing(st) == "none") {
       none_[st] = true;
@@ -57,46 +145,33 @@ Buckets::Buckets(const CardAbstraction &ca, unsigned int final_street) {
 
   for (unsigned int st = 0; st <= final_street; ++st) {
     if (none_[st]) continue;
-    unsigned int num_boards = BoardTree::NumBoards(st);
-    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-    unsigned int num_hands = num_boards * num_hole_card_pairs;
-    long long int lli_num_hands = num_hands;
-    
-    sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	    Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	    max_street, ca.Bucketing(st).c_str(), st);
-    Reader reader(buf);
-    long long int file_size = reader.FileSize();
-    if (file_size == lli_num_hands * 2) {
-      short_buckets_[st] = new unsigned short[num_hands];
-      for (unsigned int h = 0; h < num_hands; ++h) {
-	short_buckets_[st][h] = reader.ReadUnsignedShortOrDie();
-      }
-    } else if (file_size == lli_num_hands * 4) {
-      int_buckets_[st] = new unsigned int[num_hands];
-      for (unsigned int h = 0; h < num_hands; ++h) {
-	int_buckets_[st][h] = reader.ReadUnsignedIntOrDie();
-      }
-    } else {
-      fprintf(stderr, "Buckets::Buckets: Unexpected file size %lli\n",
-	      file_size);
-      exit(-1);
-    }
+    ReadStreetBuckets(st, ca.Bucketing(st));
   }
 }
 
-Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
+Buckets::Buckets(unsigned int st, const string &bucketing) {
   BoardTree::Create();
   unsigned int max_street = Game::MaxStreet();
-  none_ = new bool[max_street + 1];
-  short_buckets_ = new unsigned short *[max_street + 1];
-  int_buckets_ = new unsigned int *[max_street + 1];
-  for (unsigned int st = 0; st <= max_street; ++st) {
-    short_buckets_[st] = nullptr;
-    int_buckets_[st] = nullptr;
+  Allocate();
+  for (unsigned int st1 = 0; st1 <= max_street; ++st1) {
+    none_[st1] = true;
+    num_buckets_[st1] = 0;
   }
   char buf[500];
-  num_buckets_ = new unsigned int[max_street + 1];
+  sprintf(buf, "%s/num_buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
+	  max_street, bucketing.c_str(), st);
+  Reader reader(buf);
+  none_[st] = false;
+  num_buckets_[st] = reader.ReadUnsignedIntOrDie();
+  ReadStreetBuckets(st, bucketing);
+}
+
+Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
+  BoardTree::Create();
+  unsigned int max_street = Game::MaxStreet();
+  Allocate();
+  char buf[500];
   for (unsigned int st = 0; st <= max_street; ++st) {
     if (ca.Bucketing(st) == "none") {
       none_[st] = true;
@@ -114,69 +189,64 @@ Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
   if (! numb_only) {
     for (unsigned int st = 0; st <= max_street; ++st) {
       if (none_[st]) continue;
-      unsigned int num_boards = BoardTree::NumBoards(st);
-      unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-      unsigned int num_hands = num_boards * num_hole_card_pairs;
-      long long int lli_num_hands = num_hands;
-  
-      sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	      Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	      max_street, ca.Bucketing(st).c_str(), st);
-      Reader reader(buf);
-      long long int file_size = reader.FileSize();
-      if (file_size == lli_num_hands * 2) {
-	short_buckets_[st] = new unsigned short[num_hands];
-	for (unsigned int h = 0; h < num_hands; ++h) {
-	  short_buckets_[st][h] = reader.ReadUnsignedShortOrDie();
-	}
-      } else if (file_size == lli_num_hands * 4) {
-	int_buckets_[st] = new unsigned int[num_hands];
-	for (unsigned int h = 0; h < num_hands; ++h) {
-	  int_buckets_[st][h] = reader.ReadUnsignedIntOrDie();
-	}
-      } else {
-	fprintf(stderr, "Buckets::Buckets: Unexpected file size %lli\n",
-		file_size);
-	exit(-1);
-      }
+      ReadStreetBuckets(st, ca.Bucketing(st));
     }
   }
 }
 
 Buckets::~Buckets(void) {
   unsigned int max_street = Game::MaxStreet();
-  if (short_buckets_) {
-    for (unsigned int st = 0; st <= max_street; ++st) {
-      if (short_buckets_[st]) delete [] short_buckets_[st];
-    }
-    delete [] short_buckets_;
-  }
-  if (int_buckets_) {
-    for (unsigned int st = 0; st <= max_street; ++st) {
-      if (int_buckets_[st]) delete [] int_buckets_[st];
-    }
-    delete [] int_buckets_;
+  for (unsigned int st = 0; st <= max_street; ++st) {
+    delete [] short_buckets_[st];
+    delete [] int_buckets_[st];
+    delete [] packed_buckets_[st];
   }
+  delete [] short_buckets_;
+  delete [] int_buckets_;
+  delete [] packed_buckets_;
+  delete [] bucket_bits_;
   delete [] none_;
   delete [] num_buckets_;
 }
 
+void Buckets::BoardBuckets(unsigned int st, unsigned int gbd,
+			   unsigned int *buckets) const {
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  unsigned int base = gbd * num_hole_card_pairs;
+  if (short_buckets_[st]) {
+    const unsigned short *board_buckets = &short_buckets_[st][base];
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      buckets[i] = board_buckets[i];
+    }
+  } else if (int_buckets_[st]) {
+    memcpy(buckets, &int_buckets_[st][base],
+	   num_hole_card_pairs * sizeof(unsigned int));
+  } else {
+    const unsigned char *packed = packed_buckets_[st];
+    unsigned int bits = bucket_bits_[st];
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      buckets[i] = UnpackBucket(packed, base + i, bits);
+    }
+  }
+}
+
+// The bucket files for the river can be too big to read into memory.  We
+// map them instead; lookups are random, so readahead is turned off.
 BucketsFile::BucketsFile(const CardAbstraction &ca) {
   BoardTree::Create();
   unsigned int max_street = Game::MaxStreet();
-  int_buckets_ = nullptr;
-  short_buckets_ = nullptr;
-  none_ = new bool[max_street + 1];
-  num_buckets_ = new unsigned int[max_street + 1];
+  Allocate();
   shorts_ = new bool[max_street + 1];
-  readers_ = new Reader *[max_street + 1];
+  data_ = new unsigned char *[max_street + 1];
+  sizes_ = new long long int[max_street + 1];
   char buf[500];
   for (unsigned int st = 0; st <= max_street; ++st) {
     if (ca.Bucketing(st) == "none") {
       none_[st] = true;
       num_buckets_[st] = 0;
       shorts_[st] = false;
-      readers_[st] = nullptr;
+      data_[st] = nullptr;
+      sizes_[st] = 0;
       continue;
     }
     none_[st] = false;
@@ -193,12 +263,22 @@ BucketsFile::BucketsFile(const CardAbstraction &ca) {
     unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
     unsigned int num_hands = num_boards * num_hole_card_pairs;
     long long int lli_num_hands = num_hands;
-    sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	    Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	    max_street, ca.Bucketing(st).c_str(), st);
-    readers_[st] = new Reader(buf);
-    long long int file_size = readers_[st]->FileSize();
-    if (file_size == lli_num_hands * 2) {
+    shorts_[st] = false;
+    BucketsFilename(st, ca.Bucketing(st), true, buf);
+    bool packed = FileExists(buf);
+    if (! packed) BucketsFilename(st, ca.Bucketing(st), false, buf);
+    Reader reader(buf);
+    long long int file_size = reader.FileSize();
+    if (packed) {
+      bucket_bits_[st] = PackedBucketBits(num_buckets_[st]);
+      if (file_size !=
+	  (long long int)PackedBucketBytes(num_hands, bucket_bits_[st])) {
+	fprintf(stderr,
+		"BucketsFile::BucketsFile: Unexpected file size %lli\n",
+		file_size);
+	exit(-1);
+      }
+    } else if (file_size == lli_num_hands * 2) {
       shorts_[st] = true;
     } else if (file_size == lli_num_hands * 4) {
       shorts_[st] = false;
@@ -208,15 +288,24 @@ BucketsFile::BucketsFile(const CardAbstraction &ca) {
 	      file_size);
       exit(-1);
     }
+    void *v = mmap(NULL, file_size, PROT_READ, MAP_SHARED, reader.FD(), 0);
+    if (v == MAP_FAILED) {
+      fprintf(stderr, "mmap failed for %s\n", buf);
+      exit(-1);
+    }
+    madvise(v, file_size, MADV_RANDOM);
+    data_[st] = (unsigned char *)v;
+    sizes_[st] = file_size;
   }
 }
 
 BucketsFile::~BucketsFile(void) {
   unsigned int max_street = Game::MaxStreet();
   for (unsigned int st = 0; st <= max_street; ++st) {
-    delete readers_[st];
+    if (data_[st]) munmap(data_[st], sizes_[st]);
   }
-  delete [] readers_;
+  delete [] data_;
+  delete [] sizes_;
   delete [] shorts_;
 }
 
@@ -225,11 +314,39 @@ unsigned int BucketsFile::Bucket(unsigned int st, unsigned int h) const {
     fprintf(stderr, "No buckets on street %u\n", st);
     exit(-1);
   }
-  if (shorts_[st]) {
-    readers_[st]->SeekTo(((long long int)h) * 2);
-    return readers_[st]->ReadUnsignedShortOrDie();
+  if (bucket_bits_[st]) {
+    return UnpackBucket(data_[st], h, bucket_bits_[st]);
+  } else if (shorts_[st]) {
+    return ((const unsigned short *)data_[st])[h];
+  } else {
+    return ((const unsigned int *)data_[st])[h];
+  }
+}
+
+// A board's buckets are contiguous in the file, so this touches at most a
+// couple of pages.
+void BucketsFile::BoardBuckets(unsigned int st, unsigned int gbd,
+			       unsigned int *buckets) const {
+  if (none_[st]) {
+    fprintf(stderr, "No buckets on street %u\n", st);
+    exit(-1);
+  }
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  unsigned long long int base =
+    ((unsigned long long int)gbd) * num_hole_card_pairs;
+  if (bucket_bits_[st]) {
+    unsigned int bits = bucket_bits_[st];
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      buckets[i] = UnpackBucket(data_[st], base + i, bits);
+    }
+  } else if (shorts_[st]) {
+    const unsigned short *board_buckets =
+      ((const unsigned short *)data_[st]) + base;
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      buckets[i] = board_buckets[i];
+    }
   } else {
-    readers_[st]->SeekTo(((long long int)h) * 4);
-    return readers_[st]->ReadUnsignedIntOrDie();
+    memcpy(buckets, ((const unsigned int *)data_[st]) + base,
+	   num_hole_card_pairs * sizeof(unsigned int));
   }
 }
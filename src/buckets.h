@@ -1,40 +1,108 @@
 #ifndef _BUCKETS_H_
 #define _BUCKETS_H_
 
+#include <string.h>
+
+#include <string>
+
+#include "io.h"
+
+using namespace std;
+
 class CardAbstraction;
-class Reader;
+
+// Packed bucket files hold ceil(log2(num buckets)) bits per hand, low bits
+// first, followed by eight bytes of padding so that any entry can be
+// extracted with a single unaligned eight byte load.  They are named
+// packed_buckets.* and take precedence over the plain buckets.* files of
+// unsigned shorts or ints.
+unsigned int PackedBucketBits(unsigned int num_buckets);
+unsigned long long int PackedBucketBytes(unsigned long long int num_hands,
+					 unsigned int bits);
+
+// Assumes a little-endian machine.
+static inline unsigned int UnpackBucket(const unsigned char *packed,
+					unsigned long long int h,
+					unsigned int bits) {
+  unsigned long long int bit = h * bits;
+  unsigned long long int word;
+  memcpy(&word, packed + (bit >> 3), sizeof(word));
+  return (word >> (bit & 7)) & ((1ULL << bits) - 1);
+}
+
+// Used by the build_*_buckets programs.  Takes the buckets in hand order.
+class PackedBucketsWriter {
+public:
+  PackedBucketsWriter(const char *filename, unsigned int num_buckets);
+  ~PackedBucketsWriter(void);
+  void Write(unsigned int b) {
+    acc_ |= ((unsigned long long int)b) << num_acc_bits_;
+    num_acc_bits_ += bits_;
+    while (num_acc_bits_ >= 8) {
+      writer_.WriteUnsignedChar(acc_ & 0xff);
+      acc_ >>= 8;
+      num_acc_bits_ -= 8;
+    }
+  }
+private:
+  Writer writer_;
+  unsigned int bits_;
+  unsigned long long int acc_;
+  unsigned int num_acc_bits_;
+};
 
 class Buckets {
 public:
   Buckets(void);
   Buckets(const CardAbstraction &ca, bool numb_only);
   Buckets(const CardAbstraction &ca, unsigned int final_street);
+  // Loads the buckets of the given bucketing for street st only.
+  Buckets(unsigned int st, const string &bucketing);
   virtual ~Buckets(void);
   bool None(unsigned int st) const {return none_[st];}
   virtual unsigned int Bucket(unsigned int st, unsigned int h) const {
     if (short_buckets_[st]) {
       return short_buckets_[st][h];
-    } else {
+    } else if (int_buckets_[st]) {
       return int_buckets_[st][h];
+    } else {
+      return UnpackBucket(packed_buckets_[st], h, bucket_bits_[st]);
     }
   }
+  // Writes the buckets of all the hole card pairs on the given board, in
+  // hole card pair index order (see HCPIndex()), to buckets.
+  virtual void BoardBuckets(unsigned int st, unsigned int gbd,
+			    unsigned int *buckets) const;
   const unsigned int *NumBuckets(void) const {return num_buckets_;}
   unsigned int NumBuckets(unsigned int st) const {return num_buckets_[st];}
  protected:
+  void Allocate(void);
+  void ReadStreetBuckets(unsigned int st, const string &bucketing);
+
   bool *none_;
   unsigned short **short_buckets_;
   unsigned int **int_buckets_;
+  unsigned char **packed_buckets_;
+  unsigned int *bucket_bits_;
   unsigned int *num_buckets_;
 };
 
+// Serves buckets straight out of the mapped bucket files rather than reading
+// them into memory.  Thread-safe.
 class BucketsFile : public Buckets {
 public:
   BucketsFile(const CardAbstraction &ca);
   ~BucketsFile(void);
   unsigned int Bucket(unsigned int st, unsigned int h) const;
+  void BoardBuckets(unsigned int st, unsigned int gbd,
+		    unsigned int *buckets) const;
 private:
   bool *shorts_;
-  Reader **readers_;
+  unsigned char **data_;
+  long long int *sizes_;
 };
 
+void BucketsFilename(unsigned int st, const string &bucketing, bool packed,
+		     char *buf);
+
 #endif
@@ -0,0 +1,44 @@
+// Writes the board tree image for a game (see BoardTree::WriteImage()).
+// Subsequent calls to BoardTree::Create() for the game map the image instead
+// of building the boards.
+//
+// The hands for every board are included for streets up to and including
+// <max hand street>.  For big games the river hands take a lot of space, so
+// you may want to stop at an earlier street or pass "none".
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+
+#include "board_tree.h"
+#include "constants.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "params.h"
+
+using namespace std;
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <max hand street|none>\n",
+	  prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unsigned int max_hand_st;
+  if (! strcmp(argv[2], "none")) {
+    max_hand_st = kMaxUInt;
+  } else {
+    if (sscanf(argv[2], "%u", &max_hand_st) != 1) Usage(argv[0]);
+    if (max_hand_st > Game::MaxStreet()) Usage(argv[0]);
+  }
+  BoardTree::WriteImage(max_hand_st);
+}
@@ -3,10 +3,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "board_tree.h"
+#include "buckets.h"
 #include "constants.h"
 #include "fast_hash.h"
+#include "feature_matrix.h"
 #include "files.h"
 #include "game.h"
 #include "game_params.h"
@@ -20,27 +23,35 @@ using namespace std;
 
 static void Write(unsigned int street, const string &bucketing,
 		  KMeans *kmeans, unsigned int *indices,
-		  unsigned int num_buckets) {
-  unsigned int max_street = Game::MaxStreet();
+		  unsigned int num_buckets, bool packed) {
   char buf[500];
-  bool short_buckets = num_buckets <= 65536;
-  sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, bucketing.c_str(), street);
-  Writer writer(buf);
+  // Remove a file in the other format which would otherwise shadow (or be
+  // shadowed by) the new one.
+  BucketsFilename(street, bucketing, ! packed, buf);
+  remove(buf);
+  BucketsFilename(street, bucketing, packed, buf);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(street);
   unsigned int num_hands = BoardTree::NumBoards(street) * num_hole_card_pairs;
-  for (unsigned int h = 0; h < num_hands; ++h) {
-    unsigned int index = indices[h];
-    unsigned int b = kmeans->Assignment(index);
-    if (short_buckets) {
-      if (b > kMaxUnsignedShort) {
-	fprintf(stderr, "Bucket %i out of range for short\n", b);
-	exit(-1);
+  if (packed) {
+    PackedBucketsWriter writer(buf, num_buckets);
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      writer.Write(kmeans->Assignment(indices[h]));
+    }
+  } else {
+    bool short_buckets = num_buckets <= 65536;
+    Writer writer(buf);
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      unsigned int index = indices[h];
+      unsigned int b = kmeans->Assignment(index);
+      if (short_buckets) {
+	if (b > kMaxUnsignedShort) {
+	  fprintf(stderr, "Bucket %i out of range for short\n", b);
+	  exit(-1);
+	}
+	writer.WriteUnsignedShort(b);
+      } else {
+	writer.WriteUnsignedInt(b);
       }
-      writer.WriteUnsignedShort(b);
-    } else {
-      writer.WriteUnsignedInt(b);
     }
   }
 
@@ -54,12 +65,14 @@ static void Write(unsigned int street, const string &bucketing,
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <street> <num clusters> "
 	  "<bucketing> <features> <neighbor thresh> <num iterations> "
-	  "<num threads>\n", prog_name);
+	  "<num threads> [packed] [bounds]\n", prog_name);
+  fprintf(stderr, "\n\"bounds\" adds Hamerly's bounds so that most objects "
+	  "are skipped\nin later iterations\n");
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 9) Usage(argv[0]);
+  if (argc < 9 || argc > 11) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -75,6 +88,12 @@ int main(int argc, char *argv[]) {
   unsigned int num_iterations;
   if (sscanf(argv[7], "%u", &num_iterations) != 1)  Usage(argv[0]);
   unsigned int num_threads;
+  bool packed = false, use_bounds = false;
+  for (int a = 9; a < argc; ++a) {
+    if (! strcmp(argv[a], "packed"))      packed = true;
+    else if (! strcmp(argv[a], "bounds")) use_bounds = true;
+    else                                  Usage(argv[0]);
+  }
   if (sscanf(argv[8], "%u", &num_threads) != 1)     Usage(argv[0]);
 
   // Make clustering deterministic
@@ -97,7 +116,8 @@ int main(int argc, char *argv[]) {
   short *feature_vals = new short[num_features];
   SparseAndDenseLong *sad = new SparseAndDenseLong;
   uint64_t hash_seed = 0;
-  vector<short *> *unique_objects = new vector<short *>;
+  // Feature values of the unique objects, num_features per object
+  vector<short> *unique_vals = new vector<short>;
   for (unsigned int h = 0; h < num_hands; ++h) {
     if (h % 10000000 == 0) {
       fprintf(stderr, "h %u\n", h);
@@ -117,51 +137,43 @@ int main(int argc, char *argv[]) {
     }
     if (new_num > old_num) {
       // Previously unseen feature value vector
-      short *copy = new short[num_features];
-      for (unsigned int f = 0; f < num_features; ++f) {
-	copy[f] = feature_vals[f];
-      }
-      unique_objects->push_back(copy);
+      unique_vals->insert(unique_vals->end(), feature_vals,
+			  feature_vals + num_features);
     }
-    if (sad->Num() != unique_objects->size()) {
+    if (sad->Num() * num_features != unique_vals->size()) {
       fprintf(stderr, "Size mismatch: %u vs. %u\n", sad->Num(),
-	      (unsigned int)unique_objects->size());
+	      (unsigned int)(unique_vals->size() / num_features));
       exit(-1);
     }
   }
   delete [] feature_vals;
 
   unsigned int num_unique = sad->Num();
-  if (num_unique != unique_objects->size()) {
+  if (num_unique * num_features != unique_vals->size()) {
     fprintf(stderr, "Final size mismatch: %u vs. %u\n", num_unique,
-	    (unsigned int)unique_objects->size());
+	    (unsigned int)(unique_vals->size() / num_features));
     exit(-1);
   }
   fprintf(stderr, "%u unique objects\n", num_unique);
   delete sad;
 
-  float **objects = new float *[num_unique];
+  FeatureMatrix *objects = new FeatureMatrix(num_unique, num_features);
   for (unsigned int i = 0; i < num_unique; ++i) {
-    objects[i] = new float[num_features];
-    for (unsigned int f = 0; f < num_features; ++f) {
-      objects[i][f] = (*unique_objects)[i][f];
-    }
-    delete [] (*unique_objects)[i];
+    float *row = objects->Row(i);
+    const short *vals = &(*unique_vals)[((size_t)i) * num_features];
+    for (unsigned int f = 0; f < num_features; ++f) row[f] = vals[f];
   }
-  delete unique_objects;
+  delete unique_vals;
 
-  KMeans kmeans(num_clusters, num_features, num_unique, objects,
-		neighbor_thresh, num_threads);
+  KMeans kmeans(num_clusters, objects, neighbor_thresh, num_threads,
+		use_bounds);
   kmeans.Cluster(num_iterations);
   unsigned int num_actual = kmeans.NumClusters();
   fprintf(stderr, "Num actual buckets: %u\n", num_actual);
 
-  for (unsigned int i = 0; i < num_unique; ++i) {
-    delete [] objects[i];
-  }
-  delete [] objects;
+  delete objects;
 
-  Write(street, bucketing, &kmeans, indices, num_actual);
+  Write(street, bucketing, &kmeans, indices, num_actual, packed);
 
   delete [] indices;
 }
@@ -0,0 +1,123 @@
+// Like build_kmeans_buckets, but streams the feature file instead of
+// loading it so that it can handle streets (typically the river) with more
+// feature vectors than fit in memory.  Duplicate feature vectors are not
+// removed.
+//
+// Currently we assume all features values are shorts, but we should
+// generalize.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board_tree.h"
+#include "buckets.h"
+#include "constants.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "io.h"
+#include "minibatch_kmeans.h"
+#include "params.h"
+#include "rand.h"
+
+using namespace std;
+
+static void Write(unsigned int street, const string &bucketing,
+		  MiniBatchKMeans *kmeans, bool packed) {
+  char buf[500];
+  // Remove a file in the other format which would otherwise shadow (or be
+  // shadowed by) the new one.
+  BucketsFilename(street, bucketing, ! packed, buf);
+  remove(buf);
+  BucketsFilename(street, bucketing, packed, buf);
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(street);
+  unsigned long long int num_hands =
+    ((unsigned long long int)BoardTree::NumBoards(street)) *
+    num_hole_card_pairs;
+  unsigned int num_buckets = kmeans->NumClusters();
+  unsigned int batch_size = kmeans->BatchSize();
+  bool short_buckets = num_buckets <= 65536;
+  unique_ptr<PackedBucketsWriter> packed_writer;
+  unique_ptr<Writer> writer;
+  if (packed) packed_writer.reset(new PackedBucketsWriter(buf, num_buckets));
+  else        writer.reset(new Writer(buf));
+  unsigned int *assignments = new unsigned int[batch_size];
+  for (unsigned long long int h = 0; h < num_hands; h += batch_size) {
+    unsigned int num = batch_size;
+    if (h + num > num_hands) num = num_hands - h;
+    kmeans->AssignRange(h, num, assignments);
+    for (unsigned int i = 0; i < num; ++i) {
+      unsigned int b = assignments[i];
+      if (packed)             packed_writer->Write(b);
+      else if (short_buckets) writer->WriteUnsignedShort(b);
+      else                    writer->WriteUnsignedInt(b);
+    }
+    fprintf(stderr, "Assigned %llu/%llu\n", h + num, num_hands);
+  }
+  delete [] assignments;
+
+  sprintf(buf, "%s/num_buckets.%s.%i.%i.%i.%s.%i",
+	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
+	  Game::NumSuits(), Game::MaxStreet(), bucketing.c_str(), street);
+  Writer writer2(buf);
+  writer2.WriteUnsignedInt(num_buckets);
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <street> <num clusters> "
+	  "<bucketing> <features> <batch size> <num batches> "
+	  "<neighbor thresh> <num threads> [packed]\n", prog_name);
+  fprintf(stderr, "\nBatch size is rounded down to a multiple of the "
+	  "number of hole card pairs\n");
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 10 && argc != 11) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unsigned int street;
+  if (sscanf(argv[2], "%u", &street) != 1) Usage(argv[0]);
+  unsigned int num_clusters;
+  if (sscanf(argv[3], "%u", &num_clusters) != 1) Usage(argv[0]);
+  string bucketing = argv[4];
+  string features = argv[5];
+  unsigned int batch_size, num_batches;
+  if (sscanf(argv[6], "%u", &batch_size) != 1)  Usage(argv[0]);
+  if (sscanf(argv[7], "%u", &num_batches) != 1) Usage(argv[0]);
+  double neighbor_thresh;
+  if (sscanf(argv[8], "%lf", &neighbor_thresh) != 1) Usage(argv[0]);
+  unsigned int num_threads;
+  if (sscanf(argv[9], "%u", &num_threads) != 1) Usage(argv[0]);
+  bool packed = false;
+  if (argc == 11) {
+    if (strcmp(argv[10], "packed")) Usage(argv[0]);
+    packed = true;
+  }
+
+  // Make clustering deterministic
+  SeedRand(0);
+
+  // Just need this to get number of hands
+  BoardTree::Create();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(street);
+  unsigned long long int num_hands =
+    ((unsigned long long int)BoardTree::NumBoards(street)) *
+    num_hole_card_pairs;
+  fprintf(stderr, "%llu hands\n", num_hands);
+
+  char buf[500];
+  sprintf(buf, "%s/features.%s.%u.%s.%u", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), features.c_str(),
+	  street);
+  Reader reader(buf);
+  MiniBatchKMeans kmeans(num_clusters, &reader, num_hands,
+			 num_hole_card_pairs, batch_size, num_threads);
+  kmeans.Cluster(num_batches);
+  fprintf(stderr, "Num actual buckets: %u\n", kmeans.NumClusters());
+  kmeans.ComputeNeighbors(neighbor_thresh);
+  Write(street, bucketing, &kmeans, packed);
+}
@@ -1,11 +1,13 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <memory>
 #include <string>
 
 #include "board_tree.h"
+#include "buckets.h"
 #include "canonical_cards.h"
 #include "constants.h"
 #include "files.h"
@@ -257,18 +259,23 @@ static void NullRiver(Writer *writer, bool short_buckets,
 #endif
 
 static void Usage(const char *prog_name) {
-  fprintf(stderr, "USAGE: %s <game params> <street>\n", prog_name);
+  fprintf(stderr, "USAGE: %s <game params> <street> [packed]\n", prog_name);
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 3) Usage(argv[0]);
+  if (argc != 3 && argc != 4) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
   Game::Initialize(*game_params);
   unsigned int street;
   if (sscanf(argv[2], "%u", &street) != 1) Usage(argv[0]);
+  bool packed = false;
+  if (argc == 4) {
+    if (strcmp(argv[3], "packed")) Usage(argv[0]);
+    packed = true;
+  }
 
   BoardTree::Create();
   unsigned int num_boards = BoardTree::NumBoards(street);
@@ -306,16 +313,22 @@ int main(int argc, char *argv[]) {
   unsigned int num_buckets = b;
   printf("Num buckets: %u\n", num_buckets);
 
-  bool short_buckets = (num_buckets <= 65536);
-
   char buf[500];
-  sprintf(buf, "%s/buckets.%s.%u.%u.%u.null.%u",
-	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
-	  Game::NumSuits(), Game::MaxStreet(), street);
-  Writer writer(buf);
-  for (unsigned int h = 0; h < num_hands; ++h) {
-    if (short_buckets) writer.WriteUnsignedShort(buckets[h]);
-    else               writer.WriteUnsignedInt(buckets[h]);
+  // Remove a file in the other format which would otherwise shadow (or be
+  // shadowed by) the new one.
+  BucketsFilename(street, "null", ! packed, buf);
+  remove(buf);
+  BucketsFilename(street, "null", packed, buf);
+  if (packed) {
+    PackedBucketsWriter writer(buf, num_buckets);
+    for (unsigned int h = 0; h < num_hands; ++h) writer.Write(buckets[h]);
+  } else {
+    bool short_buckets = (num_buckets <= 65536);
+    Writer writer(buf);
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      if (short_buckets) writer.WriteUnsignedShort(buckets[h]);
+      else               writer.WriteUnsignedInt(buckets[h]);
+    }
   }
 
   sprintf(buf, "%s/num_buckets.%s.%u.%u.%u.null.%u",
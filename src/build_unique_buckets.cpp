@@ -5,11 +5,13 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <string>
 #include <unordered_map>
 
 #include "board_tree.h"
+#include "buckets.h"
 #include "constants.h"
 #include "fast_hash.h"
 #include "files.h"
@@ -23,13 +25,13 @@
 using namespace std;
 
 static void Usage(const char *prog_name) {
-  fprintf(stderr, "USAGE: %s <game params> <street> <bucketing> <features>\n",
-	  prog_name);
+  fprintf(stderr, "USAGE: %s <game params> <street> <bucketing> <features> "
+	  "[packed]\n", prog_name);
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 5) Usage(argv[0]);
+  if (argc != 5 && argc != 6) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -38,6 +40,11 @@ int main(int argc, char *argv[]) {
   if (sscanf(argv[2], "%u", &st) != 1) Usage(argv[0]);
   string bucketing = argv[3];
   string features = argv[4];
+  bool packed = false;
+  if (argc == 6) {
+    if (strcmp(argv[5], "packed")) Usage(argv[0]);
+    packed = true;
+  }
 
   BoardTree::Create();
   unsigned int num_boards = BoardTree::NumBoards(st);
@@ -79,19 +86,27 @@ int main(int argc, char *argv[]) {
   fprintf(stderr, "%u buckets\n", num_buckets);
   delete sad;
 
-  bool short_buckets = num_buckets < 65536;
-
-  sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i",
-	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
-	  Game::NumSuits(), Game::MaxStreet(), bucketing.c_str(), st);
-  Writer writer(buf);
-  if (short_buckets) {
+  // Remove a file in the other format which would otherwise shadow (or be
+  // shadowed by) the new one.
+  BucketsFilename(st, bucketing, ! packed, buf);
+  remove(buf);
+  BucketsFilename(st, bucketing, packed, buf);
+  if (packed) {
+    PackedBucketsWriter writer(buf, num_buckets);
     for (unsigned int h = 0; h < num_hands; ++h) {
-      writer.WriteUnsignedShort((unsigned short)buckets[h]);
+      writer.Write(buckets[h]);
     }
   } else {
-    for (unsigned int h = 0; h < num_hands; ++h) {
-      writer.WriteUnsignedInt(buckets[h]);
+    bool short_buckets = num_buckets < 65536;
+    Writer writer(buf);
+    if (short_buckets) {
+      for (unsigned int h = 0; h < num_hands; ++h) {
+	writer.WriteUnsignedShort((unsigned short)buckets[h]);
+      }
+    } else {
+      for (unsigned int h = 0; h < num_hands; ++h) {
+	writer.WriteUnsignedInt(buckets[h]);
+      }
     }
   }
 
@@ -21,16 +21,75 @@
 // AcKcQc/3s2h to AcKcQc/3d2h.  It gives the lower suit (diamonds) to the
 // higher hole card.
 
+#include <pthread.h>
+#include <string.h>
+
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include "canonical_cards.h"
 #include "cards.h"
 #include "game.h"
 #include "hand_value_tree.h"
+#include "io.h"
 
 using namespace std;
 
+// The canonicalization of every hole card pair under one set of suit groups.
+// Neither NumMappings() nor ToCanon() looks at the board, so all boards with
+// the same suit groups (there are at most 15 distinct sets with four suits)
+// share one table.  Indexed by hi * (max_card + 1) + lo.
+struct PairCanons {
+  unique_ptr<unsigned char []> num_variants;
+  unique_ptr<unsigned int []> canon;
+};
+
+static pthread_mutex_t g_pair_canons_mutex = PTHREAD_MUTEX_INITIALIZER;
+static map< unsigned int, unique_ptr<PairCanons> > g_pair_canons;
+
+// True if every suit is in its own group, in which case every hand is
+// canonical and has a single variant.
+static bool IdentitySuitGroups(unsigned int suit_groups) {
+  unsigned int num_suits = Game::NumSuits();
+  for (unsigned int s = 0; s < num_suits; ++s) {
+    if (((unsigned char *)&suit_groups)[s] != s) return false;
+  }
+  return true;
+}
+
+// Thread-safe.  Tables are built on first use and never freed.
+const PairCanons *CanonicalCards::LookupPairCanons(unsigned int suit_groups) {
+  pthread_mutex_lock(&g_pair_canons_mutex);
+  unique_ptr<PairCanons> &pc = g_pair_canons[suit_groups];
+  if (! pc) {
+    unsigned int max_card = Game::MaxCard();
+    unsigned int num_enc = (max_card + 1) * (max_card + 1);
+    pc.reset(new PairCanons);
+    pc->num_variants.reset(new unsigned char[num_enc]);
+    pc->canon.reset(new unsigned int[num_enc]);
+    Card cards[2], canon_cards[2];
+    for (unsigned int hi = 1; hi <= max_card; ++hi) {
+      cards[0] = hi;
+      for (unsigned int lo = 0; lo < hi; ++lo) {
+	cards[1] = lo;
+	unsigned int enc = hi * (max_card + 1) + lo;
+	unsigned int num_mappings = NumMappings(cards, 2, suit_groups);
+	pc->num_variants[enc] = num_mappings;
+	if (num_mappings == 0) {
+	  ToCanon(cards, 2, suit_groups, canon_cards);
+	  pc->canon[enc] = canon_cards[0] * (max_card + 1) + canon_cards[1];
+	} else {
+	  pc->canon[enc] = enc;
+	}
+      }
+    }
+  }
+  const PairCanons *ret = pc.get();
+  pthread_mutex_unlock(&g_pair_canons_mutex);
+  return ret;
+}
+
 CanonicalCards::CanonicalCards(unsigned int n, const Card *previous,
 			       unsigned int num_previous,
 			       unsigned int previous_suit_groups,
@@ -88,25 +147,17 @@ CanonicalCards::CanonicalCards(unsigned int n, const Card *previous,
       suit_groups_.reset(new unsigned int[num]);
     }
     
-    Card canon_cards[2];
+    const PairCanons *pc = nullptr;
+    if (! IdentitySuitGroups(previous_suit_groups)) {
+      pc = LookupPairCanons(previous_suit_groups);
+    }
     for (unsigned int hi = 1; hi <= max_card; ++hi) {
       if (InCards(hi, previous, num_previous)) continue;
       for (unsigned int lo = 0; lo < hi; ++lo) {
 	if (InCards(lo, previous, num_previous)) continue;
 	cards_[index * 2] = hi;
 	cards_[index * 2 + 1] = lo;
-	unsigned int num_mappings = NumMappings(&cards_[index * 2], n,
-						previous_suit_groups);
-	num_variants_[index] = num_mappings;
-	unsigned short encoding;
-	if (num_mappings == 0) {
-	  ToCanon(&cards_[index * 2], n, previous_suit_groups, canon_cards);
-	  encoding = canon_cards[0] * (max_card + 1) + canon_cards[1];
-	} else {
-	  encoding = hi * (max_card + 1) + lo;
-	  ++num_canon_;
-	}
-	canon_[index] = encoding;
+	SetPairCanon(index, pc);
 	if (maintain_suit_groups) {
 	  UpdateSuitGroups(&cards_[index * 2], n_, previous_suit_groups,
 			   &suit_groups_[index]);
@@ -169,11 +220,169 @@ CanonicalCards::CanonicalCards(unsigned int n, const Card *previous,
     exit(-1);
   }
   num_raw_ = index;
+  BuildPairLayout();
+}
+
+CanonicalCards::CanonicalCards(const CanonicalCards &parent,
+			       const Card *board, unsigned int num_board_cards,
+			       unsigned int suit_groups) {
+  if (parent.n_ != 2 || parent.hand_values_) {
+    fprintf(stderr, "CanonicalCards: parent must hold unsorted pairs\n");
+    exit(-1);
+  }
+  n_ = 2;
+  unsigned int num_remaining = Game::NumCardsInDeck() - num_board_cards;
+  unsigned int num = num_remaining * (num_remaining - 1) / 2;
+  cards_.reset(new Card[2 * num]);
+  num_variants_.reset(new unsigned char[num]);
+  canon_.reset(new unsigned int[num]);
+  num_canon_ = 0;
+  const PairCanons *pc = nullptr;
+  if (! IdentitySuitGroups(suit_groups)) pc = LookupPairCanons(suit_groups);
+  unsigned int index = 0;
+  for (unsigned int i = 0; i < parent.num_raw_; ++i) {
+    Card hi = parent.cards_[2 * i];
+    Card lo = parent.cards_[2 * i + 1];
+    if (InCards(hi, board, num_board_cards) ||
+	InCards(lo, board, num_board_cards)) {
+      continue;
+    }
+    cards_[index * 2] = hi;
+    cards_[index * 2 + 1] = lo;
+    SetPairCanon(index, pc);
+    ++index;
+  }
+  if (index != num) {
+    fprintf(stderr, "CanonicalCards: %u hands from parent, expected %u\n",
+	    index, num);
+    exit(-1);
+  }
+  num_raw_ = index;
+  BuildPairLayout();
+}
+
+// Sets the number of variants and the canonical encoding of the index'th
+// pair from the table for the suit groups.  A null table means every suit
+// is in its own group.
+void CanonicalCards::SetPairCanon(unsigned int index, const PairCanons *pc) {
+  unsigned int enc = cards_[index * 2] * (Game::MaxCard() + 1) +
+    cards_[index * 2 + 1];
+  if (pc == nullptr) {
+    num_variants_[index] = 1;
+    canon_[index] = enc;
+    ++num_canon_;
+  } else {
+    unsigned int num_variants = pc->num_variants[enc];
+    num_variants_[index] = num_variants;
+    canon_[index] = pc->canon[enc];
+    if (num_variants > 0) ++num_canon_;
+  }
+}
+
+// Record layout: n, num_raw, num_canon and flags (bit 0: hand values, bit 1:
+// suit groups) as unsigned ints, followed by the cards, canon, hand values
+// and suit groups arrays and then the num variants bytes.
+CanonicalCards::CanonicalCards(const unsigned char *image) {
+  const unsigned int *header = (const unsigned int *)image;
+  n_ = header[0];
+  num_raw_ = header[1];
+  num_canon_ = header[2];
+  unsigned int flags = header[3];
+  const unsigned char *ptr = image + 4 * sizeof(unsigned int);
+  cards_.reset(new Card[num_raw_ * n_]);
+  memcpy(cards_.get(), ptr, num_raw_ * n_ * sizeof(Card));
+  ptr += num_raw_ * n_ * sizeof(Card);
+  canon_.reset(new unsigned int[num_raw_]);
+  memcpy(canon_.get(), ptr, num_raw_ * sizeof(unsigned int));
+  ptr += num_raw_ * sizeof(unsigned int);
+  if (flags & 1) {
+    hand_values_.reset(new unsigned int[num_raw_]);
+    memcpy(hand_values_.get(), ptr, num_raw_ * sizeof(unsigned int));
+    ptr += num_raw_ * sizeof(unsigned int);
+  }
+  if (flags & 2) {
+    suit_groups_.reset(new unsigned int[num_raw_]);
+    memcpy(suit_groups_.get(), ptr, num_raw_ * sizeof(unsigned int));
+    ptr += num_raw_ * sizeof(unsigned int);
+  }
+  num_variants_.reset(new unsigned char[num_raw_]);
+  memcpy(num_variants_.get(), ptr, num_raw_);
+  BuildPairLayout();
 }
 
 CanonicalCards::~CanonicalCards(void) {
 }
 
+unsigned long long int CanonicalCards::NumBytes(void) const {
+  unsigned long long int bytes_per_hand =
+    n_ * sizeof(Card) + sizeof(unsigned char) + sizeof(unsigned int);
+  if (hand_values_) bytes_per_hand += sizeof(unsigned int);
+  if (suit_groups_) bytes_per_hand += sizeof(unsigned int);
+  if (hi_cards_)    bytes_per_hand += 2 * sizeof(unsigned char);
+  return sizeof(CanonicalCards) + num_raw_ * bytes_per_hand;
+}
+
+unsigned long long int CanonicalCards::WriteImage(Writer *writer) const {
+  unsigned int flags = 0;
+  if (hand_values_) flags |= 1;
+  if (suit_groups_) flags |= 2;
+  writer->WriteUnsignedInt(n_);
+  writer->WriteUnsignedInt(num_raw_);
+  writer->WriteUnsignedInt(num_canon_);
+  writer->WriteUnsignedInt(flags);
+  unsigned long long int num_bytes = 4 * sizeof(unsigned int);
+  writer->WriteNBytes((unsigned char *)cards_.get(),
+		      num_raw_ * n_ * sizeof(Card));
+  num_bytes += num_raw_ * n_ * sizeof(Card);
+  writer->WriteNBytes((unsigned char *)canon_.get(),
+		      num_raw_ * sizeof(unsigned int));
+  num_bytes += num_raw_ * sizeof(unsigned int);
+  if (hand_values_) {
+    writer->WriteNBytes((unsigned char *)hand_values_.get(),
+			num_raw_ * sizeof(unsigned int));
+    num_bytes += num_raw_ * sizeof(unsigned int);
+  }
+  if (suit_groups_) {
+    writer->WriteNBytes((unsigned char *)suit_groups_.get(),
+			num_raw_ * sizeof(unsigned int));
+    num_bytes += num_raw_ * sizeof(unsigned int);
+  }
+  writer->WriteNBytes(num_variants_.get(), num_raw_);
+  num_bytes += num_raw_;
+  while (num_bytes % 8 != 0) {
+    writer->WriteUnsignedChar(0);
+    ++num_bytes;
+  }
+  return num_bytes;
+}
+
+void CanonicalCards::BuildPairLayout(void) {
+  if (n_ != 2) return;
+  hi_cards_.reset(new unsigned char[num_raw_]);
+  lo_cards_.reset(new unsigned char[num_raw_]);
+  for (unsigned int i = 0; i < num_raw_; ++i) {
+    hi_cards_[i] = cards_[2 * i];
+    lo_cards_[i] = cards_[2 * i + 1];
+  }
+}
+
+void CanonicalCards::CanonIndices(unsigned int *canon_indices) const {
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  for (unsigned int i = 0; i < num_raw_; ++i) {
+    if (num_variants_[i] > 0) {
+      canon_indices[cards_[2 * i] * max_card1 + cards_[2 * i + 1]] = i;
+    }
+  }
+  // Every hand is its own canonical hand; e.g., most turn and river boards
+  if (num_canon_ == num_raw_) return;
+  for (unsigned int i = 0; i < num_raw_; ++i) {
+    if (num_variants_[i] == 0) {
+      canon_indices[cards_[2 * i] * max_card1 + cards_[2 * i + 1]] =
+	canon_indices[canon_[i]];
+    }
+  }
+}
+
 // This version does not resort the cards
 // Returns true if a change was made
 bool CanonicalCards::ToCanon2(const Card *cards, unsigned int num_cards,
@@ -353,19 +562,12 @@ void CanonicalCards::SortByHandStrength(const Card *board) {
 #endif
   vector<Hand> hands(num_raw_);
   Hand h;
-  unsigned int hole_cards[2];
+  // Evaluate all the hands for this board in one go
+  unique_ptr<unsigned int []> hvs(new unsigned int[num_raw_]);
+  HandValueTree::BoardVals(sorted_board.get(), cards_.get(), num_raw_,
+			   hvs.get());
   for (unsigned int i = 0; i < num_raw_; ++i) {
-    Card *cards = &cards_[i * n_];
-    hole_cards[0] = cards[0];
-    hole_cards[1] = cards[1];
-    // We know hole cards are sorted
-#if 0
-    for (unsigned int j = 0; j < num_board_cards; ++j) {
-      fprintf(stderr, "%i ", (int)sorted_board.get()[j]);
-    }
-    fprintf(stderr, "/ %i %i\n", hole_cards[0], hole_cards[1]);
-#endif
-    h.hv = HandValueTree::Val(sorted_board.get(), hole_cards);
+    h.hv = hvs[i];
     h.index = i;
     hands[i] = h;
   }
@@ -391,6 +593,7 @@ void CanonicalCards::SortByHandStrength(const Card *board) {
   cards_.reset(new_cards);
   num_variants_.reset(new_num_variants);
   canon_.reset(new_canon);
+  BuildPairLayout();
 }
 
 unsigned int NChooseK(unsigned int n, unsigned int k) {
@@ -5,6 +5,9 @@
 
 #include "cards.h"
 
+class Writer;
+struct PairCanons;
+
 class CanonicalCards {
  public:
   CanonicalCards(void) {}
@@ -12,12 +15,31 @@ class CanonicalCards {
 		 unsigned int num_previous,
 		 unsigned int previous_suit_groups,
 		 bool maintain_suit_groups);
+  // Builds the hole card pairs for a board on the next street from those of
+  // its predecessor board.  Keeps the parent's hands that do not conflict
+  // with the new board, in the same order.  The parent must hold hole card
+  // pairs that have not been sorted by hand strength.  Suit groups are not
+  // maintained.
+  CanonicalCards(const CanonicalCards &parent, const Card *board,
+		 unsigned int num_board_cards, unsigned int suit_groups);
+  // Copies a record written by WriteImage() (e.g., from a mapped board tree
+  // image).
+  CanonicalCards(const unsigned char *image);
   virtual ~CanonicalCards(void);
   void SortByHandStrength(const Card *board);
+  // Writes a self-describing record padded to a multiple of eight bytes.
+  // Returns the number of bytes written.
+  unsigned long long int WriteImage(Writer *writer) const;
+  // Approximate memory used by this object, including its arrays
+  unsigned long long int NumBytes(void) const;
   static bool ToCanon2(const Card *cards, unsigned int num_cards,
 		       unsigned int suit_groups, Card *canon_cards);
   static void ToCanon(const Card *cards, unsigned int num_cards,
 		      unsigned int suit_groups, Card *canon_cards);
+  // Fills canon_indices, indexed by hole card encoding, with the index of
+  // the canonical hand that each hand maps to.  Only entries for this
+  // object's hands are written.  Requires N() to be two.
+  void CanonIndices(unsigned int *canon_indices) const;
   unsigned int NumVariants(unsigned int i) const {return num_variants_[i];}
   unsigned int Canon(unsigned int i) const {return canon_[i];}
   unsigned int N(void) const {return n_;}
@@ -25,10 +47,19 @@ class CanonicalCards {
   unsigned int NumCanon(void) const {return num_canon_;}
   const Card *Cards(unsigned int i) const {return &cards_[i * n_];}
   unsigned int HandValue(unsigned int i) const {return hand_values_[i];}
+  const unsigned int *HandValues(void) const {return hand_values_.get();}
   unsigned int SuitGroups(unsigned int i) const {return suit_groups_[i];}
+  // Structure-of-arrays copies of the high and low hole cards, in the same
+  // order as Cards().  Only maintained when N() is two; nullptr otherwise.
+  // Used by the vectorized Showdown() and Fold() kernels.
+  const unsigned char *HiCards(void) const {return hi_cards_.get();}
+  const unsigned char *LoCards(void) const {return lo_cards_.get();}
  protected:
-  unsigned int NumMappings(const Card *cards, unsigned int n,
-			   unsigned int old_suit_groups);
+  static unsigned int NumMappings(const Card *cards, unsigned int n,
+				  unsigned int old_suit_groups);
+  static const PairCanons *LookupPairCanons(unsigned int suit_groups);
+  void SetPairCanon(unsigned int index, const PairCanons *pc);
+  void BuildPairLayout(void);
 
   unsigned int n_;
   unique_ptr<Card []> cards_;
@@ -38,6 +69,8 @@ class CanonicalCards {
   unsigned int num_raw_;
   unsigned int num_canon_;
   unique_ptr<unsigned int []> suit_groups_;
+  unique_ptr<unsigned char []> hi_cards_;
+  unique_ptr<unsigned char []> lo_cards_;
 };
 
 void UpdateSuitGroups(const Card *cards,
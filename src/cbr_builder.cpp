@@ -39,7 +39,12 @@ CBRBuilder::CBRBuilder(const CardAbstraction &ca, const BettingAbstraction &ba,
   HandValueTree::Create();
   unsigned int max_street = Game::MaxStreet();
   unsigned int num_trunk_streets = max_street + 1;
-  trunk_hand_tree_ = new HandTree(0, 0, num_trunk_streets - 1);
+  if (cfr_config_.LazyHandTree()) {
+    trunk_hand_tree_ = new HandTree(0, 0, num_trunk_streets - 1,
+				    cfr_config_.HandTreeMaxBytes());
+  } else {
+    trunk_hand_tree_ = new HandTree(0, 0, num_trunk_streets - 1);
+  }
   
   trunk_thread_ = new CBRThread(card_abstraction_, betting_abstraction_,
 				cfr_config_, buckets, betting_tree_, cfrs, p,
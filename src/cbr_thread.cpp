@@ -32,6 +32,7 @@
 #include <cmath>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -204,6 +205,7 @@ double CBRThread::Go(void) {
   VCFRState state(opp_probs, street_buckets, trunk_hand_tree_, p_, nullptr,
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
+  ArenaFrame frame(state.GetArena());
   double *vals = Process(betting_tree_->Root(), 0, state, 0);
   DeleteStreetBuckets(street_buckets);
   delete [] opp_probs;
@@ -228,6 +230,5 @@ double CBRThread::Go(void) {
   double diff_sec = difftime(end_t, start_t);
   printf("Process took %.1f seconds\n", diff_sec);
   fflush(stdout);
-  delete [] vals;
   return ev;
 }
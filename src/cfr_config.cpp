@@ -79,6 +79,13 @@ CFRConfig::CFRConfig(const Params &params) {
   } else {
     subgame_street_ = kMaxUInt;
   }
+  // The street at which VCFR divides the work between threads.  Defaults
+  // to the flop.
+  if (params.IsSet("SplitStreet")) {
+    split_street_ = params.GetIntValue("SplitStreet");
+  } else {
+    split_street_ = 1;
+  }
   if (params.IsSet("SamplingRate")) {
     sampling_rate_ = params.GetIntValue("SamplingRate");
   }
@@ -131,6 +138,31 @@ CFRConfig::CFRConfig(const Params &params) {
   }
   double_regrets_ = params.GetBooleanValue("DoubleRegrets");
   double_sumprobs_ = params.GetBooleanValue("DoubleSumprobs");
+  float_regret_streets_.reset(new bool[max_street + 1]);
+  float_sumprob_streets_.reset(new bool[max_street + 1]);
+  for (unsigned int st = 0; st <= max_street; ++st) {
+    float_regret_streets_[st] = false;
+    float_sumprob_streets_[st] = false;
+  }
+  vector<unsigned int> frsv, fssv;
+  ParseUnsignedInts(params.GetStringValue("FloatRegretStreets"), &frsv);
+  unsigned int num_frsv = frsv.size();
+  for (unsigned int i = 0; i < num_frsv; ++i) {
+    if (frsv[i] > max_street) {
+      fprintf(stderr, "FloatRegretStreets: street %u out of range\n", frsv[i]);
+      exit(-1);
+    }
+    float_regret_streets_[frsv[i]] = true;
+  }
+  ParseUnsignedInts(params.GetStringValue("FloatSumprobStreets"), &fssv);
+  unsigned int num_fssv = fssv.size();
+  for (unsigned int i = 0; i < num_fssv; ++i) {
+    if (fssv[i] > max_street) {
+      fprintf(stderr, "FloatSumprobStreets: street %u out of range\n", fssv[i]);
+      exit(-1);
+    }
+    float_sumprob_streets_[fssv[i]] = true;
+  }
   ParseUnsignedInts(params.GetStringValue("CompressedStreets"),
 		    &compressed_streets_);
 
@@ -200,4 +232,29 @@ CFRConfig::CFRConfig(const Params &params) {
   deal_twice_ = params.GetBooleanValue("DealTwice");
   boost_ = params.GetBooleanValue("Boost");
   maintain_cvs_ = params.GetBooleanValue("MaintainCVs");
+  atomic_updates_ = params.GetBooleanValue("AtomicUpdates");
+  aligned_streets_.reset(new bool[max_street + 1]);
+  for (unsigned int st = 0; st <= max_street; ++st) {
+    aligned_streets_[st] = false;
+  }
+  vector<unsigned int> asv;
+  ParseUnsignedInts(params.GetStringValue("AlignedStreets"), &asv);
+  unsigned int num_asv = asv.size();
+  for (unsigned int i = 0; i < num_asv; ++i) {
+    if (asv[i] > max_street) {
+      fprintf(stderr, "AlignedStreets: street %u out of range\n", asv[i]);
+      exit(-1);
+    }
+    aligned_streets_[asv[i]] = true;
+  }
+  huge_pages_ = params.GetBooleanValue("HugePages");
+  pin_threads_ = params.GetBooleanValue("PinThreads");
+  numa_interleave_ = params.GetBooleanValue("NUMAInterleave");
+  background_checkpoints_ = params.GetBooleanValue("BackgroundCheckpoints");
+  lazy_hand_tree_ = params.GetBooleanValue("LazyHandTree");
+  hand_tree_max_bytes_ = 0;
+  if (params.IsSet("HandTreeMaxMB")) {
+    hand_tree_max_bytes_ =
+      params.GetIntValue("HandTreeMaxMB") * 1024ULL * 1024ULL;
+  }
 }
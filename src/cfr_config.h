@@ -26,6 +26,7 @@ public:
   unsigned int SoftWarmup(void) const {return soft_warmup_;}
   unsigned int HardWarmup(void) const {return hard_warmup_;}
   unsigned int SubgameStreet(void) const {return subgame_street_;}
+  unsigned int SplitStreet(void) const {return split_street_;}
   unsigned int SamplingRate(void) const {return sampling_rate_;}
   bool SumprobStreet(unsigned int p, unsigned int st) const {
     return sumprob_streets_[p][st];
@@ -69,6 +70,13 @@ public:
   unsigned int SaveInterval(void) const {return save_interval_;}
   bool DoubleRegrets(void) const {return double_regrets_;}
   bool DoubleSumprobs(void) const {return double_sumprobs_;}
+  // Float streets override DoubleRegrets/DoubleSumprobs on that street.
+  bool FloatRegretStreet(unsigned int st) const {
+    return float_regret_streets_[st];
+  }
+  bool FloatSumprobStreet(unsigned int st) const {
+    return float_sumprob_streets_[st];
+  }
   const vector<unsigned int> &CompressedStreets(void) const {
     return compressed_streets_;
   }
@@ -76,6 +84,29 @@ public:
   bool DealTwice(void) const {return deal_twice_;}
   bool Boost(void) const {return boost_;}
   bool MaintainCVs(void) const {return maintain_cvs_;}
+  // TCFR only.  Apply regret and sumprob updates to the shared buffer with
+  // relaxed atomics instead of plain (hogwild) read-modify-writes.
+  bool AtomicUpdates(void) const {return atomic_updates_;}
+  // TCFR only.  Start the bucket data of nodes on this street on a cache
+  // line.
+  bool AlignedStreet(unsigned int st) const {return aligned_streets_[st];}
+  // TCFR only.  Back the prepared tree buffer with 2 MB pages.
+  bool HugePages(void) const {return huge_pages_;}
+  // TCFR and ECFR.  Pin worker threads to CPUs, spread across NUMA nodes.
+  bool PinThreads(void) const {return pin_threads_;}
+  // TCFR and ECFR.  Interleave the regret and sumprob storage across NUMA
+  // nodes rather than placing it all on the node of the main thread.
+  bool NUMAInterleave(void) const {return numa_interleave_;}
+  // TCFR only.  Write checkpoints from a forked child while training
+  // continues.
+  bool BackgroundCheckpoints(void) const {return background_checkpoints_;}
+  // CFRP, RGBR and CBRs.  Build the hands for each board of the full game
+  // hand tree on first use.  If HandTreeMaxMB is set, evict least recently
+  // used boards to stay under that many megabytes.
+  bool LazyHandTree(void) const {return lazy_hand_tree_;}
+  unsigned long long int HandTreeMaxBytes(void) const {
+    return hand_tree_max_bytes_;
+  }
  private:
   string cfr_config_name_;
   string algorithm_;
@@ -89,6 +120,7 @@ public:
   unsigned int soft_warmup_;
   unsigned int hard_warmup_;
   unsigned int subgame_street_;
+  unsigned int split_street_;
   unsigned int sampling_rate_;
   bool **sumprob_streets_;
   vector<unsigned int> pruning_thresholds_;
@@ -110,11 +142,21 @@ public:
   unsigned int save_interval_;
   bool double_regrets_;
   bool double_sumprobs_;
+  unique_ptr<bool []> float_regret_streets_;
+  unique_ptr<bool []> float_sumprob_streets_;
   vector<unsigned int> compressed_streets_;
   bool uniform_;
   bool deal_twice_;
   bool boost_;
   bool maintain_cvs_;
+  bool atomic_updates_;
+  unique_ptr<bool []> aligned_streets_;
+  bool huge_pages_;
+  bool pin_threads_;
+  bool numa_interleave_;
+  bool background_checkpoints_;
+  bool lazy_hand_tree_;
+  unsigned long long int hand_tree_max_bytes_;
 };
 
 #endif
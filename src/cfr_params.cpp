@@ -25,6 +25,7 @@ unique_ptr<Params> CreateCFRParams(void) {
   params->AddParam("SoftWarmup", P_INT);
   params->AddParam("HardWarmup", P_INT);
   params->AddParam("SubgameStreet", P_INT);
+  params->AddParam("SplitStreet", P_INT);
   params->AddParam("OverweightingFactor", P_INT);
   params->AddParam("SamplingRate", P_INT);
   params->AddParam("SumprobStreets", P_STRING);
@@ -37,6 +38,8 @@ unique_ptr<Params> CreateCFRParams(void) {
   params->AddParam("Probe", P_BOOLEAN);
   params->AddParam("DoubleRegrets", P_BOOLEAN);
   params->AddParam("DoubleSumprobs", P_BOOLEAN);
+  params->AddParam("FloatRegretStreets", P_STRING);
+  params->AddParam("FloatSumprobStreets", P_STRING);
   params->AddParam("CompressedStreets", P_STRING);
   params->AddParam("CloseThresholds", P_STRING);
   params->AddParam("ActiveMod", P_INT);
@@ -48,6 +51,14 @@ unique_ptr<Params> CreateCFRParams(void) {
   params->AddParam("DealTwice", P_BOOLEAN);
   params->AddParam("Boost", P_BOOLEAN);
   params->AddParam("MaintainCVs", P_BOOLEAN);
+  params->AddParam("AtomicUpdates", P_BOOLEAN);
+  params->AddParam("AlignedStreets", P_STRING);
+  params->AddParam("HugePages", P_BOOLEAN);
+  params->AddParam("PinThreads", P_BOOLEAN);
+  params->AddParam("NUMAInterleave", P_BOOLEAN);
+  params->AddParam("BackgroundCheckpoints", P_BOOLEAN);
+  params->AddParam("LazyHandTree", P_BOOLEAN);
+  params->AddParam("HandTreeMaxMB", P_INT);
 
   return params;
 }
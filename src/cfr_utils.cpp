@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <immintrin.h>
 
 #include "betting_abstraction.h"
 #include "betting_tree.h"
@@ -18,16 +19,213 @@
 #include "io.h"
 #include "split.h"
 
-double *Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
-		 double sum_opp_probs, double *total_card_probs) {
+
+// Showdown() and Fold() kernels that work off of the structure-of-arrays
+// hole card layout in CanonicalCards.  There is a scalar version and an
+// AVX2 version of each; the AVX2 version is selected at runtime if the CPU
+// supports it.  The AVX2 versions perform the same operations in the same
+// order as the scalar versions, so the results are identical.
+
+static bool HaveAVX2(void) {
+  static bool have_avx2 = __builtin_cpu_supports("avx2");
+  return have_avx2;
+}
+
+// Showdown over hands sorted by hand strength.  cum_card_probs must be
+// zeroed by the caller.
+static void ShowdownScalar(const unsigned char *his, const unsigned char *los,
+			   const unsigned int *hand_values, unsigned int n,
+			   unsigned int max_card1, const double *opp_probs,
+			   double sum_opp_probs, const double *total_card_probs,
+			   double half_pot, double *cum_card_probs,
+			   double *vals) {
+  double cum_prob = 0;
+  unsigned int j = 0;
+  while (j < n) {
+    unsigned int last_hand_val = hand_values[j];
+    unsigned int begin_range = j;
+    // First pass computes win probs for each hand and finds end of range
+    while (j < n && hand_values[j] == last_hand_val) {
+      vals[j] = cum_prob - cum_card_probs[his[j]] - cum_card_probs[los[j]];
+      ++j;
+    }
+    // Second pass updates cumulative counters
+    for (unsigned int k = begin_range; k < j; ++k) {
+      Card hi = his[k];
+      Card lo = los[k];
+      double prob = opp_probs[hi * max_card1 + lo];
+      cum_card_probs[hi] += prob;
+      cum_card_probs[lo] += prob;
+      cum_prob += prob;
+    }
+    // Third pass computes lose probs and values
+    for (unsigned int k = begin_range; k < j; ++k) {
+      Card hi = his[k];
+      Card lo = los[k];
+      double better_hi_prob = total_card_probs[hi] - cum_card_probs[hi];
+      double better_lo_prob = total_card_probs[lo] - cum_card_probs[lo];
+      double lose_prob = (sum_opp_probs - cum_prob) -
+	better_hi_prob - better_lo_prob;
+      vals[k] = (vals[k] - lose_prob) * half_pot;
+    }
+  }
+}
+
+static void FoldScalar(const unsigned char *his, const unsigned char *los,
+		       unsigned int n, unsigned int max_card1,
+		       const double *opp_probs, double sum_opp_probs,
+		       const double *total_card_probs, double half_pot,
+		       double *vals) {
+  for (unsigned int i = 0; i < n; ++i) {
+    Card hi = his[i];
+    Card lo = los[i];
+    double opp_prob = opp_probs[hi * max_card1 + lo];
+    vals[i] = half_pot *
+      (sum_opp_probs + opp_prob -
+       (total_card_probs[hi] + total_card_probs[lo]));
+  }
+}
+
+// Widen four card indices to 32-bit lanes for use as gather indices.
+__attribute__((target("avx2")))
+static inline __m128i LoadFourCards(const unsigned char *cards) {
+  int four;
+  memcpy(&four, cards, sizeof(four));
+  return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(four));
+}
+
+// Gathers four doubles at the given indices.  The unmasked
+// _mm256_i32gather_pd() passes an undefined source operand, which GCC
+// reports with -Wmaybe-uninitialized under -O3 -flto; the masked form with
+// a zero source and an all-ones mask is equivalent.
+__attribute__((target("avx2")))
+static inline __m256d GatherFour(const double *base, __m128i idx) {
+  __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx, all, 8);
+}
+
+// Within a range of equally strong hands the first and third passes only
+// read the cumulative card probs, so they can be done four hands at a time
+// with gathers.  The second pass updates per-card sums and may have
+// conflicts between lanes, so it stays scalar.
+__attribute__((target("avx2")))
+static void ShowdownAVX2(const unsigned char *his, const unsigned char *los,
+			 const unsigned int *hand_values, unsigned int n,
+			 unsigned int max_card1, const double *opp_probs,
+			 double sum_opp_probs, const double *total_card_probs,
+			 double half_pot, double *cum_card_probs,
+			 double *vals) {
+  __m256d v_half_pot = _mm256_set1_pd(half_pot);
+  double cum_prob = 0;
+  unsigned int j = 0;
+  while (j < n) {
+    unsigned int last_hand_val = hand_values[j];
+    unsigned int begin_range = j;
+    while (j < n && hand_values[j] == last_hand_val) ++j;
+    unsigned int end_range = j;
+    unsigned int k = begin_range;
+    __m256d v_cum_prob = _mm256_set1_pd(cum_prob);
+    for (; k + 4 <= end_range; k += 4) {
+      __m128i hi = LoadFourCards(his + k);
+      __m128i lo = LoadFourCards(los + k);
+      __m256d c_hi = GatherFour(cum_card_probs, hi);
+      __m256d c_lo = GatherFour(cum_card_probs, lo);
+      _mm256_storeu_pd(vals + k,
+		       _mm256_sub_pd(_mm256_sub_pd(v_cum_prob, c_hi), c_lo));
+    }
+    for (; k < end_range; ++k) {
+      vals[k] = cum_prob - cum_card_probs[his[k]] - cum_card_probs[los[k]];
+    }
+    for (k = begin_range; k < end_range; ++k) {
+      Card hi = his[k];
+      Card lo = los[k];
+      double prob = opp_probs[hi * max_card1 + lo];
+      cum_card_probs[hi] += prob;
+      cum_card_probs[lo] += prob;
+      cum_prob += prob;
+    }
+    __m256d v_rem_prob = _mm256_set1_pd(sum_opp_probs - cum_prob);
+    k = begin_range;
+    for (; k + 4 <= end_range; k += 4) {
+      __m128i hi = LoadFourCards(his + k);
+      __m128i lo = LoadFourCards(los + k);
+      __m256d better_hi_prob =
+	_mm256_sub_pd(GatherFour(total_card_probs, hi),
+		      GatherFour(cum_card_probs, hi));
+      __m256d better_lo_prob =
+	_mm256_sub_pd(GatherFour(total_card_probs, lo),
+		      GatherFour(cum_card_probs, lo));
+      __m256d lose_prob =
+	_mm256_sub_pd(_mm256_sub_pd(v_rem_prob, better_hi_prob),
+		      better_lo_prob);
+      __m256d win_prob = _mm256_loadu_pd(vals + k);
+      _mm256_storeu_pd(vals + k,
+		       _mm256_mul_pd(_mm256_sub_pd(win_prob, lose_prob),
+				     v_half_pot));
+    }
+    for (; k < end_range; ++k) {
+      Card hi = his[k];
+      Card lo = los[k];
+      double better_hi_prob = total_card_probs[hi] - cum_card_probs[hi];
+      double better_lo_prob = total_card_probs[lo] - cum_card_probs[lo];
+      double lose_prob = (sum_opp_probs - cum_prob) -
+	better_hi_prob - better_lo_prob;
+      vals[k] = (vals[k] - lose_prob) * half_pot;
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+static void FoldAVX2(const unsigned char *his, const unsigned char *los,
+		     unsigned int n, unsigned int max_card1,
+		     const double *opp_probs, double sum_opp_probs,
+		     const double *total_card_probs, double half_pot,
+		     double *vals) {
+  __m128i v_max_card1 = _mm_set1_epi32(max_card1);
+  __m256d v_sum_opp_probs = _mm256_set1_pd(sum_opp_probs);
+  __m256d v_half_pot = _mm256_set1_pd(half_pot);
+  unsigned int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i hi = LoadFourCards(his + i);
+    __m128i lo = LoadFourCards(los + i);
+    __m128i enc = _mm_add_epi32(_mm_mullo_epi32(hi, v_max_card1), lo);
+    __m256d opp_prob = GatherFour(opp_probs, enc);
+    __m256d t_hi = GatherFour(total_card_probs, hi);
+    __m256d t_lo = GatherFour(total_card_probs, lo);
+    __m256d v = _mm256_sub_pd(_mm256_add_pd(v_sum_opp_probs, opp_prob),
+			      _mm256_add_pd(t_hi, t_lo));
+    _mm256_storeu_pd(vals + i, _mm256_mul_pd(v_half_pot, v));
+  }
+  FoldScalar(his + i, los + i, n - i, max_card1, opp_probs, sum_opp_probs,
+	     total_card_probs, half_pot, vals + i);
+}
+
+void Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
+	      double sum_opp_probs, double *total_card_probs, double *vals) {
   unsigned int max_card1 = Game::MaxCard() + 1;
   double cum_prob = 0;
   double cum_card_probs[52];
   for (Card c = 0; c < max_card1; ++c) cum_card_probs[c] = 0;
   unsigned int num_hole_card_pairs = hands->NumRaw();
-  double *win_probs = new double[num_hole_card_pairs];
   double half_pot = node->LastBetTo();
-  double *vals = new double[num_hole_card_pairs];
+  // The win probs are stored in vals until the third pass turns them into
+  // values, so no scratch array is needed.
+
+  const unsigned char *his = hands->HiCards();
+  if (his) {
+    const unsigned char *los = hands->LoCards();
+    const unsigned int *hand_values = hands->HandValues();
+    if (HaveAVX2()) {
+      ShowdownAVX2(his, los, hand_values, num_hole_card_pairs, max_card1,
+		   opp_probs, sum_opp_probs, total_card_probs, half_pot,
+		   cum_card_probs, vals);
+    } else {
+      ShowdownScalar(his, los, hand_values, num_hole_card_pairs, max_card1,
+		     opp_probs, sum_opp_probs, total_card_probs, half_pot,
+		     cum_card_probs, vals);
+    }
+    return;
+  }
 
   unsigned int j = 0;
   while (j < num_hole_card_pairs) {
@@ -43,7 +241,7 @@ double *Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
       const Card *cards = hands->Cards(j);
       Card hi = cards[0];
       Card lo = cards[1];
-      win_probs[j] = cum_prob - cum_card_probs[hi] - cum_card_probs[lo];
+      vals[j] = cum_prob - cum_card_probs[hi] - cum_card_probs[lo];
       ++j;
     }
     // Positions begin_range...j-1 (inclusive) all have the same hand value
@@ -65,18 +263,21 @@ double *Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
       double better_lo_prob = total_card_probs[lo] - cum_card_probs[lo];
       double lose_prob = (sum_opp_probs - cum_prob) -
 	better_hi_prob - better_lo_prob;
-      vals[k] = (win_probs[k] - lose_prob) * half_pot;
+      vals[k] = (vals[k] - lose_prob) * half_pot;
     }
   }
+}
 
-  delete [] win_probs;
-
+double *Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
+		 double sum_opp_probs, double *total_card_probs) {
+  double *vals = new double[hands->NumRaw()];
+  Showdown(node, hands, opp_probs, sum_opp_probs, total_card_probs, vals);
   return vals;
 }
 
-double *Fold(Node *node, unsigned int p, const CanonicalCards *hands,
-	     double *opp_probs, double sum_opp_probs,
-	     double *total_card_probs) {
+void Fold(Node *node, unsigned int p, const CanonicalCards *hands,
+	  double *opp_probs, double sum_opp_probs, double *total_card_probs,
+	  double *vals) {
   unsigned int max_card1 = Game::MaxCard() + 1;
   // Sign of half_pot reflects who wins the pot
   double half_pot;
@@ -88,7 +289,19 @@ double *Fold(Node *node, unsigned int p, const CanonicalCards *hands,
     half_pot = -(double)node->LastBetTo();
   }
   unsigned int num_hole_card_pairs = hands->NumRaw();
-  double *vals = new double[num_hole_card_pairs];
+
+  const unsigned char *his = hands->HiCards();
+  if (his) {
+    const unsigned char *los = hands->LoCards();
+    if (HaveAVX2()) {
+      FoldAVX2(his, los, num_hole_card_pairs, max_card1, opp_probs,
+	       sum_opp_probs, total_card_probs, half_pot, vals);
+    } else {
+      FoldScalar(his, los, num_hole_card_pairs, max_card1, opp_probs,
+		 sum_opp_probs, total_card_probs, half_pot, vals);
+    }
+    return;
+  }
 
   for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
     const Card *cards = hands->Cards(i);
@@ -100,7 +313,13 @@ double *Fold(Node *node, unsigned int p, const CanonicalCards *hands,
       (sum_opp_probs + opp_prob -
        (total_card_probs[hi] + total_card_probs[lo]));
   }
+}
 
+double *Fold(Node *node, unsigned int p, const CanonicalCards *hands,
+	     double *opp_probs, double sum_opp_probs,
+	     double *total_card_probs) {
+  double *vals = new double[hands->NumRaw()];
+  Fold(node, p, hands, opp_probs, sum_opp_probs, total_card_probs, vals);
   return vals;
 }
 
@@ -192,13 +411,16 @@ void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
   }
 }
 
-// Abstracted, double sumprobs
-void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
-			     const CanonicalCards *hands, bool nonneg,
-			     unsigned int it, unsigned int soft_warmup,
-			     unsigned int hard_warmup, bool update_sumprobs,
-			     double *opp_probs, double **succ_opp_probs,
-			     double *current_probs, double *sumprobs) {
+// Abstracted, floating-point sumprobs (double or float)
+template <typename S>
+static void ProcessOppProbsBucketedT(Node *node,
+				     unsigned int **street_buckets,
+				     const CanonicalCards *hands,
+				     unsigned int it, unsigned int soft_warmup,
+				     unsigned int hard_warmup,
+				     bool update_sumprobs, double *opp_probs,
+				     double **succ_opp_probs,
+				     double *current_probs, S *sumprobs) {
   unsigned int st = node->Street();
   unsigned int num_succs = node->NumSuccs();
   unsigned int num_hole_cards = Game::NumCardsForStreet(0);
@@ -222,7 +444,7 @@ void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
     } else {
       unsigned int b = street_buckets[st][i];
       double *my_current_probs = current_probs + b * num_succs;
-      double *my_sumprobs = nullptr;
+      S *my_sumprobs = nullptr;
       if (sumprobs) my_sumprobs = sumprobs + b * num_succs;
       for (unsigned int s = 0; s < num_succs; ++s) {
 	double succ_opp_prob = opp_prob * my_current_probs[s];
@@ -247,6 +469,30 @@ void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
   }
 }
 
+// Abstracted, double sumprobs
+void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
+			     const CanonicalCards *hands, bool nonneg,
+			     unsigned int it, unsigned int soft_warmup,
+			     unsigned int hard_warmup, bool update_sumprobs,
+			     double *opp_probs, double **succ_opp_probs,
+			     double *current_probs, double *sumprobs) {
+  ProcessOppProbsBucketedT(node, street_buckets, hands, it, soft_warmup,
+			   hard_warmup, update_sumprobs, opp_probs,
+			   succ_opp_probs, current_probs, sumprobs);
+}
+
+// Abstracted, float sumprobs
+void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
+			     const CanonicalCards *hands, bool nonneg,
+			     unsigned int it, unsigned int soft_warmup,
+			     unsigned int hard_warmup, bool update_sumprobs,
+			     double *opp_probs, double **succ_opp_probs,
+			     double *current_probs, float *sumprobs) {
+  ProcessOppProbsBucketedT(node, street_buckets, hands, it, soft_warmup,
+			   hard_warmup, update_sumprobs, opp_probs,
+			   succ_opp_probs, current_probs, sumprobs);
+}
+
 // Unabstracted, unsigned char cs_vals, no sumprobs
 void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 		     unsigned int **street_buckets, bool nonneg, bool uniform,
@@ -422,13 +668,16 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
   delete [] nonterminal_succs;
 }
 
-// Unabstracted, double cs_vals, double sumprobs
-void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
-		     unsigned int **street_buckets, bool nonneg, bool uniform,
-		     double explore, unsigned int it, unsigned int soft_warmup,
-		     unsigned int hard_warmup, bool update_sumprobs,
-		     double *opp_probs, double **succ_opp_probs,
-		     double *cs_vals, double *sumprobs) {
+// Unabstracted, unscaled cs_vals (double, float or int), floating-point
+// sumprobs (double or float)
+template <typename C, typename S>
+static void ProcessOppProbsT(Node *node, const CanonicalCards *hands,
+			     bool bucketed, unsigned int **street_buckets,
+			     bool nonneg, bool uniform, double explore,
+			     unsigned int it, unsigned int soft_warmup,
+			     unsigned int hard_warmup, bool update_sumprobs,
+			     double *opp_probs, double **succ_opp_probs,
+			     C *cs_vals, S *sumprobs) {
   unsigned int st = node->Street();
   unsigned int num_succs = node->NumSuccs();
   unsigned int num_hole_cards = Game::NumCardsForStreet(0);
@@ -462,14 +711,14 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 	succ_opp_probs[s][enc] = 0;
       }
     } else {
-      double *my_cs_vals;
+      C *my_cs_vals;
       if (bucketed) {
 	unsigned int b = street_buckets[st][i];
 	my_cs_vals = cs_vals + b * num_succs;
       } else {
 	my_cs_vals = cs_vals + i * num_succs;
       }
-      double *my_sumprobs = nullptr;
+      S *my_sumprobs = nullptr;
       if (update_sumprobs) {
 	if (bucketed) {
 	  unsigned int b = street_buckets[st][i];
@@ -506,6 +755,18 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
   delete [] nonterminal_succs;
 }
 
+// Unabstracted, double cs_vals, double sumprobs
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     double *cs_vals, double *sumprobs) {
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
+}
+
 // Unabstracted, int cs_vals, double sumprobs
 void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 		     unsigned int **street_buckets, bool nonneg, bool uniform,
@@ -513,81 +774,57 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 		     unsigned int hard_warmup, bool update_sumprobs,
 		     double *opp_probs, double **succ_opp_probs,
 		     int *cs_vals, double *sumprobs) {
-  unsigned int st = node->Street();
-  unsigned int num_succs = node->NumSuccs();
-  unsigned int num_hole_cards = Game::NumCardsForStreet(0);
-  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  unsigned int default_succ_index = node->DefaultSuccIndex();
-  unsigned int max_card1 = Game::MaxCard() + 1;
-  double *current_probs = new double[num_succs];
-  unsigned int num_nonterminal_succs = 0;
-  bool *nonterminal_succs = new bool[num_succs];
-  for (unsigned int s = 0; s < num_succs; ++s) {
-    if (node->IthSucc(s)->Terminal()) {
-      nonterminal_succs[s] = false;
-    } else {
-      nonterminal_succs[s] = true;
-      ++num_nonterminal_succs;
-    }
-  }
-  for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
-    const Card *cards = hands->Cards(i);
-    Card hi = cards[0];
-    unsigned int enc;
-    if (num_hole_cards == 1) {
-      enc = hi;
-    } else {
-      Card lo = cards[1];
-      enc = hi * max_card1 + lo;
-    }
-    double opp_prob = opp_probs[enc];
-    if (opp_prob == 0) {
-      for (unsigned int s = 0; s < num_succs; ++s) {
-	succ_opp_probs[s][enc] = 0;
-      }
-    } else {
-      int *my_cs_vals;
-      if (bucketed) {
-	unsigned int b = street_buckets[st][i];
-	my_cs_vals = cs_vals + b * num_succs;
-      } else {
-	my_cs_vals = cs_vals + i * num_succs;
-      }
-      double *my_sumprobs = nullptr;
-      if (update_sumprobs) {
-	if (bucketed) {
-	  unsigned int b = street_buckets[st][i];
-	  my_sumprobs = sumprobs + b * num_succs;
-	} else {
-	  my_sumprobs = sumprobs + i * num_succs;
-	}
-      }
-      RegretsToProbs(my_cs_vals, num_succs, nonneg, uniform,
-		     default_succ_index, explore, num_nonterminal_succs,
-		     nonterminal_succs, current_probs);
-      for (unsigned int s = 0; s < num_succs; ++s) {
-	double succ_opp_prob = opp_prob * current_probs[s];
-	succ_opp_probs[s][enc] = succ_opp_prob;
-	if (update_sumprobs) {
-	  if ((hard_warmup == 0 && soft_warmup == 0) ||
-	      (soft_warmup > 0 && it <= soft_warmup)) {
-	    // Update sumprobs with weight of 1.  Do this when either:
-	    // a) There is no warmup (hard or soft), or
-	    // b) We are during the soft warmup period.
-	    my_sumprobs[s] += succ_opp_prob;
-	  } else if (hard_warmup > 0) {
-	    // Use a weight of (it - hard_warmup)
-	    my_sumprobs[s] += succ_opp_prob * (it - hard_warmup);
-	  } else {
-	    // Use a weight of (it - soft_warmup)
-	    my_sumprobs[s] += succ_opp_prob * (it - soft_warmup);
-	  }
-	}
-      }
-    }
-  }
-  delete [] current_probs;
-  delete [] nonterminal_succs;
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
+}
+
+// Unabstracted, float cs_vals, double sumprobs (mixed precision)
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     float *cs_vals, double *sumprobs) {
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
+}
+
+// Unabstracted, float cs_vals, float sumprobs
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     float *cs_vals, float *sumprobs) {
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
+}
+
+// Unabstracted, double cs_vals, float sumprobs
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     double *cs_vals, float *sumprobs) {
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
+}
+
+// Unabstracted, int cs_vals, float sumprobs
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     int *cs_vals, float *sumprobs) {
+  ProcessOppProbsT(node, hands, bucketed, street_buckets, nonneg, uniform,
+		   explore, it, soft_warmup, hard_warmup, update_sumprobs,
+		   opp_probs, succ_opp_probs, cs_vals, sumprobs);
 }
 
 void DeleteOldFiles(const CardAbstraction &ca, const BettingAbstraction &ba,
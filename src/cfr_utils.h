@@ -9,6 +9,14 @@ class CardAbstraction;
 class CFRConfig;
 class Node;
 
+// These two write the values of hands into vals, which must hold
+// hands->NumRaw() values.
+void Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
+	      double sum_opp_probs, double *total_card_probs, double *vals);
+void Fold(Node *node, unsigned int p, const CanonicalCards *hands,
+	  double *opp_probs, double sum_opp_probs, double *total_card_probs,
+	  double *vals);
+// These two allocate the returned values with new[].
 double *Showdown(Node *node, const CanonicalCards *hands,
 		 double *opp_probs, double sum_opp_probs,
 		 double *total_card_probs);
@@ -34,6 +42,12 @@ void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
 			     unsigned int hard_warmup, bool update_sumprobs,
 			     double *opp_probs, double **succ_opp_probs,
 			     double *current_probs, double *sumprobs);
+void ProcessOppProbsBucketed(Node *node, unsigned int **street_buckets,
+			     const CanonicalCards *hands, bool nonneg,
+			     unsigned int it, unsigned int soft_warmup,
+			     unsigned int hard_warmup, bool update_sumprobs,
+			     double *opp_probs, double **succ_opp_probs,
+			     double *current_probs, float *sumprobs);
 void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 		     unsigned int **street_buckets, bool nonneg, bool uniform,
 		     double explore, ProbMethod prob_method, unsigned int it,
@@ -58,6 +72,30 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
 		     unsigned int hard_warmup, bool update_sumprobs,
 		     double *opp_probs, double **succ_opp_probs,
 		     int *cs_vals, double *sumprobs);
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     float *cs_vals, double *sumprobs);
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     float *cs_vals, float *sumprobs);
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     double *cs_vals, float *sumprobs);
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, bool bucketed,
+		     unsigned int **street_buckets, bool nonneg, bool uniform,
+		     double explore, unsigned int it, unsigned int soft_warmup,
+		     unsigned int hard_warmup, bool update_sumprobs,
+		     double *opp_probs, double **succ_opp_probs,
+		     int *cs_vals, float *sumprobs);
 void DeleteOldFiles(const CardAbstraction &ca, const BettingAbstraction &ba,
 		    const CFRConfig &cc, unsigned int it);
 void MPTerminal(unsigned int p, const CanonicalCards *hands,
@@ -7,6 +7,7 @@ enum CFRValueType {
   CFR_SHORT,
   CFR_INT,
   CFR_DOUBLE,
+  CFR_FLOAT,
   CFR_BITS,
   CFR_HALF_BYTE,
   CFR_UNKNOWN
@@ -1,9 +1,11 @@
 // Should the tree (subtree) be a member?  Or the root node?
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <cmath>
+#include <vector>
 
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -130,6 +132,7 @@ CFRValues::CFRValues(const bool *players, bool sumprobs, bool *streets,
   s_values_ = nullptr;
   i_values_ = nullptr;
   d_values_ = nullptr;
+  f_values_ = nullptr;
 }
 
 CFRValues::~CFRValues(void) {
@@ -173,16 +176,25 @@ CFRValues::~CFRValues(void) {
 	}
 	delete [] d_values_[p][st];
       }
+      if (f_values_ && f_values_[p] && f_values_[p][st]) {
+	unsigned int num_nt = num_nonterminals_[p][st];
+	for (unsigned int i = 0; i < num_nt; ++i) {
+	  delete [] f_values_[p][st][i];
+	}
+	delete [] f_values_[p][st];
+      }
     }
     if (c_values_) delete [] c_values_[p];
     if (s_values_) delete [] s_values_[p];
     if (i_values_) delete [] i_values_[p];
     if (d_values_) delete [] d_values_[p];
+    if (f_values_) delete [] f_values_[p];
   }
   delete [] c_values_;
   delete [] s_values_;
   delete [] i_values_;
   delete [] d_values_;
+  delete [] f_values_;
 
   for (unsigned int p = 0; p < num_players; ++p) {
     delete [] num_card_holdings_[p];
@@ -204,14 +216,22 @@ void CFRValues::AllocateAndClear(Node *node, CFRValueType value_type,
   unsigned int num_succs = node->NumSuccs();
   unsigned int st = node->Street();
   unsigned int p = node->PlayerActing();
+  // Streets that AllocateAndClearByStreet() assigned a different value type
+  // to have no array for value_type; skip them.
+  bool typed_street = (value_type == CFR_CHAR && Chars(p, st)) ||
+    (value_type == CFR_SHORT && Shorts(p, st)) ||
+    (value_type == CFR_INT && Ints(p, st)) ||
+    (value_type == CFR_DOUBLE && Doubles(p, st)) ||
+    (value_type == CFR_FLOAT && Floats(p, st));
   if (streets_[st] && players_[p] && (only_p == kMaxUInt || p == only_p) &&
-      num_succs > 1) {
+      num_succs > 1 && typed_street) {
     unsigned int nt = node->NonterminalID();
     // Check for reentrant nodes
     if (! (value_type == CFR_CHAR && c_values_[p][st][nt]) &&
 	! (value_type == CFR_SHORT && s_values_[p][st][nt]) &&
 	! (value_type == CFR_INT && i_values_[p][st][nt]) &&
-	! (value_type == CFR_DOUBLE && d_values_[p][st][nt])) {
+	! (value_type == CFR_DOUBLE && d_values_[p][st][nt]) &&
+	! (value_type == CFR_FLOAT && f_values_[p][st][nt])) {
       bool bucketed = num_bucket_holdings_[p][st] > 0 &&
 	node->LastBetTo() < bucket_thresholds_[st];
       unsigned int num_holdings;
@@ -233,6 +253,10 @@ void CFRValues::AllocateAndClear(Node *node, CFRValueType value_type,
 	int *vals = new int[num_actions];
 	for (unsigned int a = 0; a < num_actions; ++a) vals[a] = 0;
 	i_values_[p][st][nt] = vals;
+      } else if (value_type == CFR_FLOAT) {
+	float *vals = new float[num_actions];
+	for (unsigned int a = 0; a < num_actions; ++a) vals[a] = 0;
+	f_values_[p][st][nt] = vals;
       } else {
 	double *vals = new double[num_actions];
 	for (unsigned int a = 0; a < num_actions; ++a) vals[a] = 0;
@@ -370,6 +394,107 @@ void CFRValues::AllocateAndClearDoubles(Node *node, unsigned int only_p) {
   AllocateAndClear(node, CFR_DOUBLE, only_p);
 }
 
+void CFRValues::AllocateAndClearFloats(Node *node, unsigned int only_p) {
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_players = Game::NumPlayers();
+  if (f_values_ == nullptr) {
+    f_values_ = new float ***[num_players];
+    for (unsigned int p = 0; p < num_players; ++p) f_values_[p] = nullptr;
+  }
+  for (unsigned int p = 0; p < num_players; ++p) {
+    // Skip player if a) players_[p] is false, or b) only_p is set to a
+    // different player.
+    if (! players_[p] || (only_p != kMaxUInt && p != only_p)) {
+      continue;
+    }
+    f_values_[p] = new float **[max_street + 1];
+    for (unsigned int st = 0; st <= max_street; ++st) {
+      if (streets_[st]) {
+	if (compressed_streets_[st]) {
+	  fprintf(stderr, "Can't use compression in combination with "
+		  "floats\n");
+	  exit(-1);
+	}
+	unsigned int num_nt = num_nonterminals_[p][st];
+	f_values_[p][st] = new float *[num_nt];
+	for (unsigned int i = 0; i < num_nt; ++i) {
+	  f_values_[p][st][i] = nullptr;
+	}
+      } else {
+	f_values_[p][st] = nullptr;
+      }
+    }
+  }
+
+  AllocateAndClear(node, CFR_FLOAT, only_p);
+}
+
+// Allocates the per-player and per-street arrays for values of type T.
+// Outer arrays that already exist are left alone, so this can be called
+// once for each value type in use.
+template <typename T>
+static void AllocateStreetValues(T *****values, unsigned int p,
+				 unsigned int st, unsigned int num_nt) {
+  unsigned int num_players = Game::NumPlayers();
+  unsigned int max_street = Game::MaxStreet();
+  if (*values == nullptr) {
+    *values = new T ***[num_players];
+    for (unsigned int p1 = 0; p1 < num_players; ++p1) (*values)[p1] = nullptr;
+  }
+  if ((*values)[p] == nullptr) {
+    (*values)[p] = new T **[max_street + 1];
+    for (unsigned int st1 = 0; st1 <= max_street; ++st1) {
+      (*values)[p][st1] = nullptr;
+    }
+  }
+  if ((*values)[p][st] == nullptr) {
+    (*values)[p][st] = new T *[num_nt];
+    for (unsigned int i = 0; i < num_nt; ++i) (*values)[p][st][i] = nullptr;
+  }
+}
+
+void CFRValues::AllocateAndClearByStreet(Node *node,
+					 const CFRValueType *value_types,
+					 unsigned int only_p) {
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_players = Game::NumPlayers();
+  bool used[CFR_UNKNOWN + 1];
+  for (unsigned int t = 0; t <= CFR_UNKNOWN; ++t) used[t] = false;
+  for (unsigned int p = 0; p < num_players; ++p) {
+    if (! players_[p] || (only_p != kMaxUInt && p != only_p)) {
+      continue;
+    }
+    for (unsigned int st = 0; st <= max_street; ++st) {
+      if (! streets_[st]) continue;
+      CFRValueType value_type = value_types[st];
+      if (compressed_streets_[st] && value_type != CFR_INT) {
+	fprintf(stderr, "Can only use compression in combination with ints\n");
+	exit(-1);
+      }
+      unsigned int num_nt = num_nonterminals_[p][st];
+      if (value_type == CFR_CHAR) {
+	AllocateStreetValues(&c_values_, p, st, num_nt);
+      } else if (value_type == CFR_SHORT) {
+	AllocateStreetValues(&s_values_, p, st, num_nt);
+      } else if (value_type == CFR_INT) {
+	AllocateStreetValues(&i_values_, p, st, num_nt);
+      } else if (value_type == CFR_DOUBLE) {
+	AllocateStreetValues(&d_values_, p, st, num_nt);
+      } else if (value_type == CFR_FLOAT) {
+	AllocateStreetValues(&f_values_, p, st, num_nt);
+      } else {
+	fprintf(stderr, "AllocateAndClearByStreet: unsupported value type %i "
+		"on street %u\n", (int)value_type, st);
+	exit(-1);
+      }
+      used[value_type] = true;
+    }
+  }
+  for (unsigned int t = 0; t <= CFR_UNKNOWN; ++t) {
+    if (used[t]) AllocateAndClear(node, (CFRValueType)t, only_p);
+  }
+}
+
 // We delete the inner arrays, but never any of the outer arrays.
 // They will get deleted eventually in CFRValues::~CFRValues().
 void CFRValues::DeleteBelow(Node *node) {
@@ -391,6 +516,9 @@ void CFRValues::DeleteBelow(Node *node) {
     } else if (d_values_&& d_values_[p] && d_values_[p][st]) {
       delete [] d_values_[p][st][nt];
       d_values_[p][st][nt] = nullptr;
+    } else if (f_values_&& f_values_[p] && f_values_[p][st]) {
+      delete [] f_values_[p][st][nt];
+      f_values_[p][st][nt] = nullptr;
     }
   }
   for (unsigned int s = 0; s < num_succs; ++s) {
@@ -465,6 +593,8 @@ void CFRValues::WriteNode(Node *node, Writer *writer,
 	writer->WriteInt(i_values_[p][st][nt][a + offset]);
       } else if (d_values_&& d_values_[p] && d_values_[p][st]) {
 	writer->WriteDouble(d_values_[p][st][nt][a + offset]);
+      } else if (f_values_&& f_values_[p] && f_values_[p][st]) {
+	writer->WriteFloat(f_values_[p][st][nt][a + offset]);
       }
     }
   }
@@ -559,6 +689,8 @@ Writer ***CFRValues::InitializeWriters(const char *dir, unsigned int it,
 	suffix = "i";
       } else if (d_values_ && d_values_[p] && d_values_[p][st]) {
 	suffix = "d";
+      } else if (f_values_ && f_values_[p] && f_values_[p][st]) {
+	suffix = "f";
       } else {
 	// This can happen in CFR+ if we don't read anything at a subtree
 	// because it is all-in.  Set writer and compressor to nullptr.
@@ -667,14 +799,21 @@ Reader *CFRValues::InitializeReader(const char *dir, unsigned int p,
 	if (FileExists(buf)) {
 	  *value_type = CFR_SHORT;
 	} else {
-	  // This can happen in CFR+.  For example, for a subgame that is
-	  // entirely all-in, nothing is saved.
-	  *value_type = CFR_UNKNOWN;
+	  sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.f", dir,
+		  sumprobs_ ? "sumprobs" : "regrets", action_sequence.c_str(),
+		  root_bd_st, root_bd, st, it, p);
+	  if (FileExists(buf)) {
+	    *value_type = CFR_FLOAT;
+	  } else {
+	    // This can happen in CFR+.  For example, for a subgame that is
+	    // entirely all-in, nothing is saved.
+	    *value_type = CFR_UNKNOWN;
 #if 0
-	  fprintf(stderr, "Couldn't find file\n");
-	  fprintf(stderr, "buf: %s\n", buf);
-	  exit(-1);
+	    fprintf(stderr, "Couldn't find file\n");
+	    fprintf(stderr, "buf: %s\n", buf);
+	    exit(-1);
 #endif
+	  }
 	}
       }
     }
@@ -809,6 +948,11 @@ void CFRValues::InitializeValuesForReading(unsigned int p, unsigned int st,
     if (i_values_[p][st][nt] == nullptr) {
       i_values_[p][st][nt] = new int[num_actions];
     }
+  } else if (value_type == CFR_FLOAT) {
+    AllocateStreetValues(&f_values_, p, st, num_nonterminals_[p][st]);
+    if (f_values_[p][st][nt] == nullptr) {
+      f_values_[p][st][nt] = new float[num_actions];
+    }
   } else {
     if (d_values_ == nullptr) {
       unsigned int num_players = Game::NumPlayers();
@@ -852,7 +996,9 @@ bool CFRValues::ReadNode(Node *node, Reader *reader, void *decompressor,
       (value_type == CFR_INT && i_values_ && i_values_[p] &&
        i_values_[p][st] && i_values_[p][st][nt]) ||
       (value_type == CFR_DOUBLE && d_values_ && d_values_[p] &&
-       d_values_[p][st] && d_values_[p][st][nt])) {
+       d_values_[p][st] && d_values_[p][st][nt]) ||
+      (value_type == CFR_FLOAT && f_values_ && f_values_[p] &&
+       f_values_[p][st] && f_values_[p][st][nt])) {
     return true;
   }
   if (reader == nullptr) {
@@ -862,13 +1008,10 @@ bool CFRValues::ReadNode(Node *node, Reader *reader, void *decompressor,
   InitializeValuesForReading(p, st, nt, node, value_type);
   unsigned int num_actions = num_holdings * num_succs;
   if (value_type == CFR_CHAR) {
-    for (unsigned int a = 0; a < num_actions; ++a) {
-      c_values_[p][st][nt][offset + a] = reader->ReadUnsignedCharOrDie();
-    }
+    reader->ReadNBytesOrDie(num_actions, &c_values_[p][st][nt][offset]);
   } else if (value_type == CFR_SHORT) {
-    for (unsigned int a = 0; a < num_actions; ++a) {
-      s_values_[p][st][nt][offset + a] = reader->ReadUnsignedShortOrDie();
-    }
+    reader->ReadNBytesOrDie(num_actions * sizeof(unsigned short),
+			    (unsigned char *)&s_values_[p][st][nt][offset]);
   } else if (value_type == CFR_INT) {
     if (compressed_streets_[st]) {
 #ifdef EJC
@@ -895,33 +1038,31 @@ bool CFRValues::ReadNode(Node *node, Reader *reader, void *decompressor,
 #endif
       }
     } else {
-      for (unsigned int a = 0; a < num_actions; ++a) {
-	i_values_[p][st][nt][offset + a] = reader->ReadIntOrDie();
-      }
+      reader->ReadNBytesOrDie(num_actions * sizeof(int),
+			      (unsigned char *)&i_values_[p][st][nt][offset]);
     }
+  } else if (value_type == CFR_FLOAT) {
+    reader->ReadNBytesOrDie(num_actions * sizeof(float),
+			    (unsigned char *)&f_values_[p][st][nt][offset]);
   } else {
-    for (unsigned int a = 0; a < num_actions; ++a) {
-      d_values_[p][st][nt][offset + a] = reader->ReadDoubleOrDie();
-    }
+    reader->ReadNBytesOrDie(num_actions * sizeof(double),
+			    (unsigned char *)&d_values_[p][st][nt][offset]);
   }
 
   return false;
 }
 
-void CFRValues::Read(Node *node, Reader ***readers, void ***decompressors,
-		     CFRValueType **value_types, unsigned int only_p) {
+// Reads the values for player p on street st only.  Each (p, st) pair has
+// its own file, so these can be read concurrently.  Nodes of other players
+// and streets are passed through without being touched.
+void CFRValues::ReadPlayerStreet(Node *node, unsigned int p, unsigned int st,
+				 Reader *reader, void *decompressor,
+				 CFRValueType value_type) {
   if (node->Terminal()) return;
-  unsigned int st = node->Street();
-  unsigned int num_succs = node->NumSuccs();
-  unsigned int p = node->PlayerActing();
-  unsigned int max_street = Game::MaxStreet();
-  unsigned int st1;
-  for (st1 = st; st1 <= max_street; ++st1) {
-    if (streets_[st1]) break;
-  }
-  if (st1 > max_street) return;
-  if (streets_[st] && players_[p] && ! (only_p <= 1 && p != only_p)) {
-    Reader *reader = readers[p][st];
+  unsigned int nst = node->Street();
+  // Streets never decrease going down the tree
+  if (nst > st) return;
+  if (nst == st && node->PlayerActing() == p) {
     bool bucketed = num_bucket_holdings_[p][st] > 0 &&
       node->LastBetTo() < bucket_thresholds_[st];
     unsigned int num_holdings;
@@ -930,17 +1071,34 @@ void CFRValues::Read(Node *node, Reader ***readers, void ***decompressors,
     } else {
       num_holdings = num_card_holdings_[p][st];
     }
-    if (ReadNode(node, reader, decompressors ? decompressors[p][st] : nullptr,
-		 num_holdings, value_types[p][st], 0)) {
+    if (ReadNode(node, reader, decompressor, num_holdings, value_type, 0)) {
       return;
     }
-
   }
+  unsigned int num_succs = node->NumSuccs();
   for (unsigned int s = 0; s < num_succs; ++s) {
-    Read(node->IthSucc(s), readers, decompressors, value_types, only_p);
+    ReadPlayerStreet(node->IthSucc(s), p, st, reader, decompressor,
+		     value_type);
   }
 }
 
+struct CFRValuesReadArgs {
+  CFRValues *values;
+  Node *root;
+  unsigned int p;
+  unsigned int st;
+  Reader *reader;
+  void *decompressor;
+  CFRValueType value_type;
+};
+
+void *CFRValues::ReadThread(void *thread_args) {
+  CFRValuesReadArgs *args = (CFRValuesReadArgs *)thread_args;
+  args->values->ReadPlayerStreet(args->root, args->p, args->st, args->reader,
+				 args->decompressor, args->value_type);
+  return NULL;
+}
+
 // Some care is required if we are reading the values for a subtree.
 // The "root" node passed in should be from a tree just for the subtree,
 // so we will get dense nonterminal IDs.  The subtree_nt passed in should
@@ -993,7 +1151,54 @@ void CFRValues::Read(const char *dir, unsigned int it, Node *root,
     }
   }
 
-  Read(root, readers, decompressors, value_types, only_p);
+  // The outer arrays are shared between streets and players, so allocate
+  // them here before any reading threads start.  Each thread then only
+  // allocates the per-node arrays for its own player and street.
+  vector<CFRValuesReadArgs> tasks;
+  for (unsigned int p = 0; p < num_players; ++p) {
+    if (readers[p] == nullptr) continue;
+    for (unsigned int st = 0; st <= max_street; ++st) {
+      if (! streets_[st]) continue;
+      unsigned int num_nt = num_nonterminals_[p][st];
+      if (num_nt > 0) {
+	CFRValueType value_type = value_types[p][st];
+	if (value_type == CFR_CHAR) {
+	  AllocateStreetValues(&c_values_, p, st, num_nt);
+	} else if (value_type == CFR_SHORT) {
+	  AllocateStreetValues(&s_values_, p, st, num_nt);
+	} else if (value_type == CFR_INT) {
+	  AllocateStreetValues(&i_values_, p, st, num_nt);
+	} else if (value_type == CFR_DOUBLE) {
+	  AllocateStreetValues(&d_values_, p, st, num_nt);
+	} else if (value_type == CFR_FLOAT) {
+	  AllocateStreetValues(&f_values_, p, st, num_nt);
+	}
+      }
+      // Tasks with no file are still run so that ReadNode() can complain
+      // if the player and street has any nodes.
+      CFRValuesReadArgs args;
+      args.values = this;
+      args.root = root;
+      args.p = p;
+      args.st = st;
+      args.reader = readers[p][st];
+      args.decompressor = decompressors[p][st];
+      args.value_type = value_types[p][st];
+      tasks.push_back(args);
+    }
+  }
+  unsigned int num_tasks = tasks.size();
+  if (num_tasks == 1) {
+    ReadThread(&tasks[0]);
+  } else {
+    unique_ptr<pthread_t []> pthread_ids(new pthread_t[num_tasks]);
+    for (unsigned int t = 0; t < num_tasks; ++t) {
+      pthread_create(&pthread_ids[t], NULL, ReadThread, &tasks[t]);
+    }
+    for (unsigned int t = 0; t < num_tasks; ++t) {
+      pthread_join(pthread_ids[t], NULL);
+    }
+  }
   
   for (unsigned int p = 0; p < num_players; ++p) {
     if (only_p != kMaxUInt && p != only_p) {
@@ -1045,6 +1250,7 @@ void CFRValues::MergeInto(Node *full_node, Node *subgame_node,
     bool chars = subgame_values.Chars(p, st);
     bool shorts = subgame_values.Shorts(p, st);
     bool ints = subgame_values.Ints(p, st);
+    bool floats = subgame_values.Floats(p, st);
     if (chars) {
       if (c_values_ == nullptr) {
 	unsigned int num_players = Game::NumPlayers();
@@ -1105,6 +1311,8 @@ void CFRValues::MergeInto(Node *full_node, Node *subgame_node,
 	  i_values_[p][st][i] = nullptr;
 	}
       }
+    } else if (floats) {
+      AllocateStreetValues(&f_values_, p, st, num_nonterminals_[p][st]);
     } else {
       if (d_values_ == nullptr) {
 	unsigned int num_players = Game::NumPlayers();
@@ -1179,6 +1387,14 @@ void CFRValues::MergeInto(Node *full_node, Node *subgame_node,
 	  i_values_[p][st][full_nt][a] = 0;
 	}
       }
+    } else if (floats) {
+      if (f_values_[p][st][full_nt] == nullptr) {
+	f_values_[p][st][full_nt] = new float[num_actions];
+	// Zeroing out is needed for bucketed case
+	for (unsigned int a = 0; a < num_actions; ++a) {
+	  f_values_[p][st][full_nt][a] = 0;
+	}
+      }
     } else {
       if (d_values_[p][st][full_nt] == nullptr) {
 	d_values_[p][st][full_nt] = new double[num_actions];
@@ -1263,6 +1479,20 @@ void CFRValues::MergeInto(Node *full_node, Node *subgame_node,
 	    }
 	  }
 	}
+      } else if (floats) {
+	float *fvals = subgame_values.f_values_[p][st][subgame_nt];
+	for (unsigned int lbd = 0; lbd < num_local_boards; ++lbd) {
+	  unsigned int gbd =
+	    BoardTree::GlobalIndex(root_bd_st, root_bd, st, lbd);
+	  for (unsigned int hcp = 0; hcp < num_hole_card_pairs; ++hcp) {
+	    for (unsigned int s = 0; s < num_succs; ++s) {
+	      float v = fvals[a++];
+	      unsigned int new_a = gbd * num_hole_card_pairs * num_succs +
+		hcp * num_succs + s;
+	      f_values_[p][st][full_nt][new_a] = v;
+	    }
+	  }
+	}
       } else {
 	double *dvals = subgame_values.d_values_[p][st][subgame_nt];
 	for (unsigned int lbd = 0; lbd < num_local_boards; ++lbd) {
@@ -1315,6 +1545,11 @@ void CFRValues::MergeInto(Node *full_node, Node *subgame_node,
 	for (unsigned int a = 0; a < num_actions; ++a) {
 	  i_values_[p][st][full_nt][a] += ivals[a];
 	}
+      } else if (floats) {
+	float *fvals = subgame_values.f_values_[p][st][subgame_nt];
+	for (unsigned int a = 0; a < num_actions; ++a) {
+	  f_values_[p][st][full_nt][a] += fvals[a];
+	}
       } else {
 	double *dvals = subgame_values.d_values_[p][st][subgame_nt];
 	for (unsigned int a = 0; a < num_actions; ++a) {
@@ -1418,6 +1653,26 @@ void CFRValues::SetValues(Node *node, double *d_values) {
   }
 }
 
+void CFRValues::SetValues(Node *node, float *f_values) {
+  unsigned int num_succs = node->NumSuccs();
+  if (num_succs <= 1) return;
+  unsigned int p = node->PlayerActing();
+  unsigned int st = node->Street();
+  unsigned int nt = node->NonterminalID();
+  bool bucketed = num_bucket_holdings_[p][st] > 0 &&
+    node->LastBetTo() < bucket_thresholds_[st];
+  unsigned int num_holdings;
+  if (bucketed) {
+    num_holdings = num_bucket_holdings_[p][st];
+  } else {
+    num_holdings = num_card_holdings_[p][st];
+  }
+  unsigned int num_actions = num_holdings * num_succs;
+  for (unsigned int a = 0; a < num_actions; ++a) {
+    f_values_[p][st][nt][a] = f_values[a];
+  }
+}
+
 // Assume full probs and subtree probs are defined for the same players.
 // The two betting trees must be identical.
 // Assumes both probs objects are bucketed for same streets.
@@ -1499,6 +1754,10 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 	    for (unsigned int a = 0; a < num_actions; ++a) {
 	      i_values_[p][st][snt][a] = reader->ReadIntOrDie();
 	    }
+	  } else if (value_types[p][st] == CFR_FLOAT) {
+	    for (unsigned int a = 0; a < num_actions; ++a) {
+	      f_values_[p][st][snt][a] = reader->ReadFloatOrDie();
+	    }
 	  } else {
 	    for (unsigned int a = 0; a < num_actions; ++a) {
 	      d_values_[p][st][snt][a] = reader->ReadDoubleOrDie();
@@ -1509,6 +1768,7 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 	  unsigned char cv = 0;
 	  unsigned short sv = 0;
 	  int iv = 0;
+	  float fv = 0;
 	  double dv = 0;
 	  for (unsigned int a = 0; a < num_full_actions; ++a) {
 	    if (value_types[p][st] == CFR_CHAR) {
@@ -1517,6 +1777,8 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 	      sv = reader->ReadUnsignedShortOrDie();
 	    } else if (value_types[p][st] == CFR_INT) {
 	      iv = reader->ReadIntOrDie();
+	    } else if (value_types[p][st] == CFR_FLOAT) {
+	      fv = reader->ReadFloatOrDie();
 	    } else {
 	      dv = reader->ReadDoubleOrDie();
 	    }
@@ -1540,6 +1802,8 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 		s_values_[p][st][snt][la] = sv;
 	      } else if (value_types[p][st] == CFR_INT) {
 		i_values_[p][st][snt][la] = iv;
+	      } else if (value_types[p][st] == CFR_FLOAT) {
+		f_values_[p][st][snt][la] = fv;
 	      } else {
 		d_values_[p][st][snt][la] = dv;
 	      }
@@ -1564,6 +1828,10 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 	    for (unsigned int a = 0; a < num_actions; ++a) {
 	      reader->ReadIntOrDie();
 	    }
+	  } else if (value_types[p][st] == CFR_FLOAT) {
+	    for (unsigned int a = 0; a < num_actions; ++a) {
+	      reader->ReadFloatOrDie();
+	    }
 	  } else {
 	    for (unsigned int a = 0; a < num_actions; ++a) {
 	      reader->ReadDoubleOrDie();
@@ -1582,6 +1850,10 @@ void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *full_subtree_root,
 	    for (unsigned int a = 0; a < num_full_actions; ++a) {
 	      reader->ReadIntOrDie();
 	    }
+	  } else if (value_types[p][st] == CFR_FLOAT) {
+	    for (unsigned int a = 0; a < num_full_actions; ++a) {
+	      reader->ReadFloatOrDie();
+	    }
 	  } else {
 	    for (unsigned int a = 0; a < num_full_actions; ++a) {
 	      reader->ReadDoubleOrDie();
@@ -1755,6 +2027,23 @@ void CFRValues::Probs(unsigned int p, unsigned int st, unsigned int nt,
 	else        probs[s] = 0;
       }
     }
+  } else if (f_values_ && f_values_[p] && f_values_[p][st]) {
+    double sum = 0;
+    for (unsigned int s = 0; s < num_succs; ++s) {
+      double fv = f_values_[p][st][nt][offset + s];
+      if (fv > 0) sum += fv;
+    }
+    if (sum == 0) {
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	probs[s] = (s == dsi ? 1.0 : 0);
+      }
+    } else {
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	double fv = f_values_[p][st][nt][offset + s];
+	if (fv > 0) probs[s] = fv / sum;
+	else        probs[s] = 0;
+      }
+    }
   } else {
     fprintf(stderr, "CFRValues::Probs() No values?!?\n");
     exit(-1);
@@ -35,6 +35,9 @@ public:
   bool Doubles(unsigned int p, unsigned int st) const {
     return d_values_ && d_values_[p] && d_values_[p][st];
   }
+  bool Floats(unsigned int p, unsigned int st) const {
+    return f_values_ && f_values_[p] && f_values_[p][st];
+  }
   void Values(unsigned int p, unsigned int st, unsigned int nt,
 	      unsigned char **c_values) const {
     *c_values = c_values_[p][st][nt];
@@ -51,11 +54,16 @@ public:
 	      double **d_values) const {
     *d_values = d_values_[p][st][nt];
   }
+  void Values(unsigned int p, unsigned int st, unsigned int nt,
+	      float **f_values) const {
+    *f_values = f_values_[p][st][nt];
+  }
   // Called by expand_strategy
   void SetValues(Node *node, unsigned char *c_values);
   void SetValues(Node *node, unsigned short *s_values);
   void SetValues(Node *node, int *i_values);
   void SetValues(Node *node, double *d_values);
+  void SetValues(Node *node, float *f_values);
   // This can be used for either regrets or sumprobs
   void Probs(unsigned int p, unsigned int st, unsigned int nt,
 	     unsigned int offset, unsigned int num_succs, unsigned int dsi,
@@ -110,6 +118,12 @@ public:
   void AllocateAndClearShorts(Node *node, unsigned int only_p);
   void AllocateAndClearInts(Node *node, unsigned int only_p);
   void AllocateAndClearDoubles(Node *node, unsigned int only_p);
+  void AllocateAndClearFloats(Node *node, unsigned int only_p);
+  // Allocates values of type value_types[st] on each street st.  Allows
+  // mixing representations across streets; e.g., float regrets on the
+  // turn and river with int regrets on earlier streets.
+  void AllocateAndClearByStreet(Node *node, const CFRValueType *value_types,
+				unsigned int only_p);
   void DeleteBelow(Node *node);
   bool ReadNode(Node *node, Reader *reader, void *decompressor,
 		unsigned int num_holdings, CFRValueType value_type,
@@ -151,8 +165,10 @@ protected:
   void InitializeValuesForReading(unsigned int p, unsigned int st,
 				  unsigned int nt, Node *node,
 				  CFRValueType value_type);
-  void Read(Node *node, Reader ***readers, void ***decompressors,
-	    CFRValueType **value_types, unsigned int only_p);
+  void ReadPlayerStreet(Node *node, unsigned int p, unsigned int st,
+			Reader *reader, void *decompressor,
+			CFRValueType value_type);
+  static void *ReadThread(void *thread_args);
   void MergeInto(Node *full_node, Node *subgame_node, unsigned int root_bd_st,
 		 unsigned int root_bd, const CFRValues &subgame_values,
 		 const Buckets &buckets, unsigned int final_st);
@@ -179,6 +195,7 @@ protected:
   unsigned short ****s_values_;
   int ****i_values_;
   double ****d_values_;
+  float ****f_values_;
   unique_ptr<bool []> compressed_streets_;
 #ifdef EJC
   long long int **new_distributions_;
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "betting_abstraction.h"
 #include "betting_tree.h"
@@ -21,7 +23,8 @@ CFRValuesFile::CFRValuesFile(const bool *players, bool *streets,
 			     const CFRConfig &cfr_config, unsigned int asym_p,
 			     unsigned int it, unsigned int endgame_st,
 			     const BettingTree *betting_tree,
-			     const unsigned int *num_buckets) {
+			     const unsigned int *num_buckets,
+			     bool mmap_files) {
   unsigned int max_street = Game::MaxStreet();
   num_holdings_ = new unsigned int[max_street + 1];
   for (unsigned int st = 0; st <= max_street; ++st) {
@@ -65,11 +68,12 @@ CFRValuesFile::CFRValuesFile(const bool *players, bool *streets,
 	  // 1) Double sumprobs.  (Get this when we solved endgames offline,
 	  //    and then merged.)
 	  // 2) Int sumprobs.  (Get this with base TCFR systems.)
-	  // 3) Half-byte sumprobs.  (Expected for the turn in the trunk of
+	  // 3) Float sumprobs.  (Get this with FloatSumprobStreets.)
+	  // 4) Half-byte sumprobs.  (Expected for the turn in the trunk of
 	  //    the final heads-up system.)
-	  // 4) Char sumprobs.  (Expected for the trunk streets of the final
+	  // 5) Char sumprobs.  (Expected for the trunk streets of the final
 	  //    system - except as noted above.)
-	  // 5) Bit regrets
+	  // 6) Bit regrets
 
 	  // Default
 	  methods_[p][st] = ProbMethod::REGRET_MATCHING;
@@ -81,32 +85,39 @@ CFRValuesFile::CFRValuesFile(const bool *players, bool *streets,
 	    if (FileExists(buf)) {
 	      value_types_[p][st] = CFR_INT;
 	    } else {
-	      sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.h", dir, st, it, p);
+	      sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.f", dir, st, it, p);
 	      if (FileExists(buf)) {
-		value_types_[p][st] = CFR_HALF_BYTE;
-		if (st != 2) {
-		  fprintf(stderr,
-			  "Only expected half-byte sumprobs on turn\n");
-		  exit(-1);
-		}
+		value_types_[p][st] = CFR_FLOAT;
 	      } else {
-		sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.c", dir, st, it, p);
+		sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.h", dir, st, it, p);
 		if (FileExists(buf)) {
-		  value_types_[p][st] = CFR_CHAR;
+		  value_types_[p][st] = CFR_HALF_BYTE;
+		  if (st != 2) {
+		    fprintf(stderr,
+			    "Only expected half-byte sumprobs on turn\n");
+		    exit(-1);
+		  }
 		} else {
-		  sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.b", dir, st, it, p);
+		  sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.c", dir, st, it,
+			  p);
 		  if (FileExists(buf)) {
-		    value_types_[p][st] = CFR_BITS;
+		    value_types_[p][st] = CFR_CHAR;
 		  } else {
-		    sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.c", dir, st, it,
+		    sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.b", dir, st, it,
 			    p);
 		    if (FileExists(buf)) {
-		      value_types_[p][st] = CFR_CHAR;
-		      methods_[p][st] = ProbMethod::PURE;
+		      value_types_[p][st] = CFR_BITS;
 		    } else {
-		      fprintf(stderr, "Couldn't find file %s p %u st %u "
-			      "it %u\n", buf, p, st, it);
-		      exit(-1);
+		      sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.c", dir, st, it,
+			      p);
+		      if (FileExists(buf)) {
+			value_types_[p][st] = CFR_CHAR;
+			methods_[p][st] = ProbMethod::PURE;
+		      } else {
+			fprintf(stderr, "Couldn't find file %s p %u st %u "
+				"it %u\n", buf, p, st, it);
+			exit(-1);
+		      }
 		    }
 		  }
 		}
@@ -189,11 +200,55 @@ CFRValuesFile::CFRValuesFile(const bool *players, bool *streets,
     delete [] current[p];
   }
   delete [] current;
+
+  // With mmap_files, Probs() decodes straight out of the page cache, so
+  // lookups involve no copies or system calls, and bot processes on the
+  // same machine share one copy of the strategy.  Access is random so we
+  // turn off readahead; Prefetch() can be used to bring in what is needed
+  // next.
+  data_ = nullptr;
+  if (mmap_files) {
+    data_ = new unsigned char **[num_players];
+    for (unsigned int p = 0; p < num_players; ++p) {
+      if (readers_[p] == nullptr) {
+	data_[p] = nullptr;
+	continue;
+      }
+      data_[p] = new unsigned char *[max_street + 1];
+      for (unsigned int st = 0; st <= max_street; ++st) {
+	Reader *reader = readers_[p][st];
+	if (reader == nullptr || reader->FileSize() == 0) {
+	  data_[p][st] = nullptr;
+	  continue;
+	}
+	void *v = mmap(NULL, reader->FileSize(), PROT_READ, MAP_SHARED,
+		       reader->FD(), 0);
+	if (v == MAP_FAILED) {
+	  fprintf(stderr, "mmap failed for %s\n", reader->Filename().c_str());
+	  exit(-1);
+	}
+	madvise(v, reader->FileSize(), MADV_RANDOM);
+	data_[p][st] = (unsigned char *)v;
+      }
+    }
+  }
+  pthread_mutex_init(&mutex_, NULL);
 }
 
 CFRValuesFile::~CFRValuesFile(void) {
+  pthread_mutex_destroy(&mutex_);
   unsigned int num_players = Game::NumPlayers();
   unsigned int max_street = Game::MaxStreet();
+  if (data_) {
+    for (unsigned int p = 0; p < num_players; ++p) {
+      if (data_[p] == nullptr) continue;
+      for (unsigned int st = 0; st <= max_street; ++st) {
+	if (data_[p][st]) munmap(data_[p][st], readers_[p][st]->FileSize());
+      }
+      delete [] data_[p];
+    }
+    delete [] data_;
+  }
   for (unsigned int p = 0; p < num_players; ++p) {
     if (readers_[p]) {
       for (unsigned int st = 0; st <= max_street; ++st) {
@@ -239,29 +294,96 @@ void CFRValuesFile::InitializeOffsets(Node *node,
   seen[st][pa][nt] = true;
   if (offsets_[pa] && offsets_[pa][st] && num_succs > 1) {
     offsets_[pa][st][nt] = current[pa][st];
-    unsigned int num_values = num_holdings_[st] * num_succs;
-    if (value_types_[pa][st] == CFR_CHAR) {
-      current[pa][st] += num_values;
-    } else if (value_types_[pa][st] == CFR_HALF_BYTE) {
-      if (num_values % 2 == 0) current[pa][st] += num_values / 2;
-      else                     current[pa][st] += num_values / 2 + 1;
-    } else if (value_types_[pa][st] == CFR_BITS) {
-      if (num_holdings_[st] % 4 == 0) {
-	current[pa][st] += num_holdings_[st] / 4;
-      } else {
-	current[pa][st] += num_holdings_[st] / 4 + 1;
-      }
-    } else if (value_types_[pa][st] == CFR_INT) {
-      current[pa][st] += num_values * 4;
-    } else if (value_types_[pa][st] == CFR_DOUBLE) {
-      current[pa][st] += num_values * 8;
-    }
+    current[pa][st] += NodeBytes(pa, st, num_succs);
   }
   for (unsigned int s = 0; s < num_succs; ++s) {
     InitializeOffsets(node->IthSucc(s), current, seen);
   }
 }
 
+// The number of bytes of data stored for a node with num_succs succs.
+unsigned long long int CFRValuesFile::NodeBytes(unsigned int p,
+						unsigned int st,
+						unsigned int num_succs) const {
+  unsigned long long int num_values =
+    ((unsigned long long int)num_holdings_[st]) * num_succs;
+  if (value_types_[p][st] == CFR_CHAR) {
+    return num_values;
+  } else if (value_types_[p][st] == CFR_HALF_BYTE) {
+    if (num_values % 2 == 0) return num_values / 2;
+    else                     return num_values / 2 + 1;
+  } else if (value_types_[p][st] == CFR_BITS) {
+    if (num_holdings_[st] % 4 == 0) return num_holdings_[st] / 4;
+    else                            return num_holdings_[st] / 4 + 1;
+  } else if (value_types_[p][st] == CFR_INT ||
+	     value_types_[p][st] == CFR_FLOAT) {
+    return num_values * 4;
+  } else if (value_types_[p][st] == CFR_DOUBLE) {
+    return num_values * 8;
+  }
+  return 0;
+}
+
+// Records, for each player and street, the range of file offsets used by
+// the nodes below node on streets up to final_st.  lo and hi are indexed by
+// p * (max_street + 1) + st.
+void CFRValuesFile::PrefetchRanges(Node *node, unsigned int final_st,
+				   unsigned long long int *lo,
+				   unsigned long long int *hi) const {
+  if (node->Terminal()) return;
+  unsigned int st = node->Street();
+  if (st > final_st) return;
+  unsigned int num_succs = node->NumSuccs();
+  unsigned int pa = node->PlayerActing();
+  if (num_succs > 1 && offsets_[pa] && offsets_[pa][st]) {
+    unsigned long long int offset = offsets_[pa][st][node->NonterminalID()];
+    unsigned long long int end = offset + NodeBytes(pa, st, num_succs);
+    unsigned int i = pa * (Game::MaxStreet() + 1) + st;
+    if (offset < lo[i]) lo[i] = offset;
+    if (end > hi[i]) hi[i] = end;
+  }
+  for (unsigned int s = 0; s < num_succs; ++s) {
+    PrefetchRanges(node->IthSucc(s), final_st, lo, hi);
+  }
+}
+
+// Asks the kernel to start reading in the data for the subtree below node
+// on this street and the next.  Because the files are written in
+// depth-first order, the data for a subtree is (mostly) contiguous within
+// each file.  Only has an effect when the files are memory-mapped.  The
+// ranges are computed by walking the subtree the first time node is seen
+// and remembered after that.
+void CFRValuesFile::Prefetch(Node *node) const {
+  if (data_ == nullptr) return;
+  unsigned int num_players = Game::NumPlayers();
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num = num_players * (max_street + 1);
+  pthread_mutex_lock(&mutex_);
+  vector<unsigned long long int> &ranges = prefetch_ranges_[node];
+  if (ranges.size() == 0) {
+    vector<unsigned long long int> lo(num, kMaxUnsignedLongLong), hi(num, 0);
+    PrefetchRanges(node, node->Street() + 1, lo.data(), hi.data());
+    ranges.resize(2 * num);
+    for (unsigned int i = 0; i < num; ++i) {
+      ranges[2 * i] = lo[i];
+      ranges[2 * i + 1] = hi[i];
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+  long page_size = sysconf(_SC_PAGESIZE);
+  for (unsigned int p = 0; p < num_players; ++p) {
+    for (unsigned int st = 0; st <= max_street; ++st) {
+      if (data_[p] == nullptr || data_[p][st] == nullptr) continue;
+      unsigned int i = p * (max_street + 1) + st;
+      unsigned long long int lo = ranges[2 * i], hi = ranges[2 * i + 1];
+      if (lo >= hi) continue;
+      // madvise() requires a page-aligned start address
+      unsigned long long int start = lo - lo % page_size;
+      madvise(data_[p][st] + start, hi - start, MADV_WILLNEED);
+    }
+  }
+}
+
 // h may be either a bucket (for an abstracted system) or an hcp index
 // (for an unabstracted system).
 // For an unabstracted system, num_prior_h is board * num_hole_card_pairs.
@@ -291,13 +413,14 @@ void CFRValuesFile::Probs(unsigned int p, unsigned int st, unsigned int nt,
     offset += (h * num_succs) / 2;
   } else if (value_types_[p][st] == CFR_BITS) {
     offset += h / 4;
-  } else if (value_types_[p][st] == CFR_INT) {
+  } else if (value_types_[p][st] == CFR_INT ||
+	     value_types_[p][st] == CFR_FLOAT) {
     offset += (h * num_succs) * 4;
   } else if (value_types_[p][st] == CFR_DOUBLE) {
     offset += (h * num_succs) * 8;
   } else {
-    fprintf(stderr, "Currently expect files to be of type char, half-byte or "
-	    "bits: %i\n", (int)value_types_[p][st]);
+    fprintf(stderr, "Currently expect files to be of type char, half-byte, "
+	    "bits, int, float or double: %i\n", (int)value_types_[p][st]);
     exit(-1);
   }
   if (offset >= (unsigned long long int)readers_[p][st]->FileSize()) {
@@ -307,15 +430,40 @@ void CFRValuesFile::Probs(unsigned int p, unsigned int st, unsigned int nt,
     fprintf(stderr, "File: %s\n", readers_[p][st]->Filename().c_str());
     exit(-1);
   }
-  readers_[p][st]->SeekTo(offset);
+  // Get a pointer to the values for this hand.  If the file is mapped this
+  // points into the mapping; otherwise we read the bytes we need into buf.
+  unsigned long long int num_bytes;
+  if (value_types_[p][st] == CFR_CHAR) {
+    num_bytes = num_succs;
+  } else if (value_types_[p][st] == CFR_HALF_BYTE) {
+    num_bytes = ((h * num_succs) % 2 + num_succs + 1) / 2;
+  } else if (value_types_[p][st] == CFR_BITS) {
+    num_bytes = 1;
+  } else if (value_types_[p][st] == CFR_INT ||
+	     value_types_[p][st] == CFR_FLOAT) {
+    num_bytes = num_succs * 4;
+  } else {
+    num_bytes = num_succs * 8;
+  }
+  const unsigned char *ptr;
+  unique_ptr<unsigned char []> buf;
+  if (data_ && data_[p][st]) {
+    ptr = data_[p][st] + offset;
+  } else {
+    buf.reset(new unsigned char[num_bytes]);
+    pthread_mutex_lock(&mutex_);
+    readers_[p][st]->SeekTo(offset);
+    readers_[p][st]->ReadNBytesOrDie(num_bytes, buf.get());
+    pthread_mutex_unlock(&mutex_);
+    ptr = buf.get();
+  }
 
   if (methods_[p][st] == ProbMethod::PURE) {
     if (value_types_[p][st] == CFR_CHAR) {
       // Signed or unsigned?  Can this be regrets?
       unsigned int s;
       for (s = 0; s < num_succs; ++s) {
-	unsigned char uc = readers_[p][st]->ReadUnsignedCharOrDie();
-	if (uc == 0) break;
+	if (ptr[s] == 0) break;
       }
       if (s == num_succs) {
 	fprintf(stderr, "No zero regret succ?!?\n");
@@ -331,12 +479,9 @@ void CFRValuesFile::Probs(unsigned int p, unsigned int st, unsigned int nt,
     }
   } else {
     if (value_types_[p][st] == CFR_CHAR) {
-      unique_ptr<unsigned char []> c_values(new unsigned char[num_succs]);
       unsigned int sum = 0;
       for (unsigned int s = 0; s < num_succs; ++s) {
-	unsigned char c = readers_[p][st]->ReadUnsignedCharOrDie();
-	sum += c;
-	c_values[s] = c;
+	sum += ptr[s];
       }
       if (sum == 0) {
 	for (unsigned int s = 0; s < num_succs; ++s) {
@@ -345,49 +490,45 @@ void CFRValuesFile::Probs(unsigned int p, unsigned int st, unsigned int nt,
       } else {
 	double d_sum = sum;
 	for (unsigned int s = 0; s < num_succs; ++s) {
-	  probs[s] = c_values[s] / d_sum;
+	  probs[s] = ptr[s] / d_sum;
 	}
       }
     } else if (value_types_[p][st] == CFR_HALF_BYTE) {
       bool high = (h * num_succs % 2) == 0;
-      unique_ptr<unsigned char []> c_values(new unsigned char[num_succs]);
-      unsigned char c = readers_[p][st]->ReadUnsignedCharOrDie();
+      unsigned char c = *ptr;
       for (unsigned int s = 0; s < num_succs; ++s) {
+	unsigned char v;
 	if (high) {
 	  // The high 4 bits
-	  c_values[s] = c >> 4;
+	  v = c >> 4;
 	} else {
 	  // The low 4 bits
-	  c_values[s] = c & 15;
+	  v = c & 15;
 	  if (s != num_succs - 1) {
-	    c = readers_[p][st]->ReadUnsignedCharOrDie();
+	    c = *++ptr;
 	  }
 	}
+	probs[s] = ((double)v) / 15.0;
 	high = ! high;
       }
-      for (unsigned int s = 0; s < num_succs; ++s) {
-	probs[s] = ((double)c_values[s]) / 15.0;
-      }
     } else if (value_types_[p][st] == CFR_BITS) {
       unsigned int shift;
       if (h % 4 == 0)      shift = 6;
       else if (h % 4 == 1) shift = 4;
       else if (h % 4 == 2) shift = 2;
       else                 shift = 0;
-      unique_ptr<unsigned char []> c_values(new unsigned char[num_succs]);
-      unsigned char c = readers_[p][st]->ReadUnsignedCharOrDie();
-      unsigned int best_s = (c >> shift) & 3;
+      unsigned int best_s = (*ptr >> shift) & 3;
       for (unsigned int s = 0; s < num_succs; ++s) {
 	probs[s] = (s == best_s ? 1.0 : 0);
       }
     } else if (value_types_[p][st] == CFR_INT) {
       // Signed or unsigned?  Can this be regrets?
+      // The values may not be aligned, so copy them out with memcpy().
       unique_ptr<unsigned int []> ui_values(new unsigned int[num_succs]);
+      memcpy(ui_values.get(), ptr, num_succs * sizeof(unsigned int));
       long long int sum = 0;
       for (unsigned int s = 0; s < num_succs; ++s) {
-	unsigned int uiv = readers_[p][st]->ReadUnsignedIntOrDie();
-	sum += uiv;
-	ui_values[s] = uiv;
+	sum += ui_values[s];
       }
       if (sum == 0) {
 	for (unsigned int s = 0; s < num_succs; ++s) {
@@ -399,13 +540,28 @@ void CFRValuesFile::Probs(unsigned int p, unsigned int st, unsigned int nt,
 	  probs[s] = ui_values[s] / d_sum;
 	}
       }
+    } else if (value_types_[p][st] == CFR_FLOAT) {
+      unique_ptr<float []> f_values(new float[num_succs]);
+      memcpy(f_values.get(), ptr, num_succs * sizeof(float));
+      double sum = 0;
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	sum += f_values[s];
+      }
+      if (sum == 0) {
+	for (unsigned int s = 0; s < num_succs; ++s) {
+	  probs[s] = s == dsi ? 1.0 : 0;
+	}
+      } else {
+	for (unsigned int s = 0; s < num_succs; ++s) {
+	  probs[s] = f_values[s] / sum;
+	}
+      }
     } else if (value_types_[p][st] == CFR_DOUBLE) {
       unique_ptr<double []> d_values(new double[num_succs]);
+      memcpy(d_values.get(), ptr, num_succs * sizeof(double));
       double sum = 0;
       for (unsigned int s = 0; s < num_succs; ++s) {
-	double dv = readers_[p][st]->ReadDoubleOrDie();
-	sum += dv;
-	d_values[s] = dv;
+	sum += d_values[s];
       }
       if (sum == 0) {
 	for (unsigned int s = 0; s < num_succs; ++s) {
@@ -462,5 +618,7 @@ void CFRValuesFile::ReadPureSubtree(Node *whole_node, Node *subtree_node,
 void CFRValuesFile::ReadPureSubtree(Node *whole_node, BettingTree *subtree,
 				    CFRValues *regrets) {
   regrets->AllocateAndClearChars(subtree->Root(), kMaxUInt);
+  pthread_mutex_lock(&mutex_);
   ReadPureSubtree(whole_node, subtree->Root(), regrets);
+  pthread_mutex_unlock(&mutex_);
 }
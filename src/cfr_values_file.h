@@ -1,14 +1,22 @@
 #ifndef _CFR_VALUES_FILE_H_
 #define _CFR_VALUES_FILE_H_
 
+#include <pthread.h>
+
+#include <unordered_map>
+#include <vector>
+
 #include "cfr_value_type.h"
 #include "prob_method.h"
 
+using namespace std;
+
 class BettingAbstraction;
 class BettingTree;
 class CardAbstraction;
 class CFRConfig;
 class CFRValues;
+class Node;
 class Reader;
 
 class CFRValuesFile {
@@ -19,11 +27,12 @@ public:
 		const CFRConfig &cfr_config, unsigned int asym_p,
 		unsigned int it, unsigned int endgame_st,
 		const BettingTree *betting_tree,
-		const unsigned int *num_buckets);
+		const unsigned int *num_buckets, bool mmap_files);
   virtual ~CFRValuesFile(void);
   void Probs(unsigned int p, unsigned int st, unsigned int nt,
 	     unsigned int h, unsigned int num_succs, unsigned int dsi,
 	     double *probs) const;
+  void Prefetch(Node *node) const;
   void ReadPureSubtree(Node *whole_node, BettingTree *subtree,
 		       CFRValues *regrets);
 private:
@@ -31,12 +40,29 @@ private:
 			 bool ***seen);
   void ReadPureSubtree(Node *whole_node, Node *subtree_node,
 		       CFRValues *regrets);
+  unsigned long long int NodeBytes(unsigned int p, unsigned int st,
+				   unsigned int num_succs) const;
+  void PrefetchRanges(Node *node, unsigned int final_st,
+		      unsigned long long int *lo,
+		      unsigned long long int *hi) const;
   
   unsigned int *num_holdings_;
   ProbMethod **methods_;
   CFRValueType **value_types_;
   Reader ***readers_;
+  // Non-null when the files are memory-mapped.  Indexed by player and
+  // street.
+  unsigned char ***data_;
   unsigned long long int ***offsets_;
+  // Serializes use of readers_ so that Probs() and ReadPureSubtree() can be
+  // called from more than one thread.  Not needed for mapped files.
+  mutable pthread_mutex_t mutex_;
+  // The file ranges needed below each node Prefetch() has been called on,
+  // so the subtree is only walked the first time.  For each player and
+  // street, the lo and hi offsets are stored at 2 * (p * (max_street + 1)
+  // + st).  Guarded by mutex_.
+  mutable unordered_map< Node *, vector<unsigned long long int> >
+    prefetch_ranges_;
 };
 
 #endif
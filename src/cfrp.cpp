@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -54,7 +55,12 @@ CFRP::CFRP(const CardAbstraction &ca, const BettingAbstraction &ba,
 
   HandValueTree::Create();
 
-  hand_tree_ = new HandTree(0, 0, max_street);
+  if (cfr_config_.LazyHandTree()) {
+    hand_tree_ = new HandTree(0, 0, max_street,
+			      cfr_config_.HandTreeMaxBytes());
+  } else {
+    hand_tree_ = new HandTree(0, 0, max_street);
+  }
 
   bool *streets = nullptr;
   if (subgame_street_ <= max_street) {
@@ -137,6 +143,13 @@ void CFRP::FloorRegrets(Node *node, unsigned int p) {
 	for (unsigned int i = 0; i < num_values; ++i) {
 	  if (i_all_regrets[i] < floor) i_all_regrets[i] = floor;
 	}
+      } else if (regrets_->Floats(p, st)) {
+	float *f_all_regrets;
+	regrets_->Values(p, st, nt, &f_all_regrets);
+	float floor = regret_floors_[st];
+	for (unsigned int i = 0; i < num_values; ++i) {
+	  if (f_all_regrets[i] < floor) f_all_regrets[i] = floor;
+	}
       } else {
 	double *d_all_regrets;
 	regrets_->Values(p, st, nt, &d_all_regrets);
@@ -177,12 +190,13 @@ void CFRP::HalfIteration(unsigned int p) {
   VCFRState state(opp_probs, street_buckets, hand_tree_, p, regrets_.get(),
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
-  double *vals = Process(betting_tree_->Root(), 0, state, 0);
+  // The values returned are not needed; the frame releases them.
+  ArenaFrame frame(state.GetArena());
+  Process(betting_tree_->Root(), 0, state, 0);
   if (subgame_street_ <= Game::MaxStreet()) {
-    delete [] vals;
     WaitForFinalSubgames();
     pre_phase_ = false;
-    vals = Process(betting_tree_->Root(), 0, state, 0);
+    Process(betting_tree_->Root(), 0, state, 0);
   }
   DeleteStreetBuckets(street_buckets);
   delete [] opp_probs;
@@ -204,8 +218,6 @@ void CFRP::HalfIteration(unsigned int p) {
   fprintf(stderr, "%s avg val %f\n", p1 ? "P1" : "P2", avg_val);
 #endif
 
-  delete [] vals;
-
   if (nn_regrets_ && bucketed_) {
     FloorRegrets(betting_tree_->Root(), p);
   }
@@ -257,16 +269,29 @@ void CFRP::Run(unsigned int start_it, unsigned int end_it) {
     ReadFromCheckpoint(start_it - 1);
     last_checkpoint_it_ = start_it - 1;
   } else {
-    if (double_regrets_) {
-      regrets_->AllocateAndClearDoubles(betting_tree_->Root(), kMaxUInt);
-    } else {
-      regrets_->AllocateAndClearInts(betting_tree_->Root(), kMaxUInt);
-    }
-    if (double_sumprobs_) {
-      sumprobs_->AllocateAndClearDoubles(betting_tree_->Root(), kMaxUInt);
-    } else {
-      sumprobs_->AllocateAndClearInts(betting_tree_->Root(), kMaxUInt);
+    unsigned int max_street = Game::MaxStreet();
+    unique_ptr<CFRValueType []> regret_types(new CFRValueType[max_street + 1]);
+    unique_ptr<CFRValueType []> sumprob_types(new CFRValueType[max_street + 1]);
+    for (unsigned int st = 0; st <= max_street; ++st) {
+      if (cfr_config_.FloatRegretStreet(st)) {
+	regret_types[st] = CFR_FLOAT;
+      } else if (double_regrets_) {
+	regret_types[st] = CFR_DOUBLE;
+      } else {
+	regret_types[st] = CFR_INT;
+      }
+      if (cfr_config_.FloatSumprobStreet(st)) {
+	sumprob_types[st] = CFR_FLOAT;
+      } else if (double_sumprobs_) {
+	sumprob_types[st] = CFR_DOUBLE;
+      } else {
+	sumprob_types[st] = CFR_INT;
+      }
     }
+    regrets_->AllocateAndClearByStreet(betting_tree_->Root(),
+				       regret_types.get(), kMaxUInt);
+    sumprobs_->AllocateAndClearByStreet(betting_tree_->Root(),
+					sumprob_types.get(), kMaxUInt);
   }
   if (bucketed_) {
     // Current strategy always uses doubles
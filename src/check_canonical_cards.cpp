@@ -0,0 +1,196 @@
+// Checks the hole card canonicalization done by CanonicalCards (the shared
+// PairCanons tables and CanonIndices()) against CanonicalizeCards().  For
+// every board up to max street, two hands are expected to map to the same
+// canonical hand exactly when CanonicalizeCards() gives them the same
+// canonical cards.  Also checks that the number of variants of each
+// canonical hand is the size of its class, and that building a board's
+// hands from those of its predecessor board gives the same result as
+// building them from scratch.
+//
+// Prints the number of mismatches and exits with a nonzero status if there
+// were any.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board_tree.h"
+#include "canonical.h"
+#include "canonical_cards.h"
+#include "cards.h"
+#include "constants.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "io.h"
+#include "params.h"
+
+using namespace std;
+
+static unsigned long long int g_num_hands = 0ULL;
+static unsigned long long int g_num_mismatches = 0ULL;
+
+static void Mismatch(unsigned int st, unsigned int bd, const Card *hole_cards,
+		     const char *what) {
+  if (g_num_mismatches < 20) {
+    string hi, lo;
+    CardName(hole_cards[0], &hi);
+    CardName(hole_cards[1], &lo);
+    fprintf(stderr, "st %u bd %u %s%s: %s\n", st, bd, hi.c_str(), lo.c_str(),
+	    what);
+  }
+  ++g_num_mismatches;
+}
+
+// Encodes the output of CanonicalizeCards() for the board and hole cards.
+// The canonical hole cards are sorted so that the order in which they come
+// back does not matter.
+static unsigned long long int OldCanonKey(const Card *board,
+					  unsigned int num_board_cards,
+					  const Card *hole_cards,
+					  unsigned int st) {
+  Card canon_board[5], canon_hole_cards[2];
+  CanonicalizeCards(board, hole_cards, st, canon_board, canon_hole_cards);
+  if (canon_hole_cards[0] < canon_hole_cards[1]) {
+    swap(canon_hole_cards[0], canon_hole_cards[1]);
+  }
+  unsigned long long int max_card1 = Game::MaxCard() + 1;
+  unsigned long long int key = 0ULL;
+  for (unsigned int i = 0; i < num_board_cards; ++i) {
+    key = key * max_card1 + canon_board[i];
+  }
+  key = key * max_card1 + canon_hole_cards[0];
+  key = key * max_card1 + canon_hole_cards[1];
+  return key;
+}
+
+static void CheckBoard(unsigned int st, unsigned int bd,
+		       const CanonicalCards &hands,
+		       unsigned int *canon_indices) {
+  const Card *board = BoardTree::Board(st, bd);
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  unsigned int num_hands = hands.NumRaw();
+  g_num_hands += num_hands;
+  unsigned int num_canon = 0;
+  for (unsigned int i = 0; i < num_hands; ++i) {
+    const Card *hole_cards = hands.Cards(i);
+    unsigned int enc = hole_cards[0] * max_card1 + hole_cards[1];
+    canon_indices[enc] = kMaxUInt;
+    if (hands.NumVariants(i) > 0) {
+      ++num_canon;
+      if (hands.Canon(i) != enc) {
+	Mismatch(st, bd, hole_cards, "canonical hand maps elsewhere");
+      }
+    }
+  }
+  if (num_canon != hands.NumCanon()) {
+    fprintf(stderr, "st %u bd %u: NumCanon() %u, %u canonical hands\n",
+	    st, bd, hands.NumCanon(), num_canon);
+    ++g_num_mismatches;
+  }
+  hands.CanonIndices(canon_indices);
+  unique_ptr<unsigned long long int []> keys(
+    new unsigned long long int[num_hands]);
+  unique_ptr<unsigned int []> class_sizes(new unsigned int[num_hands]);
+  for (unsigned int i = 0; i < num_hands; ++i) {
+    keys[i] = OldCanonKey(board, num_board_cards, hands.Cards(i), st);
+    class_sizes[i] = 0;
+  }
+  unordered_map<unsigned long long int, unsigned int> canon_of_key;
+  for (unsigned int i = 0; i < num_hands; ++i) {
+    if (hands.NumVariants(i) == 0) continue;
+    if (! canon_of_key.insert(make_pair(keys[i], i)).second) {
+      Mismatch(st, bd, hands.Cards(i),
+	       "two canonical hands canonicalize alike");
+    }
+  }
+  for (unsigned int i = 0; i < num_hands; ++i) {
+    const Card *hole_cards = hands.Cards(i);
+    unsigned int enc = hole_cards[0] * max_card1 + hole_cards[1];
+    unsigned int ci = canon_indices[enc];
+    if (ci >= num_hands || hands.NumVariants(ci) == 0) {
+      Mismatch(st, bd, hole_cards, "bad canonical index");
+      continue;
+    }
+    ++class_sizes[ci];
+    if (keys[i] != keys[ci]) {
+      Mismatch(st, bd, hole_cards, "differs from its canonical hand");
+    }
+  }
+  for (unsigned int i = 0; i < num_hands; ++i) {
+    if (hands.NumVariants(i) > 0 && hands.NumVariants(i) != class_sizes[i]) {
+      Mismatch(st, bd, hands.Cards(i), "num variants is not the class size");
+    }
+  }
+}
+
+static bool SameHands(const CanonicalCards &h1, const CanonicalCards &h2) {
+  if (h1.NumRaw() != h2.NumRaw() || h1.NumCanon() != h2.NumCanon()) {
+    return false;
+  }
+  for (unsigned int i = 0; i < h1.NumRaw(); ++i) {
+    if (h1.Cards(i)[0] != h2.Cards(i)[0] ||
+	h1.Cards(i)[1] != h2.Cards(i)[1] ||
+	h1.NumVariants(i) != h2.NumVariants(i) ||
+	h1.Canon(i) != h2.Canon(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void Walk(unsigned int st, unsigned int bd, unsigned int max_st,
+		 const CanonicalCards *parent, unsigned int *canon_indices) {
+  const Card *board = BoardTree::Board(st, bd);
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  unsigned int sg = BoardTree::SuitGroups(st, bd);
+  CanonicalCards hands(2, board, num_board_cards, sg, false);
+  if (parent) {
+    CanonicalCards derived(*parent, board, num_board_cards, sg);
+    if (! SameHands(hands, derived)) {
+      fprintf(stderr, "st %u bd %u: hands from parent differ\n", st, bd);
+      ++g_num_mismatches;
+    }
+  }
+  CheckBoard(st, bd, hands, canon_indices);
+  if (st == max_st) return;
+  unsigned int nst = st + 1;
+  unsigned int nbd_begin = BoardTree::SuccBoardBegin(st, bd, nst);
+  unsigned int nbd_end = BoardTree::SuccBoardEnd(st, bd, nst);
+  for (unsigned int nbd = nbd_begin; nbd < nbd_end; ++nbd) {
+    Walk(nst, nbd, max_st, &hands, canon_indices);
+  }
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <max street>\n", prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unsigned int max_st;
+  if (sscanf(argv[2], "%u", &max_st) != 1) Usage(argv[0]);
+  if (max_st > Game::MaxStreet()) Usage(argv[0]);
+  if (Game::NumCardsForStreet(0) != 2 || Game::NumSuits() != 4) {
+    fprintf(stderr, "Expect two hole cards and four suits\n");
+    exit(-1);
+  }
+  BoardTree::Create();
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  unique_ptr<unsigned int []> canon_indices(
+    new unsigned int[max_card1 * max_card1]);
+  Walk(0, 0, max_st, nullptr, canon_indices.get());
+  printf("%llu hands, %llu mismatches\n", g_num_hands, g_num_mismatches);
+  if (g_num_mismatches > 0) exit(-1);
+}
@@ -0,0 +1,188 @@
+// Checks the hand values returned by HandValueTree (the flat tables for
+// Holdem-style games) against a reference.  If the hand value tree file
+// written by build_hand_value_tree exists for the game, every hand is
+// checked against it; that is only practical for small games like holdem5.
+// Otherwise num samples random hands are checked against
+// HoldemHandEvaluator.  In both modes BoardVals() is checked against Val()
+// on every hand of each board examined.
+//
+// Prints the number of mismatches and exits with a nonzero status if there
+// were any.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cards.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "hand_evaluator.h"
+#include "hand_value_tree.h"
+#include "io.h"
+#include "params.h"
+#include "rand.h"
+
+using namespace std;
+
+static unsigned long long int g_num_checked = 0ULL;
+static unsigned long long int g_num_mismatches = 0ULL;
+
+static void Check(const Card *cards, unsigned int num_cards,
+		  unsigned int val, unsigned int ref_val, const char *what) {
+  ++g_num_checked;
+  if (val == ref_val) return;
+  if (g_num_mismatches < 20) {
+    fprintf(stderr, "%s mismatch: ", what);
+    for (unsigned int i = 0; i < num_cards; ++i) {
+      string name;
+      CardName(cards[i], &name);
+      fprintf(stderr, "%s ", name.c_str());
+    }
+    fprintf(stderr, "got %u expected %u\n", val, ref_val);
+  }
+  ++g_num_mismatches;
+}
+
+static unsigned long long int CardMask(const Card *cards,
+				       unsigned int num_cards) {
+  unsigned long long int mask = 0ULL;
+  for (unsigned int i = 0; i < num_cards; ++i) mask |= 1ULL << cards[i];
+  return mask;
+}
+
+// Checks Val() and BoardVals() for every hole card pair on board.
+// ref_vals maps the card mask of each hand to its reference value.
+static void CheckBoard(const Card *board, unsigned int num_board_cards,
+		       const unordered_map<unsigned long long int,
+		       unsigned int> &ref_vals, HandEvaluator *evaluator) {
+  unsigned int max_card = Game::MaxCard();
+  unsigned int num_cards = num_board_cards + 2;
+  vector<Card> hole_cards;
+  for (Card hi = 1; hi <= max_card; ++hi) {
+    if (InCards(hi, board, num_board_cards)) continue;
+    for (Card lo = 0; lo < hi; ++lo) {
+      if (InCards(lo, board, num_board_cards)) continue;
+      hole_cards.push_back(hi);
+      hole_cards.push_back(lo);
+    }
+  }
+  unsigned int num_hands = hole_cards.size() / 2;
+  unique_ptr<unsigned int []> vals(new unsigned int[num_hands]);
+  HandValueTree::BoardVals(board, hole_cards.data(), num_hands, vals.get());
+  Card cards[7];
+  for (unsigned int i = 0; i < num_board_cards; ++i) {
+    cards[i + 2] = board[i];
+  }
+  for (unsigned int h = 0; h < num_hands; ++h) {
+    cards[0] = hole_cards[2 * h];
+    cards[1] = hole_cards[2 * h + 1];
+    unsigned int ref_val;
+    if (evaluator) {
+      ref_val = evaluator->Evaluate(cards, num_cards);
+    } else {
+      ref_val = ref_vals.find(CardMask(cards, num_cards))->second;
+    }
+    Check(cards, num_cards, HandValueTree::Val(cards), ref_val, "Val");
+    Check(cards, num_cards, vals[h], ref_val, "BoardVals");
+  }
+}
+
+// Reads the reference value of every set of num_cards cards from the hand
+// value tree file.
+static void ReadTreeVals(unsigned int num_cards, Card *cards,
+			 unsigned int i, Card min_card,
+			 unordered_map<unsigned long long int,
+			 unsigned int> *ref_vals) {
+  if (i == num_cards) {
+    (*ref_vals)[CardMask(cards, num_cards)] =
+      HandValueTree::DiskRead(cards);
+    return;
+  }
+  unsigned int max_card = Game::MaxCard();
+  for (Card c = min_card; c <= max_card; ++c) {
+    cards[i] = c;
+    ReadTreeVals(num_cards, cards, i + 1, c + 1, ref_vals);
+  }
+}
+
+static void CheckAllBoards(unsigned int num_board_cards, Card *board,
+			   unsigned int i, Card min_card,
+			   const unordered_map<unsigned long long int,
+			   unsigned int> &ref_vals) {
+  if (i == num_board_cards) {
+    CheckBoard(board, num_board_cards, ref_vals, nullptr);
+    return;
+  }
+  unsigned int max_card = Game::MaxCard();
+  for (Card c = min_card; c <= max_card; ++c) {
+    board[i] = c;
+    CheckAllBoards(num_board_cards, board, i + 1, c + 1, ref_vals);
+  }
+}
+
+static void CheckSampledBoards(unsigned int num_board_cards,
+			       unsigned int num_samples) {
+  HoldemHandEvaluator evaluator;
+  unordered_map<unsigned long long int, unsigned int> no_ref_vals;
+  unsigned int max_card = Game::MaxCard();
+  Card board[5];
+  for (unsigned int i = 0; i < num_samples; ++i) {
+    for (unsigned int j = 0; j < num_board_cards; ++j) {
+      Card c;
+      do {
+	c = RandBetween(0, max_card);
+      } while (InCards(c, board, j));
+      board[j] = c;
+    }
+    CheckBoard(board, num_board_cards, no_ref_vals, &evaluator);
+  }
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <num samples>\n", prog_name);
+  fprintf(stderr, "\nNum samples is the number of random boards to check "
+	  "if there is no hand value tree file for the game.\n");
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unsigned int num_samples;
+  if (sscanf(argv[2], "%u", &num_samples) != 1) Usage(argv[0]);
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_board_cards = Game::NumBoardCards(max_street);
+  unsigned int num_cards = num_board_cards + Game::NumCardsForStreet(0);
+  if (num_cards != 7 || Game::NumCardsForStreet(0) != 2) {
+    fprintf(stderr, "Expect two hole cards and five board cards\n");
+    exit(-1);
+  }
+  HandValueTree::Create();
+  SeedRand(0);
+
+  char buf[500];
+  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
+	  num_cards);
+  if (FileExists(buf)) {
+    fprintf(stderr, "Checking every hand against %s\n", buf);
+    unordered_map<unsigned long long int, unsigned int> ref_vals;
+    Card cards[7];
+    ReadTreeVals(num_cards, cards, 0, 0, &ref_vals);
+    CheckAllBoards(num_board_cards, cards, 0, 0, ref_vals);
+  } else {
+    fprintf(stderr, "No hand value tree file; checking %u random boards "
+	    "against HoldemHandEvaluator\n", num_samples);
+    CheckSampledBoards(num_board_cards, num_samples);
+  }
+  printf("%llu checks, %llu mismatches\n", g_num_checked, g_num_mismatches);
+  if (g_num_mismatches > 0) exit(-1);
+}
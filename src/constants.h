@@ -5,6 +5,8 @@ static const unsigned int kMaxUnsignedShort = 65535U;
 static const int kMaxInt = 2147483647;
 static const int kMinInt = -2147483648;
 static const unsigned int kMaxUInt = 4294967295U;
+static const unsigned long long int kMaxUnsignedLongLong =
+  18446744073709551615ULL;
 static const int kMaxShort = 32767;
 static const int kMinShort = -32768;
 
@@ -9,6 +9,7 @@
 #include <unordered_map>
 
 #include "board_tree.h"
+#include "buckets.h"
 #include "constants.h"
 #include "fast_hash.h"
 #include "files.h"
@@ -50,59 +51,16 @@ int main(int argc, char *argv[]) {
   unsigned long long int num_hands = num_boards * num_hole_card_pairs;
   fprintf(stderr, "num_hands %llu\n", num_hands);
 
-  char buf[500];
-  sprintf(buf, "%s/num_buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, bucketing2.c_str(), st);
-  Reader nb_reader(buf);
-  unsigned long long int num_buckets2 = nb_reader.ReadUnsignedIntOrDie();
-
-  sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, bucketing1.c_str(), st);
-  Reader reader1(buf);
-  unsigned long long int file_size1 = reader1.FileSize();
-  bool shorts1;
-  if (file_size1 == 2 * num_hands) {
-    shorts1 = true;
-  } else if (file_size1 == 4 * num_hands) {
-    shorts1 = false;
-  } else {
-    fprintf(stderr, "Unexpected file size B: %llu\n", file_size1);
-    fprintf(stderr, "File: %s\n", buf);
-    exit(-1);
-  }
+  // Reads either bucket file format
+  Buckets buckets1(st, bucketing1);
+  Buckets buckets2(st, bucketing2);
+  unsigned long long int num_buckets2 = buckets2.NumBuckets(st);
 
-  sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, bucketing2.c_str(), st);
-  Reader reader2(buf);
-  unsigned long long int file_size2 = reader2.FileSize();
-  bool shorts2;
-  if (file_size2 == 2 * num_hands) {
-    shorts2 = true;
-  } else if (file_size2 == 4 * num_hands) {
-    shorts2 = false;
-  } else {
-    fprintf(stderr, "Unexpected file size B: %llu\n", file_size2);
-    fprintf(stderr, "File: %s\n", buf);
-    exit(-1);
-  }
-  
   unsigned int *buckets = new unsigned int[num_hands];
   SparseAndDenseLong sad;
   for (unsigned long long int h = 0; h < num_hands; ++h) {
-    unsigned long long int b1, b2;
-    if (shorts1) {
-      b1 = reader1.ReadUnsignedShortOrDie();
-    } else {
-      b1 = reader1.ReadUnsignedIntOrDie();
-    }
-    if (shorts2) {
-      b2 = reader2.ReadUnsignedShortOrDie();
-    } else {
-      b2 = reader2.ReadUnsignedIntOrDie();
-    }
+    unsigned long long int b1 = buckets1.Bucket(st, h);
+    unsigned long long int b2 = buckets2.Bucket(st, h);
     unsigned long long int sparse = b1 * num_buckets2 + b2;
     unsigned int b = sad.SparseToDense(sparse);
     buckets[h] = b;
@@ -111,6 +69,11 @@ int main(int argc, char *argv[]) {
   unsigned int num_buckets = sad.Num();
   bool short_buckets = num_buckets < 65536;
 
+  // A packed file for the new bucketing would take precedence over the one
+  // written here.
+  char buf[500];
+  BucketsFilename(st, new_bucketing, true, buf);
+  remove(buf);
   sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u",
 	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(), new_bucketing.c_str(), st);
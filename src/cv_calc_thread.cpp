@@ -6,6 +6,7 @@
 #include <cmath>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -215,6 +216,7 @@ void CVCalcThread::Go(Node *node, unsigned int bd) {
 		  bd, st, street_buckets, pa, nullptr,
 		  subgame_sumprobs_.get());
   SetStreetBuckets(st, bd, state);
+  ArenaFrame frame(state.GetArena());
   double *vals = Process(node, 0, state, st);
   DeleteStreetBuckets(street_buckets);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
@@ -251,7 +253,6 @@ void CVCalcThread::Go(Node *node, unsigned int bd) {
   }
   fflush(stdout);
   delete [] opp_probs;
-  delete [] vals;
   delete [] total_card_probs;
   time_t end_t = time(NULL);
   double diff_sec = difftime(end_t, start_t);
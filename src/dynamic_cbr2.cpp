@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "betting_tree.h"
 #include "board_tree.h"
 #include "buckets.h"
@@ -53,13 +54,19 @@ double *DynamicCBR2::Compute(Node *node, unsigned int p, double *opp_probs,
   VCFRState state(opp_probs, hand_tree, 0, action_sequence, root_bd,
 		  root_bd_st, street_buckets, p, regrets, sumprobs);
   SetStreetBuckets(st, gbd, state);
-  double *vals = Process(node, lbd, state, st);
-  DeleteStreetBuckets(street_buckets);
-  // Temporary?  Make our T values like T values constructed by build_cbrs,
-  // by casting to float.
-  for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
-    vals[i] = (float)vals[i];
+  // The values returned by Process() live in the arena; the caller owns the
+  // ones we return.
+  double *vals = new double[num_hole_card_pairs];
+  {
+    ArenaFrame frame(state.GetArena());
+    double *arena_vals = Process(node, lbd, state, st);
+    // Temporary?  Make our T values like T values constructed by build_cbrs,
+    // by casting to float.
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      vals[i] = (float)arena_vals[i];
+    }
   }
+  DeleteStreetBuckets(street_buckets);
   delete [] total_card_probs;
 #if 0
   // EVs for our hands are summed over all opponent hole card pairs.  To
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h> // sleep()
 
 #include <algorithm>
@@ -26,6 +27,7 @@
 #include "hand_value_tree.h"
 #include "io.h"
 #include "nonterminal_ids.h"
+#include "numa_utils.h"
 #include "rand.h"
 #include "split.h"
 #include "ecfr.h"
@@ -45,6 +47,7 @@ public:
   void RunThread(void);
   void Join(void);
   void Run(void);
+  unsigned long long int Iterations(void) const {return it_ - 1;}
 private:
   void Deal(void);
   double Process(Node *node, bool adjust);
@@ -77,6 +80,7 @@ private:
   unsigned long long int it_;
   unsigned long long int batch_size_;
   unsigned long long int *total_its_;
+  bool pin_threads_;
   pthread_t pthread_id_;
 };
 
@@ -102,6 +106,7 @@ ECFRThread::ECFRThread(const CFRConfig &cc, const Buckets &buckets,
   num_threads_ = num_threads;
   batch_size_ = batch_size;
   total_its_ = total_its;
+  pin_threads_ = cc.PinThreads();
   max_street_ = Game::MaxStreet();
   num_players_ = Game::NumPlayers();
   canon_bds_.reset(new unsigned int[max_street_ + 1]);
@@ -418,6 +423,7 @@ void ECFRThread::Relevel(void) {
 #endif
 
 void ECFRThread::Run(void) {
+  if (pin_threads_) PinThread(batch_index_ % num_threads_);
   it_ = 1;
   unique_ptr<double []> sum_values(new double[num_players_]);
   unique_ptr<unsigned long long int []> denoms(
@@ -506,7 +512,10 @@ void ECFR::Run(void) {
   }
   // Execute thread 0 in main execution thread
   fprintf(stderr, "Starting thread 0 in main thread\n");
+  bool pin_threads = cfr_config_.PinThreads();
+  if (pin_threads) SaveThreadAffinity();
   cfr_threads_[0]->Run();
+  if (pin_threads) RestoreThreadAffinity();
   fprintf(stderr, "Finished main thread\n");
   for (unsigned int i = 1; i < num_cfr_threads_; ++i) {
     cfr_threads_[i]->Join();
@@ -526,8 +535,26 @@ void ECFR::RunBatch(unsigned int batch_size) {
   }
 
   fprintf(stderr, "Running batch base %i\n", batch_base_);
+  timeval start_tv, end_tv;
+  gettimeofday(&start_tv, NULL);
   Run();
+  gettimeofday(&end_tv, NULL);
   fprintf(stderr, "Finished running batch base %i\n", batch_base_);
+  if (cfr_config_.PinThreads()) {
+    double secs = (end_tv.tv_sec - start_tv.tv_sec) +
+      (end_tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+    unsigned int num_nodes = NumNUMANodes();
+    for (unsigned int n = 0; n < num_nodes; ++n) {
+      unsigned long long int node_its = 0ULL;
+      for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
+	if (NUMANodeForThread(i) == n) {
+	  node_its += cfr_threads_[i]->Iterations();
+	}
+      }
+      fprintf(stderr, "Node %u: %llu its (%.0f its/sec)\n", n, node_its,
+	      secs > 0 ? node_its / secs : 0);
+    }
+  }
 
   for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
     delete cfr_threads_[i];
@@ -938,9 +965,9 @@ ECFR::ECFR(const CardAbstraction &ca, const BettingAbstraction &ba,
   bucket_counts_ = nullptr;
   BoardTree::DeleteBoardCounts();
 
-  regrets_ = new double ***[max_street];
-  sumprobs_ = new double ***[max_street];
-  action_sumprobs_ = new double ***[max_street];
+  regrets_ = new double ***[max_street + 1];
+  sumprobs_ = new double ***[max_street + 1];
+  action_sumprobs_ = new double ***[max_street + 1];
   unsigned int num_players = Game::NumPlayers();
   for (unsigned int st = 0; st <= max_street; ++st) {
     regrets_[st] = new double **[num_players];
@@ -958,7 +985,11 @@ ECFR::ECFR(const CardAbstraction &ca, const BettingAbstraction &ba,
       }
     }
   }
+  // Initialize() first touches the regrets and sumprobs, so that is where
+  // their pages get placed.
+  if (cfr_config_.NUMAInterleave()) InterleaveAllocations(true);
   Initialize(betting_tree_->Root());
+  if (cfr_config_.NUMAInterleave()) InterleaveAllocations(false);
 
   HandValueTree::Create();
 }
@@ -11,11 +11,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -51,6 +53,21 @@ EGCFR::EGCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
   method_ = method;
   cfrs_ = cfrs;
   zero_sum_ = zero_sum;
+  // Threads divide the work at the street-initial nodes one street below
+  // the subtree root, so a split street at or above the subtree street
+  // (e.g., the default of the flop when resolving the turn) would leave
+  // them idle.  Endgames rooted on the final street get no speedup.
+  if (num_threads_ > 1 && split_street_ <= subtree_st_) {
+    split_street_ = subtree_st_ + 1;
+  }
+
+  time_limit_ = 0;
+  stop_ = nullptr;
+  warm_root_ = nullptr;
+  warm_regrets_ = nullptr;
+  warm_buckets_ = nullptr;
+  warm_weight_ = 0;
+  num_its_run_ = 0;
 
   HandValueTree::Create();
   BoardTree::Create();
@@ -89,6 +106,8 @@ EGCFR::~EGCFR(void) {
   // delete [] sum_target_probs_;
 }
 
+// The values returned are allocated from the state's arena, as with
+// VCFR::Process().
 double *EGCFR::HalfIteration(BettingTree *subtree, unsigned int solve_bd,
 			     const VCFRState &state) {
   Node *subtree_root = subtree->Root();
@@ -144,11 +163,12 @@ void EGCFR::CFRDHalfIteration(BettingTree *subtree, unsigned int solve_bd,
   unsigned int p = state->P();
   if (p == target_p_) {
     state->SetOppProbs(villain_probs);
-    double *vals = HalfIteration(subtree, solve_bd, *state);
-    delete [] vals;
+    ArenaFrame frame(state->GetArena());
+    HalfIteration(subtree, solve_bd, *state);
   } else {
     // Opponent phase.  The target player plays his fixed range to the
     // subgame.
+    ArenaFrame frame(state->GetArena());
     double *vals = HalfIteration(subtree, solve_bd, *state);
     for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
       double *regrets = &cfrd_regrets_[i * 2];
@@ -173,7 +193,6 @@ void EGCFR::CFRDHalfIteration(BettingTree *subtree, unsigned int solve_bd,
 	if (regrets[1] < 0) regrets[1] = 0;
       }
     }
-    delete [] vals;
   }
   delete [] villain_probs;
 }
@@ -424,11 +443,12 @@ void EGCFR::CombinedHalfIteration(BettingTree *subtree, unsigned int solve_bd,
   unsigned int p = state->P();
   if (p == target_p_) {
     state->SetOppProbs(villain_probs);
-    double *vals = HalfIteration(subtree, solve_bd, *state);
-    delete [] vals;
+    ArenaFrame frame(state->GetArena());
+    HalfIteration(subtree, solve_bd, *state);
   } else {
     // Opponent phase.  The target player plays his fixed range to the
     // subgame.
+    ArenaFrame frame(state->GetArena());
     double *vals = HalfIteration(subtree, solve_bd, *state);
     for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
       double *regrets = &combined_regrets_[i * 2];
@@ -459,7 +479,6 @@ void EGCFR::CombinedHalfIteration(BettingTree *subtree, unsigned int solve_bd,
 	if (regrets[1] < 0) regrets[1] = 0;
       }
     }
-    delete [] vals;
   }
   delete [] villain_probs;
 }
@@ -518,9 +537,10 @@ void EGCFR::MaxMarginHalfIteration(BettingTree *subtree, unsigned int solve_bd,
   unsigned int p = state->P();
   if (p == target_p_) {
     state->SetOppProbs(opp_probs);
-    double *vals = HalfIteration(subtree, solve_bd, *state);
-    delete [] vals;
+    ArenaFrame frame(state->GetArena());
+    HalfIteration(subtree, solve_bd, *state);
   } else {
+    ArenaFrame frame(state->GetArena());
     double *vals = HalfIteration(subtree, solve_bd, *state);
     // Offset CVs by "T" values
     double val = 0, sum_probs = 0;
@@ -542,7 +562,6 @@ void EGCFR::MaxMarginHalfIteration(BettingTree *subtree, unsigned int solve_bd,
       double ri = (vals[i] - opp_cvs[i]) - val;
       maxmargin_regrets_[i] += ri;
     }
-    delete [] vals;
   }
   delete [] opp_probs;
 }
@@ -670,6 +689,109 @@ double *EGCFR::LoadOppCVs(Node *solve_root, const string &action_sequence,
   }
 }
 
+// Returns the succ of to that corresponds to succ s of from: call to call,
+// fold to fold and a bet to the bet whose size is closest.  Returns kMaxUInt
+// if there is none.
+static unsigned int CorrespondingSucc(Node *from, unsigned int s, Node *to) {
+  if (s == from->CallSuccIndex()) return to->CallSuccIndex();
+  if (s == from->FoldSuccIndex()) return to->FoldSuccIndex();
+  unsigned int bet_to = from->IthSucc(s)->LastBetTo();
+  unsigned int num_succs = to->NumSuccs();
+  unsigned int best_s = kMaxUInt, best_dist = kMaxUInt;
+  for (unsigned int s2 = 0; s2 < num_succs; ++s2) {
+    if (s2 == to->CallSuccIndex() || s2 == to->FoldSuccIndex()) continue;
+    unsigned int bet_to2 = to->IthSucc(s2)->LastBetTo();
+    unsigned int dist = bet_to2 > bet_to ? bet_to2 - bet_to : bet_to - bet_to2;
+    if (dist < best_dist) {
+      best_s = s2;
+      best_dist = dist;
+    }
+  }
+  return best_s;
+}
+
+// Walks the endgame subtree and the base subtree in parallel, seeding the
+// regrets (and sumprobs) at each endgame node from the pure base regrets at
+// the corresponding base node.  Endgame bets are matched to the base bet of
+// the closest size, as in bet translation.  Streets on which the base
+// strategy is unabstracted are left at zero, since the base regrets are
+// only indexed by bucket.  So are streets on which the endgame strategy is
+// bucketed: the hands sharing an endgame bucket need not agree on a base
+// best-succ, and VCFR has no current strategy for bucketed endgame streets
+// anyway.
+void EGCFR::WarmStart(Node *node, Node *base_node, unsigned int solve_bd,
+		      CFRValues *sumprobs) {
+  if (node->Terminal() || base_node->Terminal()) return;
+  unsigned int num_succs = node->NumSuccs();
+  unsigned int base_num_succs = base_node->NumSuccs();
+  unsigned int st = node->Street();
+  if (num_succs > 1 && base_num_succs > 1 &&
+      base_node->PlayerActing() == node->PlayerActing() &&
+      ! warm_buckets_->None(st) && buckets_.None(st)) {
+    unsigned int pa = node->PlayerActing();
+    unique_ptr<unsigned int []> succ_map(new unsigned int[base_num_succs]);
+    for (unsigned int s = 0; s < base_num_succs; ++s) {
+      succ_map[s] = CorrespondingSucc(base_node, s, node);
+    }
+    unsigned char *base_regrets;
+    warm_regrets_->Values(pa, st, base_node->NonterminalID(), &base_regrets);
+    double *regrets, *sps = nullptr;
+    regrets_->Values(pa, st, node->NonterminalID(), &regrets);
+    if (sumprobs && sumprobs->Players(pa) && sumprobs->Doubles(pa, st)) {
+      sumprobs->Values(pa, st, node->NonterminalID(), &sps);
+    }
+    unsigned int max_street = Game::MaxStreet();
+    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    unsigned int num_board_cards = Game::NumBoardCards(st);
+    unique_ptr<unsigned int []> board_buckets(
+				     new unsigned int[num_hole_card_pairs]);
+    Card cards[7];
+    unsigned int num_local_boards =
+      BoardTree::NumLocalBoards(subtree_st_, solve_bd, st);
+    for (unsigned int lbd = 0; lbd < num_local_boards; ++lbd) {
+      unsigned int gbd = BoardTree::GlobalIndex(subtree_st_, solve_bd, st,
+						lbd);
+      const Card *board = BoardTree::Board(st, gbd);
+      for (unsigned int i = 0; i < num_board_cards; ++i) {
+	cards[i + 2] = board[i];
+      }
+      const CanonicalCards *hands = hand_tree_->Hands(st, lbd);
+      warm_buckets_->BoardBuckets(st, gbd, board_buckets.get());
+      for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+	// Hands on the final street are sorted by hand strength; bucket
+	// lookup wants the hole card pair index.
+	unsigned int hcp = i;
+	if (st == max_street) {
+	  const Card *hole_cards = hands->Cards(i);
+	  cards[0] = hole_cards[0];
+	  cards[1] = hole_cards[1];
+	  hcp = HCPIndex(st, cards);
+	}
+	unsigned char *my_base_regrets =
+	  base_regrets + board_buckets[hcp] * base_num_succs;
+	unsigned int best_s = kMaxUInt;
+	for (unsigned int s = 0; s < base_num_succs; ++s) {
+	  if (my_base_regrets[s]) {
+	    best_s = succ_map[s];
+	    break;
+	  }
+	}
+	if (best_s == kMaxUInt) continue;
+	unsigned long long int offset =
+	  (((unsigned long long int)lbd) * num_hole_card_pairs + i) * num_succs;
+	regrets[offset + best_s] = warm_weight_;
+	if (sps) sps[offset + best_s] = warm_weight_;
+      }
+    }
+  }
+  for (unsigned int s = 0; s < num_succs; ++s) {
+    unsigned int base_s = CorrespondingSucc(node, s, base_node);
+    if (base_s == kMaxUInt) continue;
+    WarmStart(node->IthSucc(s), base_node->IthSucc(base_s), solve_bd,
+	      sumprobs);
+  }
+}
+
 // We allow for a separate "solve" subtree and "target" subtree.  We want to
 // compute a strategy for the target subtree.  But to do do that we may
 // "back up" and solve a larger enclosing subtree - the "solve" subtree.  We
@@ -695,6 +817,9 @@ void EGCFR::SolveSubgame(BettingTree *subtree, unsigned int solve_bd,
 			       compressed_streets_));
   
   regrets_->AllocateAndClearDoubles(subtree->Root(), kMaxUInt);
+  if (warm_weight_ > 0) {
+    WarmStart(subtree->Root(), warm_root_, solve_bd, sumprobs);
+  }
 
   // Should honor sumprobs_streets_
 
@@ -835,7 +960,9 @@ void EGCFR::SolveSubgame(BettingTree *subtree, unsigned int solve_bd,
     best_response_streets_[st] = false;
   }
   value_calculation_ = false;
-  double *vals;
+  timeval start_tv;
+  gettimeofday(&start_tv, NULL);
+  num_its_run_ = 0;
   for (it_ = 1; it_ <= num_its; ++it_) {
     // fprintf(stderr, "It %i\n", it_);
     if (method_ == ResolvingMethod::MAXMARGIN) {
@@ -846,16 +973,24 @@ void EGCFR::SolveSubgame(BettingTree *subtree, unsigned int solve_bd,
       CFRDHalfIteration(subtree, solve_bd, opp_cvs, initial_states[1]);
       CFRDHalfIteration(subtree, solve_bd, opp_cvs, initial_states[0]);
     } else if (method_ == ResolvingMethod::UNSAFE) {
-      vals = HalfIteration(subtree, solve_bd, *initial_states[1]);
-      delete [] vals;
-      vals = HalfIteration(subtree, solve_bd, *initial_states[0]);
-      delete [] vals;
+      ArenaFrame frame(initial_states[0]->GetArena());
+      HalfIteration(subtree, solve_bd, *initial_states[1]);
+      HalfIteration(subtree, solve_bd, *initial_states[0]);
     } else if (method_ == ResolvingMethod::COMBINED) {
       CombinedHalfIteration(subtree, solve_bd, reach_probs, opp_cvs,
 			    initial_states[1]);
       CombinedHalfIteration(subtree, solve_bd, reach_probs, opp_cvs,
 			    initial_states[0]);
     }
+    num_its_run_ = it_;
+    if (time_limit_ > 0) {
+      timeval tv;
+      gettimeofday(&tv, NULL);
+      double secs = (tv.tv_sec - start_tv.tv_sec) +
+	(tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+      if (secs + secs / it_ > time_limit_) break;
+    }
+    if (stop_ && __atomic_load_n(stop_, __ATOMIC_RELAXED)) break;
   }
 
   for (unsigned int p = 0; p < num_players; ++p) {
@@ -1023,13 +1158,18 @@ double *EGCFR::BRGo(BettingTree *subtree, unsigned int solve_bd,
   SetStreetBuckets(subtree_root->Street(), solve_bd, state);
   // If no opponent reach the subtree with non-zero probability, then all
   // vals are zero.
-  double *vals;
+  double *vals = new double[num_hole_card_pairs];
   if (state.SumOppProbs() == 0) {
-    vals = new double[num_hole_card_pairs];
     for (unsigned int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
   } else {
+    // The caller owns the values we return, so copy them out of the arena.
+    ArenaFrame frame(state.GetArena());
     // Should pass in right action sequence
-    vals = Process(subtree_root, 0, state, subtree_root->Street());
+    double *arena_vals = Process(subtree_root, 0, state,
+				 subtree_root->Street());
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      vals[i] = arena_vals[i];
+    }
   }
   DeleteStreetBuckets(street_buckets);
   return vals;
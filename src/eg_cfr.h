@@ -39,6 +39,31 @@ class EGCFR : public VCFR {
 		    const HandTree *hand_tree, double *opp_cvs,
 		    unsigned int target_p, bool both_players,
 		    unsigned int num_its, CFRValues *sumprobs);
+  // If secs is positive, SolveSubgame() stops short of num_its once another
+  // iteration (predicted from the average so far) would take it past secs.
+  // At least one iteration is always run.  Sumprobs are updated in place,
+  // so they hold the average strategy as of the last completed iteration.
+  void SetTimeLimit(double secs) {time_limit_ = secs;}
+  // If stop is non-null, SolveSubgame() returns after the current iteration
+  // once *stop becomes true.  Allows another thread to abandon a solve.
+  void SetStopFlag(const bool *stop) {stop_ = stop;}
+  // If weight is positive, SolveSubgame() starts from the base strategy
+  // rather than from zero.  base_regrets holds pure base regrets (as created
+  // by CFRValuesFile::ReadPureSubtree()) for the base subtree rooted at
+  // base_root, bucketed by base_buckets.  For each hand, the endgame action
+  // corresponding to the base best-succ gets an initial regret and sumprob
+  // of weight.  Larger weights make the base strategy persist longer.
+  // Streets that are bucketed in the endgame abstraction, or unabstracted in
+  // the base, start from zero.
+  void SetWarmStart(Node *base_root, const CFRValues *base_regrets,
+		    const Buckets *base_buckets, double weight) {
+    warm_root_ = base_root;
+    warm_regrets_ = base_regrets;
+    warm_buckets_ = base_buckets;
+    warm_weight_ = weight;
+  }
+  // Number of iterations run by the last call to SolveSubgame()
+  unsigned int NumItsRun(void) const {return num_its_run_;}
   void Write(BettingTree *subtree, Node *solve_root, Node *target_root,
 	     const string &action_sequence,
 	     const CardAbstraction &base_card_abstraction,
@@ -64,6 +89,8 @@ class EGCFR : public VCFR {
 			     VCFRState *state);
   void MaxMarginHalfIteration(BettingTree *subtree, unsigned int solve_bd,
 			      double *opp_cvs, VCFRState *state);
+  void WarmStart(Node *node, Node *base_node, unsigned int solve_bd,
+		 CFRValues *sumprobs);
   double *LoadCVs(Node *subtree_root, const string &action_sequence,
 		  unsigned int gbd, unsigned int base_it, unsigned int p,
 		  double **reach_probs, const CanonicalCards *hands,
@@ -90,6 +117,13 @@ class EGCFR : public VCFR {
   bool cfrs_;
   bool zero_sum_;
   unsigned int num_threads_;
+  double time_limit_;
+  const bool *stop_;
+  Node *warm_root_;
+  const CFRValues *warm_regrets_;
+  const Buckets *warm_buckets_;
+  double warm_weight_;
+  unsigned int num_its_run_;
   double *cfrd_regrets_;
   double *maxmargin_regrets_;
   double *combined_regrets_;
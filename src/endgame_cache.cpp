@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "betting_tree.h"
+#include "board_tree.h"
+#include "cards.h"
+#include "endgame_cache.h"
+#include "game.h"
+
+using namespace std;
+
+// Number of levels that each normalized reach probability is quantized to
+static const unsigned int kFingerprintLevels = 64;
+
+EndgameCache::EndgameCache(unsigned int max_size) {
+  if (max_size == 0) {
+    fprintf(stderr, "EndgameCache: max size must be positive\n");
+    exit(-1);
+  }
+  max_size_ = max_size;
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+EndgameCache::~EndgameCache(void) {
+  pthread_mutex_destroy(&mutex_);
+}
+
+// FNV-1a over the quantized reach probabilities of each player's hole card
+// pairs that don't conflict with the board.
+unsigned long long int EndgameCache::Fingerprint(unsigned int st,
+						 unsigned int bd,
+						 double **reach_probs) {
+  unsigned int num_players = Game::NumPlayers();
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  const Card *board = BoardTree::Board(st, bd);
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  unsigned long long int h = 14695981039346656037ULL;
+  for (unsigned int p = 0; p < num_players; ++p) {
+    double *p_reach_probs = reach_probs[p];
+    double max_prob = 0;
+    for (Card hi = 1; hi < max_card1; ++hi) {
+      if (InCards(hi, board, num_board_cards)) continue;
+      for (Card lo = 0; lo < hi; ++lo) {
+	if (InCards(lo, board, num_board_cards)) continue;
+	double prob = p_reach_probs[hi * max_card1 + lo];
+	if (prob > max_prob) max_prob = prob;
+      }
+    }
+    for (Card hi = 1; hi < max_card1; ++hi) {
+      if (InCards(hi, board, num_board_cards)) continue;
+      for (Card lo = 0; lo < hi; ++lo) {
+	if (InCards(lo, board, num_board_cards)) continue;
+	unsigned int q = 0;
+	if (max_prob > 0) {
+	  q = (unsigned int)(kFingerprintLevels *
+			     p_reach_probs[hi * max_card1 + lo] / max_prob +
+			     0.5);
+	}
+	h ^= q;
+	h *= 1099511628211ULL;
+      }
+    }
+  }
+  return h;
+}
+
+string EndgameCache::Key(unsigned int p, Node *node, unsigned int bd,
+			 unsigned long long int fingerprint) {
+  char buf[100];
+  sprintf(buf, "p%u.%u.%u.%u.%u.%016llx", p, node->Street(),
+	  node->PlayerActing(), node->NonterminalID(), bd, fingerprint);
+  return buf;
+}
+
+bool EndgameCache::Lookup(const string &key, EndgameCacheEntry *entry) {
+  pthread_mutex_lock(&mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    pthread_mutex_unlock(&mutex_);
+    return false;
+  }
+  // Move to the front
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *entry = it->second->second;
+  pthread_mutex_unlock(&mutex_);
+  return true;
+}
+
+void EndgameCache::Insert(const string &key, const EndgameCacheEntry &entry) {
+  pthread_mutex_lock(&mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = entry;
+    entries_.splice(entries_.begin(), entries_, it->second);
+  } else {
+    if (index_.size() >= max_size_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.push_front(make_pair(key, entry));
+    index_[key] = entries_.begin();
+  }
+  pthread_mutex_unlock(&mutex_);
+}
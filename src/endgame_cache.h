@@ -0,0 +1,63 @@
+#ifndef _ENDGAME_CACHE_H_
+#define _ENDGAME_CACHE_H_
+
+// An LRU cache of resolved endgames for use during a match.  The same
+// street-initial node of the base betting tree and the same canonical board
+// recur constantly (e.g., check-check on a paired flop), and there is no
+// point in rebuilding the subtree, the T-values and re-solving each time.
+//
+// Entries are keyed by the player being resolved for, the street-initial
+// node, the canonical board and a fingerprint of the reach probabilities.
+// The reach probabilities are normalized by each player's maximum and then
+// quantized before hashing so that negligible differences don't defeat the
+// cache.
+//
+// Lookup() and Insert() may be called from different threads.
+
+#include <pthread.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+class BettingTree;
+class CFRValues;
+class Node;
+
+struct EndgameCacheEntry {
+  EndgameCacheEntry(void) : num_its(0) {}
+  shared_ptr<BettingTree> subtree;
+  shared_ptr<CFRValues> sumprobs;
+  // The number of iterations the solve ran.  Less than the configured
+  // number if the solve was cut short by a time budget.
+  unsigned int num_its;
+};
+
+class EndgameCache {
+ public:
+  EndgameCache(unsigned int max_size);
+  ~EndgameCache(void);
+  static unsigned long long int Fingerprint(unsigned int st, unsigned int bd,
+					    double **reach_probs);
+  // The key has no slashes so that it can be used in a filename.
+  static string Key(unsigned int p, Node *node, unsigned int bd,
+		    unsigned long long int fingerprint);
+  // Returns false if the key is not present.  Otherwise fills in *entry and
+  // marks the entry as most recently used.
+  bool Lookup(const string &key, EndgameCacheEntry *entry);
+  // Evicts the least recently used entry if the cache is full.
+  void Insert(const string &key, const EndgameCacheEntry &entry);
+ private:
+  typedef list< pair<string, EndgameCacheEntry> > EntryList;
+
+  unsigned int max_size_;
+  // Most recently used at the front
+  EntryList entries_;
+  unordered_map<string, EntryList::iterator> index_;
+  pthread_mutex_t mutex_;
+};
+
+#endif
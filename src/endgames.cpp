@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -172,6 +173,7 @@ void EndgameSolver::BRGo(double *p0_br, double *p1_br) {
   VCFRState state(opp_probs, street_buckets, hand_tree_, 0, nullptr,
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
+  ArenaFrame frame(state.GetArena());
 
   state.SetP(0);
   double *p0_vals = Process(betting_tree_->Root(), 0, state, 0);
@@ -196,9 +198,6 @@ void EndgameSolver::BRGo(double *p0_br, double *p1_br) {
   }
   *p0_br = p0_sum / denom;
   *p1_br = p1_sum / denom;
-
-  delete [] p0_vals;
-  delete [] p1_vals;
 }
 
 double *EndgameSolver::Process(Node *node, unsigned int lbd, 
@@ -210,8 +209,15 @@ double *EndgameSolver::Process(Node *node, unsigned int lbd,
     unsigned int nt = node->NonterminalID();
     unsigned int pa = node->PlayerActing();
     unsigned int p = state.P();
-    double *vals = br_vals_[p][pa][nt][lbd];
+    double *br_vals = br_vals_[p][pa][nt][lbd];
     br_vals_[p][pa][nt][lbd] = nullptr;
+    // Callers expect the values in the arena
+    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    double *vals = state.GetArena()->AllocateDoubles(num_hole_card_pairs);
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      vals[i] = br_vals[i];
+    }
+    delete [] br_vals;
     return vals;
   } else {
     return VCFR::Process(node, lbd, state, last_st);
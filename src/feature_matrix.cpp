@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "feature_matrix.h"
+#include "io.h"
+
+FeatureMatrix::FeatureMatrix(unsigned int num_rows, unsigned int dim) {
+  num_rows_ = num_rows;
+  dim_ = dim;
+  stride_ = (dim_ + 7) & ~7U;
+  size_t num_bytes =
+    ((unsigned long long int)num_rows_) * stride_ * sizeof(float);
+  if (num_bytes == 0) num_bytes = 64;
+  void *p;
+  if (posix_memalign(&p, 64, num_bytes) != 0) {
+    fprintf(stderr, "FeatureMatrix: posix_memalign of %zu bytes failed\n",
+	    num_bytes);
+    exit(-1);
+  }
+  data_ = (float *)p;
+  memset(data_, 0, num_bytes);
+}
+
+FeatureMatrix::~FeatureMatrix(void) {
+  free(data_);
+}
+
+void FeatureMatrix::ReadRows(Reader *reader, unsigned int first_row,
+			     unsigned int num_rows) {
+  if (first_row + num_rows > num_rows_) {
+    fprintf(stderr, "FeatureMatrix::ReadRows: rows %u..%u out of range\n",
+	    first_row, first_row + num_rows);
+    exit(-1);
+  }
+  // Read a block of rows at a time with one call rather than one short at
+  // a time.
+  const unsigned int kBlockRows = 4096;
+  unsigned int block_rows = num_rows < kBlockRows ? num_rows : kBlockRows;
+  short *raw = new short[((unsigned long long int)block_rows) * dim_];
+  unsigned int done = 0;
+  while (done < num_rows) {
+    unsigned int n = num_rows - done;
+    if (n > block_rows) n = block_rows;
+    reader->ReadNBytesOrDie(n * dim_ * sizeof(short), (unsigned char *)raw);
+    for (unsigned int i = 0; i < n; ++i) {
+      float *row = Row(first_row + done + i);
+      const short *src = raw + ((unsigned long long int)i) * dim_;
+      for (unsigned int d = 0; d < dim_; ++d) row[d] = src[d];
+    }
+    done += n;
+  }
+  delete [] raw;
+}
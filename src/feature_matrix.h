@@ -0,0 +1,34 @@
+#ifndef _FEATURE_MATRIX_H_
+#define _FEATURE_MATRIX_H_
+
+class Reader;
+
+// A dense matrix of float feature values with one row per object, used by
+// the clustering code.  All rows live in one contiguous buffer.  Rows are
+// padded to a multiple of eight floats and the buffer is cache line
+// aligned, so every row starts on a 32 byte boundary.  The padding is zero.
+class FeatureMatrix {
+public:
+  FeatureMatrix(unsigned int num_rows, unsigned int dim);
+  ~FeatureMatrix(void);
+  float *Row(unsigned int r) {
+    return data_ + ((unsigned long long int)r) * stride_;
+  }
+  const float *Row(unsigned int r) const {
+    return data_ + ((unsigned long long int)r) * stride_;
+  }
+  // Fills rows first_row..first_row+num_rows-1 from the current position of
+  // a feature file (dim shorts per object).
+  void ReadRows(Reader *reader, unsigned int first_row,
+		unsigned int num_rows);
+  unsigned int NumRows(void) const {return num_rows_;}
+  unsigned int Dim(void) const {return dim_;}
+  unsigned int Stride(void) const {return stride_;}
+private:
+  unsigned int num_rows_;
+  unsigned int dim_;
+  unsigned int stride_;
+  float *data_;
+};
+
+#endif
@@ -2,60 +2,122 @@
 // For small games you can maintain all possible hands by rooting at the
 // preflop.  For large games, you might create the HandTree for all hands
 // rooted at a particular flop board.
+//
+// Alternatively a lazy HandTree (see the constructor with max_bytes) builds
+// the hands for a board on first use and can evict boards that have not been
+// used recently.  This makes a full game HandTree affordable when only some
+// boards are touched at a time.
 
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <list>
+#include <map>
 #include <vector>
 
 #include "board_tree.h"
 #include "canonical_cards.h"
 #include "cards.h"
+#include "constants.h"
 #include "game.h"
 #include "hand_tree.h"
 #include "hand_value_tree.h"
 
 using namespace std;
 
+// Live lazy trees, so that a thread's pins can be released when the thread
+// exits (if the tree is still around).
+static pthread_mutex_t g_trees_mutex = PTHREAD_MUTEX_INITIALIZER;
+static map<unsigned long long int, const HandTree *> g_trees;
+
 HandTree::HandTree(unsigned int root_st, unsigned int root_bd,
 		   unsigned int final_st) {
   root_st_ = root_st;
   root_bd_ = root_bd;
   final_st_ = final_st;
+  lazy_ = false;
+  id_ = 0;
+  max_bytes_ = 0;
+  num_bytes_ = 0;
+  pins_ = nullptr;
+  lru_its_ = nullptr;
   hands_ = new CanonicalCards **[final_st_ + 1];
   for (unsigned int st = 0; st < root_st_; ++st) {
     hands_[st] = NULL;
   }
   BoardTree::Create();
-  unsigned int max_street = Game::MaxStreet();
-  if (final_st == max_street) {
-    // Used to lazily instantiate, but that doesn't currently work in
-    // multi-threaded environment because HandValueTree::Create() is not
-    // threadsafe.  (Should just fix that.)
-    if (! HandValueTree::Created()) {
-      fprintf(stderr, "Hand value tree has not been created\n");
-      exit(-1);
+  for (unsigned int st = root_st_; st <= final_st_; ++st) {
+    unsigned int num_local_boards =
+      BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    hands_[st] = new CanonicalCards *[num_local_boards];
+    if (st == root_st_) {
+      for (unsigned int lbd = 0; lbd < num_local_boards; ++lbd) {
+	hands_[st][lbd] = BuildHands(st, lbd, nullptr);
+	num_bytes_ += hands_[st][lbd]->NumBytes();
+      }
+      continue;
     }
+    // Derive the hands for each board from those of its predecessor board
+    unsigned int pst = st - 1;
+    unsigned int num_prev_local_boards =
+      BoardTree::NumLocalBoards(root_st_, root_bd_, pst);
+    for (unsigned int plbd = 0; plbd < num_prev_local_boards; ++plbd) {
+      unsigned int pgbd = BoardTree::GlobalIndex(root_st_, root_bd_, pst,
+						 plbd);
+      unsigned int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, st);
+      unsigned int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, st);
+      for (unsigned int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+	unsigned int nlbd = BoardTree::LocalIndex(root_st_, root_bd_, st, ngbd);
+	hands_[st][nlbd] = BuildHands(st, nlbd, hands_[pst][plbd]);
+	num_bytes_ += hands_[st][nlbd]->NumBytes();
+      }
+    }
+  }
+}
+
+HandTree::HandTree(unsigned int root_st, unsigned int root_bd,
+		   unsigned int final_st, unsigned long long int max_bytes) {
+  static atomic<unsigned long long int> next_id(1);
+  root_st_ = root_st;
+  root_bd_ = root_bd;
+  final_st_ = final_st;
+  lazy_ = true;
+  id_ = next_id++;
+  max_bytes_ = max_bytes;
+  num_bytes_ = 0;
+  hands_ = new CanonicalCards **[final_st_ + 1];
+  pins_ = new unsigned int *[final_st_ + 1];
+  lru_its_ = new list<unsigned long long int>::iterator *[final_st_ + 1];
+  for (unsigned int st = 0; st < root_st_; ++st) {
+    hands_[st] = NULL;
+    pins_[st] = NULL;
+    lru_its_[st] = NULL;
   }
+  BoardTree::Create();
   for (unsigned int st = root_st_; st <= final_st_; ++st) {
     unsigned int num_local_boards =
       BoardTree::NumLocalBoards(root_st_, root_bd_, st);
-    unsigned int num_board_cards = Game::NumBoardCards(st);
     hands_[st] = new CanonicalCards *[num_local_boards];
+    pins_[st] = new unsigned int[num_local_boards];
+    lru_its_[st] = new list<unsigned long long int>::iterator[num_local_boards];
     for (unsigned int lbd = 0; lbd < num_local_boards; ++lbd) {
-      unsigned int gbd = BoardTree::GlobalIndex(root_st_, root_bd_, st, lbd);
-      const Card *board = BoardTree::Board(st, gbd);
-      unsigned int sg = BoardTree::SuitGroups(st, gbd);
-      hands_[st][lbd] = new CanonicalCards(2, board, num_board_cards, sg,
-					   false);
-      if (st == max_street) {
-	hands_[st][lbd]->SortByHandStrength(board);
-      }
+      hands_[st][lbd] = nullptr;
+      pins_[st][lbd] = 0;
     }
   }
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_mutex_lock(&g_trees_mutex);
+  g_trees[id_] = this;
+  pthread_mutex_unlock(&g_trees_mutex);
 }
 
 HandTree::~HandTree(void) {
+  if (lazy_) {
+    pthread_mutex_lock(&g_trees_mutex);
+    g_trees.erase(id_);
+    pthread_mutex_unlock(&g_trees_mutex);
+  }
   for (unsigned int st = root_st_; st <= final_st_; ++st) {
     unsigned int num_local_boards =
       BoardTree::NumLocalBoards(root_st_, root_bd_, st);
@@ -65,6 +127,138 @@ HandTree::~HandTree(void) {
     delete [] hands_[st];
   }
   delete [] hands_;
+  if (lazy_) {
+    for (unsigned int st = root_st_; st <= final_st_; ++st) {
+      delete [] pins_[st];
+      delete [] lru_its_[st];
+    }
+    delete [] pins_;
+    delete [] lru_its_;
+    pthread_mutex_destroy(&mutex_);
+  }
+}
+
+// If parent (the hands of the predecessor board) is non-null, the hands are
+// derived from it rather than built from scratch.
+CanonicalCards *HandTree::BuildHands(unsigned int st, unsigned int lbd,
+				     const CanonicalCards *parent) const {
+  unsigned int gbd = BoardTree::GlobalIndex(root_st_, root_bd_, st, lbd);
+  // Already built (and sorted) if the board tree image has hands
+  const unsigned char *image = BoardTree::ImageHands(st, gbd);
+  if (image) return new CanonicalCards(image);
+  const Card *board = BoardTree::Board(st, gbd);
+  unsigned int sg = BoardTree::SuitGroups(st, gbd);
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  CanonicalCards *hands;
+  if (parent) {
+    hands = new CanonicalCards(*parent, board, num_board_cards, sg);
+  } else {
+    hands = new CanonicalCards(2, board, num_board_cards, sg, false);
+  }
+  if (st == Game::MaxStreet()) {
+    // Thread-safe, and a no-op if already created
+    HandValueTree::Create();
+    hands->SortByHandStrength(board);
+  }
+  return hands;
+}
+
+struct HandTreePins {
+  unsigned long long int tree_id;
+  vector<unsigned int> lbds;
+  vector<const CanonicalCards *> hands;
+};
+
+// The board each thread last asked for on each street of each lazy tree,
+// so that repeated requests for the same board take no lock.
+class HandTreeThreadPins {
+public:
+  ~HandTreeThreadPins(void) {
+    pthread_mutex_lock(&g_trees_mutex);
+    for (unsigned int i = 0; i < pins_.size(); ++i) {
+      auto it = g_trees.find(pins_[i].tree_id);
+      if (it != g_trees.end()) it->second->Unpin(pins_[i].lbds);
+    }
+    pthread_mutex_unlock(&g_trees_mutex);
+  }
+  vector<HandTreePins> pins_;
+};
+
+static thread_local HandTreeThreadPins g_thread_pins;
+
+void HandTree::Unpin(const vector<unsigned int> &lbds) const {
+  pthread_mutex_lock(&mutex_);
+  for (unsigned int st = root_st_; st <= final_st_; ++st) {
+    if (lbds[st] != kMaxUInt) --pins_[st][lbds[st]];
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+const CanonicalCards *HandTree::LazyHands(unsigned int st,
+					  unsigned int lbd) const {
+  vector<HandTreePins> &pins = g_thread_pins.pins_;
+  HandTreePins *tp = nullptr;
+  for (unsigned int i = 0; i < pins.size(); ++i) {
+    if (pins[i].tree_id == id_) {
+      tp = &pins[i];
+      break;
+    }
+  }
+  if (tp == nullptr) {
+    pins.resize(pins.size() + 1);
+    tp = &pins.back();
+    tp->tree_id = id_;
+    tp->lbds.resize(final_st_ + 1, kMaxUInt);
+    tp->hands.resize(final_st_ + 1, nullptr);
+  }
+  if (tp->lbds[st] == lbd) return tp->hands[st];
+
+  pthread_mutex_lock(&mutex_);
+  if (tp->lbds[st] != kMaxUInt) --pins_[st][tp->lbds[st]];
+  tp->lbds[st] = kMaxUInt;
+  if (hands_[st][lbd] == nullptr) {
+    // Build without holding the lock.  If another thread builds the same
+    // board in the meantime, keep theirs.
+    pthread_mutex_unlock(&mutex_);
+    CanonicalCards *hands = BuildHands(st, lbd, nullptr);
+    pthread_mutex_lock(&mutex_);
+    if (hands_[st][lbd] == nullptr) {
+      hands_[st][lbd] = hands;
+      num_bytes_ += hands->NumBytes();
+      lru_its_[st][lbd] = lru_.insert(lru_.end(),
+				      lbd * (final_st_ + 1ULL) + st);
+    } else {
+      delete hands;
+      lru_.splice(lru_.end(), lru_, lru_its_[st][lbd]);
+    }
+  } else {
+    lru_.splice(lru_.end(), lru_, lru_its_[st][lbd]);
+  }
+  ++pins_[st][lbd];
+  const CanonicalCards *hands = hands_[st][lbd];
+  Evict();
+  pthread_mutex_unlock(&mutex_);
+  tp->lbds[st] = lbd;
+  tp->hands[st] = hands;
+  return hands;
+}
+
+// Must hold mutex_.
+void HandTree::Evict(void) const {
+  if (max_bytes_ == 0) return;
+  auto it = lru_.begin();
+  while (num_bytes_ > max_bytes_ && it != lru_.end()) {
+    unsigned int st = *it % (final_st_ + 1);
+    unsigned int lbd = *it / (final_st_ + 1);
+    if (pins_[st][lbd] > 0) {
+      ++it;
+      continue;
+    }
+    num_bytes_ -= hands_[st][lbd]->NumBytes();
+    delete hands_[st][lbd];
+    hands_[st][lbd] = nullptr;
+    it = lru_.erase(it);
+  }
 }
 
 // Assumes hole cards are ordered
@@ -1,6 +1,11 @@
 #ifndef _HAND_TREE_H_
 #define _HAND_TREE_H_
 
+#include <pthread.h>
+
+#include <list>
+#include <vector>
+
 #include "cards.h"
 
 class CanonicalCards;
@@ -8,16 +13,48 @@ class CanonicalCards;
 class HandTree {
 public:
   HandTree(unsigned int root_st, unsigned int root_bd, unsigned int final_st);
+  // A lazy hand tree.  The hands for a board are only built the first time
+  // they are asked for.  If max_bytes is nonzero, the least recently used
+  // boards are evicted to keep the hands under (roughly) that many bytes.
+  HandTree(unsigned int root_st, unsigned int root_bd, unsigned int final_st,
+	   unsigned long long int max_bytes);
   ~HandTree(void);
+  // Safe to call from multiple threads.  For a lazy tree the pointer stays
+  // valid until the calling thread asks for a different board on the same
+  // street; i.e., through a depth-first walk of the board.
   const CanonicalCards *Hands(unsigned int st, unsigned int lbd) const {
+    if (lazy_) return LazyHands(st, lbd);
     return hands_[st][lbd];
   }
   unsigned int RootSt(void) const {return root_st_;}
+  unsigned long long int NumBytes(void) const {return num_bytes_;}
 private:
+  const CanonicalCards *LazyHands(unsigned int st, unsigned int lbd) const;
+  CanonicalCards *BuildHands(unsigned int st, unsigned int lbd,
+			     const CanonicalCards *parent) const;
+  void Evict(void) const;
+  void Unpin(const std::vector<unsigned int> &lbds) const;
+
+  friend class HandTreeThreadPins;
+
   unsigned int root_st_;
   unsigned int root_bd_;
   unsigned int final_st_;
   CanonicalCards ***hands_;
+  // The remaining members are only used by lazy trees.  They are mutable
+  // because boards get built and evicted underneath the const Hands().
+  bool lazy_;
+  unsigned long long int id_;
+  unsigned long long int max_bytes_;
+  mutable unsigned long long int num_bytes_;
+  // Number of threads whose most recent board on the street is this one.
+  // Pinned boards are never evicted.
+  unsigned int **pins_;
+  // Boards in least recently used order, encoded as lbd * (final_st + 1) +
+  // st.  Only boards that have been built are present.
+  mutable std::list<unsigned long long int> lru_;
+  std::list<unsigned long long int>::iterator **lru_its_;
+  mutable pthread_mutex_t mutex_;
 };
 
 unsigned int HCPIndex(unsigned int st, const Card *cards);
@@ -1,4 +1,7 @@
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>
 #include <vector>
@@ -6,11 +9,13 @@
 #include "cards.h"
 #include "files.h"
 #include "game.h"
+#include "hand_evaluator.h"
 #include "hand_value_tree.h"
 #include "io.h"
 
 using namespace std;
 
+bool HandValueTree::created_ = false;
 unsigned int HandValueTree::num_board_cards_ = 0;
 unsigned int HandValueTree::num_cards_ = 0;
 unsigned int *HandValueTree::tree1_ = NULL;
@@ -20,11 +25,23 @@ unsigned int ****HandValueTree::tree4_ = NULL;
 unsigned int *****HandValueTree::tree5_ = NULL;
 unsigned int ******HandValueTree::tree6_ = NULL;
 unsigned int *******HandValueTree::tree7_ = NULL;
+bool HandValueTree::flat_ = false;
+unsigned int HandValueTree::num_ranks_ = 0;
+unsigned int HandValueTree::num_suits_ = 0;
+unsigned int *HandValueTree::colex_ = NULL;
+unsigned int *HandValueTree::rank_vals_ = NULL;
+unsigned int *HandValueTree::flush_vals_ = NULL;
+
+static pthread_mutex_t g_create_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Should make thread-safe
 void HandValueTree::Create(void) {
   // Check if already created
-  if (num_cards_ != 0) return;
+  if (__atomic_load_n(&created_, __ATOMIC_ACQUIRE)) return;
+  pthread_mutex_lock(&g_create_mutex);
+  if (created_) {
+    pthread_mutex_unlock(&g_create_mutex);
+    return;
+  }
   tree1_ = NULL;
   tree2_ = NULL;
   tree3_ = NULL;
@@ -35,17 +52,171 @@ void HandValueTree::Create(void) {
   unsigned int max_street = Game::MaxStreet();
   num_board_cards_ = Game::NumBoardCards(max_street);
   num_cards_ = num_board_cards_ + Game::NumCardsForStreet(0);
-  if (num_cards_ == 1)      ReadOne();
+  if (FlatSupported())      CreateFlat();
+  else if (num_cards_ == 1) ReadOne();
   else if (num_cards_ == 2) ReadTwo();
   else if (num_cards_ == 3) ReadThree();
   else if (num_cards_ == 4) ReadFour();
   else if (num_cards_ == 5) ReadFive();
   else if (num_cards_ == 6) ReadSix();
   else if (num_cards_ == 7) ReadSeven();
+  __atomic_store_n(&created_, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&g_create_mutex);
 }
 
 bool HandValueTree::Created(void) {
-  return num_cards_ != 0;
+  return __atomic_load_n(&created_, __ATOMIC_ACQUIRE);
+}
+
+// HoldemHandEvaluator handles at most seven cards, thirteen ranks and four
+// suits.  With one suit every hand is a flush, which the tables don't
+// handle.
+bool HandValueTree::FlatSupported(void) {
+  if (! strncmp(Game::GameName().c_str(), "leduc", 5)) return false;
+  return num_cards_ >= 2 && num_cards_ <= 7 && Game::NumRanks() <= 13 &&
+    Game::NumSuits() >= 2 && Game::NumSuits() <= 4;
+}
+
+static unsigned long long int Binom(unsigned int n, unsigned int k) {
+  if (k > n) return 0;
+  unsigned long long int b = 1;
+  for (unsigned int i = 0; i < k; ++i) {
+    b = b * (n - i) / (i + 1);
+  }
+  return b;
+}
+
+// Enumerates the sorted rank sequences (ranks[0] <= ranks[1] <= ...) and
+// evaluates a representative hand for each.  Giving the card in position j
+// suit j % num_suits_ keeps the cards of any one rank in distinct suits
+// and leaves no suit with five cards, so the representative has no flush.
+void HandValueTree::FillRankVals(HandEvaluator *evaluator, unsigned int i,
+				 unsigned int min_r, unsigned int *ranks,
+				 unsigned int *counts) {
+  if (i == num_cards_) {
+    Card cards[7];
+    unsigned int index = 0;
+    for (unsigned int j = 0; j < num_cards_; ++j) {
+      cards[j] = MakeCard(ranks[j], j % num_suits_);
+      index += colex_[j * num_ranks_ + ranks[j]];
+    }
+    rank_vals_[index] = evaluator->Evaluate(cards, num_cards_);
+    return;
+  }
+  for (unsigned int r = min_r; r < num_ranks_; ++r) {
+    if (counts[r] == num_suits_) continue;
+    ranks[i] = r;
+    ++counts[r];
+    FillRankVals(evaluator, i + 1, r, ranks, counts);
+    --counts[r];
+  }
+}
+
+// A hand's value depends only on its multiset of ranks unless it has a
+// flush.  With at most seven cards, a hand with a flush cannot also have
+// quads or a full house, so its value depends only on the ranks in the
+// flush suit.
+void HandValueTree::CreateFlat(void) {
+  flat_ = true;
+  num_ranks_ = Game::NumRanks();
+  num_suits_ = Game::NumSuits();
+  // Sorted ranks r0 <= r1 <= ... correspond to the combination
+  // r0 < r1 + 1 < r2 + 2 < ..., whose colexicographic index is our hash.
+  colex_ = new unsigned int[num_cards_ * num_ranks_];
+  for (unsigned int i = 0; i < num_cards_; ++i) {
+    for (unsigned int r = 0; r < num_ranks_; ++r) {
+      colex_[i * num_ranks_ + r] = Binom(r + i, i + 1);
+    }
+  }
+  unsigned int num_rank_vals = Binom(num_ranks_ + num_cards_ - 1, num_cards_);
+  rank_vals_ = new unsigned int[num_rank_vals];
+  for (unsigned int i = 0; i < num_rank_vals; ++i) rank_vals_[i] = 0;
+  HoldemHandEvaluator evaluator;
+  unsigned int ranks[7], counts[13];
+  for (unsigned int r = 0; r < num_ranks_; ++r) counts[r] = 0;
+  FillRankVals(&evaluator, 0, 0, ranks, counts);
+  if (num_cards_ >= 5) {
+    unsigned int num_masks = 1U << num_ranks_;
+    flush_vals_ = new unsigned int[num_masks];
+    for (unsigned int mask = 0; mask < num_masks; ++mask) {
+      flush_vals_[mask] = 0;
+      unsigned int num = __builtin_popcount(mask);
+      if (num < 5 || num > num_cards_) continue;
+      Card cards[7];
+      unsigned int j = 0;
+      for (unsigned int r = 0; r < num_ranks_; ++r) {
+	if (mask & (1U << r)) cards[j++] = MakeCard(r, 0);
+      }
+      flush_vals_[mask] = evaluator.Evaluate(cards, num);
+    }
+  }
+}
+
+// ranks must be sorted from low to high.  suit_masks has, for each suit, a
+// bit for the rank of each card in the suit.
+inline unsigned int HandValueTree::FlatVal(const unsigned int *ranks,
+					   const unsigned int *suit_masks) {
+  if (num_cards_ >= 5) {
+    for (unsigned int s = 0; s < num_suits_; ++s) {
+      if (__builtin_popcount(suit_masks[s]) >= 5) {
+	return flush_vals_[suit_masks[s]];
+      }
+    }
+  }
+  unsigned int index = 0;
+  for (unsigned int i = 0; i < num_cards_; ++i) {
+    index += colex_[i * num_ranks_ + ranks[i]];
+  }
+  return rank_vals_[index];
+}
+
+// Inserts rank r into the sorted array ranks[0..n-1].
+static inline void InsertRank(unsigned int r, unsigned int *ranks,
+			      unsigned int n) {
+  unsigned int j = n;
+  while (j > 0 && ranks[j - 1] > r) {
+    ranks[j] = ranks[j - 1];
+    --j;
+  }
+  ranks[j] = r;
+}
+
+void HandValueTree::BoardVals(const Card *board, const Card *hole_cards,
+			      unsigned int num_hands, unsigned int *vals) {
+  unsigned int num_hole_cards = num_cards_ - num_board_cards_;
+  if (! flat_) {
+    Card cards[7];
+    for (unsigned int i = 0; i < num_board_cards_; ++i) {
+      cards[num_hole_cards + i] = board[i];
+    }
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      for (unsigned int i = 0; i < num_hole_cards; ++i) {
+	cards[i] = hole_cards[h * num_hole_cards + i];
+      }
+      vals[h] = Val(cards);
+    }
+    return;
+  }
+  // Do the board once
+  unsigned int board_ranks[7], board_masks[4] = {0, 0, 0, 0};
+  for (unsigned int i = 0; i < num_board_cards_; ++i) {
+    Card c = board[i];
+    InsertRank(c / num_suits_, board_ranks, i);
+    board_masks[c % num_suits_] |= 1U << (c / num_suits_);
+  }
+  for (unsigned int h = 0; h < num_hands; ++h) {
+    unsigned int ranks[7], masks[4];
+    for (unsigned int i = 0; i < num_board_cards_; ++i) {
+      ranks[i] = board_ranks[i];
+    }
+    for (unsigned int s = 0; s < num_suits_; ++s) masks[s] = board_masks[s];
+    for (unsigned int i = 0; i < num_hole_cards; ++i) {
+      Card c = hole_cards[h * num_hole_cards + i];
+      InsertRank(c / num_suits_, ranks, num_board_cards_ + i);
+      masks[c % num_suits_] |= 1U << (c / num_suits_);
+    }
+    vals[h] = FlatVal(ranks, masks);
+  }
 }
 
 #if 0
@@ -251,6 +422,18 @@ void HandValueTree::ReadSeven(void) {
 }
 
 void HandValueTree::Delete(void) {
+  if (flat_) {
+    delete [] colex_;
+    delete [] rank_vals_;
+    delete [] flush_vals_;
+    colex_ = NULL;
+    rank_vals_ = NULL;
+    flush_vals_ = NULL;
+    flat_ = false;
+    num_cards_ = 0;
+    created_ = false;
+    return;
+  }
   unsigned int max_card = Game::MaxCard();
   if (num_cards_ == 1) {
     delete [] tree1_;
@@ -354,6 +537,7 @@ void HandValueTree::Delete(void) {
   tree7_ = NULL;
   // So HandValueTree::Create() will do something on next call
   num_cards_ = 0;
+  created_ = false;
 }
 
 #if 0
@@ -379,7 +563,15 @@ static void SortCards(Card *cards, unsigned int num) {
 #endif
 
 unsigned int HandValueTree::Val(const Card *cards) {
-  if (num_cards_ == 1) {
+  if (flat_) {
+    unsigned int ranks[7], masks[4] = {0, 0, 0, 0};
+    for (unsigned int i = 0; i < num_cards_; ++i) {
+      Card c = cards[i];
+      InsertRank(c / num_suits_, ranks, i);
+      masks[c % num_suits_] |= 1U << (c / num_suits_);
+    }
+    return FlatVal(ranks, masks);
+  } else if (num_cards_ == 1) {
     return tree1_[(int)cards[0]];
   } else if (num_cards_ == 2) {
     vector<int> v(2);
@@ -454,7 +646,17 @@ unsigned int HandValueTree::Val(const Card *cards) {
 // board and hole_cards should be sorted from high to low.
 unsigned int HandValueTree::Val(const unsigned int *board,
 				const unsigned int *hole_cards) {
-  if (num_cards_ == 1) {
+  if (flat_) {
+    Card cards[7];
+    unsigned int num_hole_cards = num_cards_ - num_board_cards_;
+    for (unsigned int i = 0; i < num_hole_cards; ++i) {
+      cards[i] = hole_cards[i];
+    }
+    for (unsigned int i = 0; i < num_board_cards_; ++i) {
+      cards[num_hole_cards + i] = board[i];
+    }
+    return Val(cards);
+  } else if (num_cards_ == 1) {
     return tree1_[hole_cards[0]];
   } else if (num_cards_ == 2 && num_board_cards_ == 1) {
     int b = board[0];
@@ -3,8 +3,18 @@
 
 #include "cards.h"
 
+class HandEvaluator;
+
+// Hand values for the showdown.  For Holdem-style games with up to seven
+// cards the values are looked up in two small flat tables that are built
+// in memory by Create(): one indexed by a perfect hash of the multiset of
+// ranks and one, for flushes, indexed by the ranks held in the flush suit.
+// Both fit in cache.  Other games fall back to the hand value tree files
+// written by build_hand_value_tree.  Either way the values are those of
+// HandEvaluator.
 class HandValueTree {
 public:
+  // Thread-safe; only the first call does anything.
   static void Create(void);
   static void Delete(void);
   static bool Created(void);
@@ -13,10 +23,22 @@ public:
   // board and hole_cards should be sorted from high to low.
   static unsigned int Val(const unsigned int *board,
 			  const unsigned int *hole_cards);
+  // Evaluates num_hands hands that share a max street board.  hole_cards
+  // holds the hole cards of each hand in turn.  Neither the board nor the
+  // hole cards need be sorted.
+  static void BoardVals(const Card *board, const Card *hole_cards,
+			unsigned int num_hands, unsigned int *vals);
   static unsigned int DiskRead(Card *cards);
 private:
   HandValueTree(void) {}
 
+  static bool FlatSupported(void);
+  static void CreateFlat(void);
+  static void FillRankVals(HandEvaluator *evaluator, unsigned int i,
+			   unsigned int min_r, unsigned int *ranks,
+			   unsigned int *counts);
+  static unsigned int FlatVal(const unsigned int *ranks,
+			      const unsigned int *suit_masks);
   static void ReadOne(void);
   static void ReadTwo(void);
   static void ReadThree(void);
@@ -25,6 +47,7 @@ private:
   static void ReadSix(void);
   static void ReadSeven(void);
 
+  static bool created_;
   static unsigned int num_board_cards_;
   static unsigned int num_cards_;
   static unsigned int *tree1_;
@@ -34,6 +57,14 @@ private:
   static unsigned int *****tree5_;
   static unsigned int ******tree6_;
   static unsigned int *******tree7_;
+  // Flat tables.  colex_[i * num_ranks_ + r] is the contribution to the
+  // perfect hash of rank r appearing in position i of the sorted ranks.
+  static bool flat_;
+  static unsigned int num_ranks_;
+  static unsigned int num_suits_;
+  static unsigned int *colex_;
+  static unsigned int *rank_vals_;
+  static unsigned int *flush_vals_;
 };
 
 #endif
@@ -443,9 +443,12 @@ void Reader::ReadOrDie(double *d) {
   *d = ReadDoubleOrDie();
 }
 
+// Copies whole buffers at a time rather than going byte by byte; this is
+// the fast path for reading large blocks of values.
 void Reader::ReadNBytesOrDie(unsigned int num_bytes, unsigned char *buf) {
-  for (unsigned int i = 0; i < num_bytes; ++i) {
-    if (buf_ptr_ + 1 > end_read_) {
+  unsigned int i = 0;
+  while (i < num_bytes) {
+    if (buf_ptr_ == end_read_) {
       if (! Refresh()) {
 	fprintf(stderr, "Couldn't read %i bytes\n", num_bytes);
 	fprintf(stderr, "Filename: %s\n", filename_.c_str());
@@ -456,8 +459,12 @@ void Reader::ReadNBytesOrDie(unsigned int num_bytes, unsigned char *buf) {
 	exit(-1);
       }
     }
-    buf[i] = *buf_ptr_++;
-    ++byte_pos_;
+    unsigned int n = end_read_ - buf_ptr_;
+    if (n > num_bytes - i) n = num_bytes - i;
+    memcpy(buf + i, buf_ptr_, n);
+    buf_ptr_ += n;
+    byte_pos_ += n;
+    i += n;
   }
 }
 
@@ -2,6 +2,16 @@
 // being clustered will have different types of features.
 // Have to take the square root or the triangle equality based test will not
 // work properly.
+//
+// If use_bounds is true we also use Hamerly's algorithm.  Each object keeps
+// an upper bound on the distance to its assigned centroid and a lower bound
+// on the distance to every other centroid.  After each Update() the bounds
+// are loosened by how far the centroids moved.  An object whose upper bound
+// is below both its lower bound and half the distance from its centroid to
+// the nearest other centroid cannot change clusters, so we skip it without
+// computing any distances.  Objects that fail the test are searched with
+// the neighbor lists (if there are any) or with a full scan, either of which
+// resets the bounds.
 
 #include <math.h>
 #include <pthread.h>
@@ -12,40 +22,49 @@
 #include <vector>
 
 #include "constants.h"
+#include "feature_matrix.h"
 #include "kmeans.h"
 #include "rand.h"
 #include "sorting.h"
+#include "sq_distance.h"
 
 static unsigned int g_it = 0;
 
 class KMeansThread {
 public:
   KMeansThread(unsigned int num_objects, unsigned int num_clusters,
-	       float **objects, unsigned int dim, double neighbor_thresh,
+	       const FeatureMatrix *objects, unsigned int dim,
+	       double neighbor_thresh,
 	       unsigned int *cluster_sizes, float **means,
 	       unsigned int *assignments, unsigned char **nearest_centroids,
 	       unsigned char **neighbor_ptrs,
 	       vector< pair<float, unsigned int> > *neighbor_vectors,
-	       unsigned int thread_index, unsigned int num_threads);
+	       float *upper_bounds, float *lower_bounds,
+	       float *half_separations, unsigned int thread_index,
+	       unsigned int num_threads);
   ~KMeansThread(void) {}
   void Assign(void);
   void ComputeIntraCentroidDistances(void);
+  void ComputeHalfSeparations(void);
   void SortNeighbors();
   void RunAssign(void);
   void RunIntra(void);
+  void RunSeparations(void);
   void RunSort(void);
   void Join(void);
   unsigned int NumChanged(void) const {return num_changed_;}
   double SumDists(void) const {return sum_dists_;}
 private:
-  unsigned int ExhaustiveNearest(unsigned int o, float *obj,
+  unsigned int ExhaustiveNearest(unsigned int o, const float *obj,
 				 unsigned int guess_c, double guess_min_dist,
 				 double *ret_min_dist);
-  unsigned int Nearest(unsigned int o, float *obj, double *ret_min_dist);
+  unsigned int Nearest(unsigned int o, const float *obj, double *ret_min_dist);
+  unsigned int BoundedNearest(unsigned int o, const float *obj,
+			      double *ret_min_dist);
 
   unsigned int num_objects_;
   unsigned int num_clusters_;
-  float **objects_;
+  const FeatureMatrix *objects_;
   unsigned int dim_;
   double neighbor_thresh_;
   unsigned int *cluster_sizes_;
@@ -54,6 +73,9 @@ private:
   unsigned char **nearest_centroids_;
   unsigned char **neighbor_ptrs_;
   vector< pair<float, unsigned int> > *neighbor_vectors_;
+  float *upper_bounds_;
+  float *lower_bounds_;
+  float *half_separations_;
   unsigned int thread_index_;
   unsigned int num_threads_;
   unsigned int num_changed_;
@@ -61,11 +83,14 @@ private:
   unsigned long long int exhaustive_count_;
   unsigned long long int abbreviated_count_;
   unsigned long long int dist_count_;
+  unsigned long long int skipped_count_;
+  unsigned long long int tightened_count_;
   pthread_t pthread_id_;
 };
 
 KMeansThread::KMeansThread(unsigned int num_objects,
-			   unsigned int num_clusters, float **objects,
+			   unsigned int num_clusters,
+			   const FeatureMatrix *objects,
 			   unsigned int dim, double neighbor_thresh,
 			   unsigned int *cluster_sizes,
 			   float **means, unsigned int *assignments,
@@ -73,6 +98,8 @@ KMeansThread::KMeansThread(unsigned int num_objects,
 			   unsigned char **neighbor_ptrs,
 			   vector< pair<float, unsigned int> > *
 			   neighbor_vectors,
+			   float *upper_bounds, float *lower_bounds,
+			   float *half_separations,
 			   unsigned int thread_index,
 			   unsigned int num_threads) {
   num_objects_ = num_objects;
@@ -86,6 +113,9 @@ KMeansThread::KMeansThread(unsigned int num_objects,
   nearest_centroids_ = nearest_centroids;
   neighbor_ptrs_ = neighbor_ptrs;
   neighbor_vectors_ = neighbor_vectors;
+  upper_bounds_ = upper_bounds;
+  lower_bounds_ = lower_bounds;
+  half_separations_ = half_separations;
   thread_index_ = thread_index;
   num_threads_ = num_threads;
   num_changed_ = 0;
@@ -93,7 +123,7 @@ KMeansThread::KMeansThread(unsigned int num_objects,
 
 #if 0
 // Could add early termination when dist exceeds min dist
-unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
+unsigned int KMeansThread::Nearest(unsigned int o, const float *obj,
 				   double *ret_min_dist) {
   // Initialize best_c to the current assignment.  This will make the triangle
   // inequality based optimization work better.
@@ -153,7 +183,7 @@ unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
 }
 #endif
 
-unsigned int KMeansThread::ExhaustiveNearest(unsigned int o, float *obj,
+unsigned int KMeansThread::ExhaustiveNearest(unsigned int o, const float *obj,
 					     unsigned int guess_c,
 					     double guess_min_dist,
 					     double *ret_min_dist) {
@@ -163,15 +193,7 @@ unsigned int KMeansThread::ExhaustiveNearest(unsigned int o, float *obj,
     if (c == best_c) continue;
     if (cluster_sizes_[c] == 0) continue;
 
-    float *cluster_means = means_[c];
-    float dist_sq = 0;
-    for (unsigned int d = 0; d < dim_; ++d) {
-      float ov = obj[d];
-      float cm = cluster_means[d];
-      float dim_delta = ov - cm;
-      dist_sq += dim_delta * dim_delta;
-    }
-    float dist = sqrt(dist_sq);
+    float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
     ++dist_count_;
     if (dist < min_dist) {
       best_c = c;
@@ -198,7 +220,7 @@ unsigned int KMeansThread::ExhaustiveNearest(unsigned int o, float *obj,
 // with ExhaustiveNearest().  Hopefully this doesn't happen too often.  In
 // case (1) we can instead repeat the process we just followed, this time
 // using the neighbors list of the new best candidate.
-unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
+unsigned int KMeansThread::Nearest(unsigned int o, const float *obj,
 				   double *ret_min_dist) {
   // Initialize orig_best_c to the current assignment.  This will make the
   // triangle inequality based optimization work better.
@@ -217,14 +239,7 @@ unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
       exit(-1);
     }
   }
-  float orig_dist = 0;
-  for (unsigned int d = 0; d < dim_; ++d) {
-    float ov = obj[d];
-    float cm = means_[orig_best_c][d];
-    float dim_delta = ov - cm;
-    orig_dist += dim_delta * dim_delta;
-  }
-  orig_dist = sqrt(orig_dist);
+  float orig_dist = sqrt(SquaredDistance(obj, means_[orig_best_c], dim_));
   ++dist_count_;
   // For testing purposes, if we can just call ExhaustiveNearest() here if
   // we suspect a bug in the optimized code below.
@@ -248,15 +263,7 @@ unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
 	return best_c;
       }
 
-      float *cluster_means = means_[c];
-      float dist_sq = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	float ov = obj[d];
-	float cm = cluster_means[d];
-	float dim_delta = ov - cm;
-	dist_sq += dim_delta * dim_delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
       ++dist_count_;
       if (dist < min_dist) {
 	best_c = c;
@@ -288,10 +295,97 @@ unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
   exit(-1);
 }
 
+// Nearest() for the bounds mode.  If the bounds test fails we search the
+// neighbor lists of the assigned cluster as in Nearest().  If we can stop
+// early, the unscanned clusters are at least intra_dist - orig_dist away,
+// which gives us the new lower bound.  Otherwise (and on the first
+// iteration) we scan all the clusters, comparing squared distances, and
+// reset the lower bound to the distance to the second nearest centroid.
+unsigned int KMeansThread::BoundedNearest(unsigned int o, const float *obj,
+					  double *ret_min_dist) {
+  unsigned int a = assignments_[o];
+  if (a != kMaxUInt) {
+    float bound = half_separations_[a];
+    if (lower_bounds_[o] > bound) bound = lower_bounds_[o];
+    // Strict inequalities so that ties get resolved by a search below
+    if (upper_bounds_[o] < bound) {
+      ++skipped_count_;
+      *ret_min_dist = upper_bounds_[o];
+      return a;
+    }
+    float orig_dist = sqrt(SquaredDistance(obj, means_[a], dim_));
+    ++dist_count_;
+    upper_bounds_[o] = orig_dist;
+    if (orig_dist < bound) {
+      ++tightened_count_;
+      *ret_min_dist = orig_dist;
+      return a;
+    }
+    if (neighbor_vectors_) {
+      unsigned int best_c = a;
+      float min_dist = orig_dist, second_dist = HUGE_VALF;
+      const vector< pair<float, unsigned int> > &v = neighbor_vectors_[a];
+      unsigned int num = v.size();
+      for (unsigned int i = 0; i < num; ++i) {
+	float intra_dist = v[i].first;
+	unsigned int c = v[i].second;
+	if (cluster_sizes_[c] == 0) continue;
+	if (intra_dist >= 2 * orig_dist) {
+	  // D(o, c) >= intra_dist - orig_dist for all remaining clusters
+	  if (intra_dist - orig_dist < second_dist) {
+	    second_dist = intra_dist - orig_dist;
+	  }
+	  ++abbreviated_count_;
+	  upper_bounds_[o] = min_dist;
+	  lower_bounds_[o] = second_dist;
+	  *ret_min_dist = min_dist;
+	  return best_c;
+	}
+	float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
+	++dist_count_;
+	// In case of tie, choose the lower numbered cluster
+	if (dist < min_dist || (dist == min_dist && c < best_c)) {
+	  second_dist = min_dist;
+	  min_dist = dist;
+	  best_c = c;
+	} else if (dist < second_dist) {
+	  second_dist = dist;
+	}
+      }
+    }
+  }
+  unsigned int best_c = kMaxUInt;
+  float min_dist_sq = HUGE_VALF, second_dist_sq = HUGE_VALF;
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    if (cluster_sizes_[c] == 0) continue;
+    float dist_sq = SquaredDistance(obj, means_[c], dim_);
+    ++dist_count_;
+    // In case of tie, the lower numbered cluster wins
+    if (best_c == kMaxUInt || dist_sq < min_dist_sq) {
+      second_dist_sq = min_dist_sq;
+      min_dist_sq = dist_sq;
+      best_c = c;
+    } else if (dist_sq < second_dist_sq) {
+      second_dist_sq = dist_sq;
+    }
+  }
+  if (best_c == kMaxUInt) {
+    fprintf(stderr, "No clusters with non-zero size?!?\n");
+    exit(-1);
+  }
+  ++exhaustive_count_;
+  upper_bounds_[o] = sqrt(min_dist_sq);
+  lower_bounds_[o] = sqrt(second_dist_sq);
+  *ret_min_dist = upper_bounds_[o];
+  return best_c;
+}
+
 void KMeansThread::Assign(void) {
   abbreviated_count_ = 0ULL;
   exhaustive_count_ = 0ULL;
   dist_count_ = 0ULL;
+  skipped_count_ = 0ULL;
+  tightened_count_ = 0ULL;
   num_changed_ = 0;
   double dist;
   sum_dists_ = 0;
@@ -299,18 +393,31 @@ void KMeansThread::Assign(void) {
     if (g_it == 0 && thread_index_ == 0 && (o / num_threads_) % 10000 == 0) {
       fprintf(stderr, "It %u o %u/%u\n", g_it, o, num_objects_);
     }
-    float *obj = objects_[o];
-    unsigned int nearest = Nearest(o, obj, &dist);
+    const float *obj = objects_->Row(o);
+    unsigned int nearest;
+    if (upper_bounds_) nearest = BoundedNearest(o, obj, &dist);
+    else               nearest = Nearest(o, obj, &dist);
     sum_dists_ += dist;
     if (nearest != assignments_[o]) ++num_changed_;
     assignments_[o] = nearest;
   }
   if (thread_index_ == 0) {
-    fprintf(stderr, "Abbreviated: %.2f%% (%llu/%llu)\n",
-	    100.0 * abbreviated_count_ /
-	    (double)(abbreviated_count_ + exhaustive_count_),
-	    num_threads_ * abbreviated_count_,
-	    num_threads_ * (abbreviated_count_ + exhaustive_count_));
+    if (upper_bounds_) {
+      unsigned long long int total = skipped_count_ + tightened_count_ +
+	abbreviated_count_ + exhaustive_count_;
+      fprintf(stderr, "Skipped: %.2f%% tightened: %.2f%% abbreviated: "
+	      "%.2f%% scanned: %.2f%%\n",
+	      100.0 * skipped_count_ / (double)total,
+	      100.0 * tightened_count_ / (double)total,
+	      100.0 * abbreviated_count_ / (double)total,
+	      100.0 * exhaustive_count_ / (double)total);
+    } else {
+      fprintf(stderr, "Abbreviated: %.2f%% (%llu/%llu)\n",
+	      100.0 * abbreviated_count_ /
+	      (double)(abbreviated_count_ + exhaustive_count_),
+	      num_threads_ * abbreviated_count_,
+	      num_threads_ * (abbreviated_count_ + exhaustive_count_));
+    }
     fprintf(stderr, "Dist count: %llu\n", dist_count_);
     // Divide by num_threads because we are reporting numbers for one thread
     unsigned long long int naive_dist_count =
@@ -337,21 +444,29 @@ void KMeansThread::ComputeIntraCentroidDistances(void) {
       if (cluster_sizes_[c2] == 0) continue;
       // Only do work that is mine
       if (c2 % num_threads_ != thread_index_) continue;
-      float *cluster_means2 = means_[c2];
-      float dist_sq = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	float cm1 = cluster_means1[d];
-	float cm2 = cluster_means2[d];
-	float delta = cm2 - cm1;
-	dist_sq += delta * delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist = sqrt(SquaredDistance(cluster_means1, means_[c2], dim_));
       if (dist >= neighbor_thresh_) continue;
       neighbor_vectors_[c2].push_back(make_pair(dist, c1));
     }
   }
 }
 
+void KMeansThread::ComputeHalfSeparations(void) {
+  for (unsigned int c1 = 0; c1 < num_clusters_; ++c1) {
+    // Only do work that is mine
+    if (c1 % num_threads_ != thread_index_) continue;
+    if (cluster_sizes_[c1] == 0) continue;
+    float *cluster_means1 = means_[c1];
+    float min_dist_sq = HUGE_VALF;
+    for (unsigned int c2 = 0; c2 < num_clusters_; ++c2) {
+      if (c2 == c1 || cluster_sizes_[c2] == 0) continue;
+      float dist_sq = SquaredDistance(cluster_means1, means_[c2], dim_);
+      if (dist_sq < min_dist_sq) min_dist_sq = dist_sq;
+    }
+    half_separations_[c1] = 0.5 * sqrt(min_dist_sq);
+  }
+}
+
 void KMeansThread::SortNeighbors(void) {
   for (unsigned int c = 0; c < num_clusters_; ++c) {
     // Only do work that is mine
@@ -381,6 +496,16 @@ void KMeansThread::RunIntra(void) {
   pthread_create(&pthread_id_, NULL, thread_run_intra, this);
 }
 
+static void *thread_run_separations(void *v_t) {
+  KMeansThread *t = (KMeansThread *)v_t;
+  t->ComputeHalfSeparations();
+  return NULL;
+}
+
+void KMeansThread::RunSeparations(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_separations, this);
+}
+
 static void *thread_run_sort(void *v_t) {
   KMeansThread *t = (KMeansThread *)v_t;
   t->SortNeighbors();
@@ -464,7 +589,7 @@ void KMeans::SeedPlusPlus(void) {
   unsigned int o = RandBetween(0, num_objects_ - 1);
   used[o] = true;
   for (unsigned int f = 0; f < dim_; ++f) {
-    means_[0][f] = objects_[o][f];
+    means_[0][f] = objects_->Row(o)[f];
   }
   double *sq_distance_to_nearest = new double[num_objects_];
   double *cum_sq_distance_to_nearest = new double[num_objects_];
@@ -475,8 +600,8 @@ void KMeans::SeedPlusPlus(void) {
       cum_sq_distance_to_nearest[o] = cum_sq_dist;
       continue;
     }
+    const float *obj = objects_->Row(o);
     double sq_dist = 0;
-    float *obj = objects_[o];
     for (unsigned int d = 0; d < dim_; ++d) {
       double ov = obj[d];
       double cm = means_[0][d];
@@ -508,7 +633,7 @@ void KMeans::SeedPlusPlus(void) {
     // Helps with old version of search
     sq_distance_to_nearest[o] = 0;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = objects_->Row(o)[f];
     }
     sum_min_sq_dist = 0;
     double cum_sq_dist = 0;
@@ -517,7 +642,7 @@ void KMeans::SeedPlusPlus(void) {
 	cum_sq_distance_to_nearest[o] = cum_sq_dist;
 	continue;
       }
-      float *obj = objects_[o];
+      const float *obj = objects_->Row(o);
       double sq_dist = 0;
       for (unsigned int d = 0; d < dim_; ++d) {
 	double ov = obj[d];
@@ -549,7 +674,7 @@ void KMeans::Seed1(void) {
     } while (used[o]);
     used[o] = true;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = objects_->Row(o)[f];
     }
   }
   delete [] used;
@@ -566,7 +691,7 @@ void KMeans::Seed2(void) {
     for (unsigned int i = 0; i < num_sample; ++i) {
       unsigned int o = RandBetween(0, num_objects_ - 1);
       for (unsigned int f = 0; f < dim_; ++f) {
-	sums[f] += objects_[o][f];
+	sums[f] += objects_->Row(o)[f];
       }
     }
     for (unsigned int f = 0; f < dim_; ++f) {
@@ -577,8 +702,9 @@ void KMeans::Seed2(void) {
 }
 
 // Should I assume dups have been removed?
-void KMeans::SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
-				  unsigned int num_objects, float **objects) {
+void KMeans::SingleObjectClusters(const FeatureMatrix *objects) {
+  unsigned int dim = objects->Dim();
+  unsigned int num_objects = objects->NumRows();
   num_clusters_ = num_objects;
   dim_ = dim;
   num_objects_ = num_objects;
@@ -593,18 +719,21 @@ void KMeans::SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
     unsigned int c = o;
     assignments_[o] = c;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects[o][f];
+      means_[c][f] = objects->Row(o)[f];
     }
     cluster_sizes_[c] = 1;
   }
   nearest_centroids_ = NULL;
   threads_ = NULL;
   num_threads_ = 0;
+  use_bounds_ = false;
 }
 
-KMeans::KMeans(unsigned int num_clusters, unsigned int dim,
-	       unsigned int num_objects, float **objects,
-	       double neighbor_thresh, unsigned int num_threads) {
+KMeans::KMeans(unsigned int num_clusters, const FeatureMatrix *objects,
+	       double neighbor_thresh, unsigned int num_threads,
+	       bool use_bounds) {
+  unsigned int dim = objects->Dim();
+  unsigned int num_objects = objects->NumRows();
   nearest_centroids_ = NULL;
   neighbor_ptrs_ = NULL;
   neighbor_vectors_ = NULL;
@@ -612,9 +741,14 @@ KMeans::KMeans(unsigned int num_clusters, unsigned int dim,
   means_ = NULL;
   assignments_ = NULL;
   threads_ = NULL;
+  use_bounds_ = false;
+  upper_bounds_ = NULL;
+  lower_bounds_ = NULL;
+  half_separations_ = NULL;
+  drifts_ = NULL;
   if (num_clusters >= num_objects) {
     fprintf(stderr, "Assigning every object to its own cluster\n");
-    SingleObjectClusters(num_clusters, dim, num_objects, objects);
+    SingleObjectClusters(objects);
     return;
   }
   num_clusters_ = num_clusters;
@@ -624,6 +758,17 @@ KMeans::KMeans(unsigned int num_clusters, unsigned int dim,
   num_objects_ = num_objects;
   objects_ = objects;
   neighbor_thresh_ = neighbor_thresh;
+  use_bounds_ = use_bounds;
+  if (use_bounds_) {
+    upper_bounds_ = new float[num_objects_];
+    lower_bounds_ = new float[num_objects_];
+    half_separations_ = new float[num_clusters_];
+    drifts_ = new float[num_clusters_];
+    for (unsigned int c = 0; c < num_clusters_; ++c) {
+      half_separations_[c] = 0;
+      drifts_[c] = 0;
+    }
+  }
   cluster_sizes_ = new unsigned int[num_clusters_];
   means_ = new float *[num_clusters_];
   for (unsigned int c = 0; c < num_clusters_; ++c) {
@@ -681,7 +826,8 @@ KMeans::KMeans(unsigned int num_clusters, unsigned int dim,
 				   dim_, neighbor_thresh_, cluster_sizes_,
 				   means_, assignments_, nearest_centroids_,
 				   neighbor_ptrs_, neighbor_vectors_,
-				   t, num_threads_);
+				   upper_bounds_, lower_bounds_,
+				   half_separations_, t, num_threads_);
   }
 
   // Normally we call this at the end of each iteration.  Call it once now
@@ -716,6 +862,10 @@ KMeans::~KMeans(void) {
   }
   delete [] means_;
   delete [] assignments_;
+  delete [] upper_bounds_;
+  delete [] lower_bounds_;
+  delete [] half_separations_;
+  delete [] drifts_;
 }
 
 // Assumes cluster means are up-to-date
@@ -770,6 +920,31 @@ void KMeans::ComputeIntraCentroidDistances(void) {
   fprintf(stderr, "Cum intra time: %f\n", intra_time_);
 }
 
+// Assumes cluster means are up-to-date.  If we have neighbor lists (which
+// are sorted and only hold non-empty clusters) we read the nearest other
+// centroid off of them.  A cluster with no neighbors is at least
+// neighbor_thresh_ from every other cluster.
+void KMeans::ComputeHalfSeparations(void) {
+  if (neighbor_vectors_) {
+    for (unsigned int c = 0; c < num_clusters_; ++c) {
+      if (neighbor_vectors_[c].size() > 0) {
+	half_separations_[c] = 0.5 * neighbor_vectors_[c][0].first;
+      } else {
+	half_separations_[c] = 0.5 * neighbor_thresh_;
+      }
+    }
+    return;
+  }
+  for (unsigned int i = 1; i < num_threads_; ++i) {
+    threads_[i]->RunSeparations();
+  }
+  // Execute thread 0 in main execution thread
+  threads_[0]->ComputeHalfSeparations();
+  for (unsigned int i = 1; i < num_threads_; ++i) {
+    threads_[i]->Join();
+  }
+}
+
 unsigned int KMeans::Assign(double *avg_dist) {
   time_t start_t = time(NULL);
 
@@ -811,23 +986,47 @@ void KMeans::Update(void) {
     // During initialization we will assign some objects to cluster kMaxUInt
     // meaning they are unassigned
     if (c == kMaxUInt) continue;
-    float *obj = objects_[o];
+    const float *obj = objects_->Row(o);
     for (unsigned int d = 0; d < dim_; ++d) {
       sums[c][d] += obj[d];
     }
     ++cluster_sizes_[c];
   }
+  // Track the largest and second largest drift for loosening the lower
+  // bounds.  Empty clusters are never assigned to again so they are ignored.
+  float max_drift = 0, second_max_drift = 0;
+  unsigned int max_drift_c = kMaxUInt;
   for (unsigned int c = 0; c < num_clusters_; ++c) {
     if (cluster_sizes_[c] > 0) {
       for (unsigned int d = 0; d < dim_; ++d) {
-	means_[c][d] = sums[c][d] / cluster_sizes_[c];
+	sums[c][d] /= cluster_sizes_[c];
+      }
+      if (use_bounds_) {
+	float drift = sqrt(SquaredDistance(sums[c], means_[c], dim_));
+	drifts_[c] = drift;
+	if (drift > max_drift) {
+	  second_max_drift = max_drift;
+	  max_drift = drift;
+	  max_drift_c = c;
+	} else if (drift > second_max_drift) {
+	  second_max_drift = drift;
+	}
       }
+      for (unsigned int d = 0; d < dim_; ++d) means_[c][d] = sums[c][d];
     } else {
       for (unsigned int d = 0; d < dim_; ++d) means_[c][d] = 0;
     }
     delete [] sums[c];
   }
   delete [] sums;
+  if (use_bounds_) {
+    for (unsigned int o = 0; o < num_objects_; ++o) {
+      unsigned int c = assignments_[o];
+      if (c == kMaxUInt) continue;
+      upper_bounds_[o] += drifts_[c];
+      lower_bounds_[o] -= c == max_drift_c ? second_max_drift : max_drift;
+    }
+  }
 }
 
 void KMeans::EliminateEmpty(void) {
@@ -864,8 +1063,10 @@ void KMeans::Cluster(unsigned int num_its) {
     g_it = it;
     double avg_dist;
     unsigned int num_changed = Assign(&avg_dist);
-    fprintf(stderr, "It %i num_changed %i avg dist %f\n", it, num_changed,
-	    avg_dist);
+    // With bounds, skipped objects only contribute an upper bound on their
+    // distance, so we can only report a bound on the average.
+    fprintf(stderr, "It %i num_changed %i avg dist%s %f\n", it, num_changed,
+	    use_bounds_ ? " bound" : "", avg_dist);
 
     Update();
 
@@ -878,6 +1079,9 @@ void KMeans::Cluster(unsigned int num_its) {
     if (neighbor_thresh_ > 0) {
       ComputeIntraCentroidDistances();
     }
+    if (use_bounds_) {
+      ComputeHalfSeparations();
+    }
 
     ++it;
   }
@@ -5,26 +5,28 @@
 
 using namespace std;
 
+class FeatureMatrix;
 class KMeansThread;
 
 class KMeans {
 public:
-  KMeans(unsigned int num_clusters, unsigned int dim, unsigned int num_objects,
-	 float **objects, double neighbor_thresh, unsigned int num_threads);
+  // The caller owns objects.  Each row is one object.
+  KMeans(unsigned int num_clusters, const FeatureMatrix *objects,
+	 double neighbor_thresh, unsigned int num_threads, bool use_bounds);
   ~KMeans(void);
   void Cluster(unsigned int num_its);
   unsigned int Assignment(unsigned int o) const {return assignments_[o];}
   unsigned int NumClusters(void) const {return num_clusters_;}
   unsigned int ClusterSize(unsigned int c) const {return cluster_sizes_[c];}
-  void SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
-			    unsigned int num_objects, float **objects);
+  void SingleObjectClusters(const FeatureMatrix *objects);
 
   static const unsigned int kMaxNeighbors = 10000;
 
 
  protected:
   void ComputeIntraCentroidDistances(void);
-  unsigned int Nearest(unsigned int o, float *obj) const;
+  void ComputeHalfSeparations(void);
+  unsigned int Nearest(unsigned int o, const float *obj) const;
   unsigned int Assign(double *avg_dist);
   void Update(void);
   void EliminateEmpty(void);
@@ -36,7 +38,7 @@ public:
 
   unsigned int num_objects_;
   unsigned int num_clusters_;
-  float **objects_;
+  const FeatureMatrix *objects_;
   unsigned int dim_;
   double neighbor_thresh_;
   unsigned int *cluster_sizes_;
@@ -46,6 +48,16 @@ public:
   unsigned char **nearest_centroids_;
   unsigned char **neighbor_ptrs_;
   bool use_shortcut_;
+  // Hamerly bounds; only allocated if use_bounds_ is true.
+  // upper_bounds_[o] >= D(o, assigned centroid).
+  // lower_bounds_[o] <= D(o, any other centroid).
+  // half_separations_[c] is half the distance from c to the nearest other
+  // centroid.  drifts_[c] is how far c moved in the last Update().
+  bool use_bounds_;
+  float *upper_bounds_;
+  float *lower_bounds_;
+  float *half_separations_;
+  float *drifts_;
   double intra_time_;
   double assign_time_;
   unsigned int num_threads_;
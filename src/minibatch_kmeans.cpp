@@ -0,0 +1,454 @@
+// The learning rate for a cluster is one over the number of objects that
+// have been assigned to it so far, so each centroid is the running mean of
+// the objects assigned to it.
+//
+// During training the centroids move after every batch, so we just compare
+// against every centroid.  In the final pass the centroids are fixed and we
+// use sorted neighbor lists as in KMeans.  Consecutive objects (hands on
+// the same board) are often in the same cluster so the previous object's
+// cluster serves as the initial guess.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "constants.h"
+#include "feature_matrix.h"
+#include "io.h"
+#include "minibatch_kmeans.h"
+#include "rand.h"
+#include "sorting.h"
+#include "sq_distance.h"
+
+class MiniBatchKMeansThread {
+public:
+  MiniBatchKMeansThread(unsigned int dim, float **means,
+			unsigned int thread_index, unsigned int num_threads);
+  ~MiniBatchKMeansThread(void) {}
+  void SetWork(const FeatureMatrix *objs, unsigned int num,
+	       unsigned int num_clusters,
+	       const vector< pair<float, unsigned int> > *neighbor_vectors,
+	       unsigned int *assignments);
+  void Assign(void);
+  void ComputeNeighbors(double neighbor_thresh,
+			vector< pair<float, unsigned int> > *neighbor_vectors);
+  void RunAssign(void);
+  void RunNeighbors(double neighbor_thresh,
+		    vector< pair<float, unsigned int> > *neighbor_vectors);
+  void Join(void);
+  double SumDists(void) const {return sum_dists_;}
+  double NeighborThresh(void) const {return neighbor_thresh_;}
+  vector< pair<float, unsigned int> > *NeighborVectors(void) const {
+    return out_neighbor_vectors_;
+  }
+private:
+  unsigned int ExhaustiveNearest(const float *obj, float *ret_min_dist_sq);
+  unsigned int Nearest(const float *obj, unsigned int guess_c,
+		       float *ret_min_dist_sq);
+
+  unsigned int dim_;
+  float **means_;
+  unsigned int thread_index_;
+  unsigned int num_threads_;
+  const FeatureMatrix *objs_;
+  unsigned int num_;
+  unsigned int num_clusters_;
+  const vector< pair<float, unsigned int> > *neighbor_vectors_;
+  unsigned int *assignments_;
+  double sum_dists_;
+  double neighbor_thresh_;
+  vector< pair<float, unsigned int> > *out_neighbor_vectors_;
+  pthread_t pthread_id_;
+};
+
+MiniBatchKMeansThread::MiniBatchKMeansThread(unsigned int dim, float **means,
+					     unsigned int thread_index,
+					     unsigned int num_threads) {
+  dim_ = dim;
+  means_ = means;
+  thread_index_ = thread_index;
+  num_threads_ = num_threads;
+  objs_ = NULL;
+  num_ = 0;
+  num_clusters_ = 0;
+  neighbor_vectors_ = NULL;
+  assignments_ = NULL;
+  sum_dists_ = 0;
+  neighbor_thresh_ = 0;
+  out_neighbor_vectors_ = NULL;
+}
+
+void MiniBatchKMeansThread::SetWork(const FeatureMatrix *objs,
+				    unsigned int num,
+				    unsigned int num_clusters,
+				    const vector< pair<float, unsigned int> > *
+				    neighbor_vectors,
+				    unsigned int *assignments) {
+  objs_ = objs;
+  num_ = num;
+  num_clusters_ = num_clusters;
+  neighbor_vectors_ = neighbor_vectors;
+  assignments_ = assignments;
+}
+
+unsigned int MiniBatchKMeansThread::ExhaustiveNearest(const float *obj,
+						      float *ret_min_dist_sq) {
+  unsigned int best_c = 0;
+  float min_dist_sq = SquaredDistance(obj, means_[0], dim_);
+  for (unsigned int c = 1; c < num_clusters_; ++c) {
+    float dist_sq = SquaredDistance(obj, means_[c], dim_);
+    // In case of tie, the lower numbered cluster wins
+    if (dist_sq < min_dist_sq) {
+      best_c = c;
+      min_dist_sq = dist_sq;
+    }
+  }
+  *ret_min_dist_sq = min_dist_sq;
+  return best_c;
+}
+
+// Same search as KMeansThread::Nearest().  We can stop scanning the
+// neighbors of our current guess once we reach a neighbor at least twice as
+// far from the guess as the object is.
+unsigned int MiniBatchKMeansThread::Nearest(const float *obj,
+					    unsigned int guess_c,
+					    float *ret_min_dist_sq) {
+  float guess_dist = sqrt(SquaredDistance(obj, means_[guess_c], dim_));
+  float min_dist = guess_dist;
+  unsigned int best_c = guess_c;
+  while (true) {
+    const vector< pair<float, unsigned int> > &v = neighbor_vectors_[best_c];
+    unsigned int num = v.size();
+    unsigned int i;
+    for (i = 0; i < num; ++i) {
+      // Has to be guess_dist, not min_dist.
+      if (v[i].first >= 2 * guess_dist) break;
+      unsigned int c = v[i].second;
+      float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
+      if (dist < min_dist || (dist == min_dist && c < best_c)) {
+	best_c = c;
+	min_dist = dist;
+      }
+    }
+    if (i < num) {
+      *ret_min_dist_sq = min_dist * min_dist;
+      return best_c;
+    }
+    // Got to the end of the neighbors list without proving anything.  If
+    // we found a better candidate, search its neighbors.  Otherwise fall
+    // back to an exhaustive search.
+    if (best_c == guess_c) return ExhaustiveNearest(obj, ret_min_dist_sq);
+    guess_c = best_c;
+    guess_dist = min_dist;
+  }
+}
+
+// Each thread takes a contiguous slice of the objects so that the previous
+// object is available as a guess.
+void MiniBatchKMeansThread::Assign(void) {
+  unsigned int begin =
+    (unsigned int)(((unsigned long long int)num_) * thread_index_ /
+		   num_threads_);
+  unsigned int end =
+    (unsigned int)(((unsigned long long int)num_) * (thread_index_ + 1) /
+		   num_threads_);
+  sum_dists_ = 0;
+  for (unsigned int i = begin; i < end; ++i) {
+    const float *obj = objs_->Row(i);
+    float dist_sq;
+    unsigned int c;
+    if (neighbor_vectors_ && i > begin) {
+      c = Nearest(obj, assignments_[i - 1], &dist_sq);
+    } else {
+      c = ExhaustiveNearest(obj, &dist_sq);
+    }
+    assignments_[i] = c;
+    sum_dists_ += sqrt(dist_sq);
+  }
+}
+
+void MiniBatchKMeansThread::ComputeNeighbors(double neighbor_thresh,
+					     vector< pair<float, unsigned int> >
+					     *neighbor_vectors) {
+  for (unsigned int c1 = 0; c1 < num_clusters_; ++c1) {
+    // Only do work that is mine
+    if (c1 % num_threads_ != thread_index_) continue;
+    vector< pair<float, unsigned int> > *v = &neighbor_vectors[c1];
+    v->clear();
+    for (unsigned int c2 = 0; c2 < num_clusters_; ++c2) {
+      if (c2 == c1) continue;
+      float dist = sqrt(SquaredDistance(means_[c1], means_[c2], dim_));
+      if (dist >= neighbor_thresh) continue;
+      v->push_back(make_pair(dist, c2));
+    }
+    sort(v->begin(), v->end(), g_pfui_lower_compare);
+  }
+}
+
+static void *thread_run_assign(void *v_t) {
+  MiniBatchKMeansThread *t = (MiniBatchKMeansThread *)v_t;
+  t->Assign();
+  return NULL;
+}
+
+void MiniBatchKMeansThread::RunAssign(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_assign, this);
+}
+
+static void *thread_run_neighbors(void *v_t) {
+  MiniBatchKMeansThread *t = (MiniBatchKMeansThread *)v_t;
+  t->ComputeNeighbors(t->NeighborThresh(), t->NeighborVectors());
+  return NULL;
+}
+
+void MiniBatchKMeansThread::RunNeighbors(double neighbor_thresh,
+					 vector< pair<float, unsigned int> > *
+					 neighbor_vectors) {
+  neighbor_thresh_ = neighbor_thresh;
+  out_neighbor_vectors_ = neighbor_vectors;
+  pthread_create(&pthread_id_, NULL, thread_run_neighbors, this);
+}
+
+void MiniBatchKMeansThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+MiniBatchKMeans::MiniBatchKMeans(unsigned int num_clusters, Reader *reader,
+				 unsigned long long int num_objects,
+				 unsigned int run_length,
+				 unsigned int batch_size,
+				 unsigned int num_threads) {
+  num_clusters_ = num_clusters;
+  reader_ = reader;
+  reader_->SeekTo(0);
+  dim_ = reader_->ReadUnsignedIntOrDie();
+  num_objects_ = num_objects;
+  unsigned long long int expected_size = sizeof(unsigned int) +
+    num_objects_ * dim_ * sizeof(short);
+  if (reader_->FileSize() != (long long int)expected_size) {
+    fprintf(stderr, "Expected feature file size %llu, found %lli\n",
+	    expected_size, reader_->FileSize());
+    exit(-1);
+  }
+  if (run_length > batch_size) run_length = batch_size;
+  if (run_length == 0 || run_length > num_objects_) {
+    fprintf(stderr, "Bad run length %u\n", run_length);
+    exit(-1);
+  }
+  run_length_ = run_length;
+  // Whole number of runs per batch
+  batch_size_ = (batch_size / run_length_) * run_length_;
+  if (batch_size_ < num_clusters_) {
+    fprintf(stderr, "Batch size must be at least the number of clusters\n");
+    exit(-1);
+  }
+  batch_ = new FeatureMatrix(batch_size_, dim_);
+  batch_assignments_ = new unsigned int[batch_size_];
+  means_ = new float *[num_clusters_];
+  counts_ = new unsigned long long int[num_clusters_];
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    means_[c] = new float[dim_];
+    counts_[c] = 0ULL;
+  }
+  neighbor_vectors_ = NULL;
+  num_threads_ = num_threads;
+  threads_ = new MiniBatchKMeansThread *[num_threads_];
+  for (unsigned int t = 0; t < num_threads_; ++t) {
+    threads_[t] = new MiniBatchKMeansThread(dim_, means_, t, num_threads_);
+  }
+  fprintf(stderr, "%llu objects, %u features, batch size %u, run length "
+	  "%u\n", num_objects_, dim_, batch_size_, run_length_);
+}
+
+MiniBatchKMeans::~MiniBatchKMeans(void) {
+  for (unsigned int t = 0; t < num_threads_; ++t) {
+    delete threads_[t];
+  }
+  delete [] threads_;
+  delete [] neighbor_vectors_;
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    delete [] means_[c];
+  }
+  delete [] means_;
+  delete [] counts_;
+  delete [] batch_assignments_;
+  delete batch_;
+}
+
+// Reads objects first..first+num-1 into the batch starting at the given
+// row.
+void MiniBatchKMeans::ReadRun(unsigned long long int first, unsigned int num,
+			      unsigned int row) {
+  long long int offset = sizeof(unsigned int) + first * dim_ * sizeof(short);
+  if (reader_->BytePos() != offset) reader_->SeekTo(offset);
+  batch_->ReadRows(reader_, row, num);
+}
+
+void MiniBatchKMeans::ReadBatch(void) {
+  unsigned long long int num_runs = num_objects_ / run_length_;
+  unsigned int runs_per_batch = batch_size_ / run_length_;
+  for (unsigned int r = 0; r < runs_per_batch; ++r) {
+    // RandBetween() only handles ints
+    unsigned long long int run =
+      (unsigned long long int)(RandZeroToOne() * num_runs);
+    if (run >= num_runs) run = num_runs - 1;
+    ReadRun(run * run_length_, run_length_, r * run_length_);
+  }
+}
+
+// Chooses the initial centroids from the first batch with the KMeans++
+// method.  As in KMeans, this is too slow for many clusters and large
+// batches, in which case we just choose distinct objects at random.
+// Identical objects can yield identical centroids; all but one of them will
+// end up empty and get eliminated.
+void MiniBatchKMeans::Seed(void) {
+  ReadBatch();
+  if (num_clusters_ >= 10000 && batch_size_ >= 1000000) {
+    bool *used = new bool[batch_size_];
+    for (unsigned int i = 0; i < batch_size_; ++i) used[i] = false;
+    for (unsigned int c = 0; c < num_clusters_; ++c) {
+      unsigned int i;
+      do {
+	i = RandBetween(0, batch_size_ - 1);
+      } while (used[i]);
+      used[i] = true;
+      const float *obj = batch_->Row(i);
+      for (unsigned int d = 0; d < dim_; ++d) means_[c][d] = obj[d];
+    }
+    delete [] used;
+    return;
+  }
+  double *sq_distance_to_nearest = new double[batch_size_];
+  unsigned int i = RandBetween(0, batch_size_ - 1);
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    const float *obj = batch_->Row(i);
+    for (unsigned int d = 0; d < dim_; ++d) means_[c][d] = obj[d];
+    double sum_min_sq_dist = 0;
+    for (unsigned int j = 0; j < batch_size_; ++j) {
+      double sq_dist = SquaredDistance(batch_->Row(j), means_[c], dim_);
+      if (c == 0 || sq_dist < sq_distance_to_nearest[j]) {
+	sq_distance_to_nearest[j] = sq_dist;
+      }
+      sum_min_sq_dist += sq_distance_to_nearest[j];
+    }
+    // Choose the next centroid with probability proportional to the squared
+    // distance to the nearest centroid so far.  Objects already chosen have
+    // a squared distance of zero.
+    double x = RandZeroToOne() * sum_min_sq_dist;
+    double cum = 0;
+    for (i = 0; i < batch_size_ - 1; ++i) {
+      cum += sq_distance_to_nearest[i];
+      if (x < cum) break;
+    }
+  }
+  delete [] sq_distance_to_nearest;
+}
+
+// Assigns the first num objects in batch_.  Returns the average distance.
+double MiniBatchKMeans::AssignBatch(unsigned int num) {
+  for (unsigned int t = 0; t < num_threads_; ++t) {
+    threads_[t]->SetWork(batch_, num, num_clusters_, neighbor_vectors_,
+			 batch_assignments_);
+  }
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    threads_[t]->RunAssign();
+  }
+  // Execute thread 0 in main execution thread
+  threads_[0]->Assign();
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    threads_[t]->Join();
+  }
+  double sum_dists = 0;
+  for (unsigned int t = 0; t < num_threads_; ++t) {
+    sum_dists += threads_[t]->SumDists();
+  }
+  return sum_dists / num;
+}
+
+void MiniBatchKMeans::Update(unsigned int num) {
+  for (unsigned int i = 0; i < num; ++i) {
+    unsigned int c = batch_assignments_[i];
+    const float *obj = batch_->Row(i);
+    float *mean = means_[c];
+    float eta = 1.0 / ++counts_[c];
+    for (unsigned int d = 0; d < dim_; ++d) {
+      mean[d] += eta * (obj[d] - mean[d]);
+    }
+  }
+}
+
+void MiniBatchKMeans::EliminateEmpty(void) {
+  unsigned int i = 0;
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    if (counts_[c] > 0) {
+      float *tmp = means_[i];
+      means_[i] = means_[c];
+      means_[c] = tmp;
+      counts_[i] = counts_[c];
+      ++i;
+    }
+  }
+  fprintf(stderr, "Eliminated %u empty clusters\n", num_clusters_ - i);
+  // Free the means of the eliminated clusters now; the destructor only
+  // sees the first num_clusters_.
+  for (unsigned int c = i; c < num_clusters_; ++c) {
+    delete [] means_[c];
+    means_[c] = NULL;
+  }
+  num_clusters_ = i;
+}
+
+void MiniBatchKMeans::Cluster(unsigned int num_batches) {
+  Seed();
+  for (unsigned int b = 0; b < num_batches; ++b) {
+    // Seed() leaves the first batch in batch_
+    if (b > 0) ReadBatch();
+    double avg_dist = AssignBatch(batch_size_);
+    Update(batch_size_);
+    if (b % 100 == 0 || b == num_batches - 1) {
+      fprintf(stderr, "Batch %u/%u avg dist %f\n", b, num_batches, avg_dist);
+    }
+  }
+  EliminateEmpty();
+}
+
+void MiniBatchKMeans::ComputeNeighbors(double neighbor_thresh) {
+  if (neighbor_thresh <= 0) return;
+  delete [] neighbor_vectors_;
+  neighbor_vectors_ = new vector< pair<float, unsigned int> >[num_clusters_];
+  for (unsigned int t = 0; t < num_threads_; ++t) {
+    threads_[t]->SetWork(NULL, 0, num_clusters_, NULL, NULL);
+  }
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    threads_[t]->RunNeighbors(neighbor_thresh, neighbor_vectors_);
+  }
+  threads_[0]->ComputeNeighbors(neighbor_thresh, neighbor_vectors_);
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    threads_[t]->Join();
+  }
+  unsigned long long int sum_lens = 0;
+  for (unsigned int c = 0; c < num_clusters_; ++c) {
+    sum_lens += neighbor_vectors_[c].size();
+  }
+  fprintf(stderr, "Avg neighbor vector length: %.1f\n",
+	  sum_lens / (double)num_clusters_);
+}
+
+void MiniBatchKMeans::AssignRange(unsigned long long int first,
+				  unsigned int num,
+				  unsigned int *assignments) {
+  if (num > batch_size_) {
+    fprintf(stderr, "AssignRange: num %u > batch size %u\n", num,
+	    batch_size_);
+    exit(-1);
+  }
+  ReadRun(first, num, 0);
+  AssignBatch(num);
+  for (unsigned int i = 0; i < num; ++i) {
+    assignments[i] = batch_assignments_[i];
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef _MINIBATCH_KMEANS_H_
+#define _MINIBATCH_KMEANS_H_
+
+// Mini-batch k-means (Sculley 2010) for feature files too big to hold in
+// memory.  Only the centroids are kept in memory; objects are streamed from
+// a feature file (an unsigned int num features followed by num features
+// shorts per object) as written by build_rollout_features and
+// combine_features.
+//
+// Each training batch is made up of runs of run_length consecutive objects
+// read from random offsets in the file.  Typically the run length is the
+// number of hole card pairs so that each run is one board.  After training
+// clusters that never received an object are eliminated and AssignRange()
+// can be used to assign objects in the final pass.
+
+#include <vector>
+
+using namespace std;
+
+class FeatureMatrix;
+class MiniBatchKMeansThread;
+class Reader;
+
+class MiniBatchKMeans {
+public:
+  MiniBatchKMeans(unsigned int num_clusters, Reader *reader,
+		  unsigned long long int num_objects, unsigned int run_length,
+		  unsigned int batch_size, unsigned int num_threads);
+  ~MiniBatchKMeans(void);
+  void Cluster(unsigned int num_batches);
+  // Prepares the neighbor lists for AssignRange().  Call once after
+  // Cluster().
+  void ComputeNeighbors(double neighbor_thresh);
+  // Assigns num consecutive objects starting at first.  num must be at most
+  // the batch size.
+  void AssignRange(unsigned long long int first, unsigned int num,
+		   unsigned int *assignments);
+  unsigned int NumClusters(void) const {return num_clusters_;}
+  unsigned int Dim(void) const {return dim_;}
+  unsigned int BatchSize(void) const {return batch_size_;}
+ private:
+  void ReadRun(unsigned long long int first, unsigned int num,
+	       unsigned int row);
+  void ReadBatch(void);
+  void Seed(void);
+  double AssignBatch(unsigned int num);
+  void Update(unsigned int num);
+  void EliminateEmpty(void);
+
+  unsigned int num_clusters_;
+  unsigned int dim_;
+  Reader *reader_;
+  unsigned long long int num_objects_;
+  unsigned int run_length_;
+  unsigned int batch_size_;
+  FeatureMatrix *batch_;
+  unsigned int *batch_assignments_;
+  float **means_;
+  // Number of objects that have been assigned to each cluster over all
+  // batches so far.  Determines the per-cluster learning rate.
+  unsigned long long int *counts_;
+  vector< pair<float, unsigned int> > *neighbor_vectors_;
+  unsigned int num_threads_;
+  MiniBatchKMeansThread **threads_;
+};
+
+#endif
@@ -511,23 +511,7 @@ double *MPVCFR::StreetInitial(Node *node, unsigned int plbd,
   unsigned int *prev_canons = new unsigned int[num_encodings];
   double *vals = new double[prev_num_hole_card_pairs];
   for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
-  for (unsigned int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) > 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      unsigned int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      prev_canons[prev_encoding] = ph;
-    }
-  }
-  for (unsigned int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) == 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      unsigned int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      unsigned int pc = prev_canons[pred_hands->Canon(ph)];
-      prev_canons[prev_encoding] = pc;
-    }
-  }
+  pred_hands->CanonIndices(prev_canons);
 
   if (nst == 1 && num_threads_ > 1) {
     // Currently only flop supported
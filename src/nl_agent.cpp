@@ -8,10 +8,12 @@
 //
 // Don't need buckets on the river, I don't think.
 
+#include <errno.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include <algorithm>
 #include <map>
@@ -32,6 +34,7 @@
 #include "constants.h"
 #include "dynamic_cbr2.h"
 #include "eg_cfr.h"
+#include "endgame_cache.h"
 #include "endgame_utils.h"
 #include "files.h"
 #include "game.h"
@@ -42,9 +45,17 @@
 #include "rand.h"
 #include "resolving_method.h"
 #include "runtime_config.h"
+#include "thread_pool.h"
 
 using namespace std;
 
+static double SecsSince(const timeval &start_tv) {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return (tv.tv_sec - start_tv.tv_sec) +
+    (tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+}
+
 // Assume no bet pending
 BettingTree *NLAgent::CreateSubtree(Node *node, unsigned int target_p,
 				    bool base) {
@@ -66,43 +77,85 @@ BettingTree *NLAgent::CreateSubtree(Node *node, unsigned int target_p,
   return BettingTree::BuildSubtree(subtree_root.get());
 }
 
-// Need to set reach_probs
-void NLAgent::ResolveSubgame(unsigned int p, unsigned int bd,
-			     double **reach_probs) {
+// Only sets up the sumprobs for player p; doesn't allocate the values.
+CFRValues *NLAgent::CreateEndgameSumprobs(unsigned int p, unsigned int bd,
+					  BettingTree *subtree) {
+  unsigned int max_street = Game::MaxStreet();
   unsigned int num_players = Game::NumPlayers();
-  if (debug_) {
-    unsigned int max_card1 = Game::MaxCard() + 1;
-    // Temporary
-    for (unsigned int p = 0; p < num_players; ++p) {
-      double sum = 0;
-      const Card *board = BoardTree::Board(endgame_st_, bd);
-      unsigned int num_board_cards = Game::NumBoardCards(endgame_st_);
-      for (Card hi = 1; hi < max_card1; ++hi) {
-	if (InCards(hi, board, num_board_cards)) continue; 
-	for (Card lo = 0; lo < hi; ++lo) {
-	  if (InCards(lo, board, num_board_cards)) continue;
-	  unsigned int enc = hi * max_card1 + lo;
-	  sum += reach_probs[p][enc];
-	}
-      }
-      fprintf(stderr, "P%u sum-reach-probs %f\n", p, sum);
-    }
+  unique_ptr<bool []> subtree_streets(new bool[max_street + 1]);
+  for (unsigned int st = 0; st <= max_street; ++st) {
+    subtree_streets[st] = st >= endgame_st_;
   }
+  unique_ptr<bool []> players(new bool[num_players]);
+  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
+    players[p1] = p1 == p;
+  }
+  return new CFRValues(players.get(), true, subtree_streets.get(), subtree,
+		       bd, endgame_st_, endgame_card_abstraction_,
+		       endgame_buckets_->NumBuckets(), nullptr);
+}
+
+static void CachedSumprobsFilename(const string &dir, const string &key,
+				   unsigned int st, unsigned int bd,
+				   unsigned int p, char *buf) {
+  sprintf(buf, "%s/sumprobs.%s.%u.%u.%u.0.p%u.d", dir.c_str(), key.c_str(),
+	  st, bd, st, p);
+}
+
+// Looks for a previously resolved endgame first in memory and then on disk.
+// If found, sets endgame_subtree_ and endgame_sumprobs_ and returns true.
+bool NLAgent::LookupEndgame(Node *si_node, unsigned int p, unsigned int bd,
+			    const string &key) {
+  EndgameCacheEntry entry;
+  const char *source;
+  char buf[500];
+  if (endgame_cache_dir_ != "") {
+    CachedSumprobsFilename(endgame_cache_dir_, key, endgame_st_, bd, p, buf);
+  }
+  if (endgame_cache_ && endgame_cache_->Lookup(key, &entry)) {
+    ++num_endgame_cache_hits_;
+    source = "hit";
+  } else if (endgame_cache_dir_ != "" && FileExists(buf)) {
+    entry.subtree.reset(CreateSubtree(si_node, p, false));
+    entry.sumprobs.reset(CreateEndgameSumprobs(p, bd, entry.subtree.get()));
+    entry.sumprobs->Read(endgame_cache_dir_.c_str(), 0,
+			 entry.subtree->Root(), key, p);
+    // Only complete solves are written to disk
+    entry.num_its = num_endgame_its_;
+    if (endgame_cache_) endgame_cache_->Insert(key, entry);
+    ++num_endgame_disk_hits_;
+    source = "disk hit";
+  } else {
+    ++num_endgame_cache_misses_;
+    source = "miss";
+  }
+  fprintf(stderr, "Endgame cache %s st %u bd %u (hits %llu disk hits %llu "
+	  "misses %llu)\n", source, endgame_st_, bd, num_endgame_cache_hits_,
+	  num_endgame_disk_hits_, num_endgame_cache_misses_);
+  if (! entry.sumprobs) return false;
+  endgame_subtree_ = entry.subtree;
+  endgame_sumprobs_ = entry.sumprobs;
+  return true;
+}
+
+static bool Stopped(const bool *stop) {
+  return stop && __atomic_load_n(stop, __ATOMIC_RELAXED);
+}
 
+// Builds the endgame subtree for si_node and solves it, filling in *entry.
+// Only reads agent state that is fixed after construction, so it can be
+// called from the speculation thread.  A negative budget means run all
+// num_endgame_its_ iterations; otherwise the solve stops once budget seconds
+// have passed since start_tv.  Returns the number of iterations run, which
+// is also stored in entry->num_its.  If *stop is set, returns early, between
+// phases of the solve or between iterations, with an incomplete entry.
+unsigned int NLAgent::SolveEndgame(Node *si_node, unsigned int p,
+				   unsigned int bd, double **reach_probs,
+				   DynamicCBR2 *dynamic_cbr, ThreadPool *pool,
+				   const timeval &start_tv, double budget,
+				   const bool *stop, EndgameCacheEntry *entry) {
   unsigned int max_street = Game::MaxStreet();
-  unsigned int num_path = path_->size();
   HandTree hand_tree(endgame_st_, bd, Game::MaxStreet());
-  if (num_path == 0) {
-    fprintf(stderr, "ResolveSubgame: empty path?!?\n");
-    exit(-1);
-  }
-  Node *si_node = (*path_)[num_path - 1];
-  if (si_node->Street() != endgame_st_) {
-    fprintf(stderr,
-	    "ResolveSubgame: last node on path not on endgame street?!?\n");
-    exit(-1);
-  }
-
   BettingTree *base_subtree = CreateSubtree(si_node, p, true);
   if (debug_) {
     fprintf(stderr, "Created subtree\n");
@@ -141,43 +194,437 @@ void NLAgent::ResolveSubgame(unsigned int p, unsigned int bd,
   if (debug_) fprintf(stderr, "Calling ReadPureSubtree\n");
   probs_[p]->ReadPureSubtree(si_node, base_subtree, &base_regrets);
   if (debug_) fprintf(stderr, "Back from ReadPureSubtree\n");
-
-  t_vals.reset(dynamic_cbr_->Compute(base_subtree->Root(), reach_probs, bd,
-				     &hand_tree, endgame_st_, bd, p^1, t_cfrs,
-				     t_zero_sum, current, pure, &base_regrets,
-				     nullptr));
+  if (Stopped(stop)) {
+    delete base_subtree;
+    entry->num_its = 0;
+    return 0;
+  }
+
+  t_vals.reset(dynamic_cbr->Compute(base_subtree->Root(), reach_probs, bd,
+				    &hand_tree, endgame_st_, bd, p^1, t_cfrs,
+				    t_zero_sum, current, pure, &base_regrets,
+				    nullptr));
+  if (Stopped(stop)) {
+    delete base_subtree;
+    entry->num_its = 0;
+    return 0;
+  }
+  entry->subtree.reset(CreateSubtree(si_node, p, false));
+  entry->sumprobs.reset(CreateEndgameSumprobs(p, bd, entry->subtree.get()));
+  entry->sumprobs->AllocateAndClearDoubles(entry->subtree->Root(), kMaxUInt);
+  ResolvingMethod method = ResolvingMethod::COMBINED;
+  bool cfrs = false, zero_sum = true;
+  EGCFR eg_cfr(endgame_card_abstraction_, endgame_betting_abstraction_,
+	       endgame_cfr_config_, *endgame_buckets_, endgame_st_, method,
+	       cfrs, zero_sum, endgame_threads_);
+  if (pool) eg_cfr.SetThreadPool(pool);
+  if (budget >= 0) {
+    // Deduct the time already spent building the subtrees and T values.
+    // SolveSubgame() always runs at least one iteration.
+    double time_limit = budget - SecsSince(start_tv);
+    eg_cfr.SetTimeLimit(time_limit > 0 ? time_limit : 1e-9);
+  }
+  eg_cfr.SetStopFlag(stop);
+  if (endgame_warm_start_weight_ > 0) {
+    eg_cfr.SetWarmStart(base_subtree->Root(), &base_regrets, buckets_,
+			endgame_warm_start_weight_);
+  }
+  eg_cfr.SolveSubgame(entry->subtree.get(), bd, reach_probs, "x",
+		      &hand_tree, t_vals.get(), p, false, num_endgame_its_,
+		      entry->sumprobs.get());
   delete base_subtree;
-  delete endgame_subtree_;
-  endgame_subtree_ = CreateSubtree(si_node, p, false);
+  entry->num_its = eg_cfr.NumItsRun();
+  return entry->num_its;
+}
+
+// Need to set reach_probs
+void NLAgent::ResolveSubgame(unsigned int p, unsigned int bd,
+			     double **reach_probs) {
+  timeval start_tv;
+  gettimeofday(&start_tv, NULL);
+  unsigned int num_players = Game::NumPlayers();
+  if (debug_) {
+    unsigned int max_card1 = Game::MaxCard() + 1;
+    // Temporary
+    for (unsigned int p = 0; p < num_players; ++p) {
+      double sum = 0;
+      const Card *board = BoardTree::Board(endgame_st_, bd);
+      unsigned int num_board_cards = Game::NumBoardCards(endgame_st_);
+      for (Card hi = 1; hi < max_card1; ++hi) {
+	if (InCards(hi, board, num_board_cards)) continue; 
+	for (Card lo = 0; lo < hi; ++lo) {
+	  if (InCards(lo, board, num_board_cards)) continue;
+	  unsigned int enc = hi * max_card1 + lo;
+	  sum += reach_probs[p][enc];
+	}
+      }
+      fprintf(stderr, "P%u sum-reach-probs %f\n", p, sum);
+    }
+  }
+
+  unsigned int num_path = path_->size();
+  if (num_path == 0) {
+    fprintf(stderr, "ResolveSubgame: empty path?!?\n");
+    exit(-1);
+  }
+  Node *si_node = (*path_)[num_path - 1];
+  if (si_node->Street() != endgame_st_) {
+    fprintf(stderr,
+	    "ResolveSubgame: last node on path not on endgame street?!?\n");
+    exit(-1);
+  }
+
+  double budget = -1;
+  if (endgame_secs_per_hand_ > 0) {
+    budget = endgame_time_bank_;
+    if (endgame_max_secs_ > 0 && budget > endgame_max_secs_) {
+      budget = endgame_max_secs_;
+    }
+    if (budget < 0) budget = 0;
+  }
+
+  bool use_cache = endgame_cache_ || endgame_cache_dir_ != "";
+  string cache_key;
+  if (use_cache) {
+    cache_key = EndgameCache::Key(p, si_node, bd,
+				  EndgameCache::Fingerprint(endgame_st_, bd,
+							    reach_probs));
+    // If the speculation thread is working on this very endgame, let it
+    // finish, within our budget; its result goes into the cache.
+    WaitForSpeculation(cache_key, start_tv, budget);
+    if (LookupEndgame(si_node, p, bd, cache_key)) {
+      (*path_)[num_path-1] = endgame_subtree_->Root();
+      // The wait and the lookup count against the bank
+      if (endgame_secs_per_hand_ > 0) {
+	endgame_time_bank_ -= SecsSince(start_tv);
+      }
+      return;
+    }
+  } else {
+    StopSpeculating();
+  }
+
+  EndgameCacheEntry entry;
+  unsigned int num_its = SolveEndgame(si_node, p, bd, reach_probs,
+				      dynamic_cbr_.get(), endgame_pool_.get(),
+				      start_tv, budget, nullptr, &entry);
+  endgame_subtree_ = entry.subtree;
+  endgame_sumprobs_ = entry.sumprobs;
   // Switch the street initial node for the endgame street to the root of
   // the endgame subtree.
   (*path_)[num_path-1] = endgame_subtree_->Root();
-  delete endgame_sumprobs_;
+  if (endgame_secs_per_hand_ > 0) {
+    double secs = SecsSince(start_tv);
+    endgame_time_bank_ -= secs;
+    fprintf(stderr, "Resolved st %u bd %u: %u its in %.2f secs (budget %.2f "
+	    "bank %.2f)\n", endgame_st_, bd, num_its, secs, budget,
+	    endgame_time_bank_);
+  }
+  // A solve cut short by the time budget is not cached.  A later hand may
+  // have more time in the bank to solve the endgame fully.
+  if (use_cache && num_its >= num_endgame_its_) {
+    if (endgame_cache_) endgame_cache_->Insert(cache_key, entry);
+    if (endgame_cache_dir_ != "") {
+      endgame_sumprobs_->Write(endgame_cache_dir_.c_str(), 0,
+			       endgame_subtree_->Root(), cache_key, p);
+    }
+  }
+}
 
-  unique_ptr<bool []> subtree_streets(new bool[max_street + 1]);
-  for (unsigned int st = 0; st <= max_street; ++st) {
-    subtree_streets[st] = st >= endgame_st_;
+// Adds each way of completing raw_board to num_endgame_board_cards cards to
+// *counts, keyed by canonical endgame board.  Cards are added in increasing
+// order so that each set of new cards is counted once.
+static void CountEndgameBoards(Card *raw_board, unsigned int num_board_cards,
+			       unsigned int num_endgame_board_cards,
+			       Card min_card, const Card *hole_cards,
+			       unsigned int endgame_st,
+			       map<unsigned int, unsigned int> *counts) {
+  if (num_board_cards == num_endgame_board_cards) {
+    Card canon_board[5], canon_hole_cards[2];
+    CanonicalizeCards(raw_board, hole_cards, endgame_st, canon_board,
+		      canon_hole_cards);
+    ++(*counts)[BoardTree::LookupBoard(canon_board, endgame_st)];
+    return;
   }
-  unique_ptr<bool []> players(new bool[num_players]);
-  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
-    players[p1] = p1 == p;
+  Card max_card = Game::MaxCard();
+  for (Card c = min_card; c <= max_card; ++c) {
+    if (InCards(c, raw_board, num_board_cards)) continue;
+    if (InCards(c, hole_cards, 2)) continue;
+    raw_board[num_board_cards] = c;
+    CountEndgameBoards(raw_board, num_board_cards + 1,
+		       num_endgame_board_cards, c + 1, hole_cards, endgame_st,
+		       counts);
   }
-  endgame_sumprobs_ = new CFRValues(players.get(), true, subtree_streets.get(),
-				    endgame_subtree_, bd, endgame_st_,
-				    endgame_card_abstraction_,
-				    endgame_buckets_->NumBuckets(),
-				    nullptr);
+}
 
-  endgame_sumprobs_->AllocateAndClearDoubles(endgame_subtree_->Root(),
-					     kMaxUInt);
-  ResolvingMethod method = ResolvingMethod::COMBINED;
-  bool cfrs = false, zero_sum = true;
-  EGCFR eg_cfr(endgame_card_abstraction_, endgame_betting_abstraction_,
-	       endgame_cfr_config_, *endgame_buckets_, endgame_st_, method,
-	       cfrs, zero_sum, 1);
-  eg_cfr.SolveSubgame(endgame_subtree_, bd, reach_probs, "x", &hand_tree,
-		      t_vals.get(), p, false, num_endgame_its_,
-		      endgame_sumprobs_);
+// Appends to *paths each extension of *path that ends at a street-initial
+// node on the endgame street where there is still a decision to make.
+static void FindEndgameRoots(vector<Node *> *path, unsigned int endgame_st,
+			     vector< vector<Node *> > *paths) {
+  Node *node = path->back();
+  if (node->Terminal()) return;
+  if (node->Street() == endgame_st) {
+    if (node->NumSuccs() > 1) paths->push_back(*path);
+    return;
+  }
+  unsigned int num_succs = node->NumSuccs();
+  for (unsigned int s = 0; s < num_succs; ++s) {
+    path->push_back(node->IthSucc(s));
+    FindEndgameRoots(path, endgame_st, paths);
+    path->pop_back();
+  }
+}
+
+void *NLAgent::SpeculationThread(void *v_agent) {
+  NLAgent *agent = (NLAgent *)v_agent;
+  agent->Speculate();
+  pthread_mutex_lock(&agent->speculation_mutex_);
+  agent->speculation_finished_ = true;
+  pthread_mutex_unlock(&agent->speculation_mutex_);
+  return NULL;
+}
+
+// Runs in the speculation thread.  Ranks each possible endgame (a path to a
+// street-initial node on the endgame street and an endgame board) by the
+// product over players of the summed base strategy reach probabilities of
+// the path, times the number of raw boards that map to the canonical
+// board.  Then solves the most likely endgames that are not already cached.
+void NLAgent::Speculate(void) {
+  unsigned int num_players = Game::NumPlayers();
+  vector<Node *> path = speculation_path_;
+  vector< vector<Node *> > paths;
+  FindEndgameRoots(&path, endgame_st_, &paths);
+  map<unsigned int, unsigned int> board_counts;
+  Card raw_board[5];
+  unsigned int num_board_cards = Game::NumBoardCards(speculation_st_);
+  for (unsigned int i = 0; i < num_board_cards; ++i) {
+    raw_board[i] = speculation_board_[i];
+  }
+  CountEndgameBoards(raw_board, num_board_cards,
+		     Game::NumBoardCards(endgame_st_), 0,
+		     speculation_hole_cards_, endgame_st_, &board_counts);
+
+  unsigned int max_card1 = Game::MaxCard() + 1;
+  const Card *board = BoardTree::Board(speculation_st_, speculation_bd_);
+  // Score, path index and endgame board
+  vector< pair<double, pair<unsigned int, unsigned int> > > candidates;
+  unsigned int num_paths = paths.size();
+  for (unsigned int i = 0; i < num_paths; ++i) {
+    double **reach_probs = GetReachProbs(paths[i], speculation_st_,
+					 speculation_bd_, speculation_p_);
+    double weight = 1.0;
+    for (unsigned int p = 0; p < num_players; ++p) {
+      double sum = 0;
+      for (Card hi = 1; hi < max_card1; ++hi) {
+	if (InCards(hi, board, num_board_cards)) continue;
+	for (Card lo = 0; lo < hi; ++lo) {
+	  if (InCards(lo, board, num_board_cards)) continue;
+	  sum += reach_probs[p][hi * max_card1 + lo];
+	}
+      }
+      weight *= sum;
+      delete [] reach_probs[p];
+    }
+    delete [] reach_probs;
+    if (weight == 0) continue;
+    for (auto it = board_counts.begin(); it != board_counts.end(); ++it) {
+      candidates.push_back(make_pair(weight * it->second,
+				     make_pair(i, it->first)));
+    }
+  }
+  // Most likely first
+  sort(candidates.rbegin(), candidates.rend());
+
+  unsigned int num_candidates = candidates.size();
+  unsigned int num_solved = 0;
+  char buf[500];
+  for (unsigned int c = 0; c < num_candidates; ++c) {
+    if (num_solved == num_speculative_endgames_) break;
+    const vector<Node *> &endgame_path = paths[candidates[c].second.first];
+    unsigned int bd = candidates[c].second.second;
+    pthread_mutex_lock(&speculation_mutex_);
+    bool stop = stop_speculation_;
+    bool skip = speculation_endgame_bd_ != kMaxUInt &&
+      speculation_endgame_bd_ != bd;
+    pthread_mutex_unlock(&speculation_mutex_);
+    if (stop) break;
+    if (skip) continue;
+
+    Node *si_node = endgame_path.back();
+    double **reach_probs = GetReachProbs(endgame_path, endgame_st_, bd,
+					 speculation_p_);
+    string key =
+      EndgameCache::Key(speculation_p_, si_node, bd,
+			EndgameCache::Fingerprint(endgame_st_, bd,
+						  reach_probs));
+    EndgameCacheEntry entry;
+    bool cached = endgame_cache_->Lookup(key, &entry);
+    if (! cached && endgame_cache_dir_ != "") {
+      CachedSumprobsFilename(endgame_cache_dir_, key, endgame_st_, bd,
+			     speculation_p_, buf);
+      cached = FileExists(buf);
+    }
+    if (! cached) {
+      pthread_mutex_lock(&speculation_mutex_);
+      stop = stop_speculation_;
+      if (! stop) {
+	speculation_key_ = key;
+	speculation_solve_bd_ = bd;
+	__atomic_store_n(&abort_speculation_, false, __ATOMIC_RELAXED);
+      }
+      pthread_mutex_unlock(&speculation_mutex_);
+      if (stop) {
+	for (unsigned int p = 0; p < num_players; ++p) {
+	  delete [] reach_probs[p];
+	}
+	delete [] reach_probs;
+	break;
+      }
+      timeval start_tv;
+      gettimeofday(&start_tv, NULL);
+      unsigned int num_its =
+	SolveEndgame(si_node, speculation_p_, bd, reach_probs,
+		     speculation_cbr_.get(), nullptr, start_tv,
+		     endgame_max_secs_ > 0 ? endgame_max_secs_ : -1,
+		     &abort_speculation_, &entry);
+      pthread_mutex_lock(&speculation_mutex_);
+      bool aborted = abort_speculation_;
+      speculation_key_ = "";
+      speculation_solve_bd_ = kMaxUInt;
+      pthread_cond_broadcast(&speculation_cond_);
+      pthread_mutex_unlock(&speculation_mutex_);
+      if (! aborted && num_its < num_endgame_its_) {
+	fprintf(stderr, "Speculative solve st %u bd %u ran out of time after "
+		"%u its; not cached\n", endgame_st_, bd, num_its);
+      } else if (! aborted) {
+	// Abandoned and truncated solves are incomplete and are not cached
+	endgame_cache_->Insert(key, entry);
+	if (endgame_cache_dir_ != "") {
+	  entry.sumprobs->Write(endgame_cache_dir_.c_str(), 0,
+				entry.subtree->Root(), key, speculation_p_);
+	}
+	++num_solved;
+	fprintf(stderr, "Speculatively resolved st %u bd %u (%u/%u): %u its "
+		"in %.2f secs\n", endgame_st_, bd, num_solved,
+		num_speculative_endgames_, num_its, SecsSince(start_tv));
+      }
+    }
+    for (unsigned int p = 0; p < num_players; ++p) {
+      delete [] reach_probs[p];
+    }
+    delete [] reach_probs;
+  }
+}
+
+// Called after we act on the street before the endgame street.  The current
+// path and board are copied so that the main thread can carry on.  Does
+// nothing if an abandoned speculation thread is still winding down, since
+// it still reads the speculation_ members.
+void NLAgent::StartSpeculating(unsigned int p, unsigned int bd,
+			       const Card *board, Card our_hi, Card our_lo) {
+  StopSpeculating();
+  if (! ReapSpeculation(false)) {
+    fprintf(stderr, "Abandoned speculation still running; not speculating\n");
+    return;
+  }
+  speculation_path_ = *path_;
+  speculation_p_ = p;
+  speculation_st_ = endgame_st_ - 1;
+  speculation_bd_ = bd;
+  unsigned int num_board_cards = Game::NumBoardCards(speculation_st_);
+  for (unsigned int i = 0; i < num_board_cards; ++i) {
+    speculation_board_[i] = board[i];
+  }
+  speculation_hole_cards_[0] = our_hi;
+  speculation_hole_cards_[1] = our_lo;
+  speculation_endgame_bd_ = kMaxUInt;
+  speculation_solve_bd_ = kMaxUInt;
+  speculation_key_ = "";
+  stop_speculation_ = false;
+  abort_speculation_ = false;
+  speculation_finished_ = false;
+  pthread_create(&speculation_thread_, NULL, SpeculationThread, this);
+  speculation_thread_live_ = true;
+  speculating_ = true;
+}
+
+// Joins the speculation thread if it has finished, or if wait is true.
+// Returns true if there is no longer a speculation thread.
+bool NLAgent::ReapSpeculation(bool wait) {
+  if (! speculation_thread_live_) return true;
+  if (! wait) {
+    pthread_mutex_lock(&speculation_mutex_);
+    bool finished = speculation_finished_;
+    pthread_mutex_unlock(&speculation_mutex_);
+    if (! finished) return false;
+  }
+  pthread_join(speculation_thread_, NULL);
+  speculation_thread_live_ = false;
+  return true;
+}
+
+// Abandons any speculative solve in progress.  Does not wait for the thread
+// to notice: it may be partway through a phase of the solve (e.g., computing
+// T values) that does not check for an abort.  The thread is reaped later.
+void NLAgent::StopSpeculating(void) {
+  if (! speculating_) return;
+  pthread_mutex_lock(&speculation_mutex_);
+  stop_speculation_ = true;
+  __atomic_store_n(&abort_speculation_, true, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&speculation_mutex_);
+  speculating_ = false;
+  ReapSpeculation(false);
+}
+
+// Like StopSpeculating(), but if the speculation thread is solving the
+// endgame with the given key, waits for that solve to finish and for its
+// result to be cached.  If budget is nonnegative, waits at most until budget
+// seconds after start_tv and then abandons the solve.
+void NLAgent::WaitForSpeculation(const string &key, const timeval &start_tv,
+				 double budget) {
+  if (! speculating_) return;
+  pthread_mutex_lock(&speculation_mutex_);
+  stop_speculation_ = true;
+  bool abandon = false;
+  if (speculation_key_ != key) {
+    abandon = true;
+  } else if (budget >= 0) {
+    timespec deadline;
+    long long int usecs = start_tv.tv_usec + (long long int)(budget * 1e6);
+    deadline.tv_sec = start_tv.tv_sec + usecs / 1000000;
+    deadline.tv_nsec = (usecs % 1000000) * 1000;
+    while (speculation_key_ == key) {
+      if (pthread_cond_timedwait(&speculation_cond_, &speculation_mutex_,
+				 &deadline) == ETIMEDOUT) {
+	if (speculation_key_ == key) {
+	  fprintf(stderr, "Abandoning speculative solve after %.2f secs\n",
+		  SecsSince(start_tv));
+	  abandon = true;
+	}
+	break;
+      }
+    }
+  }
+  if (abandon) {
+    __atomic_store_n(&abort_speculation_, true, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&speculation_mutex_);
+  speculating_ = false;
+  // Once told to stop, the thread exits as soon as it has cached the
+  // endgame we want, so only an abandoned thread is left to be reaped later.
+  ReapSpeculation(! abandon);
+}
+
+// Once the endgame board is known there is no point in solving endgames on
+// other boards.
+void NLAgent::NarrowSpeculation(unsigned int bd) {
+  if (! speculating_) return;
+  pthread_mutex_lock(&speculation_mutex_);
+  speculation_endgame_bd_ = bd;
+  if (speculation_solve_bd_ != kMaxUInt && speculation_solve_bd_ != bd) {
+    __atomic_store_n(&abort_speculation_, true, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&speculation_mutex_);
 }
 
 // Currently assume that this is a street-initial node.
@@ -202,7 +649,7 @@ void NLAgent::ResolveAndWrite(Node *node, unsigned int gbd,
 		 gbd, base_card_abstraction_, endgame_card_abstraction_,
 		 base_betting_abstraction_, endgame_betting_abstraction_,
 		 base_cfr_config_, endgame_cfr_config_, method,
-		 endgame_sumprobs_, st, gbd, p, p, st);
+		 endgame_sumprobs_.get(), st, gbd, p, p, st);
   }
 }
 
@@ -725,11 +1172,11 @@ NLAgent::NLAgent(const CardAbstraction &base_ca,
       // each asym_p system.
       probs_[p] = new CFRValuesFile(nullptr, nullptr, base_ca, base_ba,
 				    base_cc, p, it, endgame_st_, betting_tree,
-				    num_buckets);
+				    num_buckets, rc.MmapProbs());
     } else {
       probs_[0] = new CFRValuesFile(nullptr, nullptr, base_ca, base_ba,
 				    base_cc, p, it, endgame_st_, betting_tree,
-				    num_buckets);
+				    num_buckets, rc.MmapProbs());
       for (unsigned int p1 = 1; p1 < num_players; ++p1) {
 	probs_[p1] = probs_[0];
       }
@@ -745,20 +1192,51 @@ NLAgent::NLAgent(const CardAbstraction &base_ca,
 
   endgame_buckets_.reset(new Buckets());
   dynamic_cbr_.reset(new DynamicCBR2(base_ca, base_ba, base_cc, *buckets_, 1));
-  endgame_sumprobs_ = nullptr;
-  endgame_subtree_ = nullptr;
+  endgame_secs_per_hand_ = rc.EndgameSecsPerHand();
+  endgame_max_secs_ = rc.EndgameMaxSecs();
+  endgame_time_bank_ = 0;
+  endgame_warm_start_weight_ = rc.EndgameWarmStartWeight();
+  endgame_threads_ = rc.EndgameThreads();
+  if (endgame_threads_ > 1) {
+    endgame_pool_.reset(new ThreadPool(endgame_threads_));
+  }
+  if (rc.EndgameCacheSize() > 0) {
+    endgame_cache_.reset(new EndgameCache(rc.EndgameCacheSize()));
+  }
+  endgame_cache_dir_ = rc.EndgameCacheDir();
+  if (endgame_cache_dir_ != "") Mkdir(endgame_cache_dir_.c_str());
+  num_endgame_cache_hits_ = 0;
+  num_endgame_disk_hits_ = 0;
+  num_endgame_cache_misses_ = 0;
+  num_speculative_endgames_ = rc.SpeculativeEndgames();
+  if (num_speculative_endgames_ > 0) {
+    if (! endgame_cache_) {
+      fprintf(stderr, "SpeculativeEndgames requires EndgameCacheSize\n");
+      exit(-1);
+    }
+    speculation_cbr_.reset(new DynamicCBR2(base_ca, base_ba, base_cc,
+					   *buckets_, 1));
+  }
+  speculating_ = false;
+  speculation_thread_live_ = false;
+  speculation_finished_ = false;
+  pthread_mutex_init(&speculation_mutex_, NULL);
+  pthread_cond_init(&speculation_cond_, NULL);
 
   last_hand_index_ = kMaxUInt;
+  prefetch_st_ = kMaxUInt;
   folded_.reset(new bool[num_players]);
 
   rand_bufs_ = new drand48_data[num_players];
 }
 
 NLAgent::~NLAgent(void) {
+  StopSpeculating();
+  ReapSpeculation(true);
+  pthread_mutex_destroy(&speculation_mutex_);
+  pthread_cond_destroy(&speculation_cond_);
   delete [] rand_bufs_;
   delete path_;
-  delete endgame_sumprobs_;
-  delete endgame_subtree_;
   if (base_betting_abstraction_.Asymmetric()) {
     unsigned int num_players = Game::NumPlayers();
     for (unsigned int p = 0; p < num_players; ++p) {
@@ -838,6 +1316,11 @@ double *NLAgent::CurrentProbs(Node *node, unsigned int h, unsigned int p) {
     }
     // For multiplayer, pa may be different from p
     probs_[p]->Probs(pa, st, node->NonterminalID(), h, num_succs, dsi, probs);
+    // Start paging in what we are likely to need for the rest of the hand
+    if (runtime_config_.PrefetchProbs() && st != prefetch_st_) {
+      probs_[p]->Prefetch(node);
+      prefetch_st_ = st;
+    }
   }
   return probs;
 }
@@ -866,6 +1349,12 @@ void NLAgent::AllProbs(Node *node, unsigned int s, unsigned int gbd,
     for (unsigned int i = 0; i < num_board_cards; ++i) {
       cards[i+2] = board[i];
     }
+    // Fetch the buckets for the whole board at once
+    unique_ptr<unsigned int []> board_buckets;
+    if (! buckets_->None(st)) {
+      board_buckets.reset(new unsigned int[num_hole_card_pairs]);
+      buckets_->BoardBuckets(st, gbd, board_buckets.get());
+    }
     for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
       const Card *hole_cards = hands->Cards(i);
       cards[0] = hole_cards[0];
@@ -877,7 +1366,7 @@ void NLAgent::AllProbs(Node *node, unsigned int s, unsigned int gbd,
 	// This does wrong thing on river
 	holding = h;
       } else {
-	holding = buckets_->Bucket(st, h);
+	holding = board_buckets[hcp];
       }
       
       // For multiplayer, pa may be different from p
@@ -1094,14 +1583,18 @@ unsigned int NLAgent::WhoseAction(vector<Action> *actions) {
   return player_to_act;
 }
 
-double **NLAgent::GetReachProbs(unsigned int current_bd, unsigned int asym_p) {
-  unsigned int num_path = path_->size();
+// Reach probabilities of each player's hole cards along the given path of
+// the base betting tree.  current_bd is a board on current_st, which is
+// normally the street of the last node on the path.  Safe to call from the
+// speculation thread.
+double **NLAgent::GetReachProbs(const vector<Node *> &path,
+				unsigned int current_st,
+				unsigned int current_bd, unsigned int asym_p) {
+  unsigned int num_path = path.size();
   if (num_path < 1) {
     fprintf(stderr, "Empty path?!?\n");
     exit(-1);
   }
-  Node *current = (*path_)[num_path - 1];
-  unsigned int current_st = current->Street();
   unsigned int num_players = Game::NumPlayers();
   double **reach_probs = new double *[num_players];
   unsigned int max_card1 = Game::MaxCard() + 1;
@@ -1126,8 +1619,8 @@ double **NLAgent::GetReachProbs(unsigned int current_bd, unsigned int asym_p) {
   }
   Card max_card = Game::MaxCard();
   for (unsigned int i = 0; i < num_path - 1; ++i) {
-    Node *before = (*path_)[i];
-    Node *after = (*path_)[i + 1];
+    Node *before = path[i];
+    Node *after = path[i + 1];
     // This can happen when we map large bets up to an all-in.
     // For example, r19000c/cr19500c.  That last call doesn't correspond to
     // any succ in the abstract game.
@@ -1165,6 +1658,10 @@ double **NLAgent::GetReachProbs(unsigned int current_bd, unsigned int asym_p) {
     } else {
       bd = BoardTree::LookupBoard(board, st);
     }
+    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    unique_ptr<unsigned int []> board_buckets(
+				    new unsigned int[num_hole_card_pairs]);
+    buckets_->BoardBuckets(st, bd, board_buckets.get());
     double sum = 0;
     for (Card hi = 1; hi <= max_card; ++hi) {
       if (InCards(hi, board, num_board_cards)) continue;
@@ -1173,9 +1670,7 @@ double **NLAgent::GetReachProbs(unsigned int current_bd, unsigned int asym_p) {
 	if (InCards(lo, board, num_board_cards)) continue;
 	cards[1] = lo;
 	unsigned int hcp = HCPIndex(st, cards);
-	unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-	unsigned int h = bd * num_hole_card_pairs + hcp;
-	unsigned int b = buckets_->Bucket(st, h);
+	unsigned int b = board_buckets[hcp];
 	probs_[asym_p]->Probs(pa, st, nt, b, num_succs, dsi,
 			      probs.get());
 	unsigned int enc = hi * max_card1 + lo;
@@ -1517,11 +2012,12 @@ BotAction NLAgent::HandleStateChange(const string &match_state,
     for (unsigned int p = 0; p < num_players; ++p) {
       folded_[p] = false;
     }
-    delete endgame_sumprobs_;
-    endgame_sumprobs_ = nullptr;
-    delete endgame_subtree_;
-    endgame_subtree_ = nullptr;
+    StopSpeculating();
+    endgame_sumprobs_.reset();
+    endgame_subtree_.reset();
     last_hand_index_ = hand_index;
+    prefetch_st_ = kMaxUInt;
+    endgame_time_bank_ += endgame_secs_per_hand_;
     if (fixed_seed_) {
       // Have a separate seed for each player.  Makes it easier to
       // match results from those of play.  May also prevent synchronization
@@ -1547,8 +2043,17 @@ BotAction NLAgent::HandleStateChange(const string &match_state,
 
   unsigned int player_to_act = WhoseAction(&actions);
   if (debug_) fprintf(stderr, "player_to_act %u p %u\n", player_to_act, p);
-  if (player_to_act == kMaxUInt) return BA_NONE;
-  if (p != player_to_act) return BA_NONE;
+  if (player_to_act == kMaxUInt) {
+    StopSpeculating();
+    return BA_NONE;
+  }
+  if (p != player_to_act) {
+    if (board_street == endgame_st_) NarrowSpeculation(bd);
+    return BA_NONE;
+  }
+  // Speculation only pays off on the endgame street; there it is consumed
+  // (or stopped) by ResolveSubgame().
+  if (board_street < endgame_st_) StopSpeculating();
 
   if (AreWeAllIn(&actions, p)) {
     if (debug_) fprintf(stderr, "We are all-in; returning no-action\n");
@@ -1584,7 +2089,8 @@ BotAction NLAgent::HandleStateChange(const string &match_state,
     // the river.
     if (current_node->NumSuccs() > 1) {
       if (debug_) fprintf(stderr, "Calling GetReachProbs()\n");
-      double **reach_probs = GetReachProbs(bd, p);
+      double **reach_probs = GetReachProbs(*path_, current_node->Street(),
+					   bd, p);
       if (debug_) fprintf(stderr, "ResolveSubgame\n");
       ResolveSubgame(p, bd, reach_probs);
       if (debug_) fprintf(stderr, "Back from ResolveSubgame\n");
@@ -1592,6 +2098,8 @@ BotAction NLAgent::HandleStateChange(const string &match_state,
 	delete [] reach_probs[p];
       }
       delete [] reach_probs;
+    } else {
+      StopSpeculating();
     }
 
     if (action_index_ != actions.size()) {
@@ -1785,5 +2293,9 @@ BotAction NLAgent::HandleStateChange(const string &match_state,
 				  folded_.get());
     }
   }
+  if (num_speculative_endgames_ > 0 && board_street + 1 == endgame_st_ &&
+      ! next_node->Terminal()) {
+    StartSpeculating(p, bd, board, our_hi, our_lo);
+  }
   return bot_action;
 }
@@ -1,6 +1,8 @@
 #ifndef _NL_AGENT_H_
 #define _NL_AGENT_H_
 
+#include <pthread.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -21,11 +23,15 @@ class CFRConfig;
 class CFRValues;
 class CFRValuesFile;
 class DynamicCBR2;
+class EndgameCache;
+struct EndgameCacheEntry;
 class Game;
 class HandTree;
 class Hands;
 class Node;
 class RuntimeConfig;
+class ThreadPool;
+struct timeval;
 
 class NLAgent : public Agent {
  public:
@@ -49,7 +55,25 @@ class NLAgent : public Agent {
 		CanonicalCards *hands, unsigned int p, double *probs);
  protected:
   BettingTree *CreateSubtree(Node *node, unsigned int target_p, bool base);
+  CFRValues *CreateEndgameSumprobs(unsigned int p, unsigned int bd,
+				   BettingTree *subtree);
+  bool LookupEndgame(Node *si_node, unsigned int p, unsigned int bd,
+		     const string &key);
+  unsigned int SolveEndgame(Node *si_node, unsigned int p, unsigned int bd,
+			    double **reach_probs, DynamicCBR2 *dynamic_cbr,
+			    ThreadPool *pool, const timeval &start_tv,
+			    double budget, const bool *stop,
+			    EndgameCacheEntry *entry);
   void ResolveSubgame(unsigned int p, unsigned int bd, double **reach_probs);
+  void StartSpeculating(unsigned int p, unsigned int bd, const Card *board,
+			Card our_hi, Card our_lo);
+  void StopSpeculating(void);
+  bool ReapSpeculation(bool wait);
+  void WaitForSpeculation(const string &key, const timeval &start_tv,
+			  double budget);
+  void NarrowSpeculation(unsigned int bd);
+  static void *SpeculationThread(void *v_agent);
+  void Speculate(void);
   void GetTwoClosestSuccs(Node *node, unsigned int actual_bet_to,
 			  unsigned int *below_succ, unsigned int *below_bet_to,
 			  unsigned int *above_succ,
@@ -72,7 +96,8 @@ class NLAgent : public Agent {
   double *GetActionProbs(const vector<Action> &actions, Node *sob_node, 
 			 unsigned int *current_buckets, unsigned int p,
 			 bool *force_call);
-  double **GetReachProbs(unsigned int bd, unsigned int asym_p);
+  double **GetReachProbs(const vector<Node *> &path, unsigned int current_st,
+			 unsigned int current_bd, unsigned int asym_p);
 
   const CardAbstraction &base_card_abstraction_;
   const CardAbstraction &endgame_card_abstraction_;
@@ -104,6 +129,62 @@ class NLAgent : public Agent {
   unsigned int translation_method_;
   unique_ptr<Buckets> endgame_buckets_;
   unique_ptr<DynamicCBR2> dynamic_cbr_;
+  unsigned int endgame_threads_;
+  // Persists across resolves so that threads are not created for every
+  // endgame.  Only created if endgame_threads_ > 1.
+  unique_ptr<ThreadPool> endgame_pool_;
+  // If endgame_secs_per_hand_ is positive, each hand adds that many seconds
+  // to endgame_time_bank_ and resolving runs until it has used up the bank
+  // (capped at endgame_max_secs_ if that is positive) rather than for a
+  // fixed number of iterations.  Time not spent on one hand carries over to
+  // later hands.
+  double endgame_secs_per_hand_;
+  double endgame_max_secs_;
+  double endgame_time_bank_;
+  // If positive, each endgame solve is warm-started from the base strategy
+  // (see EGCFR::SetWarmStart()).
+  double endgame_warm_start_weight_;
+  // Resolved endgames for reuse in later hands.  Null if EndgameCacheSize
+  // is zero.  If endgame_cache_dir_ is not empty, resolved endgames are also
+  // written there and looked for there on a miss in memory.
+  unique_ptr<EndgameCache> endgame_cache_;
+  string endgame_cache_dir_;
+  unsigned long long int num_endgame_cache_hits_;
+  unsigned long long int num_endgame_disk_hits_;
+  unsigned long long int num_endgame_cache_misses_;
+  // If positive, after we act on the street before the endgame street a
+  // background thread solves up to this many of the most likely endgames
+  // (street-initial node and board) into endgame_cache_ while the opponent
+  // is thinking.  The speculation_ members other than the control flags
+  // below are only touched by the main thread while no speculation thread
+  // is running.
+  unsigned int num_speculative_endgames_;
+  unique_ptr<DynamicCBR2> speculation_cbr_;
+  bool speculating_;
+  // True from when the speculation thread is created until it is joined.
+  // An abandoned thread (speculating_ false) may still be winding down.
+  bool speculation_thread_live_;
+  pthread_t speculation_thread_;
+  vector<Node *> speculation_path_;
+  unsigned int speculation_p_;
+  unsigned int speculation_st_;
+  unsigned int speculation_bd_;
+  Card speculation_board_[5];
+  Card speculation_hole_cards_[2];
+  // The following are protected by speculation_mutex_.  Once the actual
+  // endgame board is known, speculation_endgame_bd_ is set and only
+  // endgames on that board are solved.  stop_speculation_ ends the thread
+  // after the current solve; abort_speculation_ also abandons the current
+  // solve.  speculation_cond_ is signalled when a speculative solve ends.
+  pthread_mutex_t speculation_mutex_;
+  pthread_cond_t speculation_cond_;
+  unsigned int speculation_endgame_bd_;
+  unsigned int speculation_solve_bd_;
+  string speculation_key_;
+  bool stop_speculation_;
+  bool abort_speculation_;
+  // Set by the speculation thread just before it exits
+  bool speculation_finished_;
   vector<Node *> *path_;
   unsigned int last_hand_index_;
   unsigned int action_index_;
@@ -112,8 +193,13 @@ class NLAgent : public Agent {
   unsigned int num_remaining_;
   unsigned int num_to_act_on_street_;
   unique_ptr<bool []> folded_;
-  CFRValues *endgame_sumprobs_;
-  BettingTree *endgame_subtree_;
+  // The street we last prefetched probs for in this hand.  With
+  // PrefetchProbs we prefetch at the first lookup on each street rather
+  // than on every lookup.
+  unsigned int prefetch_st_;
+  // Shared with endgame_cache_
+  shared_ptr<CFRValues> endgame_sumprobs_;
+  shared_ptr<BettingTree> endgame_subtree_;
   struct drand48_data *rand_bufs_;
 };
 
@@ -0,0 +1,136 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "numa_utils.h"
+#include "split.h"
+
+using namespace std;
+
+// From <linux/mempolicy.h>
+static const int kMPolDefault = 0;
+static const int kMPolInterleave = 3;
+
+// Worker threads call PinThread() concurrently, so the topology is read
+// exactly once under pthread_once().
+static pthread_once_t g_init_once = PTHREAD_ONCE_INIT;
+// Kernel ids and CPUs of each online node that has CPUs
+static vector<unsigned int> g_node_ids;
+static vector< vector<unsigned int> > g_node_cpus;
+static cpu_set_t g_saved_affinity;
+
+// Parses a list such as "0-7,16-23".
+static void ParseList(const char *str, vector<unsigned int> *values) {
+  vector<string> ranges;
+  Split(str, ',', false, &ranges);
+  for (unsigned int i = 0; i < ranges.size(); ++i) {
+    unsigned int lo, hi;
+    if (sscanf(ranges[i].c_str(), "%u-%u", &lo, &hi) == 2) {
+      for (unsigned int v = lo; v <= hi; ++v) values->push_back(v);
+    } else if (sscanf(ranges[i].c_str(), "%u", &lo) == 1) {
+      values->push_back(lo);
+    }
+  }
+}
+
+// Reads a one-line sysfs list file.  Leaves values empty if the file is
+// missing.
+static void ReadList(const char *path, vector<unsigned int> *values) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) return;
+  char line[4096];
+  if (fgets(line, sizeof(line), fp)) {
+    unsigned int len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') line[len - 1] = 0;
+    ParseList(line, values);
+  }
+  fclose(fp);
+}
+
+static void InitNUMA(void) {
+  vector<unsigned int> nodes;
+  ReadList("/sys/devices/system/node/online", &nodes);
+  for (unsigned int i = 0; i < nodes.size(); ++i) {
+    char buf[500];
+    sprintf(buf, "/sys/devices/system/node/node%u/cpulist", nodes[i]);
+    vector<unsigned int> cpus;
+    ReadList(buf, &cpus);
+    // Skip memory-only nodes
+    if (cpus.size() == 0) continue;
+    g_node_ids.push_back(nodes[i]);
+    g_node_cpus.push_back(cpus);
+  }
+  if (g_node_cpus.size() == 0) {
+    // No NUMA information; treat the machine as one node.
+    vector<unsigned int> cpus;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1) num_cpus = 1;
+    for (long c = 0; c < num_cpus; ++c) cpus.push_back(c);
+    g_node_ids.push_back(0);
+    g_node_cpus.push_back(cpus);
+  }
+  fprintf(stderr, "%u NUMA node(s)\n", (unsigned int)g_node_cpus.size());
+}
+
+unsigned int NumNUMANodes(void) {
+  pthread_once(&g_init_once, InitNUMA);
+  return g_node_cpus.size();
+}
+
+unsigned int NUMANodeForThread(unsigned int thread_index) {
+  return thread_index % NumNUMANodes();
+}
+
+bool PinThread(unsigned int thread_index) {
+  unsigned int num_nodes = NumNUMANodes();
+  const vector<unsigned int> &cpus =
+    g_node_cpus[thread_index % num_nodes];
+  unsigned int cpu = cpus[(thread_index / num_nodes) % cpus.size()];
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "Could not pin thread %u to CPU %u\n", thread_index, cpu);
+    return false;
+  }
+  return true;
+}
+
+void SaveThreadAffinity(void) {
+  pthread_getaffinity_np(pthread_self(), sizeof(g_saved_affinity),
+			 &g_saved_affinity);
+}
+
+void RestoreThreadAffinity(void) {
+  pthread_setaffinity_np(pthread_self(), sizeof(g_saved_affinity),
+			 &g_saved_affinity);
+}
+
+bool InterleaveAllocations(bool on) {
+  unsigned int num_nodes = NumNUMANodes();
+  long ret;
+  if (on) {
+    if (num_nodes == 1) return true;
+    // Assumes node ids are below 64, which holds on any machine we run on.
+    unsigned long mask = 0;
+    for (unsigned int n = 0; n < num_nodes; ++n) {
+      if (g_node_ids[n] < 64) mask |= 1UL << g_node_ids[n];
+    }
+    ret = syscall(SYS_set_mempolicy, kMPolInterleave, &mask,
+		  (unsigned long)(8 * sizeof(mask)));
+  } else {
+    ret = syscall(SYS_set_mempolicy, kMPolDefault, NULL, 0UL);
+  }
+  if (ret != 0) {
+    fprintf(stderr, "set_mempolicy failed; using default placement\n");
+    return false;
+  }
+  return true;
+}
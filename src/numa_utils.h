@@ -0,0 +1,25 @@
+#ifndef _NUMA_UTILS_H_
+#define _NUMA_UTILS_H_
+
+// Thread pinning and NUMA memory placement for the sampling CFR variants
+// (TCFR, ECFR).  The topology is read from /sys/devices/system/node and
+// memory policy is set with the raw set_mempolicy system call, so there is
+// no dependency on libnuma.  On a machine without NUMA support everything
+// degrades to a single node and the calls become no-ops.
+
+unsigned int NumNUMANodes(void);
+// Worker threads are spread round-robin across nodes; i.e., thread i runs
+// on node i % NumNUMANodes().
+unsigned int NUMANodeForThread(unsigned int thread_index);
+// Pins the calling thread to a CPU on NUMANodeForThread(thread_index).
+// Returns false if the affinity could not be set.
+bool PinThread(unsigned int thread_index);
+// Saves/restores the affinity of the calling thread.  Used around running
+// worker 0 in the main thread.
+void SaveThreadAffinity(void);
+void RestoreThreadAffinity(void);
+// While on, pages first touched by the calling thread are interleaved
+// across all nodes.  Returns false if the kernel rejected the policy.
+bool InterleaveAllocations(bool on);
+
+#endif
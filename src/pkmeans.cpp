@@ -20,16 +20,19 @@
 #include <vector>
 
 #include "constants.h"
+#include "feature_matrix.h"
 #include "pkmeans.h"
 #include "rand.h"
 #include "sorting.h"
+#include "sq_distance.h"
 
 static unsigned int g_it = 0;
 
 class PKMeansThread {
 public:
   PKMeansThread(unsigned int num_objects, unsigned int num_clusters,
-		float **objects, unsigned int dim, double neighbor_thresh,
+		const FeatureMatrix *objects, unsigned int dim,
+		double neighbor_thresh,
 		unsigned int *cluster_sizes, float **means,
 		unsigned int num_pivots, float **pivot_means,
 		unsigned int *assignments, unsigned char **nearest_centroids,
@@ -50,15 +53,15 @@ public:
   unsigned int NumChanged(void) const {return num_changed_;}
   double SumDists(void) const {return sum_dists_;}
 private:
-  unsigned int ExhaustiveNearest(unsigned int o, float *obj,
+  unsigned int ExhaustiveNearest(unsigned int o, const float *obj,
 				 unsigned int guess_c, double guess_min_dist,
 				 double *ret_min_dist);
   unsigned int GetInitialGuess(unsigned int o);
-  unsigned int Nearest(unsigned int o, float *obj, double *ret_min_dist);
+  unsigned int Nearest(unsigned int o, const float *obj, double *ret_min_dist);
 
   unsigned int num_objects_;
   unsigned int num_clusters_;
-  float **objects_;
+  const FeatureMatrix *objects_;
   unsigned int dim_;
   double neighbor_thresh_;
   unsigned int *cluster_sizes_;
@@ -83,7 +86,8 @@ private:
 };
 
 PKMeansThread::PKMeansThread(unsigned int num_objects,
-			     unsigned int num_clusters, float **objects,
+			     unsigned int num_clusters,
+			     const FeatureMatrix *objects,
 			     unsigned int dim, double neighbor_thresh,
 			     unsigned int *cluster_sizes,
 			     float **means, unsigned int num_pivots,
@@ -117,7 +121,7 @@ PKMeansThread::PKMeansThread(unsigned int num_objects,
   num_changed_ = 0;
 }
 
-unsigned int PKMeansThread::ExhaustiveNearest(unsigned int o, float *obj,
+unsigned int PKMeansThread::ExhaustiveNearest(unsigned int o, const float *obj,
 					     unsigned int guess_c,
 					     double guess_min_dist,
 					     double *ret_min_dist) {
@@ -127,15 +131,7 @@ unsigned int PKMeansThread::ExhaustiveNearest(unsigned int o, float *obj,
     if (c == best_c) continue;
     if (cluster_sizes_[c] == 0) continue;
 
-    float *cluster_means = means_[c];
-    float dist_sq = 0;
-    for (unsigned int d = 0; d < dim_; ++d) {
-      float ov = obj[d];
-      float cm = cluster_means[d];
-      float dim_delta = ov - cm;
-      dist_sq += dim_delta * dim_delta;
-    }
-    float dist = sqrt(dist_sq);
+    float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
     ++dist_count_;
     if (dist < min_dist) {
       best_c = c;
@@ -186,17 +182,11 @@ unsigned int PKMeansThread::GetInitialGuess(unsigned int o) {
 // with ExhaustiveNearest().  Hopefully this doesn't happen too often.  In
 // case (1) we can instead repeat the process we just followed, this time
 // using the neighbors list of the new best candidate.
-unsigned int PKMeansThread::Nearest(unsigned int o, float *obj,
+unsigned int PKMeansThread::Nearest(unsigned int o, const float *obj,
 				    double *ret_min_dist) {
   unsigned int initial_guess = GetInitialGuess(o);
-  float initial_dist = 0;
-  for (unsigned int d = 0; d < dim_; ++d) {
-    float ov = obj[d];
-    float cm = means_[initial_guess][d];
-    float dim_delta = ov - cm;
-    initial_dist += dim_delta * dim_delta;
-  }
-  initial_dist = sqrt(initial_dist);
+  float initial_dist =
+    sqrt(SquaredDistance(obj, means_[initial_guess], dim_));
   ++dist_count_;
   // For testing purposes, if we can just call ExhaustiveNearest() here if
   // we suspect a bug in the optimized code below.
@@ -228,15 +218,7 @@ unsigned int PKMeansThread::Nearest(unsigned int o, float *obj,
 	return best_c;
       }
 
-      float *cluster_means = means_[c];
-      float dist_sq = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	float ov = obj[d];
-	float cm = cluster_means[d];
-	float dim_delta = ov - cm;
-	dist_sq += dim_delta * dim_delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist = sqrt(SquaredDistance(obj, means_[c], dim_));
       ++dist_count_;
       if (dist < min_dist) {
 	best_c = c;
@@ -279,7 +261,7 @@ void PKMeansThread::Assign(void) {
     if (g_it == 0 && thread_index_ == 0 && (o / num_threads_) % 10000 == 0) {
       fprintf(stderr, "It %u o %u/%u\n", g_it, o, num_objects_);
     }
-    float *obj = objects_[o];
+    const float *obj = objects_->Row(o);
     unsigned int nearest = Nearest(o, obj, &dist);
     sum_dists_ += dist;
     if (nearest != assignments_[o]) ++num_changed_;
@@ -310,15 +292,8 @@ void PKMeansThread::ComputeCentroidPivotDistances(void) {
     unsigned int best_p = kMaxUInt;
     float best_pivot_dist = 0;
     for (unsigned int p = 0; p < num_pivots_; ++p) {
-      float *pivot_means = pivot_means_[p];
-      float dist_sq = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	float cm = cluster_means[d];
-	float pm = pivot_means[d];
-	float delta = cm - pm;
-	dist_sq += delta * delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist =
+	sqrt(SquaredDistance(cluster_means, pivot_means_[p], dim_));
       centroid_pivot_distances_[c * num_pivots_ + p] = dist;
       if (best_p == kMaxUInt || dist < best_pivot_dist) {
 	best_p = p;
@@ -354,15 +329,7 @@ void PKMeansThread::ComputeIntraCentroidDistances(void) {
 	continue;
       }
       ++ic_not_pruned;
-      float *cluster_means2 = means_[c2];
-      float dist_sq = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	float cm1 = cluster_means1[d];
-	float cm2 = cluster_means2[d];
-	float delta = cm2 - cm1;
-	dist_sq += delta * delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist = sqrt(SquaredDistance(cluster_means1, means_[c2], dim_));
       if (dist >= neighbor_thresh_) continue;
       neighbor_vectors_[c2].push_back(make_pair(dist, c1));
     }
@@ -434,20 +401,13 @@ void PKMeans::SeedPlusPlus(void) {
   unsigned int o = RandBetween(0, num_objects_ - 1);
   used[o] = true;
   for (unsigned int f = 0; f < dim_; ++f) {
-    means_[0][f] = objects_[o][f];
+    means_[0][f] = objects_->Row(o)[f];
   }
   double *sq_distance_to_nearest = new double[num_objects_];
   for (unsigned int o = 0; o < num_objects_; ++o) {
     if (used[o]) continue;
-    double sq_dist = 0;
-    float *obj = objects_[o];
-    for (unsigned int d = 0; d < dim_; ++d) {
-      double ov = obj[d];
-      double cm = means_[0][d];
-      float dim_delta = ov - cm;
-      sq_dist += dim_delta * dim_delta;
-    }
-    sq_distance_to_nearest[o] = sq_dist;
+    sq_distance_to_nearest[o] =
+      SquaredDistance(objects_->Row(o), means_[0], dim_);
   }
   for (unsigned int c = 1; c < num_clusters_; ++c) {
     if (c % 1000 == 0) {
@@ -468,18 +428,11 @@ void PKMeans::SeedPlusPlus(void) {
     }
     used[o] = true;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = objects_->Row(o)[f];
     }
     for (unsigned int o = 0; o < num_objects_; ++o) {
       if (used[o]) continue;
-      float *obj = objects_[o];
-      double sq_dist = 0;
-      for (unsigned int d = 0; d < dim_; ++d) {
-	double ov = obj[d];
-	double cm = means_[c][d];
-	float dim_delta = ov - cm;
-	sq_dist += dim_delta * dim_delta;
-      }
+      double sq_dist = SquaredDistance(objects_->Row(o), means_[c], dim_);
       if (sq_dist < sq_distance_to_nearest[o]) {
 	sq_distance_to_nearest[o] = sq_dist;
       }
@@ -500,7 +453,7 @@ void PKMeans::Seed1(void) {
     } while (used[o]);
     used[o] = true;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = objects_->Row(o)[f];
     }
   }
   delete [] used;
@@ -517,7 +470,7 @@ void PKMeans::Seed2(void) {
     for (unsigned int i = 0; i < num_sample; ++i) {
       unsigned int o = RandBetween(0, num_objects_ - 1);
       for (unsigned int f = 0; f < dim_; ++f) {
-	sums[f] += objects_[o][f];
+	sums[f] += objects_->Row(o)[f];
       }
     }
     for (unsigned int f = 0; f < dim_; ++f) {
@@ -528,8 +481,9 @@ void PKMeans::Seed2(void) {
 }
 
 // Should I assume dups have been removed?
-void PKMeans::SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
-				   unsigned int num_objects, float **objects) {
+void PKMeans::SingleObjectClusters(const FeatureMatrix *objects) {
+  unsigned int dim = objects->Dim();
+  unsigned int num_objects = objects->NumRows();
   num_clusters_ = num_objects;
   dim_ = dim;
   num_objects_ = num_objects;
@@ -544,7 +498,7 @@ void PKMeans::SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
     unsigned int c = o;
     assignments_[o] = c;
     for (unsigned int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects[o][f];
+      means_[c][f] = objects->Row(o)[f];
     }
     cluster_sizes_[c] = 1;
   }
@@ -553,10 +507,11 @@ void PKMeans::SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
   num_threads_ = 0;
 }
 
-PKMeans::PKMeans(unsigned int num_clusters, unsigned int dim,
-		 unsigned int num_objects, float **objects,
+PKMeans::PKMeans(unsigned int num_clusters, const FeatureMatrix *objects,
 		 double neighbor_thresh, unsigned int num_pivots,
 		 unsigned int num_threads) {
+  unsigned int dim = objects->Dim();
+  unsigned int num_objects = objects->NumRows();
   nearest_centroids_ = NULL;
   neighbor_vectors_ = NULL;
   cluster_sizes_ = NULL;
@@ -565,7 +520,7 @@ PKMeans::PKMeans(unsigned int num_clusters, unsigned int dim,
   threads_ = NULL;
   if (num_clusters >= num_objects) {
     fprintf(stderr, "Assigning every object to its own cluster\n");
-    SingleObjectClusters(num_clusters, dim, num_objects, objects);
+    SingleObjectClusters(objects);
     return;
   }
   num_clusters_ = num_clusters;
@@ -804,7 +759,7 @@ void PKMeans::Update(void) {
     // During initialization we will assign some objects to cluster kMaxUInt
     // meaning they are unassigned
     if (c == kMaxUInt) continue;
-    float *obj = objects_[o];
+    const float *obj = objects_->Row(o);
     for (unsigned int d = 0; d < dim_; ++d) {
       sums[c][d] += obj[d];
     }
@@ -5,20 +5,21 @@
 
 using namespace std;
 
+class FeatureMatrix;
 class PKMeansThread;
 
 class PKMeans {
 public:
-  PKMeans(unsigned int num_clusters, unsigned int dim, unsigned int num_objects,
-	  float **objects, double neighbor_thresh, unsigned int num_pivots,
+  // The caller owns objects.  Each row is one object.
+  PKMeans(unsigned int num_clusters, const FeatureMatrix *objects,
+	  double neighbor_thresh, unsigned int num_pivots,
 	  unsigned int num_threads);
   ~PKMeans(void);
   void Cluster(unsigned int num_its);
   unsigned int Assignment(unsigned int o) const {return assignments_[o];}
   unsigned int NumClusters(void) const {return num_clusters_;}
   unsigned int ClusterSize(unsigned int c) const {return cluster_sizes_[c];}
-  void SingleObjectClusters(unsigned int num_clusters, unsigned int dim,
-			    unsigned int num_objects, float **objects);
+  void SingleObjectClusters(const FeatureMatrix *objects);
 
   static const unsigned int kMaxNeighbors = 10000;
 
@@ -26,7 +27,7 @@ public:
  protected:
   void ComputeCentroidPivotDistances(void);
   void ComputeIntraCentroidDistances(void);
-  unsigned int Nearest(unsigned int o, float *obj) const;
+  unsigned int Nearest(unsigned int o, const float *obj) const;
   unsigned int Assign(double *avg_dist);
   void Update(void);
   void EliminateEmpty(void);
@@ -36,7 +37,7 @@ public:
 
   unsigned int num_objects_;
   unsigned int num_clusters_;
-  float **objects_;
+  const FeatureMatrix *objects_;
   unsigned int dim_;
   double neighbor_thresh_;
   unsigned int *cluster_sizes_;
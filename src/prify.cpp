@@ -10,6 +10,7 @@
 #include <unordered_map>
 
 #include "board_tree.h"
+#include "buckets.h"
 #include "constants.h"
 #include "fast_hash.h"
 #include "files.h"
@@ -46,57 +47,17 @@ int main(int argc, char *argv[]) {
   }
   unsigned int pst = st - 1;
 
-  char buf[500];
-  sprintf(buf, "%s/num_buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, prev_bucketing.c_str(), pst);
-  Reader nb_reader(buf);
-  unsigned long long int prev_num_buckets = nb_reader.ReadUnsignedIntOrDie();
-
   BoardTree::Create();
-  unsigned int prev_num_boards = BoardTree::NumBoards(pst);
+  // Reads either bucket file format
+  Buckets prev_buckets(pst, prev_bucketing);
+  Buckets ir_buckets(st, ir_bucketing);
+  unsigned long long int prev_num_buckets = prev_buckets.NumBuckets(pst);
   unsigned int prev_num_hole_card_pairs = Game::NumHoleCardPairs(pst);
-  unsigned int prev_num_hands = prev_num_boards * prev_num_hole_card_pairs;
-  unsigned int *prev_buckets = new unsigned int[prev_num_hands];
-  sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, prev_bucketing.c_str(), pst);
-  Reader prev_reader(buf);
-  long long int prev_file_size = prev_reader.FileSize();
-  if (prev_file_size == 2 * prev_num_hands) {
-    for (unsigned int h = 0; h < prev_num_hands; ++h) {
-      prev_buckets[h] = prev_reader.ReadUnsignedShortOrDie();
-    }
-  } else if (prev_file_size == 4 * prev_num_hands) {
-    for (unsigned int h = 0; h < prev_num_hands; ++h) {
-      prev_buckets[h] = prev_reader.ReadUnsignedIntOrDie();
-    }
-  } else {
-    fprintf(stderr, "Unexpected file size: %lli\n", prev_file_size);
-    exit(-1);
-  }
 
   unsigned int num_boards = BoardTree::NumBoards(st);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int num_hands = num_boards * num_hole_card_pairs;
 
-  sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  max_street, ir_bucketing.c_str(), st);
-  Reader ir_reader(buf);
-  long long int ir_file_size = ir_reader.FileSize();
-  bool ir_shorts;
-  if (ir_file_size == 2 * (long long int)num_hands) {
-    ir_shorts = true;
-  } else if (ir_file_size == 4 * (long long int)num_hands) {
-    ir_shorts = false;
-  } else {
-    fprintf(stderr, "Unexpected file size B: %lli\n", ir_file_size);
-    fprintf(stderr, "Num hands %u\n", num_hands);
-    fprintf(stderr, "File: %s\n", buf);
-    exit(-1);
-  }
-
   BoardTree::CreateLookup();
   unsigned int *buckets = new unsigned int[num_hands];
   unsigned int num_board_cards = Game::NumBoardCards(st);
@@ -117,15 +78,10 @@ int main(int argc, char *argv[]) {
       for (unsigned int lo = 0; lo < hi; ++lo) {
 	if (InCards(lo, cards + 2, num_board_cards)) continue;
 	cards[1] = lo;
-	unsigned long long int ir_b;
-	if (ir_shorts) {
-	  ir_b = ir_reader.ReadUnsignedShortOrDie();
-	} else {
-	  ir_b = ir_reader.ReadUnsignedIntOrDie();
-	}
+	unsigned long long int ir_b = ir_buckets.Bucket(st, h);
 	unsigned int prev_hcp = HCPIndex(pst, cards);
 	unsigned int prev_h = prev_bd * prev_num_hole_card_pairs + prev_hcp;
-	unsigned long long int prev_b = prev_buckets[prev_h];
+	unsigned long long int prev_b = prev_buckets.Bucket(pst, prev_h);
 	unsigned long long int sparse = ir_b * prev_num_buckets + prev_b;
 	unsigned int b = sad.SparseToDense(sparse);
 	buckets[h] = b;
@@ -137,6 +93,11 @@ int main(int argc, char *argv[]) {
   unsigned int num_buckets = sad.Num();
   bool short_buckets = num_buckets < 65536;
 
+  // A packed file for the new bucketing would take precedence over the one
+  // written here.
+  char buf[500];
+  BucketsFilename(st, new_bucketing, true, buf);
+  remove(buf);
   sprintf(buf, "%s/buckets.%s.%u.%u.%u.%s.%u",
 	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(), new_bucketing.c_str(), st);
@@ -158,6 +119,5 @@ int main(int argc, char *argv[]) {
   writer2.WriteUnsignedInt(num_buckets);
   printf("%u buckets\n", num_buckets);
 
-  delete [] prev_buckets;
   delete [] buckets;
 }
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -58,6 +59,9 @@ RGBR::RGBR(const CardAbstraction &ca, const BettingAbstraction &ba,
 
   if (subgame_street_ <= max_street) {
     hand_tree_ = new HandTree(0, 0, subgame_street_ - 1);
+  } else if (cfr_config_.LazyHandTree()) {
+    hand_tree_ = new HandTree(0, 0, max_street,
+			      cfr_config_.HandTreeMaxBytes());
   } else {
     hand_tree_ = new HandTree(0, 0, max_street);
   }
@@ -170,9 +174,9 @@ double RGBR::Go(unsigned int it, unsigned int p) {
   VCFRState state(opp_probs, street_buckets, hand_tree_, p, regrets_.get(),
 		  sumprobs_.get());
   SetStreetBuckets(0, 0, state);
+  ArenaFrame frame(state.GetArena());
   double *vals = Process(betting_tree_->Root(), 0, state, 0);
   if (subgame_street_ <= max_street) {
-    delete [] vals;
     WaitForFinalSubgames();
     pre_phase_ = false;
     vals = Process(betting_tree_->Root(), 0, state, 0);
@@ -206,7 +210,6 @@ double RGBR::Go(unsigned int it, unsigned int p) {
 #endif
   }
   double overall = sum / (num_hole_card_pairs * num_opp_hole_card_pairs);
-  delete [] vals;
 
   regrets_.reset(nullptr);
   sumprobs_.reset(nullptr);
@@ -5,10 +5,19 @@
 // for the postflop streets we iterate through all raw boards.  For the
 // preflop we iterate through only the canonical boards so I had to worry
 // about this.
+//
+// Boards are divided among threads; thread t handles boards t, t +
+// num_threads, etc.  Each thread allocates its scratch buffers once.  The
+// rollout values for a hand are gathered either into a histogram (when
+// there are many rollouts per hand, as from the flop) or into a small array
+// that gets sorted (as from the turn).  Either way the percentiles are the
+// same as those of the sorted list of values.
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <algorithm>
 #include <vector>
@@ -24,47 +33,195 @@
 
 using namespace std;
 
-static short *RiverHandStrength(const Card *board, bool wins) {
+class RolloutThread {
+public:
+  RolloutThread(unsigned int st, double *percentiles,
+		unsigned int num_percentiles, bool wins, short *pct_vals,
+		unsigned int thread_index, unsigned int num_threads);
+  ~RolloutThread(void);
+  void Go(void);
+  void GoPreflop(void);
+  void RunGo(void);
+  void RunPreflop(void);
+  void Join(void);
+  const unsigned int *PreflopCounts(void) const {return preflop_counts_;}
+private:
+  const short *RiverHandStrength(const Card *board);
+  void Rollout(Card *board, unsigned int st);
+  void BoardPercentiles(const Card *board, short *pct_vals);
+
+  unsigned int st_;
+  double *percentiles_;
+  unsigned int num_percentiles_;
+  // Indices into percentiles_ in increasing order of percentile
+  unsigned int *pct_order_;
+  bool wins_;
+  short *pct_vals_;
+  unsigned int thread_index_;
+  unsigned int num_threads_;
+  unsigned int max_card_;
+  unsigned int num_enc_;
+  // Number of hole card pairs on the max street.  WMLs lie in the range
+  // -max_wml_...max_wml_.
+  unsigned int max_wml_;
+  // Scratch for RiverHandStrength()
+  Card *hole_cards_;
+  unsigned int *hvs_;
+  pair<unsigned int, unsigned int> *v_;
+  short *values_;
+  unsigned int *seen_;
+  unsigned int *beats_;
+  // Scratch for the rollouts.  local_index_ maps a hole card encoding to
+  // the index of the hand on the current board.  The rollout values of
+  // each hand go in hist_ (indexed by WML + max_wml_) if use_hist_ or in
+  // vals_ otherwise.
+  unsigned int num_deals_;
+  bool use_hist_;
+  unsigned int *local_index_;
+  unsigned int *hist_;
+  short *vals_;
+  unsigned int *num_vals_;
+  // For the preflop; counts of each WML for each hole card encoding,
+  // weighted by board count.
+  unsigned int num_wmls_;
+  unsigned int *preflop_counts_;
+  pthread_t pthread_id_;
+};
+
+RolloutThread::RolloutThread(unsigned int st, double *percentiles,
+			     unsigned int num_percentiles, bool wins,
+			     short *pct_vals, unsigned int thread_index,
+			     unsigned int num_threads) {
+  st_ = st;
+  percentiles_ = percentiles;
+  num_percentiles_ = num_percentiles;
+  vector< pair<double, unsigned int> > pct_pairs(num_percentiles);
+  for (unsigned int p = 0; p < num_percentiles; ++p) {
+    pct_pairs[p] = make_pair(percentiles[p], p);
+  }
+  stable_sort(pct_pairs.begin(), pct_pairs.end(), g_pdui_lower_compare);
+  pct_order_ = new unsigned int[num_percentiles];
+  for (unsigned int p = 0; p < num_percentiles; ++p) {
+    pct_order_[p] = pct_pairs[p].second;
+  }
+  wins_ = wins;
+  pct_vals_ = pct_vals;
+  thread_index_ = thread_index;
+  num_threads_ = num_threads;
+  max_card_ = Game::MaxCard();
+  num_enc_ = (max_card_ + 1) * (max_card_ + 1);
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_ms_hcps = Game::NumHoleCardPairs(max_street);
+  max_wml_ = num_ms_hcps;
+  hole_cards_ = new Card[2 * num_ms_hcps];
+  hvs_ = new unsigned int[num_ms_hcps];
+  v_ = new pair<unsigned int, unsigned int>[num_ms_hcps];
+  values_ = new short[num_enc_];
+  seen_ = new unsigned int[max_card_ + 1];
+  beats_ = new unsigned int[num_ms_hcps];
+  local_index_ = NULL;
+  hist_ = NULL;
+  vals_ = NULL;
+  num_vals_ = NULL;
+  preflop_counts_ = NULL;
+  num_wmls_ = 0;
+  if (st_ == 0) {
+    // Num cards left after board cards and hole cards for target player
+    // removed from deck.
+    unsigned int num_remaining = Game::NumCardsInDeck() -
+      Game::NumBoardCards(max_street) - Game::NumCardsForStreet(0);
+    // Assume two hole cards
+    int max_wml = num_remaining * (num_remaining - 1) / 2;
+    num_wmls_ = 2 * max_wml + 1;
+    unsigned long long int num_counts =
+      ((unsigned long long int)num_enc_) * num_wmls_;
+    preflop_counts_ = new unsigned int[num_counts];
+    memset(preflop_counts_, 0, num_counts * sizeof(unsigned int));
+    return;
+  }
+  // The number of boards we deal out from each st_ board.  Must match
+  // Rollout().
+  unsigned int n = Game::NumCardsInDeck() - Game::NumBoardCards(st_);
+  num_deals_ = 1;
+  for (unsigned int st = st_ + 1; st <= max_street; ++st) {
+    unsigned int num_new_board_cards = Game::NumCardsForStreet(st);
+    if (num_new_board_cards == 1) {
+      num_deals_ *= n;
+    } else {
+      num_deals_ *= n * (n - 1) * (n - 2) / 6;
+    }
+    n -= num_new_board_cards;
+  }
+  // A histogram costs a scan of 2 * max_wml_ + 1 counts per hand.  Sorting
+  // costs O(n log n) for n rollouts.
+  unsigned int hist_size = 2 * max_wml_ + 1;
+  use_hist_ = num_deals_ * 8 >= hist_size;
+  unsigned int num_hcps = Game::NumHoleCardPairs(st_);
+  local_index_ = new unsigned int[num_enc_];
+  num_vals_ = new unsigned int[num_hcps];
+  if (use_hist_) {
+    unsigned long long int num_counts =
+      ((unsigned long long int)num_hcps) * hist_size;
+    hist_ = new unsigned int[num_counts];
+    memset(hist_, 0, num_counts * sizeof(unsigned int));
+  } else {
+    vals_ = new short[((unsigned long long int)num_hcps) * num_deals_];
+  }
+}
+
+RolloutThread::~RolloutThread(void) {
+  delete [] preflop_counts_;
+  delete [] num_vals_;
+  delete [] vals_;
+  delete [] hist_;
+  delete [] local_index_;
+  delete [] beats_;
+  delete [] seen_;
+  delete [] values_;
+  delete [] v_;
+  delete [] hvs_;
+  delete [] hole_cards_;
+  delete [] pct_order_;
+}
+
+// Returns values indexed by hole card encoding.  Encodings of hole card
+// pairs that conflict with the board get 32000.  The returned buffer is
+// overwritten by the next call.
+const short *RolloutThread::RiverHandStrength(const Card *board) {
   unsigned int max_street = Game::MaxStreet();
   unsigned int num_board_cards = Game::NumBoardCards(max_street);
 
-  vector<unsigned int> vb(num_board_cards);
-  for (unsigned int i = 0; i < num_board_cards; ++i) vb[i] = board[i];
-  sort(vb.begin(), vb.end());
-  unsigned int *ui_board = new unsigned int[num_board_cards];
-  for (unsigned int i = 0; i < num_board_cards; ++i) {
-    ui_board[(num_board_cards - 1) - i] = vb[i];
-  }
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
-  vector< pair<unsigned int, unsigned int> > v(num_hole_card_pairs);
-  unsigned int max_card = Game::MaxCard();
-  unsigned int hole_cards[2];
+  unsigned int max_card = max_card_;
   unsigned int hcp = 0;
   for (unsigned int hi = 1; hi <= max_card; ++hi) {
     if (InCards(hi, board, num_board_cards)) continue;
-    hole_cards[0] = hi;
     for (unsigned int lo = 0; lo < hi; ++lo) {
       if (InCards(lo, board, num_board_cards)) continue;
-      hole_cards[1] = lo;
-      unsigned int hv = HandValueTree::Val(ui_board, hole_cards);
-      unsigned int enc = hi * (max_card + 1) + lo;
-      v[hcp] = make_pair(hv, enc);
+      hole_cards_[2 * hcp] = hi;
+      hole_cards_[2 * hcp + 1] = lo;
       ++hcp;
     }
   }
-  delete [] ui_board;
-  sort(v.begin(), v.end(), g_puiui_lower_compare);
+  // Evaluate all the hole card pairs for this board in one go
+  HandValueTree::BoardVals(board, hole_cards_, num_hole_card_pairs, hvs_);
+  pair<unsigned int, unsigned int> *v = v_;
+  for (hcp = 0; hcp < num_hole_card_pairs; ++hcp) {
+    unsigned int hi = hole_cards_[2 * hcp];
+    unsigned int lo = hole_cards_[2 * hcp + 1];
+    unsigned int enc = hi * (max_card + 1) + lo;
+    v[hcp] = make_pair(hvs_[hcp], enc);
+  }
+  sort(v, v + num_hole_card_pairs, g_puiui_lower_compare);
 
-  unsigned int num_enc = (max_card + 1) * (max_card + 1);
-  short *values = new short[num_enc];
-  // Necessary?
-  for (unsigned int i = 0; i < num_enc; ++i) values[i] = 32000;
+  short *values = values_;
+  for (unsigned int i = 0; i < num_enc_; ++i) values[i] = 32000;
   unsigned int num_cards_in_deck = Game::NumCardsInDeck();
   // The number of possible hole card pairs containing a given card
   unsigned int num_buddies = (num_cards_in_deck - num_board_cards) - 1;
-  unsigned int *seen = new unsigned int[max_card + 1];
+  unsigned int *seen = seen_;
   for (unsigned int i = 0; i <= max_card; ++i) seen[i] = 0;
-  unsigned int *beats = new unsigned int[num_hole_card_pairs];
+  unsigned int *beats = beats_;
   unsigned int last_hv = kMaxUInt;
   unsigned int j = 0;
   while (j < num_hole_card_pairs) {
@@ -93,7 +250,7 @@ static short *RiverHandStrength(const Card *board, bool wins) {
       ++seen[hi];
       ++seen[lo];
     }
-    if (wins) {
+    if (wins_) {
       for (unsigned int k = begin_range; k < j; ++k) {
 	unsigned int enc = v[k].second;
 	values[enc] = (short)beats[k];
@@ -112,38 +269,205 @@ static short *RiverHandStrength(const Card *board, bool wins) {
 	// beats[k] - lose is the WML
 	short wml = ((short)beats[k]) - lose;
 	values[enc] = wml;
-	// OutputTwoCards(hi, lo);
-	// printf(" %i %i %i %u\n", (int)wml, beats[k], (int)lose, enc);
       }
     }
   }
-  delete [] seen;
-  delete [] beats;
   return values;
 }
 
-static void GetPercentiles(vector<short> &wmls, double *percentiles,
-			   unsigned int num_percentiles,
-			   short *my_percentiles) {
-  sort(wmls.begin(), wmls.end());
-  unsigned int num = wmls.size();
-  for (unsigned int i = 0; i < num_percentiles; ++i) {
-    double percentile = percentiles[i];
-    unsigned int j = percentile * (num - 1) + 0.5;
-    if (j >= num) {
-      fprintf(stderr, "OOB pct %f j %u num %u\n", percentile, j, num);
-      exit(-1);
+// Deals out all boards from the given street to the max street and records
+// the river values of every hand.  Not practical for preflop for full-deck
+// holdem.
+void RolloutThread::Rollout(Card *board, unsigned int st) {
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int max_card = max_card_;
+  if (st == max_street) {
+    const short *wmls = RiverHandStrength(board);
+    unsigned int hist_size = 2 * max_wml_ + 1;
+    for (unsigned int enc = 0; enc < num_enc_; ++enc) {
+      short wml = wmls[enc];
+      if (wml == 32000) continue;
+      unsigned int l = local_index_[enc];
+      if (use_hist_) {
+	++hist_[((unsigned long long int)l) * hist_size + wml + max_wml_];
+	++num_vals_[l];
+      } else {
+	vals_[((unsigned long long int)l) * num_deals_ + num_vals_[l]++] = wml;
+      }
+    }
+    return;
+  }
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  unsigned int nst = st + 1;
+  unsigned int num_new_board_cards = Game::NumCardsForStreet(nst);
+  if (num_new_board_cards == 1) {
+    for (unsigned int c = 0; c <= max_card; ++c) {
+      if (InCards(c, board, num_board_cards)) continue;
+      board[num_board_cards] = c;
+      Rollout(board, nst);
+    }
+  } else if (num_new_board_cards == 3) {
+    unsigned int hi, mid, lo;
+    for (hi = 2; hi <= max_card; ++hi) {
+      if (InCards(hi, board, num_board_cards)) continue;
+      board[num_board_cards] = hi;
+      for (mid = 1; mid < hi; ++mid) {
+	if (InCards(mid, board, num_board_cards)) continue;
+	board[num_board_cards + 1] = mid;
+	for (lo = 0; lo < mid; ++lo) {
+	  board[num_board_cards + 2] = lo;
+	  Rollout(board, nst);
+	}
+      }
+    }
+  } else {
+    fprintf(stderr, "Unhandled number of new board cards: %u\n",
+	    num_new_board_cards);
+    exit(-1);
+  }
+}
+
+// Computes the percentiles of every hand on one st_ board.  Hands are
+// ordered by hole card encoding.  Leaves hist_ zeroed.
+void RolloutThread::BoardPercentiles(const Card *st_board, short *pct_vals) {
+  unsigned int num_board_cards = Game::NumBoardCards(st_);
+  Card board[5];
+  for (unsigned int i = 0; i < num_board_cards; ++i) {
+    board[i] = st_board[i];
+  }
+  unsigned int max_card = max_card_;
+  unsigned int l = 0;
+  for (unsigned int hi = 1; hi <= max_card; ++hi) {
+    bool hi_on_board = InCards(hi, board, num_board_cards);
+    for (unsigned int lo = 0; lo < hi; ++lo) {
+      unsigned int enc = hi * (max_card + 1) + lo;
+      if (hi_on_board || InCards(lo, board, num_board_cards)) {
+	local_index_[enc] = kMaxUInt;
+      } else {
+	num_vals_[l] = 0;
+	local_index_[enc] = l++;
+      }
+    }
+  }
+  unsigned int num_hands = l;
+  Rollout(board, st_);
+
+  unsigned int hist_size = 2 * max_wml_ + 1;
+  for (l = 0; l < num_hands; ++l) {
+    unsigned int num = num_vals_[l];
+    short *my_percentiles = pct_vals + l * num_percentiles_;
+    if (use_hist_) {
+      unsigned int *hist = hist_ + ((unsigned long long int)l) * hist_size;
+      unsigned int q = 0, cum = 0;
+      for (unsigned int w = 0; w < hist_size; ++w) {
+	if (hist[w] == 0) continue;
+	cum += hist[w];
+	hist[w] = 0;
+	// Assign every percentile whose index into the sorted values falls
+	// below cum.  The percentiles are visited in increasing order so that
+	// one pass over the histogram suffices.
+	while (q < num_percentiles_) {
+	  unsigned int p = pct_order_[q];
+	  unsigned int j = percentiles_[p] * (num - 1) + 0.5;
+	  if (j >= num) {
+	    fprintf(stderr, "OOB pct %f j %u num %u\n", percentiles_[p], j,
+		    num);
+	    exit(-1);
+	  }
+	  if (j >= cum) break;
+	  my_percentiles[p] = (short)((int)w - (int)max_wml_);
+	  ++q;
+	}
+      }
+    } else {
+      short *vals = vals_ + ((unsigned long long int)l) * num_deals_;
+      sort(vals, vals + num);
+      for (unsigned int p = 0; p < num_percentiles_; ++p) {
+	double percentile = percentiles_[p];
+	unsigned int j = percentile * (num - 1) + 0.5;
+	if (j >= num) {
+	  fprintf(stderr, "OOB pct %f j %u num %u\n", percentile, j, num);
+	  exit(-1);
+	}
+	my_percentiles[p] = vals[j];
+      }
+    }
+  }
+}
+
+void RolloutThread::Go(void) {
+  unsigned int num_boards = BoardTree::NumBoards(st_);
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st_);
+  for (unsigned int bd = thread_index_; bd < num_boards;
+       bd += num_threads_) {
+    if (thread_index_ == 0 && (bd / num_threads_) % 1000 == 0) {
+      fprintf(stderr, "bd %u/%u\n", bd, num_boards);
     }
-    short wml = wmls[j];
-    my_percentiles[i] = wml;
+    unsigned long long int h =
+      ((unsigned long long int)bd) * num_hole_card_pairs;
+    BoardPercentiles(BoardTree::Board(st_, bd),
+		     pct_vals_ + h * num_percentiles_);
   }
 }
 
+// Accumulates WML counts weighted by board count over max street boards.
+void RolloutThread::GoPreflop(void) {
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_remaining = Game::NumCardsInDeck() -
+    Game::NumBoardCards(max_street) - Game::NumCardsForStreet(0);
+  int max_wml = num_remaining * (num_remaining - 1) / 2;
+  unsigned int num_boards = BoardTree::NumBoards(max_street);
+  for (unsigned int bd = thread_index_; bd < num_boards;
+       bd += num_threads_) {
+    if (thread_index_ == 0 && (bd / num_threads_) % 1000 == 0) {
+      fprintf(stderr, "bd %u/%u\n", bd, num_boards);
+    }
+    const Card *board = BoardTree::Board(max_street, bd);
+    unsigned int board_count = BoardTree::BoardCount(max_street, bd);
+    const short *river_wmls = RiverHandStrength(board);
+    for (unsigned int enc = 0; enc < num_enc_; ++enc) {
+      short wml = river_wmls[enc];
+      if (wml != 32000) {
+	// The raw WML values can be negative.  They range from -990 to 990,
+	// I think, for full-deck holdem.  We normalize them to the range
+	// 0 to 1980.
+	int norm_wml = wml + max_wml;
+	preflop_counts_[((unsigned long long int)enc) * num_wmls_ + norm_wml] +=
+	  board_count;
+      }
+    }
+  }
+}
+
+static void *thread_run(void *v_t) {
+  RolloutThread *t = (RolloutThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void RolloutThread::RunGo(void) {
+  pthread_create(&pthread_id_, NULL, thread_run, this);
+}
+
+static void *thread_run_preflop(void *v_t) {
+  RolloutThread *t = (RolloutThread *)v_t;
+  t->GoPreflop();
+  return NULL;
+}
+
+void RolloutThread::RunPreflop(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_preflop, this);
+}
+
+void RolloutThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
 // We need to pool the WMLs for all the variants of each canonical hand.
 // What about for the flop/turn/river?
 static short *ComputePreflopPercentiles(double *percentiles,
 					unsigned int num_percentiles,
-					bool wins) {
+					bool wins, unsigned int num_threads) {
   BoardTree::BuildBoardCounts();
   unsigned int max_street = Game::MaxStreet();
   unsigned int num_ms_board_cards = Game::NumBoardCards(max_street);
@@ -156,29 +480,27 @@ static short *ComputePreflopPercentiles(double *percentiles,
   int num_wmls = 2 * max_wml + 1;
   unsigned int max_card = Game::MaxCard();
   unsigned int num_enc = (max_card + 1) * (max_card + 1);
+  unique_ptr<RolloutThread *[]> threads(new RolloutThread *[num_threads]);
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    threads[t] = new RolloutThread(0, percentiles, num_percentiles, wins,
+				   NULL, t, num_threads);
+  }
+  for (unsigned int t = 1; t < num_threads; ++t) threads[t]->RunPreflop();
+  // Execute thread 0 in main execution thread
+  threads[0]->GoPreflop();
+  for (unsigned int t = 1; t < num_threads; ++t) threads[t]->Join();
   unsigned int **wml_counts = new unsigned int *[num_enc];
   for (unsigned int enc = 0; enc < num_enc; ++enc) {
     wml_counts[enc] = new unsigned int[num_wmls];
-    for (int w = 0; w < num_wmls; ++w) wml_counts[enc][w] = 0;
-  }
-  unsigned int num_boards = BoardTree::NumBoards(max_street);
-  for (unsigned int bd = 0; bd < num_boards; ++bd) {
-    if (bd % 1000 == 0) fprintf(stderr, "bd %u/%u\n", bd, num_boards);
-    const Card *board = BoardTree::Board(max_street, bd);
-    unsigned int board_count = BoardTree::BoardCount(max_street, bd);
-    short *river_wmls = RiverHandStrength(board, wins);
-    for (unsigned int enc = 0; enc < num_enc; ++enc) {
-      short wml = river_wmls[enc];
-      if (wml != 32000) {
-	// The raw WML values can be negative.  They range from -990 to 990,
-	// I think, for full-deck holdem.  We normalize them to the range
-	// 0 to 1980.
-	int norm_wml = wml + max_wml;
-	wml_counts[enc][norm_wml] += board_count;
+    for (int w = 0; w < num_wmls; ++w) {
+      unsigned int sum = 0;
+      for (unsigned int t = 0; t < num_threads; ++t) {
+	sum += threads[t]->PreflopCounts()[enc * num_wmls + w];
       }
+      wml_counts[enc][w] = sum;
     }
-    delete [] river_wmls;
   }
+  for (unsigned int t = 0; t < num_threads; ++t) delete threads[t];
   CanonicalCards preflop_hands(2, NULL, 0, 0, false);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(0);
   unsigned int num_vals = num_hole_card_pairs * num_percentiles;
@@ -261,105 +583,30 @@ static short *ComputePreflopPercentiles(double *percentiles,
   return pct_vals;
 }
 
-// Not practical for preflop for full-deck holdem.
-static vector<short> *ComputeRollout(Card *board, bool wins, unsigned int st) {
-  unsigned int max_street = Game::MaxStreet();
-  unsigned int max_card = Game::MaxCard();
-  unsigned int num_enc = (max_card + 1) * (max_card + 1);
-  vector<short> *wmls = new vector<short>[num_enc];
-  if (st == max_street) {
-    short *wmls1 = RiverHandStrength(board, wins);
-    for (unsigned int i = 0; i < num_enc; ++i) {
-      short wml = wmls1[i];
-      if (wml != 32000) {
-	wmls[i].push_back(wml);
-      }
-    }
-    delete [] wmls1;
-  } else {
-    unsigned int num_board_cards = Game::NumBoardCards(st);
-    unsigned int nst = st + 1;
-    unsigned int num_new_board_cards = Game::NumCardsForStreet(nst);
-    if (num_new_board_cards == 1) {
-      for (unsigned int c = 0; c <= max_card; ++c) {
-	if (InCards(c, board, num_board_cards)) continue;
-	board[num_board_cards] = c;
-	vector<short> *next_wmls = ComputeRollout(board, wins, nst);
-	for (unsigned int i = 0; i < num_enc; ++i) {
-	  vector<short> &v = next_wmls[i];
-	  unsigned int num = v.size();
-	  for (unsigned int j = 0; j < num; ++j) {
-	    wmls[i].push_back(v[j]);
-	  }
-	}
-	delete [] next_wmls;
-      }
-    } else if (num_new_board_cards == 3) {
-      unsigned int hi, mid, lo;
-      for (hi = 2; hi <= max_card; ++hi) {
-	fprintf(stderr, "hi %u/%u\n", hi, max_card + 1);
-	if (InCards(hi, board, num_board_cards)) continue;
-	board[num_board_cards] = hi;
-	for (mid = 1; mid < hi; ++mid) {
-	  if (InCards(mid, board, num_board_cards)) continue;
-	  board[num_board_cards + 1] = mid;
-	  for (lo = 0; lo < mid; ++lo) {
-	    board[num_board_cards + 2] = lo;
-	    vector<short> *next_wmls = ComputeRollout(board, wins, nst);
-	    for (unsigned int i = 0; i < num_enc; ++i) {
-	      vector<short> &v = next_wmls[i];
-	      unsigned int num = v.size();
-	      for (unsigned int j = 0; j < num; ++j) {
-		wmls[i].push_back(v[j]);
-	      }
-	    }
-	    delete [] next_wmls;
-	  }
-	}
-      }
-    } else {
-      fprintf(stderr, "Unhandled number of new board cards: %u\n",
-	      num_new_board_cards);
-      exit(-1);
-    }
-  }
-  return wmls;
-}
-
 // On turn, deal out all river cards.  Compute WML for all hands.
 short *ComputeRollout(unsigned int st, double *percentiles,
 		      unsigned int num_percentiles,
-		      double squashing, bool wins) {
+		      double squashing, bool wins, unsigned int num_threads) {
   unsigned int num_boards = BoardTree::NumBoards(st);
-  unsigned int num_board_cards = Game::NumBoardCards(st);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int num_hands = num_boards * num_hole_card_pairs;
   unsigned int num_vals = num_hands * num_percentiles;
   short *pct_vals;
   if (st == 0) {
-    pct_vals = ComputePreflopPercentiles(percentiles, num_percentiles, wins);
+    pct_vals = ComputePreflopPercentiles(percentiles, num_percentiles, wins,
+					 num_threads);
   } else {
     pct_vals = new short[num_vals];
-    Card board[5];
-    for (unsigned int bd = 0; bd < num_boards; ++bd) {
-      fprintf(stderr, "bd %u/%u\n", bd, num_boards);
-      const Card *st_board = BoardTree::Board(st, bd);
-      for (unsigned int i = 0; i < num_board_cards; ++i) {
-	board[i] = st_board[i];
-      }
-      unsigned int h = bd * num_hole_card_pairs;
-      vector<short> *wmls = ComputeRollout(board, wins, st);
-      unsigned int max_card = Game::MaxCard();
-      unsigned int num_enc = (max_card + 1) * (max_card + 1);
-      for (unsigned int i = 0; i < num_enc; ++i) {
-	vector<short> &v = wmls[i];
-	if (v.size() == 0) continue;
-	GetPercentiles(v, percentiles, num_percentiles,
-		       &pct_vals[h * num_percentiles]);
-	++h;
-      }
-      delete [] wmls;
+    unique_ptr<RolloutThread *[]> threads(new RolloutThread *[num_threads]);
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      threads[t] = new RolloutThread(st, percentiles, num_percentiles, wins,
+				     pct_vals, t, num_threads);
     }
+    for (unsigned int t = 1; t < num_threads; ++t) threads[t]->RunGo();
+    // Execute thread 0 in main execution thread
+    threads[0]->Go();
+    for (unsigned int t = 1; t < num_threads; ++t) threads[t]->Join();
+    for (unsigned int t = 0; t < num_threads; ++t) delete threads[t];
   }
   if (squashing == 1.0) {
     return pct_vals;
@@ -5,6 +5,6 @@
 
 short *ComputeRollout(unsigned int st, double *percentiles,
 		      unsigned int num_percentiles,
-		      double squashing, bool wins);
+		      double squashing, bool wins, unsigned int num_threads);
 
 #endif
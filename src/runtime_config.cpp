@@ -24,6 +24,8 @@ RuntimeConfig::RuntimeConfig(const Params &params) {
   purify_ = params.GetBooleanValue("Purify");
   sampled_purify_ = params.GetBooleanValue("SampledPurify");
   probs_in_memory_ = params.GetBooleanValue("ProbsInMemory");
+  mmap_probs_ = params.GetBooleanValue("MmapProbs");
+  prefetch_probs_ = params.GetBooleanValue("PrefetchProbs");
   ParseUnsignedInts(params.GetStringValue("BucketMemoryStreets"),
 		    &bucket_memory_streets_);
   respect_pot_frac_ = params.GetBooleanValue("RespectPotFrac");
@@ -85,4 +87,33 @@ RuntimeConfig::RuntimeConfig(const Params &params) {
     params.GetBooleanValue("HardCodedR200R800Strategy");
   nearest_neighbors_ = params.GetBooleanValue("NearestNeighbors");
   nn_disk_ = params.GetBooleanValue("NNDisk");
+  // Number of threads for resolving endgames during a match
+  if (params.IsSet("EndgameThreads")) {
+    endgame_threads_ = params.GetIntValue("EndgameThreads");
+    if (endgame_threads_ == 0) {
+      fprintf(stderr, "EndgameThreads must be positive\n");
+      exit(-1);
+    }
+  } else {
+    endgame_threads_ = 1;
+  }
+  // Time budget for resolving.  Zero for EndgameSecsPerHand means always run
+  // the fixed number of endgame iterations; zero for EndgameMaxSecs means no
+  // cap on a single resolve.
+  endgame_secs_per_hand_ = params.GetDoubleValue("EndgameSecsPerHand");
+  endgame_max_secs_ = params.GetDoubleValue("EndgameMaxSecs");
+  // Maximum number of resolved endgames kept in memory; zero disables the
+  // cache.  If EndgameCacheDir is set, resolved endgames are also written
+  // there and looked up there on a miss in memory.  The directory should be
+  // specific to one set of base and endgame systems.
+  endgame_cache_size_ = params.GetIntValue("EndgameCacheSize");
+  endgame_cache_dir_ = params.GetStringValue("EndgameCacheDir");
+  // Number of likely endgames to solve in the background while the opponent
+  // acts on the street before the endgame street.  Requires the cache.
+  speculative_endgames_ = params.GetIntValue("SpeculativeEndgames");
+  // If positive, endgame solving starts from the base strategy rather than
+  // from zero, with this as the initial regret and sumprob of the base
+  // action for each hand.
+  endgame_warm_start_weight_ =
+    params.GetDoubleValue("EndgameWarmStartWeight");
 }
@@ -24,6 +24,8 @@ class RuntimeConfig {
   bool Purify(void) const {return purify_;}
   bool SampledPurify(void) const {return sampled_purify_;}
   bool ProbsInMemory(void) const {return probs_in_memory_;}
+  bool MmapProbs(void) const {return mmap_probs_;}
+  bool PrefetchProbs(void) const {return prefetch_probs_;}
   const vector<unsigned int> &BucketMemoryStreets(void) const {
     return bucket_memory_streets_;
   }
@@ -75,6 +77,17 @@ class RuntimeConfig {
   }
   bool NearestNeighbors(void) const {return nearest_neighbors_;}
   bool NNDisk(void) const {return nn_disk_;}
+  unsigned int EndgameThreads(void) const {return endgame_threads_;}
+  double EndgameSecsPerHand(void) const {return endgame_secs_per_hand_;}
+  double EndgameMaxSecs(void) const {return endgame_max_secs_;}
+  unsigned int EndgameCacheSize(void) const {return endgame_cache_size_;}
+  const string &EndgameCacheDir(void) const {return endgame_cache_dir_;}
+  unsigned int SpeculativeEndgames(void) const {
+    return speculative_endgames_;
+  }
+  double EndgameWarmStartWeight(void) const {
+    return endgame_warm_start_weight_;
+  }
 
   void SetIteration(unsigned long long int it) {iteration_ = it;}
 
@@ -90,6 +103,8 @@ class RuntimeConfig {
   bool purify_;
   bool sampled_purify_;
   bool probs_in_memory_;
+  bool mmap_probs_;
+  bool prefetch_probs_;
   vector<unsigned int> bucket_memory_streets_;
   bool respect_pot_frac_;
   bool use_supervisor_;
@@ -127,6 +142,13 @@ class RuntimeConfig {
   bool hard_coded_r200r800_strategy_;
   bool nearest_neighbors_;
   bool nn_disk_;
+  unsigned int endgame_threads_;
+  double endgame_secs_per_hand_;
+  double endgame_max_secs_;
+  unsigned int endgame_cache_size_;
+  string endgame_cache_dir_;
+  unsigned int speculative_endgames_;
+  double endgame_warm_start_weight_;
 };
 
 #endif
@@ -20,6 +20,8 @@ unique_ptr<Params> CreateRuntimeParams(void) {
   params->AddParam("Purify", P_BOOLEAN);
   params->AddParam("SampledPurify", P_BOOLEAN);
   params->AddParam("ProbsInMemory", P_BOOLEAN);
+  params->AddParam("MmapProbs", P_BOOLEAN);
+  params->AddParam("PrefetchProbs", P_BOOLEAN);
   params->AddParam("BucketMemoryStreets", P_STRING);
   params->AddParam("RespectPotFrac", P_BOOLEAN);
   params->AddParam("UseSupervisor", P_BOOLEAN);
@@ -58,6 +60,13 @@ unique_ptr<Params> CreateRuntimeParams(void) {
   params->AddParam("HardCodedR200R800Strategy", P_BOOLEAN);
   params->AddParam("NearestNeighbors", P_BOOLEAN);
   params->AddParam("NNDisk", P_BOOLEAN);
+  params->AddParam("EndgameThreads", P_INT);
+  params->AddParam("EndgameSecsPerHand", P_DOUBLE);
+  params->AddParam("EndgameMaxSecs", P_DOUBLE);
+  params->AddParam("EndgameCacheSize", P_INT);
+  params->AddParam("EndgameCacheDir", P_STRING);
+  params->AddParam("SpeculativeEndgames", P_INT);
+  params->AddParam("EndgameWarmStartWeight", P_DOUBLE);
 
   return params;
 }
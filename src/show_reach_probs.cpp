@@ -70,7 +70,8 @@ Processor::Processor(const CardAbstraction &ca, const BettingAbstraction &ba,
 
   unsigned int max_street = Game::MaxStreet();
   fprintf(stderr, "ccc3\n");
-  hand_tree_.reset(new HandTree(0, 0, max_street));
+  // Only a few boards get looked at, so build their hands on demand
+  hand_tree_.reset(new HandTree(0, 0, max_street, 0));
   fprintf(stderr, "ccc4\n");
 }
 
@@ -0,0 +1,48 @@
+#ifndef _SQ_DISTANCE_H_
+#define _SQ_DISTANCE_H_
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Squared Euclidean distance between two float vectors.  Used by KMeans and
+// PKMeans for every object-to-centroid and centroid-to-centroid distance.
+// Callers that only need to compare distances can skip the sqrt.
+static inline float SquaredDistance(const float *v1, const float *v2,
+				    unsigned int dim) {
+  unsigned int d = 0;
+  float dist_sq = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+  if (dim >= 8) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; d + 16 <= dim; d += 16) {
+      __m256 delta0 = _mm256_sub_ps(_mm256_loadu_ps(v1 + d),
+				    _mm256_loadu_ps(v2 + d));
+      __m256 delta1 = _mm256_sub_ps(_mm256_loadu_ps(v1 + d + 8),
+				    _mm256_loadu_ps(v2 + d + 8));
+      acc0 = _mm256_fmadd_ps(delta0, delta0, acc0);
+      acc1 = _mm256_fmadd_ps(delta1, delta1, acc1);
+    }
+    if (d + 8 <= dim) {
+      __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(v1 + d),
+				   _mm256_loadu_ps(v2 + d));
+      acc0 = _mm256_fmadd_ps(delta, delta, acc0);
+      d += 8;
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0),
+			    _mm256_extractf128_ps(acc0, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    dist_sq = _mm_cvtss_f32(sum);
+  }
+#endif
+  for (; d < dim; ++d) {
+    float delta = v1[d] - v2[d];
+    dist_sq += delta * delta;
+  }
+  return dist_sq;
+}
+
+#endif
@@ -6,6 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h> // sleep()
 
 #include <algorithm>
@@ -25,6 +29,7 @@
 #include "hand_value_tree.h"
 #include "io.h"
 #include "nonterminal_ids.h"
+#include "numa_utils.h"
 #include "rand.h"
 #include "regret_compression.h"
 #include "split.h"
@@ -69,6 +74,10 @@ TCFRThread::TCFRThread(const BettingAbstraction &ba, const CFRConfig &cc,
   board_table_ = board_table;
   batch_size_ = batch_size;
   total_its_ = total_its;
+  atomic_updates_ = cfr_config_.AtomicUpdates();
+  regret_snapshot_.reset(new T_REGRET[kMaxSuccs]);
+  sumprob_updates_ = 0ULL;
+  pin_threads_ = cfr_config_.PinThreads();
   
   max_street_ = Game::MaxStreet();
   char_quantized_streets_.reset(new bool[max_street_ + 1]);
@@ -344,6 +353,29 @@ void TCFRThread::NoHVBDealHand(void) {
   }
 }
 
+static const int kCheckpointBufSize = 16 * 1024 * 1024;
+
+// Used in AtomicUpdates mode.  Adds delta to *regret with a relaxed CAS loop,
+// keeping the result within [0, 2000000000] just as the hogwild update does.
+static inline void AtomicAddRegret(T_REGRET *regret, long long int delta) {
+  T_REGRET old_r = __atomic_load_n(regret, __ATOMIC_RELAXED);
+  T_REGRET new_r;
+  do {
+    long long int r = old_r + delta;
+    if (r < 0)                 r = 0;
+    else if (r > 2000000000LL) r = 2000000000LL;
+    new_r = (T_REGRET)r;
+  } while (! __atomic_compare_exchange_n(regret, &old_r, new_r, true,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static inline void AtomicHalve(T_SUM_PROB *sum_prob) {
+  T_SUM_PROB old_sp = __atomic_load_n(sum_prob, __ATOMIC_RELAXED);
+  while (! __atomic_compare_exchange_n(sum_prob, &old_sp, old_sp / 2, true,
+				       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
 static unsigned int PrecedingPlayer(unsigned int p) {
   if (p == 0) return Game::NumPlayers() - 1;
   else        return p - 1;
@@ -353,6 +385,7 @@ static double **g_preflop_vals = nullptr;
 static unsigned long long int **g_preflop_nums = nullptr;
 
 void TCFRThread::Run(void) {
+  if (pin_threads_) PinThread(batch_index_ % num_threads_);
   process_count_ = 0ULL;
   full_process_count_ = 0ULL;
   it_ = 1;
@@ -364,7 +397,8 @@ void TCFRThread::Run(void) {
   }
   
   while (1) {
-    if (*total_its_ >= ((unsigned long long int)batch_size_) * num_threads_) {
+    if (__atomic_load_n(total_its_, __ATOMIC_RELAXED) >=
+	((unsigned long long int)batch_size_) * num_threads_) {
       fprintf(stderr, "Thread %u performed %llu iterations\n",
 	      batch_index_ % num_threads_, it_);
       break;
@@ -474,9 +508,9 @@ void TCFRThread::Run(void) {
       ++*total_its_;
     } else {
       if (it_ % 1000 == 0) {
-	// To reduce the chance of multiple threads trying to update total_its_
-	// at the same time, only update every 1000 iterations.
-	*total_its_ += 1000;
+	// To reduce contention on the cache line holding total_its_, only
+	// update every 1000 iterations.
+	__atomic_add_fetch(total_its_, 1000, __ATOMIC_RELAXED);
       }
     }
   }
@@ -826,11 +860,19 @@ T_VALUE TCFRThread::Process(unsigned char *ptr,
 	    ucr = short_uncompress_[bucket_regrets[s]];
 	  } else {
 	    T_REGRET *bucket_regrets = (T_REGRET *)ptr1;
-	    if (s != fold_succ_index &&
-		bucket_regrets[s] >= pruning_threshold) {
+	    T_REGRET r;
+	    if (atomic_updates_) {
+	      // Remember the value we based our update on so that we can
+	      // apply it as a delta below.
+	      r = __atomic_load_n(&bucket_regrets[s], __ATOMIC_RELAXED);
+	      regret_snapshot_[s] = r;
+	    } else {
+	      r = bucket_regrets[s];
+	    }
+	    if (s != fold_succ_index && r >= pruning_threshold) {
 	      continue;
 	    }
-	    ucr = bucket_regrets[s];
+	    ucr = r;
 	  }
 	  int i_regret;
 	  if (scaled_streets_[st]) {
@@ -861,8 +903,9 @@ T_VALUE TCFRThread::Process(unsigned char *ptr,
 	  if (! char_quantized_streets_[st] &&
 	      ! short_quantized_streets_[st]) {
 	    T_REGRET *bucket_regrets = (T_REGRET *)ptr1;
-	    if (s != fold_succ_index &&
-		bucket_regrets[s] >= pruning_threshold) {
+	    T_REGRET old_r = atomic_updates_ ? regret_snapshot_[s] :
+	      bucket_regrets[s];
+	    if (s != fold_succ_index && old_r >= pruning_threshold) {
 	      continue;
 	    }
 	  }
@@ -883,7 +926,12 @@ T_VALUE TCFRThread::Process(unsigned char *ptr,
 	    // Try capping instead of dividing by two.  Make sure to apply
 	    // cap after adding offset.
 	    if (r > 2000000000) r = 2000000000;
-	    bucket_regrets[s] = r;
+	    if (atomic_updates_) {
+	      AtomicAddRegret(&bucket_regrets[s],
+			      (long long int)r - regret_snapshot_[s]);
+	    } else {
+	      bucket_regrets[s] = r;
+	    }
 	  }
 	}
       }
@@ -963,14 +1011,27 @@ T_VALUE TCFRThread::Process(unsigned char *ptr,
 	    (T_SUM_PROB *)(ptr1 + num_succs * sizeof(T_REGRET));
 	}
 	T_SUM_PROB ceiling = sumprob_ceilings_[st];
-	these_sum_probs[ss] += 1;
-	bool sum_prob_too_extreme = false;
-	if (these_sum_probs[ss] > ceiling) {
-	  sum_prob_too_extreme = true;
-	}
-	if (sum_prob_too_extreme) {
-	  for (unsigned int s = 0; s < num_succs; ++s) {
-	    these_sum_probs[s] /= 2;
+	++sumprob_updates_;
+	if (atomic_updates_) {
+	  T_SUM_PROB sp = __atomic_add_fetch(&these_sum_probs[ss], 1,
+					     __ATOMIC_RELAXED);
+	  // Only the thread that takes the value across the ceiling halves,
+	  // so concurrent updaters don't halve the same bucket twice.
+	  if (sp == ceiling + 1) {
+	    for (unsigned int s = 0; s < num_succs; ++s) {
+	      AtomicHalve(&these_sum_probs[s]);
+	    }
+	  }
+	} else {
+	  these_sum_probs[ss] += 1;
+	  bool sum_prob_too_extreme = false;
+	  if (these_sum_probs[ss] > ceiling) {
+	    sum_prob_too_extreme = true;
+	  }
+	  if (sum_prob_too_extreme) {
+	    for (unsigned int s = 0; s < num_succs; ++s) {
+	      these_sum_probs[s] /= 2;
+	    }
 	  }
 	}
 	T_SUM_PROB *action_sumprobs = nullptr;
@@ -1066,7 +1127,9 @@ void TCFR::WriteCVs(unsigned char *ptr, Node *node, Writer ***writers,
     Writer *writer = writers[pa][st];
     unsigned int num_buckets = buckets_.NumBuckets(st);
     unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
-    if (char_quantized_streets_[st]) {
+    if (writer == NULL) {
+      // This player and street are being written by another thread
+    } else if (char_quantized_streets_[st]) {
       fprintf(stderr, "char_quantized_streets not supported\n");
       exit(-1);
     } else if (short_quantized_streets_[st]) {
@@ -1118,7 +1181,9 @@ void TCFR::ReadCVs(unsigned char *ptr, Node *node, Reader ***readers,
     Reader *reader = readers[pa][st];
     unsigned int num_buckets = buckets_.NumBuckets(st);
     unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
-    if (char_quantized_streets_[st]) {
+    if (reader == NULL) {
+      // This player and street are being read by another thread
+    } else if (char_quantized_streets_[st]) {
       fprintf(stderr, "char_quantized_streets not supported\n");
       exit(-1);
     } else if (short_quantized_streets_[st]) {
@@ -1129,10 +1194,8 @@ void TCFR::ReadCVs(unsigned char *ptr, Node *node, Reader ***readers,
 	int *cvs_and_counts =
 	  (int *)(ptr1 + num_succs * sizeof(T_REGRET) +
 		  num_succs * sizeof(T_SUM_PROB));
-	for (unsigned int s = 0; s < num_succs; ++s) {
-	  cvs_and_counts[2 * s] = reader->ReadIntOrDie();
-	  cvs_and_counts[2 * s + 1] = reader->ReadIntOrDie();
-	}
+	reader->ReadNBytesOrDie(num_succs * 2 * sizeof(int),
+				(unsigned char *)cvs_and_counts);
 	ptr1 += num_succs * sizeof(T_REGRET);
 	if (sumprob_streets_[pa][st]) {
 	  ptr1 += num_succs * sizeof(T_SUM_PROB);
@@ -1163,11 +1226,11 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers,
     Reader *reader = readers[pa][st];
     unsigned int num_buckets = buckets_.NumBuckets(st);
     unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
-    if (char_quantized_streets_[st]) {
+    if (reader == NULL) {
+      // This player and street are being read by another thread
+    } else if (char_quantized_streets_[st]) {
       for (unsigned int b = 0; b < num_buckets; ++b) {
-	for (unsigned int s = 0; s < num_succs; ++s) {
-	  ptr1[s] = reader->ReadUnsignedCharOrDie();
-	}
+	reader->ReadNBytesOrDie(num_succs, ptr1);
 	ptr1 += num_succs;
 	if (sumprob_streets_[pa][st]) {
 	  ptr1 += num_succs * sizeof(T_SUM_PROB);
@@ -1175,10 +1238,7 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers,
       }
     } else if (short_quantized_streets_[st]) {
       for (unsigned int b = 0; b < num_buckets; ++b) {
-	unsigned short *regrets = (unsigned short *)ptr1;
-	for (unsigned int s = 0; s < num_succs; ++s) {
-	  regrets[s] = reader->ReadUnsignedShortOrDie();
-	}
+	reader->ReadNBytesOrDie(num_succs * 2, ptr1);
 	ptr1 += num_succs * 2;
 	if (sumprob_streets_[pa][st]) {
 	  ptr1 += num_succs * sizeof(T_SUM_PROB);
@@ -1186,10 +1246,7 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers,
       }
     } else {
       for (unsigned int b = 0; b < num_buckets; ++b) {
-	T_REGRET *regrets = (T_REGRET *)ptr1;
-	for (unsigned int s = 0; s < num_succs; ++s) {
-	  regrets[s] = reader->ReadUnsignedIntOrDie();
-	}
+	reader->ReadNBytesOrDie(num_succs * sizeof(T_REGRET), ptr1);
 	ptr1 += num_succs * sizeof(T_REGRET);
 	if (sumprob_streets_[pa][st]) {
 	  ptr1 += num_succs * sizeof(T_SUM_PROB);
@@ -1222,7 +1279,9 @@ void TCFR::WriteRegrets(unsigned char *ptr, Node *node, Writer ***writers,
     Writer *writer = writers[pa][st];
     unsigned int num_buckets = buckets_.NumBuckets(st);
     unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
-    if (char_quantized_streets_[st]) {
+    if (writer == NULL) {
+      // This player and street are being written by another thread
+    } else if (char_quantized_streets_[st]) {
       for (unsigned int b = 0; b < num_buckets; ++b) {
 	for (unsigned int s = 0; s < num_succs; ++s) {
 	  writer->WriteUnsignedChar(ptr1[s]);
@@ -1280,49 +1339,26 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers,
     seen[st][pa][nt] = true;
     unsigned int num_buckets = buckets_.NumBuckets(st);
     unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
-    if (sumprob_streets_[pa][st]) {
+    // A NULL reader means this player and street are being read by another
+    // thread.
+    if (sumprob_streets_[pa][st] && readers[pa][st]) {
       Reader *reader = readers[pa][st];
       if (char_quantized_streets_[st]) {
 	for (unsigned int b = 0; b < num_buckets; ++b) {
-	  T_SUM_PROB *sum_probs = (T_SUM_PROB *)(ptr1 + num_succs);
-	  for (unsigned int s = 0; s < num_succs; ++s) {
-	    // Temporary for the case where I am starting to maintain
-	    // sumprobs in the middle of running CFR.
-	    if (reader == nullptr) {
-	      sum_probs[s] = 0;
-	    } else {
-	      sum_probs[s] = reader->ReadUnsignedIntOrDie();
-	    }
-	  }
+	  reader->ReadNBytesOrDie(num_succs * sizeof(T_SUM_PROB),
+				  ptr1 + num_succs);
 	  ptr1 += num_succs * (1 + sizeof(T_SUM_PROB));
 	}
       } else if (short_quantized_streets_[st]) {
 	for (unsigned int b = 0; b < num_buckets; ++b) {
-	  T_SUM_PROB *sum_probs = (T_SUM_PROB *)(ptr1 + num_succs * 2);
-	  for (unsigned int s = 0; s < num_succs; ++s) {
-	    // Temporary for the case where I am starting to maintain
-	    // sumprobs in the middle of running CFR.
-	    if (reader == nullptr) {
-	      sum_probs[s] = 0;
-	    } else {
-	      sum_probs[s] = reader->ReadUnsignedIntOrDie();
-	    }
-	  }
+	  reader->ReadNBytesOrDie(num_succs * sizeof(T_SUM_PROB),
+				  ptr1 + num_succs * 2);
 	  ptr1 += num_succs * (2 + sizeof(T_SUM_PROB));
 	}
       } else {
 	for (unsigned int b = 0; b < num_buckets; ++b) {
-	  T_SUM_PROB *sumprobs =
-	    (T_SUM_PROB *)(ptr1 + num_succs * sizeof(T_REGRET));
-	  for (unsigned int s = 0; s < num_succs; ++s) {
-	    // Temporary for the case where I am starting to maintain
-	    // sumprobs in the middle of running CFR.
-	    if (reader == nullptr) {
-	      sumprobs[s] = 0;
-	    } else {
-	      sumprobs[s] = reader->ReadUnsignedIntOrDie();
-	    }
-	  }
+	  reader->ReadNBytesOrDie(num_succs * sizeof(T_SUM_PROB),
+				  ptr1 + num_succs * sizeof(T_REGRET));
 	  ptr1 += num_succs * (sizeof(T_REGRET) + sizeof(T_SUM_PROB));
 	  if (maintain_cvs_) {
 	    ptr1 += num_succs * 2 * sizeof(int);
@@ -1391,7 +1427,7 @@ void TCFR::WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers,
     unsigned int nt = node->NonterminalID();
     if (seen[st][pa][nt]) return;
     seen[st][pa][nt] = true;
-    if (sumprob_streets_[pa][st]) {
+    if (sumprob_streets_[pa][st] && writers[pa][st]) {
       Writer *writer = writers[pa][st];
       unsigned int num_buckets = buckets_.NumBuckets(st);
       unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
@@ -1433,50 +1469,51 @@ void TCFR::WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers,
   }
 }
 
-void TCFR::Read(unsigned int batch_base) {
-  char dir[500], buf[500];
-  sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::OldCFRBase(),
-	  Game::GameName().c_str(), Game::NumPlayers(),
-	  card_abstraction_.CardAbstractionName().c_str(), Game::NumRanks(),
-	  Game::NumSuits(), Game::MaxStreet(), 
-	  betting_abstraction_.BettingAbstractionName().c_str(),
-	  cfr_config_.CFRConfigName().c_str());
-  if (asymmetric_) {
-    char buf2[20];
-    sprintf(buf2, ".p%u", target_player_);
-    strcat(dir, buf2);
-  }
-  unsigned int num_players = Game::NumPlayers();
-  Reader ***regret_readers = new Reader **[num_players];
-  for (unsigned int p = 0; p < num_players; ++p) {
-    regret_readers[p] = new Reader *[max_street_ + 1];
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      char suffix;
+void TCFR::SumSumprobs(unsigned char *ptr, Node *node, bool ***seen,
+			unsigned long long int *total) {
+  unsigned char first_byte = ptr[0];
+  // Terminal node
+  if (first_byte != 0) return;
+  unsigned int num_succs = ptr[2];
+  if (num_succs > 1) {
+    unsigned int pa = ptr[5];
+    unsigned int st = ptr[1];
+    unsigned int nt = node->NonterminalID();
+    if (seen[st][pa][nt]) return;
+    seen[st][pa][nt] = true;
+    if (sumprob_streets_[pa][st]) {
+      unsigned int num_buckets = buckets_.NumBuckets(st);
+      unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+      unsigned int regret_size, size_bucket_data;
       if (char_quantized_streets_[st]) {
-	suffix = 'c';
+	regret_size = 1;
+	size_bucket_data = num_succs * (1 + sizeof(T_SUM_PROB));
       } else if (short_quantized_streets_[st]) {
-	suffix = 's';
+	regret_size = 2;
+	size_bucket_data = num_succs * (2 + sizeof(T_SUM_PROB));
       } else {
-	suffix = 'i';
+	regret_size = sizeof(T_REGRET);
+	size_bucket_data = num_succs * (sizeof(T_REGRET) + sizeof(T_SUM_PROB));
+	if (maintain_cvs_) size_bucket_data += num_succs * 2 * sizeof(int);
       }
-      sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir,
-	      st, batch_base, p, suffix);
-      regret_readers[p][st] = new Reader(buf);
-    }
-  }
-  Reader ***sum_prob_readers = new Reader **[num_players];
-  for (unsigned int p = 0; p < num_players; ++p) {
-    sum_prob_readers[p] = new Reader *[max_street_ + 1];
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      if (! sumprob_streets_[p][st]) {
-	sum_prob_readers[p][st] = NULL;
-	continue;
+      for (unsigned int b = 0; b < num_buckets; ++b) {
+	T_SUM_PROB *sum_probs = (T_SUM_PROB *)(ptr1 + num_succs * regret_size);
+	for (unsigned int s = 0; s < num_succs; ++s) {
+	  *total += sum_probs[s];
+	}
+	ptr1 += size_bucket_data;
       }
-      sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir,
-	      st, batch_base, p);
-      sum_prob_readers[p][st] = new Reader(buf);
     }
   }
+  for (unsigned int s = 0; s < num_succs; ++s) {
+    unsigned long long int succ_offset =
+      *((unsigned long long int *)(SUCCPTR(ptr) + s * 8));
+    SumSumprobs(data_ + succ_offset, node->IthSucc(s), seen, total);
+  }
+}
+
+unsigned long long int TCFR::SumprobTotal(void) {
+  unsigned int num_players = Game::NumPlayers();
   bool ***seen = new bool **[max_street_ + 1];
   for (unsigned int st = 0; st <= max_street_; ++st) {
     seen[st] = new bool *[num_players];
@@ -1488,47 +1525,48 @@ void TCFR::Read(unsigned int batch_base) {
       }
     }
   }
-  ReadRegrets(data_, betting_tree_->Root(), regret_readers, seen);
+  unsigned long long int total = 0ULL;
+  SumSumprobs(data_, betting_tree_->Root(), seen, &total);
   for (unsigned int st = 0; st <= max_street_; ++st) {
+    for (unsigned int p = 0; p < num_players; ++p) {
+      delete [] seen[st][p];
+    }
+    delete [] seen[st];
+  }
+  delete [] seen;
+  return total;
+}
+
+bool ***TCFR::NewSeen(void) const {
+  unsigned int num_players = Game::NumPlayers();
+  bool ***seen = new bool **[max_street_ + 1];
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    seen[st] = new bool *[num_players];
     for (unsigned int p = 0; p < num_players; ++p) {
       unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
+      seen[st][p] = new bool[num_nt];
       for (unsigned int i = 0; i < num_nt; ++i) {
 	seen[st][p][i] = false;
       }
     }
   }
-  ReadSumprobs(data_, betting_tree_->Root(), sum_prob_readers, seen);
-  if (maintain_cvs_) {
-    Reader ***cv_readers = new Reader **[num_players];
+  return seen;
+}
+
+void TCFR::ClearSeen(bool ***seen) const {
+  unsigned int num_players = Game::NumPlayers();
+  for (unsigned int st = 0; st <= max_street_; ++st) {
     for (unsigned int p = 0; p < num_players; ++p) {
-      cv_readers[p] = new Reader *[max_street_ + 1];
-      for (unsigned int st = 0; st <= max_street_; ++st) {
-	sprintf(buf, "%s/cvs.x.0.0.%u.%u.p%u.i", dir,
-		st, batch_base, p);
-	cv_readers[p][st] = new Reader(buf);
-      }
-    }
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      for (unsigned int p = 0; p < num_players; ++p) {
-	unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
-	for (unsigned int i = 0; i < num_nt; ++i) {
-	  seen[st][p][i] = false;
-	}
-      }
-    }
-    ReadCVs(data_, betting_tree_->Root(), cv_readers, seen);
-    for (unsigned int p = 0; p <= 1; ++p) {
-      for (unsigned int st = 0; st <= max_street_; ++st) {
-	if (! cv_readers[p][st]->AtEnd()) {
-	  fprintf(stderr, "CV reader didn't get to EOF\n");
-	  exit(-1);
-	}
-	delete cv_readers[p][st];
+      unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
+      for (unsigned int i = 0; i < num_nt; ++i) {
+	seen[st][p][i] = false;
       }
-      delete [] cv_readers[p];
     }
-    delete [] cv_readers;
   }
+}
+
+void TCFR::DeleteSeen(bool ***seen) const {
+  unsigned int num_players = Game::NumPlayers();
   for (unsigned int st = 0; st <= max_street_; ++st) {
     for (unsigned int p = 0; p < num_players; ++p) {
       delete [] seen[st][p];
@@ -1536,148 +1574,294 @@ void TCFR::Read(unsigned int batch_base) {
     delete [] seen[st];
   }
   delete [] seen;
-  for (unsigned int p = 0; p <= 1; ++p) {
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      if (! regret_readers[p][st]->AtEnd()) {
-	fprintf(stderr, "Regret reader didn't get to EOF\n");
-	exit(-1);
-      }
-      delete regret_readers[p][st];
+}
+
+// Reads the regret, sumprob and CV files for one player and street.  Like
+// WritePlayerStreet(), each pass walks the whole tree but only reads the
+// nodes belonging to p and st.
+void TCFR::ReadPlayerStreet(const char *dir, unsigned int batch_base,
+			    unsigned int p, unsigned int st) {
+  char buf[500];
+  unsigned int num_players = Game::NumPlayers();
+  Reader ***readers = new Reader **[num_players];
+  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
+    readers[p1] = new Reader *[max_street_ + 1];
+    for (unsigned int st1 = 0; st1 <= max_street_; ++st1) {
+      readers[p1][st1] = NULL;
     }
-    delete [] regret_readers[p];
   }
-  delete [] regret_readers;
-  for (unsigned int p = 0; p <= 1; ++p) {
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      if (! sumprob_streets_[p][st]) continue;
-      if (sum_prob_readers[p][st] && ! sum_prob_readers[p][st]->AtEnd()) {
-	fprintf(stderr, "Sumprob reader didn't get to EOF\n");
-	exit(-1);
-      }
-      delete sum_prob_readers[p][st];
+  bool ***seen = NewSeen();
+
+  char suffix;
+  if (char_quantized_streets_[st]) {
+    suffix = 'c';
+  } else if (short_quantized_streets_[st]) {
+    suffix = 's';
+  } else {
+    suffix = 'i';
+  }
+  sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir, st, batch_base, p,
+	  suffix);
+  readers[p][st] = new Reader(buf);
+  ReadRegrets(data_, betting_tree_->Root(), readers, seen);
+  if (! readers[p][st]->AtEnd()) {
+    fprintf(stderr, "Regret reader didn't get to EOF\n");
+    exit(-1);
+  }
+  delete readers[p][st];
+  readers[p][st] = NULL;
+
+  if (sumprob_streets_[p][st]) {
+    ClearSeen(seen);
+    sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_base, p);
+    readers[p][st] = new Reader(buf);
+    ReadSumprobs(data_, betting_tree_->Root(), readers, seen);
+    if (! readers[p][st]->AtEnd()) {
+      fprintf(stderr, "Sumprob reader didn't get to EOF\n");
+      exit(-1);
+    }
+    delete readers[p][st];
+    readers[p][st] = NULL;
+  }
+
+  if (maintain_cvs_) {
+    ClearSeen(seen);
+    sprintf(buf, "%s/cvs.x.0.0.%u.%u.p%u.i", dir, st, batch_base, p);
+    readers[p][st] = new Reader(buf);
+    ReadCVs(data_, betting_tree_->Root(), readers, seen);
+    if (! readers[p][st]->AtEnd()) {
+      fprintf(stderr, "CV reader didn't get to EOF\n");
+      exit(-1);
     }
-    delete [] sum_prob_readers[p];
+    delete readers[p][st];
+    readers[p][st] = NULL;
   }
-  delete [] sum_prob_readers;
+
+  DeleteSeen(seen);
+  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
+    delete [] readers[p1];
+  }
+  delete [] readers;
 }
 
-void TCFR::Write(unsigned int batch_base) {
-  char dir[500], buf[500];
-  sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::NewCFRBase(),
+struct TCFRReadArgs {
+  TCFR *tcfr;
+  const char *dir;
+  unsigned int batch_base;
+  unsigned int *next_task;
+};
+
+void *TCFR::ReadThread(void *v_args) {
+  TCFRReadArgs *args = (TCFRReadArgs *)v_args;
+  TCFR *tcfr = args->tcfr;
+  unsigned int num_streets = tcfr->max_street_ + 1;
+  unsigned int num_tasks = Game::NumPlayers() * num_streets;
+  while (true) {
+    unsigned int task = __atomic_fetch_add(args->next_task, 1,
+					   __ATOMIC_RELAXED);
+    if (task >= num_tasks) break;
+    tcfr->ReadPlayerStreet(args->dir, args->batch_base, task / num_streets,
+			   task % num_streets);
+  }
+  return NULL;
+}
+
+// The files for each player and street are read in parallel, using up to
+// one thread per CFR thread.  Each player and street owns disjoint regions
+// of data_, so the readers never touch the same bytes.
+void TCFR::Read(unsigned int batch_base) {
+  char dir[500];
+  sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::OldCFRBase(),
 	  Game::GameName().c_str(), Game::NumPlayers(),
 	  card_abstraction_.CardAbstractionName().c_str(), Game::NumRanks(),
-	  Game::NumSuits(), Game::MaxStreet(),
-	  betting_abstraction_.BettingAbstractionName().c_str(), 
+	  Game::NumSuits(), Game::MaxStreet(), 
+	  betting_abstraction_.BettingAbstractionName().c_str(),
 	  cfr_config_.CFRConfigName().c_str());
   if (asymmetric_) {
     char buf2[20];
     sprintf(buf2, ".p%u", target_player_);
     strcat(dir, buf2);
   }
-  Mkdir(dir);
-  unsigned int num_players = Game::NumPlayers();
-  Writer ***regret_writers = new Writer **[num_players];
-  for (unsigned int p = 0; p < num_players; ++p) {
-    regret_writers[p] = new Writer *[max_street_ + 1];
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      char suffix;
-      if (char_quantized_streets_[st]) {
-	suffix = 'c';
-      } else if (short_quantized_streets_[st]) {
-	suffix = 's';
-      } else {
-	suffix = 'i';
-      }
-      sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir,
-	      st, batch_base, p, suffix);
-      regret_writers[p][st] = new Writer(buf);
-    }
+
+  unsigned int num_tasks = Game::NumPlayers() * (max_street_ + 1);
+  unsigned int num_threads = num_cfr_threads_;
+  if (num_threads > num_tasks) num_threads = num_tasks;
+  unsigned int next_task = 0;
+  TCFRReadArgs args;
+  args.tcfr = this;
+  args.dir = dir;
+  args.batch_base = batch_base;
+  args.next_task = &next_task;
+  unique_ptr<pthread_t []> pthread_ids(new pthread_t[num_threads]);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    pthread_create(&pthread_ids[i], NULL, ReadThread, &args);
   }
-  bool ***seen = new bool **[max_street_ + 1];
-  for (unsigned int st = 0; st <= max_street_; ++st) {
-    seen[st] = new bool *[num_players];
-    for (unsigned int p = 0; p < num_players; ++p) {
-      unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
-      seen[st][p] = new bool[num_nt];
-      for (unsigned int i = 0; i < num_nt; ++i) {
-	seen[st][p][i] = false;
-      }
-    }
+  ReadThread(&args);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    pthread_join(pthread_ids[i], NULL);
   }
-  WriteRegrets(data_, betting_tree_->Root(), regret_writers, seen);
-  for (unsigned int p = 0; p < num_players; ++p) {
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      delete regret_writers[p][st];
+}
+
+// Writes the regret, sumprob and CV files for one player and street.  Each
+// of these walks the whole tree but only writes the nodes belonging to p and
+// st.
+void TCFR::WritePlayerStreet(const char *dir, unsigned int batch_base,
+			     unsigned int p, unsigned int st) {
+  char buf[500];
+  unsigned int num_players = Game::NumPlayers();
+  Writer ***writers = new Writer **[num_players];
+  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
+    writers[p1] = new Writer *[max_street_ + 1];
+    for (unsigned int st1 = 0; st1 <= max_street_; ++st1) {
+      writers[p1][st1] = NULL;
     }
-    delete [] regret_writers[p];
   }
-  delete [] regret_writers;
+  bool ***seen = NewSeen();
 
-  Writer ***sum_prob_writers = new Writer **[num_players];
-  for (unsigned int p = 0; p < num_players; ++p) {
-    sum_prob_writers[p] = new Writer *[max_street_ + 1];
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      if (! sumprob_streets_[p][st]) {
-	sum_prob_writers[p][st] = NULL;
-	continue;
-      }
-      sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir,
-	      st, batch_base, p);
-      sum_prob_writers[p][st] = new Writer(buf);
-    }
+  char suffix;
+  if (char_quantized_streets_[st]) {
+    suffix = 'c';
+  } else if (short_quantized_streets_[st]) {
+    suffix = 's';
+  } else {
+    suffix = 'i';
   }
-  for (unsigned int st = 0; st <= max_street_; ++st) {
-    for (unsigned int p = 0; p < num_players; ++p) {
-      unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
-      for (unsigned int i = 0; i < num_nt; ++i) {
-	seen[st][p][i] = false;
-      }
-    }
+  sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir, st, batch_base, p,
+	  suffix);
+  writers[p][st] = new Writer(buf, kCheckpointBufSize);
+  WriteRegrets(data_, betting_tree_->Root(), writers, seen);
+  delete writers[p][st];
+  writers[p][st] = NULL;
+
+  if (sumprob_streets_[p][st]) {
+    ClearSeen(seen);
+    sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_base, p);
+    writers[p][st] = new Writer(buf, kCheckpointBufSize);
+    WriteSumprobs(data_, betting_tree_->Root(), writers, seen);
+    delete writers[p][st];
+    writers[p][st] = NULL;
   }
-  WriteSumprobs(data_, betting_tree_->Root(), sum_prob_writers, seen);
+
   if (maintain_cvs_) {
-    fprintf(stderr, "Getting ready to write CVs\n");
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      for (unsigned int p = 0; p < num_players; ++p) {
-	unsigned int num_nt = betting_tree_->NumNonterminals(p, st);
-	for (unsigned int i = 0; i < num_nt; ++i) {
-	  seen[st][p][i] = false;
-	}
-      }
-    }
-    Writer ***cv_writers = new Writer **[num_players];
-    for (unsigned int p = 0; p < num_players; ++p) {
-      cv_writers[p] = new Writer *[max_street_ + 1];
-      for (unsigned int st = 0; st <= max_street_; ++st) {
-	sprintf(buf, "%s/cvs.x.0.0.%u.%u.p%u.i", dir,
-		st, batch_base, p);
-	cv_writers[p][st] = new Writer(buf);
-      }
-    }
-    WriteCVs(data_, betting_tree_->Root(), cv_writers, seen);
-    for (unsigned int p = 0; p < num_players; ++p) {
-      for (unsigned int st = 0; st <= max_street_; ++st) {
-	delete cv_writers[p][st];
-      }
-      delete [] cv_writers[p];
-    }
-    delete [] cv_writers;
+    ClearSeen(seen);
+    sprintf(buf, "%s/cvs.x.0.0.%u.%u.p%u.i", dir, st, batch_base, p);
+    writers[p][st] = new Writer(buf, kCheckpointBufSize);
+    WriteCVs(data_, betting_tree_->Root(), writers, seen);
+    delete writers[p][st];
+    writers[p][st] = NULL;
   }
-  for (unsigned int st = 0; st <= max_street_; ++st) {
-    for (unsigned int p = 0; p < num_players; ++p) {
-      delete [] seen[st][p];
-    }
-    delete [] seen[st];
+
+  DeleteSeen(seen);
+  for (unsigned int p1 = 0; p1 < num_players; ++p1) {
+    delete [] writers[p1];
   }
-  delete [] seen;
-  for (unsigned int p = 0; p < num_players; ++p) {
-    for (unsigned int st = 0; st <= max_street_; ++st) {
-      if (! sumprob_streets_[p][st]) continue;
-      delete sum_prob_writers[p][st];
-    }
-    delete [] sum_prob_writers[p];
+  delete [] writers;
+}
+
+struct TCFRWriteArgs {
+  TCFR *tcfr;
+  const char *dir;
+  unsigned int batch_base;
+  unsigned int *next_task;
+};
+
+void *TCFR::WriteThread(void *v_args) {
+  TCFRWriteArgs *args = (TCFRWriteArgs *)v_args;
+  TCFR *tcfr = args->tcfr;
+  unsigned int num_streets = tcfr->max_street_ + 1;
+  unsigned int num_tasks = Game::NumPlayers() * num_streets;
+  while (true) {
+    unsigned int task = __atomic_fetch_add(args->next_task, 1,
+					   __ATOMIC_RELAXED);
+    if (task >= num_tasks) break;
+    tcfr->WritePlayerStreet(args->dir, args->batch_base, task / num_streets,
+			    task % num_streets);
+  }
+  return NULL;
+}
+
+// The files for each player and street are written in parallel, using up
+// to one thread per CFR thread.
+void TCFR::Write(unsigned int batch_base) {
+  char dir[500];
+  sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::NewCFRBase(),
+	  Game::GameName().c_str(), Game::NumPlayers(),
+	  card_abstraction_.CardAbstractionName().c_str(), Game::NumRanks(),
+	  Game::NumSuits(), Game::MaxStreet(),
+	  betting_abstraction_.BettingAbstractionName().c_str(), 
+	  cfr_config_.CFRConfigName().c_str());
+  if (asymmetric_) {
+    char buf2[20];
+    sprintf(buf2, ".p%u", target_player_);
+    strcat(dir, buf2);
+  }
+  Mkdir(dir);
+  if (maintain_cvs_) fprintf(stderr, "Getting ready to write CVs\n");
+
+  unsigned int num_tasks = Game::NumPlayers() * (max_street_ + 1);
+  unsigned int num_threads = num_cfr_threads_;
+  if (num_threads > num_tasks) num_threads = num_tasks;
+  unsigned int next_task = 0;
+  TCFRWriteArgs args;
+  args.tcfr = this;
+  args.dir = dir;
+  args.batch_base = batch_base;
+  args.next_task = &next_task;
+  unique_ptr<pthread_t []> pthread_ids(new pthread_t[num_threads]);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    pthread_create(&pthread_ids[i], NULL, WriteThread, &args);
+  }
+  WriteThread(&args);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    pthread_join(pthread_ids[i], NULL);
+  }
+}
+
+// Writes a checkpoint.  With BackgroundCheckpoints, we fork and let the
+// child write out a copy-on-write snapshot of data_ while the parent carries
+// on training.  This is safe because all CFR threads have been joined at
+// this point, so the parent is single-threaded when it forks.  Only one
+// checkpoint is in flight at a time.  Note that pages the parent modifies
+// while the child is writing get copied, so in the worst case memory usage
+// doubles.
+void TCFR::Checkpoint(unsigned int batch_base) {
+  if (! background_checkpoints_) {
+    Write(batch_base);
+    fprintf(stderr, "Checkpointed batch base %u\n", batch_base);
+    return;
+  }
+  WaitForCheckpoint();
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid < 0) {
+    fprintf(stderr, "fork() failed; checkpointing in the foreground\n");
+    Write(batch_base);
+    fprintf(stderr, "Checkpointed batch base %u\n", batch_base);
+    return;
+  }
+  if (pid == 0) {
+    Write(batch_base);
+    fprintf(stderr, "Background checkpoint of batch base %u done\n",
+	    batch_base);
+    _exit(0);
   }
-  delete [] sum_prob_writers;
+  fprintf(stderr, "Checkpointing batch base %u in the background\n",
+	  batch_base);
+  checkpoint_pid_ = pid;
+  checkpoint_batch_base_ = batch_base;
+}
+
+void TCFR::WaitForCheckpoint(void) {
+  if (checkpoint_pid_ <= 0) return;
+  int status;
+  if (waitpid(checkpoint_pid_, &status, 0) < 0 || ! WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "Background checkpoint of batch base %u failed\n",
+	    checkpoint_batch_base_);
+    exit(-1);
+  }
+  checkpoint_pid_ = 0;
 }
 
 void TCFR::Run(void) {
@@ -1701,7 +1885,9 @@ void TCFR::Run(void) {
   }
   // Execute thread 0 in main execution thread
   fprintf(stderr, "Starting thread 0 in main thread\n");
+  if (pin_threads_) SaveThreadAffinity();
   cfr_threads_[0]->Run();
+  if (pin_threads_) RestoreThreadAffinity();
   fprintf(stderr, "Finished main thread\n");
   for (unsigned int i = 1; i < num_cfr_threads_; ++i) {
     cfr_threads_[i]->Join();
@@ -1764,7 +1950,10 @@ void TCFR::RunBatch(unsigned int batch_size) {
   }
 
   fprintf(stderr, "Running batch base %i\n", batch_base_);
+  timeval start_tv, end_tv;
+  gettimeofday(&start_tv, NULL);
   Run();
+  gettimeofday(&end_tv, NULL);
   fprintf(stderr, "Finished running batch base %i\n", batch_base_);
 
   for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
@@ -1773,6 +1962,29 @@ void TCFR::RunBatch(unsigned int batch_size) {
   for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
     total_full_process_count_ += cfr_threads_[i]->FullProcessCount();
   }
+  unsigned long long int batch_its = 0ULL;
+  for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
+    total_sumprob_updates_ += cfr_threads_[i]->SumprobUpdates();
+    batch_its += cfr_threads_[i]->Iterations();
+  }
+  total_iterations_ += batch_its;
+  double secs = (end_tv.tv_sec - start_tv.tv_sec) +
+    (end_tv.tv_usec - start_tv.tv_usec) / 1000000.0;
+  fprintf(stderr, "Batch base %i: %llu its in %.2f secs (%.0f its/sec)\n",
+	  batch_base_, batch_its, secs, secs > 0 ? batch_its / secs : 0);
+  if (pin_threads_) {
+    unsigned int num_nodes = NumNUMANodes();
+    for (unsigned int n = 0; n < num_nodes; ++n) {
+      unsigned long long int node_its = 0ULL;
+      for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
+	if (NUMANodeForThread(i) == n) {
+	  node_its += cfr_threads_[i]->Iterations();
+	}
+      }
+      fprintf(stderr, "  Node %u: %llu its (%.0f its/sec)\n", n, node_its,
+	      secs > 0 ? node_its / secs : 0);
+    }
+  }
 
   for (unsigned int i = 0; i < num_cfr_threads_; ++i) {
     delete cfr_threads_[i];
@@ -1810,13 +2022,12 @@ void TCFR::Run(unsigned int start_batch_base, unsigned int batch_size,
     // at batches 800, 1600, etc., but not at batch 0 even though 0 % 800 == 0.
     // But if our save interval is 8 (and we have eight threads), then we
     // do want to save at batch 0.
-    if (batch_base_ % save_interval == 0 &&
+    if (checkpoints_ && batch_base_ % save_interval == 0 &&
 	(batch_base_ > 0 || save_interval == num_cfr_threads_)) {
       fprintf(stderr, "Process count: %llu\n", total_process_count_);
       fprintf(stderr, "Full process count: %llu\n", total_full_process_count_);
       time_t start_t = time(NULL);
-      Write(batch_base_);
-      fprintf(stderr, "Checkpointed batch base %u\n", batch_base_);
+      Checkpoint(batch_base_);
       time_t end_t = time(NULL);
       double diff_sec = difftime(end_t, start_t);
       fprintf(stderr, "Writing took %.1f seconds\n", diff_sec);
@@ -1861,16 +2072,16 @@ void TCFR::Run(unsigned int start_batch_base, unsigned int end_batch_base,
     // at batches 800, 1600, etc., but not at batch 0 even though 0 % 800 == 0.
     // But if our save interval is 8 (and we have eight threads), then we
     // do want to save at batch 0.
-    if (batch_base_ % save_interval == 0 &&
+    if (checkpoints_ && batch_base_ % save_interval == 0 &&
 	(batch_base_ > 0 || save_interval == num_cfr_threads_)) {
       fprintf(stderr, "Process count: %llu\n", total_process_count_);
       fprintf(stderr, "Full process count: %llu\n", total_full_process_count_);
-      Write(batch_base_);
-      fprintf(stderr, "Checkpointed batch base %u\n", batch_base_);
+      Checkpoint(batch_base_);
       total_process_count_ = 0ULL;
       total_full_process_count_ = 0ULL;
     }
   }
+  WaitForCheckpoint();
 }
 
 // Returns a pointer to the allocation buffer after this node and all of its
@@ -1893,6 +2104,8 @@ void TCFR::Run(unsigned int start_batch_base, unsigned int end_batch_base,
 //   num-succs * sizeof(T_SUM_PROB) for the sum-probs
 //   If maintain_cvs_: num_succs * 2 * sizeof(int)
 // If boost_: num_succs * sizeof(T_SUM_PROB) for the action-sum-probs
+// On AlignedStreets, padding is inserted before a nonterminal so that its
+// bucket data starts on a cache line (see NodePadding()).
 unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node,
 			     unsigned short last_bet_to,
 			     unsigned long long int ***offsets) {
@@ -1963,8 +2176,8 @@ unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node,
   }
 
   for (unsigned int s = 0; s < num_succs; ++s) {
-    unsigned long long int ull_offset = ptr1 - data_;
     Node *succ = node->IthSucc(s);
+    unsigned long long int ull_offset = ptr1 - data_;
     if (! succ->Terminal()) {
       unsigned int succ_st = succ->Street();
       unsigned int succ_pa = succ->PlayerActing();
@@ -1989,6 +2202,8 @@ unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node,
 	*((unsigned long long int *)(succ_ptr + s * 8)) = succ_offset;
 	continue;
       } else {
+	ptr1 += NodePadding(ptr1 - data_alloc_, succ);
+	ull_offset = ptr1 - data_;
 	offsets[succ_st][succ_pa][succ_nt] = ull_offset;
       }
     }
@@ -2003,6 +2218,23 @@ unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node,
   return ptr1;
 }
 
+// Returns the number of bytes of padding to put in front of node, if it is
+// placed at byte position pos of the allocation, so that its bucket data
+// starts on a cache line.  Only done on AlignedStreets, which should be the
+// small, frequently visited streets (e.g., preflop and flop); the padding
+// would be wasted on the river where almost every visit is a cache miss
+// anyway.
+unsigned int TCFR::NodePadding(unsigned long long int pos, Node *node) const {
+  if (node->Terminal()) return 0;
+  unsigned int num_succs = node->NumSuccs();
+  if (num_succs <= 1 || ! aligned_streets_[node->Street()]) return 0;
+  unsigned long long int bucket_pos = pos + 8 + num_succs * 8;
+  return (kCacheLineSize - bucket_pos % kCacheLineSize) % kCacheLineSize;
+}
+
+// allocation_size is also the position at which the next node will be
+// placed, which lets us compute alignment padding.  Nodes are visited in the
+// same order as in Prepare().
 void TCFR::MeasureTree(Node *node, bool ***seen,
 		       unsigned long long int *allocation_size) {
   if (node->Terminal()) {
@@ -2017,6 +2249,7 @@ void TCFR::MeasureTree(Node *node, bool ***seen,
     return;
   }
   seen[st][pa][nt] = true;
+  *allocation_size += NodePadding(*allocation_size, node);
   
   // This is the number of bytes needed for everything else (e.g.,
   // num-succs).
@@ -2053,6 +2286,51 @@ void TCFR::MeasureTree(Node *node, bool ***seen,
   }
 }
 
+// The buffer is always at least cache line aligned.  With HugePages we
+// try for explicit 2 MB pages (MAP_HUGETLB) and fall back to asking for
+// transparent huge pages if none are reserved.  With hundreds of GB of
+// river data, TLB misses are a big part of the cost of Process().
+//
+// With BackgroundCheckpoints we go straight to transparent huge pages.
+// After the checkpoint fork(), each write by the parent copies a page, and
+// for explicit huge pages the copy must come from the hugetlb pool; if
+// the pool has no spare pages the process is killed with SIGBUS.
+void TCFR::AllocateData(unsigned long long int size) {
+  if (huge_pages_) {
+    data_alloc_size_ = (size + kHugePageSize - 1) / kHugePageSize *
+      kHugePageSize;
+    void *p = MAP_FAILED;
+    if (! background_checkpoints_) {
+      p = mmap(NULL, data_alloc_size_, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (p == MAP_FAILED) {
+      p = mmap(NULL, data_alloc_size_, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+	fprintf(stderr, "Could not allocate %llu bytes\n", data_alloc_size_);
+	exit(-1);
+      }
+      if (madvise(p, data_alloc_size_, MADV_HUGEPAGE) != 0) {
+	fprintf(stderr, "madvise(MADV_HUGEPAGE) failed; using normal pages\n");
+      } else {
+	fprintf(stderr, "Using transparent huge pages\n");
+      }
+    } else {
+      fprintf(stderr, "Using explicit huge pages\n");
+    }
+    data_alloc_ = (unsigned char *)p;
+  } else {
+    data_alloc_size_ = size;
+    void *p;
+    if (posix_memalign(&p, kCacheLineSize, size) != 0) {
+      fprintf(stderr, "Could not allocate\n");
+      exit(-1);
+    }
+    data_alloc_ = (unsigned char *)p;
+  }
+}
+
 // Allocate one contiguous block of memory that has successors, street,
 // num-succs, regrets, sum-probs, showdown/fold flag, pot-size/2.
 void TCFR::Prepare(void) {
@@ -2086,11 +2364,8 @@ void TCFR::Prepare(void) {
     exit(-1);
   }
   fprintf(stderr, "Allocation size: %llu\n", allocation_size);
-  data_ = new unsigned char[allocation_size];
-  if (data_ == NULL) {
-    fprintf(stderr, "Could not allocate\n");
-    exit(-1);
-  }
+  AllocateData(allocation_size);
+  data_ = data_alloc_ + NodePadding(0, betting_tree_->Root());
 
   unsigned long long int ***offsets =
     new unsigned long long int **[max_street + 1];
@@ -2106,7 +2381,7 @@ void TCFR::Prepare(void) {
   }
   unsigned char *end = Prepare(data_, betting_tree_->Root(), Game::BigBlind(),
 			       offsets);
-  unsigned long long int sz = end - data_;
+  unsigned long long int sz = end - data_alloc_;
   if (sz != allocation_size) {
     fprintf(stderr, "Didn't fill expected number of bytes: sz %llu as %llu\n",
 	    sz, allocation_size);
@@ -2153,6 +2428,11 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
 #ifdef SWITCH
   fprintf(stderr, "Switching the order of phases each iteration\n");
 #endif
+  if (cfr_config_.AtomicUpdates()) {
+    fprintf(stderr, "Atomic regret and sumprob updates\n");
+  } else {
+    fprintf(stderr, "Hogwild regret and sumprob updates\n");
+  }
   time_t start_t = time(NULL);
   asymmetric_ = betting_abstraction_.Asymmetric();
   boost_ = cfr_config_.Boost();
@@ -2193,6 +2473,15 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
   for (unsigned int st = 0; st <= max_street_; ++st) {
     short_quantized_streets_[st] = cfr_config_.ShortQuantizedStreet(st);
   }
+  aligned_streets_.reset(new bool[max_street_ + 1]);
+  for (unsigned int st = 0; st <= max_street_; ++st) {
+    aligned_streets_[st] = cfr_config_.AlignedStreet(st);
+  }
+  huge_pages_ = cfr_config_.HugePages();
+  pin_threads_ = cfr_config_.PinThreads();
+  background_checkpoints_ = cfr_config_.BackgroundCheckpoints();
+  checkpoint_pid_ = 0;
+  checkpoint_batch_base_ = 0;
 
   if (betting_abstraction_.Asymmetric()) {
     betting_tree_.reset(BettingTree::BuildAsymmetricTree(betting_abstraction_,
@@ -2235,7 +2524,14 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
   BoardTree::DeleteBoardCounts();
 #endif
 
+  // The buffer is first touched in Prepare(), so that is where its pages
+  // get placed.
+  if (cfr_config_.NUMAInterleave()) InterleaveAllocations(true);
   Prepare();
+  if (cfr_config_.NUMAInterleave()) InterleaveAllocations(false);
+  total_sumprob_updates_ = 0ULL;
+  total_iterations_ = 0ULL;
+  checkpoints_ = true;
 
   rngs_ = new float[kNumPregenRNGs];
   uncompress_ = new unsigned int[256];
@@ -2312,6 +2608,7 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
 }
 
 TCFR::~TCFR(void) {
+  WaitForCheckpoint();
   if (cards_to_indices_) {
     for (unsigned int st = 0; st <= max_street_; ++st) {
       unsigned int num_boards = BoardTree::NumBoards(st);
@@ -2327,7 +2624,8 @@ TCFR::~TCFR(void) {
   delete [] uncompress_;
   delete [] short_uncompress_;
   delete [] rngs_;
-  delete [] data_;
+  if (huge_pages_) munmap(data_alloc_, data_alloc_size_);
+  else             free(data_alloc_);
   for (unsigned int p = 0; p < num_players_; ++p) {
     delete [] sumprob_streets_[p];
   }
@@ -1,6 +1,8 @@
 #ifndef _TCFR_H_
 #define _TCFR_H_
 
+#include <sys/types.h>
+
 #include <memory>
 
 #include "cfr.h"
@@ -23,6 +25,8 @@ class Writer;
 #define SUCCPTR(ptr) (ptr + 8)
 
 static const unsigned int kNumPregenRNGs = 10000000;
+static const unsigned int kCacheLineSize = 64;
+static const unsigned long long int kHugePageSize = 2097152ULL;
 
 class TCFRThread {
 public:
@@ -44,6 +48,10 @@ public:
   unsigned long long int FullProcessCount(void) const {
     return full_process_count_;
   }
+  unsigned long long int SumprobUpdates(void) const {
+    return sumprob_updates_;
+  }
+  unsigned long long int Iterations(void) const {return it_ - 1;}
  protected:
   static const unsigned int kStackDepth = 500;
   static const unsigned int kMaxSuccs = 50;
@@ -113,6 +121,11 @@ public:
   unsigned int **active_rems_;
   unsigned int batch_size_;
   unsigned long long int *total_its_;
+  bool atomic_updates_;
+  // Regrets read at the start of an update; only used if atomic_updates_
+  unique_ptr<T_REGRET []> regret_snapshot_;
+  unsigned long long int sumprob_updates_;
+  bool pin_threads_;
   struct drand48_data rand_buf_;
   // Keep this as a signed int so we can use it in winnings calculation
   // without casting.
@@ -133,6 +146,20 @@ public:
 	   unsigned int batch_size, unsigned int save_interval);
   // In extract_cvs
   void Extract(unsigned int it);
+  // Number of sumprob increments performed by all threads since
+  // construction.
+  unsigned long long int SumprobUpdates(void) const {
+    return total_sumprob_updates_;
+  }
+  // Sum of all sumprobs currently in the shared buffer.  Compared against
+  // SumprobUpdates() this measures updates lost to races (as long as no
+  // sumprob has hit its ceiling).
+  unsigned long long int SumprobTotal(void);
+  // Iterations performed by all threads since construction.
+  unsigned long long int Iterations(void) const {return total_iterations_;}
+  // If false, Run() never writes checkpoints, whatever the save interval.
+  // For benchmarks, which should not touch the CFR output directory.
+  void SetCheckpoints(bool b) {checkpoints_ = b;}
 private:
   void ReadCVs(unsigned char *ptr, Node *node, Reader ***readers,
 	       bool ***seen);
@@ -146,15 +173,30 @@ private:
 		    bool ***seen);
   void WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers,
 		     bool ***seen);
+  void SumSumprobs(unsigned char *ptr, Node *node, bool ***seen,
+		   unsigned long long int *total);
+  bool ***NewSeen(void) const;
+  void ClearSeen(bool ***seen) const;
+  void DeleteSeen(bool ***seen) const;
+  void ReadPlayerStreet(const char *dir, unsigned int batch_base,
+			unsigned int p, unsigned int st);
+  static void *ReadThread(void *v_args);
   void Read(unsigned int batch_base);
+  void WritePlayerStreet(const char *dir, unsigned int batch_base,
+			 unsigned int p, unsigned int st);
+  static void *WriteThread(void *v_args);
   void Write(unsigned int batch_base);
+  void Checkpoint(unsigned int batch_base);
+  void WaitForCheckpoint(void);
   void Run(void);
   void RunBatch(unsigned int batch_size);
   unsigned char *Prepare(unsigned char *ptr, Node *node,
 			 unsigned short last_bet_to,
 			 unsigned long long int ***offsets);
+  unsigned int NodePadding(unsigned long long int pos, Node *node) const;
   void MeasureTree(Node *node, bool ***seen,
 		   unsigned long long int *allocation_size);
+  void AllocateData(unsigned long long int size);
   void Prepare(void);
   // In extract_cvs
   void Walk(Node *node, unsigned char *ptr, string *action_sequences,
@@ -171,6 +213,17 @@ private:
   unsigned int num_players_;
   unsigned int target_player_;
   unsigned char *data_;
+  // data_ may start a little past the beginning of the allocation so that
+  // the root's bucket data is aligned.
+  unsigned char *data_alloc_;
+  unsigned long long int data_alloc_size_;
+  bool huge_pages_;
+  unique_ptr<bool []> aligned_streets_;
+  bool pin_threads_;
+  bool background_checkpoints_;
+  // Process writing the last checkpoint; 0 if none
+  pid_t checkpoint_pid_;
+  unsigned int checkpoint_batch_base_;
   unsigned int batch_base_;
   unsigned int num_cfr_threads_;
   TCFRThread **cfr_threads_;
@@ -189,6 +242,9 @@ private:
   unsigned long long int total_process_count_;
   unsigned long long int total_full_process_count_;
   unsigned long long int total_its_;
+  unsigned long long int total_sumprob_updates_;
+  unsigned long long int total_iterations_;
+  bool checkpoints_;
 };
 
 #endif
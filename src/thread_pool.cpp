@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+struct ThreadPoolArgs {
+  ThreadPool *pool;
+  unsigned int t;
+};
+
+static void *thread_pool_run(void *v_args) {
+  ThreadPoolArgs *args = (ThreadPoolArgs *)v_args;
+  ThreadPool *pool = args->pool;
+  unsigned int t = args->t;
+  delete args;
+  pool->Work(t);
+  return NULL;
+}
+
+// Creates num_threads - 1 threads; the thread calling Run() is the
+// remaining one.
+ThreadPool::ThreadPool(unsigned int num_threads) {
+  if (num_threads == 0) {
+    fprintf(stderr, "ThreadPool: need at least one thread\n");
+    exit(-1);
+  }
+  num_threads_ = num_threads;
+  generation_ = 0;
+  num_tasks_ = 0;
+  num_remaining_ = 0;
+  f_ = nullptr;
+  arg_ = nullptr;
+  quit_ = false;
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&start_cond_, NULL);
+  pthread_cond_init(&done_cond_, NULL);
+  pthread_ids_ = new pthread_t[num_threads_];
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    ThreadPoolArgs *args = new ThreadPoolArgs;
+    args->pool = this;
+    args->t = t;
+    pthread_create(&pthread_ids_[t], NULL, thread_pool_run, args);
+  }
+}
+
+ThreadPool::~ThreadPool(void) {
+  pthread_mutex_lock(&mutex_);
+  quit_ = true;
+  pthread_cond_broadcast(&start_cond_);
+  pthread_mutex_unlock(&mutex_);
+  for (unsigned int t = 1; t < num_threads_; ++t) {
+    pthread_join(pthread_ids_[t], NULL);
+  }
+  delete [] pthread_ids_;
+  pthread_cond_destroy(&done_cond_);
+  pthread_cond_destroy(&start_cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+// Main loop of pool thread t
+void ThreadPool::Work(unsigned int t) {
+  unsigned long long int seen_generation = 0;
+  pthread_mutex_lock(&mutex_);
+  while (true) {
+    while (! quit_ && generation_ == seen_generation) {
+      pthread_cond_wait(&start_cond_, &mutex_);
+    }
+    if (quit_) break;
+    seen_generation = generation_;
+    if (t >= num_tasks_) continue;
+    void (*f)(void *, unsigned int) = f_;
+    void *arg = arg_;
+    pthread_mutex_unlock(&mutex_);
+    (*f)(arg, t);
+    pthread_mutex_lock(&mutex_);
+    if (--num_remaining_ == 0) pthread_cond_signal(&done_cond_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void ThreadPool::Run(unsigned int num_tasks, void (*f)(void *, unsigned int),
+		     void *arg) {
+  if (num_tasks > num_threads_) {
+    fprintf(stderr, "ThreadPool::Run: %u tasks but only %u threads\n",
+	    num_tasks, num_threads_);
+    exit(-1);
+  }
+  if (num_tasks == 0) return;
+  if (num_tasks > 1) {
+    pthread_mutex_lock(&mutex_);
+    f_ = f;
+    arg_ = arg;
+    num_tasks_ = num_tasks;
+    num_remaining_ = num_tasks - 1;
+    ++generation_;
+    pthread_cond_broadcast(&start_cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+  (*f)(arg, 0);
+  if (num_tasks > 1) {
+    pthread_mutex_lock(&mutex_);
+    while (num_remaining_ > 0) pthread_cond_wait(&done_cond_, &mutex_);
+    pthread_mutex_unlock(&mutex_);
+  }
+}
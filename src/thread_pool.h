@@ -0,0 +1,39 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+// A fixed set of threads that persist across calls to Run().  Meant for
+// code that repeatedly divides a short-lived job among threads (e.g.,
+// VCFR::Split() while resolving an endgame during a match) where creating
+// and joining threads each time would be a noticeable cost.
+//
+// Only one Run() may be in progress at a time.
+
+#include <pthread.h>
+
+class ThreadPool {
+ public:
+  ThreadPool(unsigned int num_threads);
+  ~ThreadPool(void);
+  // Calls f(arg, t) for t = 0...num_tasks-1.  Task 0 is executed in the
+  // calling thread and task t in the t'th pool thread.  Returns when all
+  // tasks are done.  num_tasks must be at most NumThreads().
+  void Run(unsigned int num_tasks, void (*f)(void *, unsigned int),
+	   void *arg);
+  unsigned int NumThreads(void) const {return num_threads_;}
+  void Work(unsigned int t);
+ private:
+  unsigned int num_threads_;
+  pthread_t *pthread_ids_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t start_cond_;
+  pthread_cond_t done_cond_;
+  // Incremented by Run() each time there is a new job
+  unsigned long long int generation_;
+  unsigned int num_tasks_;
+  unsigned int num_remaining_;
+  void (*f_)(void *, unsigned int);
+  void *arg_;
+  bool quit_;
+};
+
+#endif
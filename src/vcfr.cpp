@@ -22,6 +22,7 @@
 
 #include <algorithm>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -38,6 +39,7 @@
 #include "io.h"
 #include "rand.h"
 #include "split.h"
+#include "thread_pool.h"
 #include "vcfr.h"
 #include "vcfr_state.h"
 #include "vcfr_subgame.h"
@@ -206,24 +208,96 @@ void VCFR::UpdateRegretsBucketed(Node *node, unsigned int **street_buckets,
   }
 }
 
+// Unabstracted, float regrets
+// Like the double version, no rounding or scaling.  The update is computed in
+// double precision and only the stored regret is narrowed to a float.
+void VCFR::UpdateRegrets(Node *node, double *vals, double **succ_vals,
+			 float *regrets) {
+  unsigned int st = node->Street();
+  unsigned int num_succs = node->NumSuccs();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  
+  double floor = regret_floors_[st];
+  double ceiling = regret_ceilings_[st];
+  if (nn_regrets_) {
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      float *my_regrets = regrets + i * num_succs;
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	double newr = my_regrets[s] + succ_vals[s][i] - vals[i];
+	if (newr < floor) {
+	  my_regrets[s] = floor;
+	} else if (newr > ceiling) {
+	  my_regrets[s] = ceiling;
+	} else {
+	  my_regrets[s] = newr;
+	}
+      }
+    }
+  } else {
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      float *my_regrets = regrets + i * num_succs;
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	my_regrets[s] += succ_vals[s][i] - vals[i];
+      }
+    }
+  }
+}
+
+// Abstracted, float regrets
+// No flooring here.  Will be done later.
+void VCFR::UpdateRegretsBucketed(Node *node, unsigned int **street_buckets,
+				 double *vals, double **succ_vals,
+				 float *regrets) {
+  unsigned int st = node->Street();
+  unsigned int num_succs = node->NumSuccs();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  
+  double ceiling = regret_ceilings_[st];
+  if (nn_regrets_) {
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      unsigned int b = street_buckets[st][i];
+      float *my_regrets = regrets + b * num_succs;
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	double newr = my_regrets[s] + succ_vals[s][i] - vals[i];
+	if (newr > ceiling) {
+	  my_regrets[s] = ceiling;
+	} else {
+	  my_regrets[s] = newr;
+	}
+      }
+    }
+  } else {
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      unsigned int b = street_buckets[st][i];
+      float *my_regrets = regrets + b * num_succs;
+      for (unsigned int s = 0; s < num_succs; ++s) {
+	my_regrets[s] += succ_vals[s][i] - vals[i];
+      }
+    }
+  }
+}
+
 double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
   unsigned int st = node->Street();
   unsigned int pa = node->PlayerActing();
   unsigned int num_succs = node->NumSuccs();
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int nt = node->NonterminalID();
-  double *vals = nullptr;
-  double **succ_vals = new double *[num_succs];
+  Arena *arena = state.GetArena();
+  // Allocated before the frame so that it survives the return
+  double *vals = arena->AllocateDoubles(num_hole_card_pairs);
+  ArenaFrame frame(arena);
+  double **succ_vals = arena->AllocateDoublePtrs(num_succs);
   for (unsigned int s = 0; s < num_succs; ++s) {
     VCFRState succ_state(state, node, s);
     succ_vals[s] = Process(node->IthSucc(s), lbd, succ_state, st);
   }
   if (num_succs == 1) {
-    vals = succ_vals[0];
-    succ_vals[0] = nullptr;
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      vals[i] = succ_vals[0][i];
+    }
   } else {
     unsigned int **street_buckets = state.StreetBuckets();
-    vals = new double[num_hole_card_pairs];
     for (unsigned int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
     if (best_response_streets_[st]) {
       if (always_call_preflop_ && st == 0) {
@@ -232,7 +306,7 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	  vals[i] = succ_vals[csi][i];
 	}
       } else {
-	unique_ptr<unsigned int []> succ_counts(new unsigned int [num_succs]);
+	unsigned int *succ_counts = arena->AllocateUnsignedInts(num_succs);
 	for (unsigned int s = 0; s < num_succs; ++s) succ_counts[s] = 0;
 	for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
 	  double max_val = succ_vals[0][i];
@@ -270,6 +344,11 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	    regrets->Values(pa, st, nt, &i_all_regrets);
 	    UpdateRegretsBucketed(node, street_buckets, vals, succ_vals,
 				  i_all_regrets);
+	  } else if (regrets->Floats(pa, st)) {
+	    float *f_all_regrets;
+	    regrets->Values(pa, st, nt, &f_all_regrets);
+	    UpdateRegretsBucketed(node, street_buckets, vals, succ_vals,
+				  f_all_regrets);
 	  } else {
 	    double *d_all_regrets;
 	    regrets->Values(pa, st, nt, &d_all_regrets);
@@ -281,9 +360,10 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	// If we are doing a value calculation then we are not updating
 	// regrets so we do not need this separate copy of the current
 	// strategy as we do in CFR+ (see above).
-	double *current_probs = new double[num_succs];
+	double *current_probs = arena->AllocateDoubles(num_succs);
 	unsigned int default_succ_index = node->DefaultSuccIndex();
 	double *d_all_cs_vals = nullptr;
+	float *f_all_cs_vals = nullptr;
 	int *i_all_cs_vals = nullptr;
 	bool nonneg;
 	double explore;
@@ -291,6 +371,8 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	  // For example, when called from build_cbrs.
 	  if (sumprobs->Ints(pa, st)) {
 	    sumprobs->Values(pa, st, nt, &i_all_cs_vals);
+	  } else if (sumprobs->Floats(pa, st)) {
+	    sumprobs->Values(pa, st, nt, &f_all_cs_vals);
 	  } else {
 	    sumprobs->Values(pa, st, nt, &d_all_cs_vals);
 	  }
@@ -300,6 +382,8 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	} else {
 	  if (regrets->Ints(pa, st)) {
 	    regrets->Values(pa, st, nt, &i_all_cs_vals);
+	  } else if (regrets->Floats(pa, st)) {
+	    regrets->Values(pa, st, nt, &f_all_cs_vals);
 	  } else {
 	    regrets->Values(pa, st, nt, &d_all_cs_vals);
 	  }
@@ -307,7 +391,7 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	  explore = explore_;
 	}
 	unsigned int num_nonterminal_succs = 0;
-	bool *nonterminal_succs = new bool[num_succs];
+	bool *nonterminal_succs = arena->AllocateBools(num_succs);
 	for (unsigned int s = 0; s < num_succs; ++s) {
 	  if (node->IthSucc(s)->Terminal()) {
 	    nonterminal_succs[s] = false;
@@ -329,6 +413,18 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 		vals[i] += succ_vals[s][i] * current_probs[s];
 	      }
 	    }
+	  } else if (f_all_cs_vals) {
+	    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+	      unsigned int b = street_buckets[st][i];
+	      float *my_cs_vals = f_all_cs_vals + b * num_succs;
+	      RegretsToProbs(my_cs_vals, num_succs, nonneg, uniform_,
+			     default_succ_index, explore,
+			     num_nonterminal_succs, nonterminal_succs,
+			     current_probs);
+	      for (unsigned int s = 0; s < num_succs; ++s) {
+		vals[i] += succ_vals[s][i] * current_probs[s];
+	      }
+	    }
 	  } else {
 	    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
 	      unsigned int b = street_buckets[st][i];
@@ -359,6 +455,22 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	    if (! value_calculation_ && ! pre_phase_) {
 	      UpdateRegrets(node, vals, succ_vals, i_bd_cs_vals);
 	    }
+	  } else if (f_all_cs_vals) {
+	    float *f_bd_cs_vals =
+	      f_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
+	    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+	      float *my_cs_vals = f_bd_cs_vals + i * num_succs;
+	      RegretsToProbs(my_cs_vals, num_succs, nonneg, uniform_,
+			     default_succ_index, explore,
+			     num_nonterminal_succs, nonterminal_succs,
+			     current_probs);
+	      for (unsigned int s = 0; s < num_succs; ++s) {
+		vals[i] += succ_vals[s][i] * current_probs[s];
+	      }
+	    }
+	    if (! value_calculation_ && ! pre_phase_) {
+	      UpdateRegrets(node, vals, succ_vals, f_bd_cs_vals);
+	    }
 	  } else {
 	    double *d_bd_cs_vals =
 	      d_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
@@ -376,17 +488,10 @@ double *VCFR::OurChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	    }
 	  }
 	}
-	delete [] current_probs;
-	delete [] nonterminal_succs;
       }
     }
   }
 
-  for (unsigned int s = 0; s < num_succs; ++s) {
-    delete [] succ_vals[s];
-  }
-  delete [] succ_vals;
-
   return vals;
 }
 
@@ -403,10 +508,15 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
   if (num_hole_cards == 1) num_enc = max_card1;
   else                     num_enc = max_card1 * max_card1;
 
+  Arena *arena = state.GetArena();
+  // Allocated before the frame so that it survives the return
+  double *vals = arena->AllocateDoubles(num_hole_card_pairs);
+  for (unsigned int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+  ArenaFrame frame(arena);
   double *opp_probs = state.OppProbs();
-  double **succ_opp_probs = new double *[num_succs];
+  double **succ_opp_probs = arena->AllocateDoublePtrs(num_succs);
   if (num_succs == 1) {
-    succ_opp_probs[0] = new double[num_enc];
+    succ_opp_probs[0] = arena->AllocateDoubles(num_enc);
     for (unsigned int i = 0; i < num_enc; ++i) {
       succ_opp_probs[0][i] = opp_probs[i];
     }
@@ -416,13 +526,14 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
     unsigned int **street_buckets = state.StreetBuckets();
     unsigned int nt = node->NonterminalID();
     for (unsigned int s = 0; s < num_succs; ++s) {
-      succ_opp_probs[s] = new double[num_enc];
+      succ_opp_probs[s] = arena->AllocateDoubles(num_enc);
       for (unsigned int i = 0; i < num_enc; ++i) succ_opp_probs[s][i] = 0;
     }
 
     // The "all" values point to the values for all hands.
     double *d_all_current_probs = nullptr;
     double *d_all_cs_vals = nullptr;
+    float *f_all_cs_vals = nullptr;
     int *i_all_cs_vals = nullptr;
     unsigned char *c_all_cs_vals = nullptr;
 
@@ -460,6 +571,13 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 		    pa, st, nt);
 	    exit(-1);
 	  }
+	} else if (sumprobs->Floats(pa, st)) {
+	  sumprobs->Values(pa, st, nt, &f_all_cs_vals);
+	  if (f_all_cs_vals == nullptr) {
+	    fprintf(stderr, "No float sumprob cs vals???  pa %u st %u "
+		    "nt %u\n", pa, st, nt);
+	    exit(-1);
+	  }
 	} else {
 	  sumprobs->Values(pa, st, nt, &d_all_cs_vals);
 	  if (d_all_cs_vals == nullptr) {
@@ -487,6 +605,13 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 		    pa, st, nt);
 	    exit(-1);
 	  }
+	} else if (regrets->Floats(pa, st)) {
+	  regrets->Values(pa, st, nt, &f_all_cs_vals);
+	  if (f_all_cs_vals == nullptr) {
+	    fprintf(stderr, "No float regret cs vals???  pa %u st %u "
+		    "nt %u\n", pa, st, nt);
+	    exit(-1);
+	  }
 	} else {
 	  regrets->Values(pa, st, nt, &d_all_cs_vals);
 	  if (d_all_cs_vals == nullptr) {
@@ -500,6 +625,7 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 
     // The "all" values point to the values for all hands.
     double *d_all_sumprobs = nullptr;
+    float *f_all_sumprobs = nullptr;
     int *i_all_sumprobs = nullptr;
     // sumprobs->Players(pa) check is there because in asymmetric systems
     // (e.g., endgame solving with CFR-D method) we are only saving probs for
@@ -509,6 +635,8 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 	sumprobs->Players(pa)) {
       if (sumprobs->Ints(pa, st)) {
 	sumprobs->Values(pa, st, nt, &i_all_sumprobs);
+      } else if (sumprobs->Floats(pa, st)) {
+	sumprobs->Values(pa, st, nt, &f_all_sumprobs);
       } else {
 	sumprobs->Values(pa, st, nt, &d_all_sumprobs);
       }
@@ -516,20 +644,25 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 
     // These values will point to the values for the current board
     double *d_cs_vals = nullptr, *d_sumprobs = nullptr;
+    float *f_cs_vals = nullptr, *f_sumprobs = nullptr;
     int *i_cs_vals = nullptr, *i_sumprobs = nullptr;
     unsigned char *c_cs_vals = nullptr;
 
     if (bucketed) {
       i_cs_vals = i_all_cs_vals;
       d_cs_vals = d_all_cs_vals;
+      f_cs_vals = f_all_cs_vals;
       i_sumprobs = i_all_sumprobs;
       d_sumprobs = d_all_sumprobs;
+      f_sumprobs = f_all_sumprobs;
       c_cs_vals = c_all_cs_vals;
     } else {
       if (c_all_cs_vals) {
 	c_cs_vals = c_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
       } else if (i_all_cs_vals) {
 	i_cs_vals = i_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
+      } else if (f_all_cs_vals) {
+	f_cs_vals = f_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
       } else {
 	d_cs_vals = d_all_cs_vals + lbd * num_hole_card_pairs * num_succs;
       }
@@ -539,6 +672,9 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
       if (d_all_sumprobs) {
 	d_sumprobs = d_all_sumprobs + lbd * num_hole_card_pairs * num_succs;
       }
+      if (f_all_sumprobs) {
+	f_sumprobs = f_all_sumprobs + lbd * num_hole_card_pairs * num_succs;
+      }
     }
 
     bool nonneg;
@@ -560,6 +696,14 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 				soft_warmup_, hard_warmup_, update_sumprobs,
 				opp_probs, succ_opp_probs,
 				d_all_current_probs, d_sumprobs);
+      } else if (f_sumprobs) {
+	// Float sumprobs
+	bool update_sumprobs =
+	  ! (value_calculation_ || (hard_warmup_ > 0 && it_ <= hard_warmup_));
+	ProcessOppProbsBucketed(node, street_buckets, hands, nonneg, it_,
+				soft_warmup_, hard_warmup_, update_sumprobs,
+				opp_probs, succ_opp_probs,
+				d_all_current_probs, f_sumprobs);
       } else {
 	// Int sumprobs
 	bool update_sumprobs =
@@ -576,7 +720,15 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 			uniform_, explore, prob_method_, it_, opp_probs,
 			succ_opp_probs, c_cs_vals);
       } else if (i_cs_vals) {
-	if (d_sumprobs) {
+	if (f_sumprobs) {
+	  // Int regrets, float sumprobs
+	  bool update_sumprobs =
+	    ! (value_calculation_ || (hard_warmup_ > 0 && it_ <= hard_warmup_));
+	  ProcessOppProbs(node, hands, bucketed, street_buckets, nonneg,
+			  uniform_, explore, it_, soft_warmup_, hard_warmup_,
+			  update_sumprobs, opp_probs, succ_opp_probs,
+			  i_cs_vals, f_sumprobs);
+	} else if (d_sumprobs) {
 	  // Int regrets, double sumprobs
 	  bool update_sumprobs =
 	    ! (value_calculation_ || d_sumprobs == nullptr ||
@@ -595,6 +747,33 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
 			  hard_warmup_, update_sumprobs, sumprob_scaling_,
 			  opp_probs, succ_opp_probs, i_cs_vals, i_sumprobs);
 	}
+      } else if (f_cs_vals) {
+	if (f_sumprobs) {
+	  // Float regrets and sumprobs
+	  bool update_sumprobs =
+	    ! (value_calculation_ || (hard_warmup_ > 0 && it_ <= hard_warmup_));
+	  ProcessOppProbs(node, hands, bucketed, street_buckets, nonneg,
+			  uniform_, explore, it_, soft_warmup_, hard_warmup_,
+			  update_sumprobs, opp_probs, succ_opp_probs,
+			  f_cs_vals, f_sumprobs);
+	} else {
+	  // Float regrets, double sumprobs (mixed precision)
+	  bool update_sumprobs =
+	    ! (value_calculation_ || d_sumprobs == nullptr ||
+	       (hard_warmup_ > 0 && it_ <= hard_warmup_));
+	  ProcessOppProbs(node, hands, bucketed, street_buckets, nonneg,
+			  uniform_, explore, it_, soft_warmup_, hard_warmup_,
+			  update_sumprobs, opp_probs, succ_opp_probs,
+			  f_cs_vals, d_sumprobs);
+	}
+      } else if (f_sumprobs) {
+	// Double regrets, float sumprobs
+	bool update_sumprobs =
+	  ! (value_calculation_ || (hard_warmup_ > 0 && it_ <= hard_warmup_));
+	ProcessOppProbs(node, hands, bucketed, street_buckets, nonneg,
+			uniform_, explore, it_, soft_warmup_, hard_warmup_,
+			update_sumprobs, opp_probs, succ_opp_probs,
+			d_cs_vals, f_sumprobs);
       } else {
 	// Double regrets and sumprobs
 	bool update_sumprobs =
@@ -608,92 +787,74 @@ double *VCFR::OppChoice(Node *node, unsigned int lbd, const VCFRState &state) {
     }
   }
 
-  double *vals = nullptr;
   double succ_sum_opp_probs;
+  double *succ_total_card_probs = arena->AllocateDoubles(max_card1);
+  // If every succ is pruned, vals stays all zeroes.  This can happen if there
+  // were non-zero opp probs on the prior street, but the board cards just
+  // dealt blocked all the opponent hands with non-zero probability.
   for (unsigned int s = 0; s < num_succs; ++s) {
-    double *succ_total_card_probs = new double[max_card1];
     CommonBetResponseCalcs(st, hands, succ_opp_probs[s], &succ_sum_opp_probs,
 			   succ_total_card_probs);
     if (prune_ && succ_sum_opp_probs == 0) {
-      delete [] succ_total_card_probs;
       continue;
     }
     VCFRState succ_state(state, node, s, succ_opp_probs[s], succ_sum_opp_probs,
 			 succ_total_card_probs);
+    ArenaFrame succ_frame(arena);
     double *succ_vals = Process(node->IthSucc(s), lbd, succ_state, st);
-    if (vals == nullptr) {
-      vals = succ_vals;
-    } else {
-      for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
-	vals[i] += succ_vals[i];
-      }
-      delete [] succ_vals;
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      vals[i] += succ_vals[i];
     }
-    delete [] succ_total_card_probs;
   }
-  if (vals == nullptr) {
-    // This can happen if there were non-zero opp probs on the prior street,
-    // but the board cards just dealt blocked all the opponent hands with
-    // non-zero probability.
-    vals = new double[num_hole_card_pairs];
-    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
-  }
-  for (unsigned int s = 0; s < num_succs; ++s) {
-    delete [] succ_opp_probs[s];
-  }
-  delete [] succ_opp_probs;
 
   return vals;
 }
 
+// A contiguous range of boards [next_, end_) that remains to be processed by
+// one worker.  The owner takes boards from the front; idle workers steal the
+// back half.
+struct BoardRange {
+  unsigned int next_;
+  unsigned int end_;
+  pthread_mutex_t mutex_;
+};
+
 class VCFRThread {
 public:
   VCFRThread(VCFR *vcfr, unsigned int thread_index, unsigned int num_threads,
-	     Node *node, const string &action_sequence, double *opp_probs,
-	     const HandTree *hand_tree, unsigned int p, CFRValues *regrets,
-	     CFRValues *sumprobs, unsigned int *prev_canons);
-  ~VCFRThread(void);
+	     Node *node, const VCFRState &pred_state, BoardRange *ranges,
+	     unsigned int ngbd_begin, double **board_vals);
+  ~VCFRThread(void) {}
   void Run(void);
   void Join(void);
   void Go(void);
-  double *RetVals(void) const {return ret_vals_;}
 private:
+  bool NextBoard(unsigned int *ngbd);
+  bool Steal(void);
+
   VCFR *vcfr_;
   unsigned int thread_index_;
   unsigned int num_threads_;
   Node *node_;
-  const string &action_sequence_;
-  double *opp_probs_;
-  const HandTree *hand_tree_;
-  unsigned int p_;
-  CFRValues *regrets_;
-  CFRValues *sumprobs_;
-  unsigned int *prev_canons_;
-  double *ret_vals_;
+  const VCFRState &pred_state_;
+  BoardRange *ranges_;
+  unsigned int ngbd_begin_;
+  double **board_vals_;
   pthread_t pthread_id_;
 };
 
 VCFRThread::VCFRThread(VCFR *vcfr, unsigned int thread_index,
 		       unsigned int num_threads, Node *node,
-		       const string &action_sequence, double *opp_probs,
-		       const HandTree *hand_tree, unsigned int p,
-		       CFRValues *regrets, CFRValues *sumprobs,
-		       unsigned int *prev_canons) :
-  action_sequence_(action_sequence) {
+		       const VCFRState &pred_state, BoardRange *ranges,
+		       unsigned int ngbd_begin, double **board_vals) :
+  pred_state_(pred_state) {
   vcfr_ = vcfr;
   thread_index_ = thread_index;
   num_threads_ = num_threads;
   node_ = node;
-  opp_probs_ = opp_probs;
-  hand_tree_ = hand_tree;
-  p_ = p;
-  regrets_ = regrets;
-  sumprobs_ = sumprobs;
-  prev_canons_ = prev_canons;
-}
-
-VCFRThread::~VCFRThread(void) {
-  delete [] ret_vals_;
+  ranges_ = ranges;
+  ngbd_begin_ = ngbd_begin;
+  board_vals_ = board_vals;
 }
 
 static void *vcfr_thread_run(void *v_t) {
@@ -710,70 +871,159 @@ void VCFRThread::Join(void) {
   pthread_join(pthread_id_, NULL); 
 }
 
+// Take the next board from the front of our own range.
+bool VCFRThread::NextBoard(unsigned int *ngbd) {
+  BoardRange *range = &ranges_[thread_index_];
+  bool found = false;
+  pthread_mutex_lock(&range->mutex_);
+  if (range->next_ < range->end_) {
+    *ngbd = range->next_++;
+    found = true;
+  }
+  pthread_mutex_unlock(&range->mutex_);
+  return found;
+}
+
+// Our own range is exhausted.  Look for a victim with work remaining and
+// move the back half of its range into ours.  Returns false when there is
+// no work left anywhere.
+bool VCFRThread::Steal(void) {
+  for (unsigned int i = 1; i < num_threads_; ++i) {
+    BoardRange *victim = &ranges_[(thread_index_ + i) % num_threads_];
+    pthread_mutex_lock(&victim->mutex_);
+    if (victim->next_ >= victim->end_) {
+      pthread_mutex_unlock(&victim->mutex_);
+      continue;
+    }
+    unsigned int num_left = victim->end_ - victim->next_;
+    unsigned int mid = victim->end_ - (num_left + 1) / 2;
+    unsigned int end = victim->end_;
+    victim->end_ = mid;
+    pthread_mutex_unlock(&victim->mutex_);
+    BoardRange *range = &ranges_[thread_index_];
+    pthread_mutex_lock(&range->mutex_);
+    range->next_ = mid;
+    range->end_ = end;
+    pthread_mutex_unlock(&range->mutex_);
+    return true;
+  }
+  return false;
+}
+
+// Each board's values are stored separately in board_vals_ so that the
+// reduction in VCFR::Split() can be done in board order no matter which
+// thread processed which board.
 void VCFRThread::Go(void) {
-  unsigned int st = node_->Street();
-  unsigned int pst = node_->Street() - 1;
-  unsigned int num_boards = BoardTree::NumBoards(st);
-  unsigned int num_prev_hole_card_pairs = Game::NumHoleCardPairs(pst);
-  Card max_card1 = Game::MaxCard() + 1;
-  ret_vals_ = new double[num_prev_hole_card_pairs];
-  for (unsigned int i = 0; i < num_prev_hole_card_pairs; ++i) ret_vals_[i] = 0;
-  for (unsigned int bd = thread_index_; bd < num_boards; bd += num_threads_) {
-    unsigned int **street_buckets = AllocateStreetBuckets();
-    VCFRState state(opp_probs_, hand_tree_, bd, action_sequence_, 0, 0,
-		    street_buckets, p_, regrets_, sumprobs_);
+  unsigned int nst = node_->Street();
+  unsigned int root_bd = pred_state_.RootBd();
+  unsigned int root_bd_st = pred_state_.RootBdSt();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(nst);
+  unsigned int **street_buckets = AllocateStreetBuckets();
+  while (true) {
+    unsigned int ngbd;
+    if (! NextBoard(&ngbd)) {
+      if (! Steal()) break;
+      continue;
+    }
+    unsigned int nlbd = BoardTree::LocalIndex(root_bd_st, root_bd, nst, ngbd);
+    VCFRState state(pred_state_.OppProbs(), pred_state_.GetHandTree(), nlbd,
+		    pred_state_.ActionSequence(), root_bd, root_bd_st,
+		    street_buckets, pred_state_.P(), pred_state_.Regrets(),
+		    pred_state_.Sumprobs());
     // Initialize buckets for this street
-    vcfr_->SetStreetBuckets(st, bd, state);
-    double *bd_vals = vcfr_->Process(node_, bd, state, st);
-    const CanonicalCards *hands = hand_tree_->Hands(st, bd);
-    unsigned int board_variants = BoardTree::NumVariants(st, bd);
-    unsigned int num_hands = hands->NumRaw();
-    for (unsigned int h = 0; h < num_hands; ++h) {
-      const Card *cards = hands->Cards(h);
-      Card hi = cards[0];
-      Card lo = cards[1];
-      unsigned int enc = hi * max_card1 + lo;
-      unsigned int prev_canon = prev_canons_[enc];
-      ret_vals_[prev_canon] += board_variants * bd_vals[h];
+    vcfr_->SetStreetBuckets(nst, ngbd, state);
+    ArenaFrame frame(state.GetArena());
+    double *vals = vcfr_->Process(node_, nlbd, state, nst);
+    double *bd_vals = board_vals_[ngbd - ngbd_begin_];
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      bd_vals[i] = vals[i];
     }
-    delete [] bd_vals;
-    DeleteStreetBuckets(street_buckets);
   }
+  DeleteStreetBuckets(street_buckets);
+}
+
+// Task t of a ThreadPool job; arg is the array of VCFRThread pointers.
+static void vcfr_thread_go(void *arg, unsigned int t) {
+  VCFRThread **threads = (VCFRThread **)arg;
+  threads[t]->Go();
 }
 
-// Divide work at a street-initial node between multiple threads.  Spawns
-// the threads, joins them, aggregates the resulting CVs.
-// Only support splitting on the flop for now.
+// Divide work at a street-initial node between multiple threads.  The
+// successor boards are initially partitioned into one contiguous range per
+// thread; a thread that finishes its range early steals from the others so
+// that a few expensive boards do not leave most of the threads idle.  Once
+// all threads are joined, the per-board CVs are aggregated in board order
+// so that the results do not depend on the number of threads or on the
+// schedule.
 // Ugly that we pass prev_canons in.
-void VCFR::Split(Node *node, double *opp_probs, const HandTree *hand_tree,
-		 unsigned int p, CFRValues *regrets, CFRValues *sumprobs,
-		 const string &action_sequence, unsigned int *prev_canons,
-		 double *vals) {
+void VCFR::Split(Node *node, unsigned int plbd, const VCFRState &state,
+		 unsigned int *prev_canons, double *vals) {
   unsigned int nst = node->Street();
   unsigned int pst = nst - 1;
   unsigned int prev_num_hole_card_pairs = Game::NumHoleCardPairs(pst);
   for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
-  unique_ptr<VCFRThread * []> threads(new VCFRThread *[num_threads_]);
-  for (unsigned int t = 0; t < num_threads_; ++t) {
-    threads[t] = new VCFRThread(this, t, num_threads_, node, action_sequence,
-				opp_probs, hand_tree, p, regrets, sumprobs,
-				prev_canons);
+  unsigned int root_bd = state.RootBd();
+  unsigned int root_bd_st = state.RootBdSt();
+  unsigned int pgbd = BoardTree::GlobalIndex(root_bd_st, root_bd, pst, plbd);
+  unsigned int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
+  unsigned int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+  unsigned int num_boards = ngbd_end - ngbd_begin;
+  unsigned int num_threads = num_threads_;
+  if (num_boards < num_threads) num_threads = num_boards;
+  // Each thread walks boards with its own arena, so the per-board values are
+  // copied into space taken from the caller's arena.
+  Arena *arena = state.GetArena();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(nst);
+  double **board_vals = arena->AllocateDoublePtrs(num_boards);
+  double *all_board_vals =
+    arena->AllocateDoubles(num_boards * num_hole_card_pairs);
+  for (unsigned int b = 0; b < num_boards; ++b) {
+    board_vals[b] = all_board_vals + b * num_hole_card_pairs;
   }
-  for (unsigned int t = 1; t < num_threads_; ++t) {
-    threads[t]->Run();
+  unique_ptr<BoardRange []> ranges(new BoardRange[num_threads]);
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    ranges[t].next_ = ngbd_begin + (t * num_boards) / num_threads;
+    ranges[t].end_ = ngbd_begin + ((t + 1) * num_boards) / num_threads;
+    pthread_mutex_init(&ranges[t].mutex_, NULL);
   }
-  // Do first thread in main thread
-  threads[0]->Go();
-  for (unsigned int t = 1; t < num_threads_; ++t) {
-    threads[t]->Join();
+  unique_ptr<VCFRThread * []> threads(new VCFRThread *[num_threads]);
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    threads[t] = new VCFRThread(this, t, num_threads, node, state,
+				ranges.get(), ngbd_begin, board_vals);
   }
-  for (unsigned int t = 0; t < num_threads_; ++t) {
-    double *t_vals = threads[t]->RetVals();
-    for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) {
-      vals[i] += t_vals[i];
+  if (pool_) {
+    pool_->Run(num_threads, vcfr_thread_go, threads.get());
+  } else {
+    for (unsigned int t = 1; t < num_threads; ++t) {
+      threads[t]->Run();
     }
+    // Do first thread in main thread
+    threads[0]->Go();
+    for (unsigned int t = 1; t < num_threads; ++t) {
+      threads[t]->Join();
+    }
+  }
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    pthread_mutex_destroy(&ranges[t].mutex_);
     delete threads[t];
   }
+  const HandTree *hand_tree = state.GetHandTree();
+  Card max_card1 = Game::MaxCard() + 1;
+  for (unsigned int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+    unsigned int nlbd = BoardTree::LocalIndex(root_bd_st, root_bd, nst, ngbd);
+    const CanonicalCards *hands = hand_tree->Hands(nst, nlbd);
+    double *bd_vals = board_vals[ngbd - ngbd_begin];
+    unsigned int board_variants = BoardTree::NumVariants(nst, ngbd);
+    unsigned int num_hands = hands->NumRaw();
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      const Card *cards = hands->Cards(h);
+      Card hi = cards[0];
+      Card lo = cards[1];
+      unsigned int enc = hi * max_card1 + lo;
+      unsigned int prev_canon = prev_canons[enc];
+      vals[prev_canon] += board_variants * bd_vals[h];
+    }
+  }
 }
 
 void VCFR::SetStreetBuckets(unsigned int st, unsigned int gbd,
@@ -793,20 +1043,23 @@ void VCFR::SetStreetBuckets(unsigned int st, unsigned int gbd,
   unsigned int max_street = Game::MaxStreet();
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int **street_buckets = state.StreetBuckets();
+  if (st < max_street) {
+    buckets_.BoardBuckets(st, gbd, street_buckets[st]);
+    return;
+  }
+  // Hands on final street were reordered by hand strength, but bucket
+  // lookup requires the unordered hole card pair index
+  Arena *arena = state.GetArena();
+  ArenaFrame frame(arena);
+  unsigned int *board_buckets =
+    arena->AllocateUnsignedInts(num_hole_card_pairs);
+  buckets_.BoardBuckets(st, gbd, board_buckets);
   for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
-    unsigned int h;
-    if (st == max_street) {
-      // Hands on final street were reordered by hand strength, but
-      // bucket lookup requires the unordered hole card pair index
-      const Card *hole_cards = hands->Cards(i);
-      cards[0] = hole_cards[0];
-      cards[1] = hole_cards[1];
-      unsigned int hcp = HCPIndex(st, cards);
-      h = gbd * num_hole_card_pairs + hcp;
-    } else {
-      h = gbd * num_hole_card_pairs + i;
-    }
-    street_buckets[st][i] = buckets_.Bucket(st, h);
+    const Card *hole_cards = hands->Cards(i);
+    cards[0] = hole_cards[0];
+    cards[1] = hole_cards[1];
+    unsigned int hcp = HCPIndex(st, cards);
+    street_buckets[st][i] = board_buckets[hcp];
   }
 }
 
@@ -815,12 +1068,14 @@ double *VCFR::StreetInitial(Node *node, unsigned int plbd,
   unsigned int nst = node->Street();
   unsigned int pst = nst - 1;
   unsigned int prev_num_hole_card_pairs = Game::NumHoleCardPairs(pst);
+  Arena *arena = state.GetArena();
+  // Allocated before the frame so that it survives the return
+  double *vals = arena->AllocateDoubles(prev_num_hole_card_pairs);
   if (nst == subgame_street_ && ! subgame_) {
     if (pre_phase_) {
       SpawnSubgame(node, plbd, state.P(), state.ActionSequence(),
 		   state.OppProbs());
       // Code expects values to be returned so we return all zeroes
-      double *vals = new double[prev_num_hole_card_pairs];
       for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
       return vals;
     } else {
@@ -832,39 +1087,25 @@ double *VCFR::StreetInitial(Node *node, unsigned int plbd,
 	exit(-1);
       }
       final_vals_[p][nt][plbd] = nullptr;
-      return final_vals;
+      for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) {
+	vals[i] = final_vals[i];
+      }
+      delete [] final_vals;
+      return vals;
     }
   }
   const HandTree *hand_tree = state.GetHandTree();
   const CanonicalCards *pred_hands = hand_tree->Hands(pst, plbd);
   Card max_card = Game::MaxCard();
   unsigned int num_encodings = (max_card + 1) * (max_card + 1);
-  unsigned int *prev_canons = new unsigned int[num_encodings];
-  double *vals = new double[prev_num_hole_card_pairs];
+  ArenaFrame frame(arena);
+  unsigned int *prev_canons = arena->AllocateUnsignedInts(num_encodings);
   for (unsigned int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
-  for (unsigned int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) > 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      unsigned int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      prev_canons[prev_encoding] = ph;
-    }
-  }
-  for (unsigned int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) == 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      unsigned int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      unsigned int pc = prev_canons[pred_hands->Canon(ph)];
-      prev_canons[prev_encoding] = pc;
-    }
-  }
+  pred_hands->CanonIndices(prev_canons);
 
-  if (nst == 1 && subgame_street_ == kMaxUInt && num_threads_ > 1) {
-    // Currently only flop supported
-    Split(node, state.OppProbs(), state.GetHandTree(), state.P(),
-	  state.Regrets(), state.Sumprobs(), state.ActionSequence(),
-	  prev_canons, vals);
+  if (nst == split_street_ && subgame_street_ == kMaxUInt &&
+      num_threads_ > 1) {
+    Split(node, plbd, state, prev_canons, vals);
   } else {
     unsigned int pgbd = BoardTree::GlobalIndex(state.RootBdSt(),
 					       state.RootBd(), pst, plbd);
@@ -880,6 +1121,7 @@ double *VCFR::StreetInitial(Node *node, unsigned int plbd,
       // I can pass unset values for sum_opp_probs and total_card_probs.  I
       // know I will come across an opp choice node before getting to a terminal
       // node.
+      ArenaFrame next_frame(arena);
       double *next_vals = Process(node, nlbd, state, nst);
 
       unsigned int board_variants = BoardTree::NumVariants(nst, ngbd);
@@ -892,7 +1134,6 @@ double *VCFR::StreetInitial(Node *node, unsigned int plbd,
 	unsigned int prev_canon = prev_canons[encoding];
 	vals[prev_canon] += board_variants * next_vals[nh];
       }
-      delete [] next_vals;
     }
   }
   // Scale down the values of the previous-street canonical hands
@@ -911,7 +1152,6 @@ double *VCFR::StreetInitial(Node *node, unsigned int plbd,
     }
   }
 
-  delete [] prev_canons;
   return vals;
 }
 
@@ -1053,15 +1293,16 @@ double *VCFR::Process(Node *node, unsigned int lbd, const VCFRState &state,
 		      unsigned int last_st) {
   unsigned int st = node->Street();
   if (node->Terminal()) {
+    const CanonicalCards *hands = state.GetHandTree()->Hands(st, lbd);
+    double *vals = state.GetArena()->AllocateDoubles(hands->NumRaw());
     if (node->NumRemaining() == 1) {
-      return Fold(node, state.P(), state.GetHandTree()->Hands(st, lbd),
-		  state.OppProbs(), state.SumOppProbs(),
-		  state.TotalCardProbs());
+      Fold(node, state.P(), hands, state.OppProbs(), state.SumOppProbs(),
+	   state.TotalCardProbs(), vals);
     } else {
-      return Showdown(node, state.GetHandTree()->Hands(st, lbd),
-		      state.OppProbs(), state.SumOppProbs(),
-		      state.TotalCardProbs());
+      Showdown(node, hands, state.OppProbs(), state.SumOppProbs(),
+	       state.TotalCardProbs(), vals);
     }
+    return vals;
   }
   if (st > last_st) {
     return StreetInitial(node, lbd, state);
@@ -1102,6 +1343,7 @@ void VCFR::SetCurrentStrategy(Node *node, CFRValues *regrets,
     double *d_all_current_strategy;
     current_strategy_->Values(p, st, nt, &d_all_current_strategy);
     double *d_all_cs_vals = nullptr;
+    float *f_all_cs_vals = nullptr;
     int *i_all_cs_vals = nullptr;
     bool nonneg;
     double explore;
@@ -1109,6 +1351,8 @@ void VCFR::SetCurrentStrategy(Node *node, CFRValues *regrets,
       // Use average strategy for the "cs vals"
       if (sumprobs->Ints(p, st)) {
 	sumprobs->Values(p, st, nt, &i_all_cs_vals);
+      } else if (sumprobs->Floats(p, st)) {
+	sumprobs->Values(p, st, nt, &f_all_cs_vals);
       } else {
 	sumprobs->Values(p, st, nt, &d_all_cs_vals);
       }
@@ -1118,6 +1362,8 @@ void VCFR::SetCurrentStrategy(Node *node, CFRValues *regrets,
       // Use regrets for the "cs vals"
       if (regrets->Ints(p, st)) {
 	regrets->Values(p, st, nt, &i_all_cs_vals);
+      } else if (regrets->Floats(p, st)) {
+	regrets->Values(p, st, nt, &f_all_cs_vals);
       } else {
 	regrets->Values(p, st, nt, &d_all_cs_vals);
       }
@@ -1132,6 +1378,14 @@ void VCFR::SetCurrentStrategy(Node *node, CFRValues *regrets,
 		       explore, num_nonterminal_succs, nonterminal_succs,
 		       probs);
       }
+    } else if (f_all_cs_vals) {
+      for (unsigned int b = 0; b < num_buckets; ++b) {
+	float *cs_vals = f_all_cs_vals + b * num_succs;
+	double *probs = d_all_current_strategy + b * num_succs;
+	RegretsToProbs(cs_vals, num_succs, nonneg, uniform_, default_succ_index,
+		       explore, num_nonterminal_succs, nonterminal_succs,
+		       probs);
+      }
     } else {
       for (unsigned int b = 0; b < num_buckets; ++b) {
 	double *cs_vals = d_all_cs_vals + b * num_succs;
@@ -1161,9 +1415,11 @@ VCFR::VCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
   card_abstraction_(ca), betting_abstraction_(ba), cfr_config_(cc),
   buckets_(buckets), betting_tree_(betting_tree) {
   num_threads_ = num_threads;
+  pool_ = nullptr;
   target_p_ = kMaxUInt; // Should set this somehow
   num_players_ = Game::NumPlayers();
   subgame_street_ = cfr_config_.SubgameStreet();
+  split_street_ = cfr_config_.SplitStreet();
   nn_regrets_ = cfr_config_.NNR();
   uniform_ = cfr_config_.Uniform();
   soft_warmup_ = cfr_config_.SoftWarmup();
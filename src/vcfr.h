@@ -20,6 +20,7 @@ class CFRConfig;
 class CFRValues;
 class HandTree;
 class Node;
+class ThreadPool;
 class VCFRState;
 class VCFRSubgame;
 
@@ -29,6 +30,10 @@ class VCFR {
        const CFRConfig &cc, const Buckets &buckets,
        const BettingTree *betting_tree, unsigned int num_threads);
   virtual ~VCFR(void);
+  // Returns the values of our hands at node.  Like those returned by
+  // OurChoice(), OppChoice() and StreetInitial(), the values are allocated
+  // from the state's arena in the caller's frame, so the caller must not
+  // delete[] them; they are released along with that frame.
   virtual double *Process(Node *node, unsigned int lbd, const VCFRState &state,
 			  unsigned int last_st);
   virtual void SetStreetBuckets(unsigned int st, unsigned int gbd,
@@ -39,6 +44,9 @@ class VCFR {
   void SetBestResponseStreets(bool *sts);
   void SetBRCurrent(bool b) {br_current_ = b;}
   void SetValueCalculation(bool b) {value_calculation_ = b;}
+  // Split() runs its threads in the given pool rather than creating them
+  // each time.  The pool must have at least num_threads threads.
+  void SetThreadPool(ThreadPool *pool) {pool_ = pool;}
   virtual void Post(unsigned int t);
   const Buckets &GetBuckets(void) const {return buckets_;}
  protected:
@@ -54,14 +62,17 @@ class VCFR {
   virtual void UpdateRegretsBucketed(Node *node, unsigned int **street_buckets,
 				     double *vals, double **succ_vals,
 				     double *regrets);
+  virtual void UpdateRegrets(Node *node, double *vals, double **succ_vals,
+			     float *regrets);
+  virtual void UpdateRegretsBucketed(Node *node, unsigned int **street_buckets,
+				     double *vals, double **succ_vals,
+				     float *regrets);
   virtual double *OurChoice(Node *node, unsigned int lbd,
 			    const VCFRState &state);
   virtual double *OppChoice(Node *node, unsigned int lbd, 
 			    const VCFRState &state);
-  virtual void Split(Node *node, double *opp_probs, const HandTree *hand_tree,
-		     unsigned int p, CFRValues *regrets, CFRValues *sumprobs,
-		     const string &action_sequence, unsigned int *prev_canons,
-		     double *vals);
+  virtual void Split(Node *node, unsigned int plbd, const VCFRState &state,
+		     unsigned int *prev_canons, double *vals);
   virtual double *StreetInitial(Node *node, unsigned int lbd,
 				const VCFRState &state);
   virtual void WaitForFinalSubgames(void);
@@ -114,6 +125,7 @@ class VCFR {
   VCFRSubgame **active_subgames_;
   sem_t available_;
   unsigned int num_threads_;
+  ThreadPool *pool_;
 };
 
 void DeleteOldFiles(const CardAbstraction &ca, const BettingAbstraction &ba,
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "betting_tree.h"
 #include "cfr_utils.h"
 #include "game.h"
@@ -56,6 +57,7 @@ VCFRState::VCFRState(double *opp_probs, unsigned int **street_buckets,
   p_ = p;
   regrets_ = regrets;
   sumprobs_ = sumprobs;
+  arena_ = Arena::ThreadArena();
   root_bd_ = 0;
   root_bd_st_ = 0;
   unsigned int max_card1 = Game::MaxCard() + 1;
@@ -85,6 +87,7 @@ VCFRState::VCFRState(double *opp_probs, const HandTree *hand_tree,
   p_ = p;
   regrets_ = regrets;
   sumprobs_ = sumprobs;
+  arena_ = Arena::ThreadArena();
 #if 0
   // Temporary below
   unsigned int max_card1 = Game::MaxCard() + 1;
@@ -116,6 +119,7 @@ VCFRState::VCFRState(double *opp_probs, double *total_card_probs,
   p_ = p;
   regrets_ = regrets;
   sumprobs_ = sumprobs;
+  arena_ = Arena::ThreadArena();
   const CanonicalCards *hands = hand_tree_->Hands(st, lbd);
   CommonBetResponseCalcs(root_bd_st_, hands, opp_probs_, &sum_opp_probs_,
 			 total_card_probs_);
@@ -134,6 +138,7 @@ VCFRState::VCFRState(const VCFRState &pred, Node *node, unsigned int s) {
   p_ = pred.P();
   regrets_ = pred.Regrets();
   sumprobs_ = pred.Sumprobs();
+  arena_ = pred.GetArena();
 }
 
 // Create a new VCFRState corresponding to taking an opponent action.
@@ -151,6 +156,7 @@ VCFRState::VCFRState(const VCFRState &pred, Node *node, unsigned int s,
   p_ = pred.P();
   regrets_ = pred.Regrets();
   sumprobs_ = pred.Sumprobs();
+  arena_ = pred.GetArena();
 }
 
 // We don't own any of the arrays.  Caller must delete.
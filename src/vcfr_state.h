@@ -1,6 +1,7 @@
 #ifndef _VCFR_STATE_H_
 #define _VCFR_STATE_H_
 
+class Arena;
 class CFRValues;
 
 class VCFRState {
@@ -33,6 +34,7 @@ class VCFRState {
   CFRValues *Sumprobs(void) const {return sumprobs_;}
   unsigned int RootBd(void) const {return root_bd_;}
   unsigned int RootBdSt(void) const {return root_bd_st_;}
+  Arena *GetArena(void) const {return arena_;}
   void SetOppProbs(double *opp_probs) {opp_probs_ = opp_probs;}
   void SetP(unsigned int p) {p_ = p;}
  protected:
@@ -47,6 +49,8 @@ class VCFRState {
   unsigned int root_bd_st_;
   CFRValues *regrets_;
   CFRValues *sumprobs_;
+  // Scratch memory for the thread doing the walk
+  Arena *arena_;
 };
 
 unsigned int **AllocateStreetBuckets(void);
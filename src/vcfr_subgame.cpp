@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <vector>
 
+#include "arena.h"
 #include "betting_abstraction.h"
 #include "betting_tree.h"
 #include "board_tree.h"
@@ -235,7 +236,17 @@ void VCFRSubgame::Go(void) {
 		  root_bd_st_, street_buckets, p_, regrets_.get(),
 		  sumprobs_.get());
   SetStreetBuckets(root_bd_st_, root_bd_, state);
-  final_vals_ = Process(subtree_->Root(), 0, state, subtree_st - 1);
+  {
+    // The values returned by Process() live in this thread's arena, but
+    // final_vals_ is handed to the parent VCFR object.
+    ArenaFrame frame(state.GetArena());
+    double *vals = Process(subtree_->Root(), 0, state, subtree_st - 1);
+    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(subtree_st - 1);
+    final_vals_ = new double[num_hole_card_pairs];
+    for (unsigned int i = 0; i < num_hole_card_pairs; ++i) {
+      final_vals_[i] = vals[i];
+    }
+  }
   DeleteStreetBuckets(street_buckets);
 
 